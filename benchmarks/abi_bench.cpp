@@ -0,0 +1,135 @@
+// Cost of fusing through the C ABI versus the HTTP API.
+//
+//   abi_bench [calls]
+//
+// For several payload sizes, times tf_fuse from libtelemetry_fuser.so with a
+// reused workspace, tf_fuse_batch over 64 series per call, and the same
+// readings POSTed to /fuse on an in-process busy-poll HttpServer over one
+// loopback keep-alive connection. Prints p50 / p99 per call in microseconds
+// and the HTTP overhead as a multiple of the ABI call.
+#include "telemetry_fuser.h"
+#include "http_server.hpp"
+#include "service.hpp"
+#include "../third_party/simple_http.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using cpp_service::HttpServer;
+using cpp_service::Service;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<double> make_readings(size_t count) {
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(12.0, 0.2);
+    std::vector<double> readings(count);
+    for (double& reading : readings) reading = noise(rng);
+    return readings;
+}
+
+std::string make_body(const std::vector<double>& readings) {
+    std::string body = "{\"readings\": [";
+    for (size_t i = 0; i < readings.size(); ++i) {
+        if (i > 0) body += ", ";
+        body += std::to_string(readings[i]);
+    }
+    return body + "]}";
+}
+
+// Sorted per-call latencies in nanoseconds after a warm-up
+template <typename Call>
+std::vector<double> time_calls(size_t calls, Call call) {
+    for (size_t i = 0; i < std::min<size_t>(calls / 10 + 1, 1000); ++i) call();
+    std::vector<double> samples;
+    samples.reserve(calls);
+    for (size_t i = 0; i < calls; ++i) {
+        auto start = Clock::now();
+        call();
+        samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+double percentile_us(const std::vector<double>& sorted_ns, double p) {
+    return sorted_ns[static_cast<size_t>(p * static_cast<double>(sorted_ns.size() - 1))] / 1000.0;
+}
+
+void fail(const char* what) {
+    std::fprintf(stderr, "%s failed: %s\n", what, tf_last_error());
+    std::exit(1);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t calls = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+    calls = std::max<size_t>(calls, 100);
+    const size_t sizes[] = {8, 64, 1024};
+    const size_t batch = 64;
+
+    tf_service* fuser = tf_service_create();
+    tf_workspace* workspace = tf_workspace_create();
+    if (!fuser || !workspace) fail("setup");
+
+    Service service;
+    HttpServer server(0, &service);
+    HttpServer::BusyPollConfig busy_poll;
+    busy_poll.threads = 1;
+    server.set_busy_poll(busy_poll);
+    std::thread server_thread([&server]() { server.run(); });
+    while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    simple_http::Client client("127.0.0.1", server.bound_port());
+
+    std::printf("\nPer call, %zu calls, p50 / p99 in us\n", calls);
+    std::printf("  %-10s %20s %20s %20s %10s\n", "readings", "tf_fuse", "tf_fuse_batch/64", "HTTP /fuse",
+                "HTTP/ABI");
+    for (size_t size : sizes) {
+        std::vector<double> readings = make_readings(size);
+        tf_result result;
+        auto abi = time_calls(calls, [&]() {
+            if (tf_fuse(fuser, workspace, readings.data(), size, nullptr, nullptr, &result) != TF_OK) fail("tf_fuse");
+        });
+
+        std::vector<double> batched;
+        std::vector<size_t> offsets = {0};
+        for (size_t b = 0; b < batch; ++b) {
+            batched.insert(batched.end(), readings.begin(), readings.end());
+            offsets.push_back(batched.size());
+        }
+        std::vector<double> values(batch);
+        auto abi_batch = time_calls(std::max<size_t>(100, calls / batch), [&]() {
+            if (tf_fuse_batch(fuser, workspace, batched.data(), offsets.data(), batch, nullptr, nullptr,
+                              values.data(), values.size()) != TF_OK) {
+                fail("tf_fuse_batch");
+            }
+        });
+
+        std::string body = make_body(readings);
+        simple_http::Response response;
+        auto http = time_calls(calls, [&]() {
+            if (!client.request("POST", "/fuse", body, response) || response.status_code != 200) fail("POST /fuse");
+        });
+
+        std::printf("  %-10zu %9.2f / %8.2f %9.2f / %8.2f %9.1f / %8.1f %9.0fx\n", size,
+                    percentile_us(abi, 0.5), percentile_us(abi, 0.99),
+                    percentile_us(abi_batch, 0.5) / batch, percentile_us(abi_batch, 0.99) / batch,
+                    percentile_us(http, 0.5), percentile_us(http, 0.99),
+                    percentile_us(http, 0.5) / percentile_us(abi, 0.5));
+    }
+    std::printf("  (tf_fuse_batch columns are per series)\n");
+
+    server.stop();
+    server_thread.join();
+    tf_workspace_destroy(workspace);
+    tf_service_destroy(fuser);
+    return 0;
+}
@@ -0,0 +1,215 @@
+// Cost of reproducible summation versus plain double accumulation.
+//
+//   fusion_bench [elements] [repetitions]
+//   fusion_bench --cost-model [repetitions]
+//
+// Reports ns/element for the raw reductions, shows how a plain parallel sum
+// drifts with the thread count while the reproducible one does not, and
+// measures end-to-end Service::fuse_readings with the mode off and on and
+// with each fusion algorithm, plus the cost of bootstrap intervals.
+//
+// --cost-model times every estimator over a range of input sizes, fits
+// fixed_ns + per_item_ns * n by least squares and prints the result as a
+// config document, ready for POST /config (used by "algorithm": "auto").
+#include "reproducible_sum.hpp"
+#include "service.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using cpp_service::ReproducibleSum;
+using cpp_service::Service;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<double> make_readings(size_t count) {
+    std::mt19937_64 rng(1234);
+    std::normal_distribution<double> noise(0.0, 0.5);
+    std::uniform_int_distribution<int> exponent(-20, 20);
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; ++i) {
+        // Mostly sensor-like values with a spread of magnitudes mixed in
+        values[i] = (i % 16 == 0) ? std::ldexp(noise(rng), exponent(rng)) : 21.0 + noise(rng);
+    }
+    return values;
+}
+
+template <typename Fn>
+double best_ns(int repetitions, Fn fn) {
+    double best = 1e300;
+    for (int r = 0; r < repetitions; ++r) {
+        auto start = Clock::now();
+        fn();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+double naive_parallel(const std::vector<double>& values, unsigned threads) {
+    std::vector<double> partials(threads, 0.0);
+    std::vector<std::thread> workers;
+    size_t chunk = (values.size() + threads - 1) / threads;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            double sum = 0.0;
+            size_t end = std::min(values.size(), (t + 1) * chunk);
+            for (size_t i = t * chunk; i < end; ++i) sum += values[i];
+            partials[t] = sum;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    double total = 0.0;
+    for (double partial : partials) total += partial;
+    return total;
+}
+
+double reproducible_parallel(const std::vector<double>& values, unsigned threads) {
+    std::vector<ReproducibleSum> partials(threads);
+    std::vector<std::thread> workers;
+    size_t chunk = (values.size() + threads - 1) / threads;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            size_t begin = std::min(values.size(), t * chunk);
+            size_t end = std::min(values.size(), (t + 1) * chunk);
+            partials[t].add(values.data() + begin, end - begin);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    ReproducibleSum total;
+    for (const auto& partial : partials) total.merge(partial);
+    return total.value();
+}
+
+uint64_t bits_of(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+int print_cost_model(int repetitions) {
+    const size_t sizes[] = {16, 64, 256, 1024, 4096, 16384};
+    std::vector<double> values = make_readings(16384);
+    Service service;
+    service.set_config("{\"enable_outlier_detection\": false}");
+
+    std::printf("{\n  \"cost_model\": {");
+    bool first = true;
+    for (auto algorithm : {Service::FusionAlgorithm::median, Service::FusionAlgorithm::trimmed_mean,
+                           Service::FusionAlgorithm::winsorized_mean, Service::FusionAlgorithm::huber,
+                           Service::FusionAlgorithm::weighted, Service::FusionAlgorithm::sketch}) {
+        Service::FusionOptions options;
+        options.algorithm = algorithm;
+
+        // Least squares over (n, ns per call), weighted by 1 / ns^2 so small
+        // sizes count as much as large ones (a relative-error fit)
+        double sum_w = 0.0, sum_n = 0.0, sum_t = 0.0, sum_nn = 0.0, sum_nt = 0.0;
+        for (size_t n : sizes) {
+            std::vector<double> request(values.begin(), values.begin() + n);
+            int calls = static_cast<int>(std::max<size_t>(20, 200000 / n));
+            volatile double sink = 0.0;
+            double ns = best_ns(repetitions, [&] {
+                for (int i = 0; i < calls; ++i) sink = service.fuse(request, {}, options).value;
+            }) / calls;
+            double w = 1.0 / (ns * ns);
+            sum_w += w;
+            sum_n += w * n;
+            sum_t += w * ns;
+            sum_nn += w * n * n;
+            sum_nt += w * n * ns;
+        }
+        double per_item = (sum_w * sum_nt - sum_n * sum_t) / (sum_w * sum_nn - sum_n * sum_n);
+        double fixed = (sum_t - per_item * sum_n) / sum_w;
+
+        std::printf("%s\n    \"%s\": {\"fixed_ns\": %.0f, \"per_item_ns\": %.2f}", first ? "" : ",",
+                    Service::algorithm_name(algorithm), std::max(0.0, fixed), std::max(0.0, per_item));
+        first = false;
+    }
+    std::printf("\n  }\n}\n");
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--cost-model") == 0) {
+        return print_cost_model(argc > 2 ? std::atoi(argv[2]) : 3);
+    }
+
+    size_t elements = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+    std::vector<double> values = make_readings(elements);
+
+    std::printf("Reduction over %zu elements (best of %d)\n", elements, repetitions);
+    volatile double sink = 0.0;
+    double naive_ns = best_ns(repetitions, [&] {
+        double sum = 0.0;
+        for (double v : values) sum += v;
+        sink = sum;
+    });
+    double exact_ns = best_ns(repetitions, [&] {
+        ReproducibleSum sum;
+        sum.add(values.data(), values.size());
+        sink = sum.value();
+    });
+    std::printf("  %-14s %8.3f ns/element\n", "naive", naive_ns / elements);
+    std::printf("  %-14s %8.3f ns/element  (%.1fx)\n", "reproducible", exact_ns / elements, exact_ns / naive_ns);
+
+    std::printf("\nParallel sums by thread count\n");
+    std::printf("  %-8s %-24s %-24s\n", "threads", "naive", "reproducible");
+    for (unsigned threads : {1u, 2u, 3u, 4u, 8u}) {
+        double naive = naive_parallel(values, threads);
+        double exact = reproducible_parallel(values, threads);
+        std::printf("  %-8u %.17g (%016" PRIx64 ")  %.17g (%016" PRIx64 ")\n",
+                    threads, naive, bits_of(naive), exact, bits_of(exact));
+    }
+
+    std::printf("\nService::fuse_readings, 64 readings per call\n");
+    std::vector<double> request(values.begin(), values.begin() + std::min<size_t>(64, values.size()));
+    const int calls = 20000;
+    for (bool reproducible : {false, true}) {
+        Service service;
+        service.set_config(reproducible ? "{\"reproducible_summation\": true}" : "{\"reproducible_summation\": false}");
+        double ns = best_ns(repetitions, [&] {
+            for (int i = 0; i < calls; ++i) sink = service.fuse_readings(request);
+        });
+        std::printf("  %-14s %8.1f ns/call\n", reproducible ? "reproducible" : "naive", ns / calls);
+    }
+
+    std::printf("\nService::fuse_readings by algorithm, 1024 readings per call\n");
+    std::vector<double> large(values.begin(), values.begin() + std::min<size_t>(1024, values.size()));
+    const int large_calls = 2000;
+    for (const char* algorithm : {"median", "trimmed_mean", "winsorized_mean", "huber", "weighted", "sketch"}) {
+        Service service;
+        service.set_config(std::string("{\"fusion_algorithm\": \"") + algorithm + "\"}");
+        double ns = best_ns(repetitions, [&] {
+            for (int i = 0; i < large_calls; ++i) sink = service.fuse_readings(large);
+        });
+        std::printf("  %-16s %8.1f ns/call\n", algorithm, ns / large_calls);
+    }
+
+    std::printf("\nBootstrap interval (median), 1000 resamples\n");
+    for (size_t n : {16u, 64u, 256u, 1024u}) {
+        std::vector<double> sample(values.begin(), values.begin() + std::min(n, values.size()));
+        Service service;
+        Service::FusionOptions options;
+        options.interval = true;
+        options.max_resamples = 1000;
+        options.deadline_ms = 1e6;  // pin the count so sizes are comparable
+        service.fuse(sample, {}, options);  // warm the pool and the index pattern
+        double ns = best_ns(repetitions, [&] { sink = service.fuse(sample, {}, options).interval_low; });
+        std::printf("  n=%-6zu %10.1f us/request\n", sample.size(), ns / 1000.0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,277 @@
+// Closed-loop HTTP load generator for /fuse latency.
+//
+//   http_loadgen [requests] [connections]
+//   http_loadgen --target HOST:PORT [requests] [connections] [readings | MIX]
+//   http_loadgen --mixed [requests]
+//
+// Without --target it starts the real HttpServer in-process three times -
+// blocking thread-per-connection, busy-poll run-to-completion, and busy-poll
+// feeding the staged fusion pipeline - drives each with the same clients at
+// several payload sizes and prints latency percentiles per mode and size,
+// plus a histogram at 64 readings. With --target it measures a running
+// cpp-service instead. --mixed measures 8-reading requests on one busy-poll
+// loop while another connection streams bulk uploads, with and without the
+// bulk lane. Each connection sends its requests back to back, so the numbers
+// are per-request round trips, not throughput limits.
+//
+// MIX is a payload mix such as 8:70,64:25,1024:5 (readings:weight, ...),
+// cycled in a fixed shuffled order so every run sends the same requests.
+// With --target the last line is a summary for scripts (see
+// tools/loadgen/scaling_sweep.py): requests, seconds, rps and p50/p99/p99.9
+// in microseconds; with enough connections to saturate the server, rps is
+// its throughput.
+#include "http_server.hpp"
+#include "service.hpp"
+#include "../third_party/simple_http.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using cpp_service::HttpServer;
+using cpp_service::Service;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string make_body(size_t readings) {
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(12.0, 0.2);
+    std::string body = "{\"readings\": [";
+    for (size_t i = 0; i < readings; ++i) {
+        if (i > 0) body += ", ";
+        body += std::to_string(noise(rng));
+    }
+    return body + "]}";
+}
+
+// Bodies for a mix like "8:70,64:25,1024:5" (or a single reading count),
+// one per unit of weight in a fixed shuffled order; empty if it does not parse
+std::vector<std::string> make_mix(const std::string& spec) {
+    std::vector<std::string> bodies;
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string item = spec.substr(start, end - start);
+        char* rest = nullptr;
+        unsigned long long readings = std::strtoull(item.c_str(), &rest, 10);
+        unsigned long long weight = 1;
+        if (*rest == ':') weight = std::strtoull(rest + 1, &rest, 10);
+        if (readings == 0 || weight == 0 || *rest != '\0') return {};
+        bodies.insert(bodies.end(), weight, make_body(readings));
+        start = end + 1;
+    }
+    std::shuffle(bodies.begin(), bodies.end(), std::mt19937(11));
+    return bodies;
+}
+
+// Round-trip latencies in nanoseconds, sorted. Connection c sends
+// bodies[(c + i) % size] as request i. `seconds` (if set) receives the wall
+// time of the measured requests, which all connections start together.
+std::vector<double> drive(const std::string& host, int port, const std::vector<std::string>& bodies,
+                          size_t requests, unsigned connections, double* seconds = nullptr) {
+    std::vector<std::vector<double>> samples(connections);
+    std::vector<std::thread> clients;
+    size_t per_connection = (requests + connections - 1) / connections;
+    std::atomic<unsigned> warm{0};
+    Clock::time_point measured_from;
+    for (unsigned c = 0; c < connections; ++c) {
+        clients.emplace_back([&, c]() {
+            simple_http::Client client(host, port);
+            simple_http::Response response;
+            for (size_t i = 0; i < 200; ++i) {
+                client.request("POST", "/fuse", bodies[(c + i) % bodies.size()], response);  // warm up
+            }
+            if (warm.fetch_add(1) + 1 == connections) measured_from = Clock::now();
+            while (warm.load() < connections) std::this_thread::yield();
+            samples[c].reserve(per_connection);
+            for (size_t i = 0; i < per_connection; ++i) {
+                const std::string& body = bodies[(c + i) % bodies.size()];
+                auto start = Clock::now();
+                bool ok = client.request("POST", "/fuse", body, response);
+                double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                if (!ok || response.status_code != 200) {
+                    std::fprintf(stderr, "request failed\n");
+                    std::exit(1);
+                }
+                samples[c].push_back(ns);
+            }
+        });
+    }
+    for (auto& client : clients) client.join();
+    if (seconds) *seconds = std::chrono::duration<double>(Clock::now() - measured_from).count();
+
+    std::vector<double> all;
+    for (const auto& connection_samples : samples) {
+        all.insert(all.end(), connection_samples.begin(), connection_samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    return all;
+}
+
+double percentile_us(const std::vector<double>& sorted_ns, double p) {
+    return sorted_ns[static_cast<size_t>(p * static_cast<double>(sorted_ns.size() - 1))] / 1000.0;
+}
+
+void print_histogram(const char* label, const std::vector<double>& sorted_ns) {
+    auto percentile = [&](double p) { return percentile_us(sorted_ns, p); };
+    std::printf("\n%s: %zu requests\n", label, sorted_ns.size());
+    std::printf("  p50 %8.1f us   p90 %8.1f us   p99 %8.1f us   p99.9 %8.1f us   max %8.1f us\n",
+                percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999),
+                sorted_ns.back() / 1000.0);
+
+    // Power-of-two buckets in microseconds
+    std::vector<size_t> buckets(32, 0);
+    for (double ns : sorted_ns) {
+        size_t bucket = 0;
+        for (double upper = 1000.0; ns >= upper && bucket + 1 < buckets.size(); upper *= 2) ++bucket;
+        buckets[bucket]++;
+    }
+    size_t last = buckets.size();
+    while (last > 0 && buckets[last - 1] == 0) --last;
+    size_t first = 0;
+    while (first < last && buckets[first] == 0) ++first;
+    size_t peak = *std::max_element(buckets.begin(), buckets.end());
+    for (size_t b = first; b < last; ++b) {
+        int width = static_cast<int>(50.0 * static_cast<double>(buckets[b]) / static_cast<double>(peak));
+        std::printf("  < %7.0f us %8zu %s\n", static_cast<double>(1u << b), buckets[b],
+                    std::string(static_cast<size_t>(width), '#').c_str());
+    }
+}
+
+void run_in_process(size_t requests, unsigned connections) {
+    const size_t sizes[] = {8, 64, 512, 4096};
+    struct Mode {
+        const char* name;
+        HttpServer::BusyPollConfig config;
+        std::vector<std::vector<double>> samples;  // per size
+    };
+    std::vector<Mode> modes(3);
+    modes[0].name = "blocking";
+    modes[1].name = "busy-poll";
+    modes[1].config.threads = 1;
+    modes[2].name = "pipeline";
+    modes[2].config.threads = 1;
+    modes[2].config.pipeline_threads = 1;
+
+    Service service;
+    for (auto& mode : modes) {
+        HttpServer server(0, &service);
+        server.set_busy_poll(mode.config);
+        std::thread server_thread([&server]() { server.run(); });
+        while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        int port = server.bound_port();
+
+        for (size_t size : sizes) {
+            // Fewer requests for large payloads keeps each size to similar wall time
+            size_t count = std::max<size_t>(500, requests * 64 / std::max<size_t>(64, size));
+            mode.samples.push_back(drive("127.0.0.1", port, {make_body(size)}, count, connections));
+        }
+
+        server.stop();
+        server_thread.join();
+    }
+
+    std::printf("\n/fuse round trips, %u connection(s), p50 / p99 in us\n", connections);
+    std::printf("  %-10s", "readings");
+    for (const auto& mode : modes) std::printf(" %22s", mode.name);
+    std::printf("\n");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        std::printf("  %-10zu", sizes[s]);
+        for (const auto& mode : modes) {
+            std::printf("      %8.1f / %7.1f", percentile_us(mode.samples[s], 0.5),
+                        percentile_us(mode.samples[s], 0.99));
+        }
+        std::printf("\n");
+    }
+    for (const auto& mode : modes) {
+        print_histogram((std::string(mode.name) + ", 64 readings").c_str(), mode.samples[1]);
+    }
+}
+
+void run_mixed(size_t requests) {
+    const size_t bulk_readings = 200000;
+    std::string bulk_body = make_body(bulk_readings);
+    Service service;
+    std::printf("\n8-reading /fuse next to %zu-reading uploads, busy-poll, p50 / p99 in us\n", bulk_readings);
+    for (unsigned bulk_threads : {0u, 1u}) {
+        HttpServer server(0, &service);
+        HttpServer::BusyPollConfig busy_poll;
+        busy_poll.threads = 1;
+        server.set_busy_poll(busy_poll);
+        HttpServer::BulkLaneConfig bulk;
+        bulk.threads = bulk_threads;
+        server.set_bulk_lane(bulk);
+        std::thread server_thread([&server]() { server.run(); });
+        while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        int port = server.bound_port();
+
+        std::atomic<bool> done{false};
+        size_t uploads = 0;
+        std::thread uploader([&]() {
+            simple_http::Client client("127.0.0.1", port);
+            simple_http::Response response;
+            while (!done.load()) {
+                if (client.request("POST", "/fuse", bulk_body, response)) ++uploads;
+            }
+        });
+        auto samples = drive("127.0.0.1", port, {make_body(8)}, requests, 1);
+        done = true;
+        uploader.join();
+
+        server.stop();
+        server_thread.join();
+        std::printf("  bulk lane %-4s %8.1f / %9.1f   (%zu uploads)\n", bulk_threads ? "on" : "off",
+                    percentile_us(samples, 0.5), percentile_us(samples, 0.99), uploads);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string target;
+    int arg = 1;
+    if (argc > 1 && std::strcmp(argv[1], "--mixed") == 0) {
+        run_mixed(argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000);
+        return 0;
+    }
+    if (argc > 2 && std::strcmp(argv[1], "--target") == 0) {
+        target = argv[2];
+        arg = 3;
+    }
+    size_t requests = argc > arg ? std::strtoull(argv[arg], nullptr, 10) : 20000;
+    unsigned connections = argc > arg + 1 ? static_cast<unsigned>(std::atoi(argv[arg + 1])) : 1;
+    connections = std::max(1u, connections);
+
+    if (target.empty()) {
+        run_in_process(requests, connections);
+        return 0;
+    }
+
+    size_t colon = target.rfind(':');
+    if (colon == std::string::npos) {
+        std::fprintf(stderr, "--target expects HOST:PORT\n");
+        return 1;
+    }
+    std::vector<std::string> bodies = make_mix(argc > arg + 2 ? argv[arg + 2] : "8");
+    if (bodies.empty()) {
+        std::fprintf(stderr, "readings must be a count or a mix like 8:70,64:25,1024:5\n");
+        return 1;
+    }
+    double seconds = 0.0;
+    auto samples = drive(target.substr(0, colon), std::atoi(target.c_str() + colon + 1), bodies, requests,
+                         connections, &seconds);
+    print_histogram(target.c_str(), samples);
+    std::printf("\nsummary requests=%zu seconds=%.3f rps=%.1f p50_us=%.1f p99_us=%.1f p999_us=%.1f\n",
+                samples.size(), seconds, static_cast<double>(samples.size()) / seconds,
+                percentile_us(samples, 0.5), percentile_us(samples, 0.99), percentile_us(samples, 0.999));
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Replays a capture written by cpp-service --capture against a running instance.
+//
+//   http_replay CAPTURE HOST:PORT [--speed X] [--connections N] [--limit N]
+//
+// Requests are re-issued on the captured schedule, compressed or stretched by
+// --speed (2 = twice the original rate); --speed 0 sends them back to back.
+// Request i goes out on connection i % N, and its latency is measured from
+// the time it was scheduled, not the time it was sent, so a server that falls
+// behind is charged for the queueing it causes (no coordinated omission).
+// Reports status counts, latency percentiles overall and per path, and how
+// far the sender itself fell behind the schedule.
+#include "../third_party/simple_http.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Outcome {
+    double latency_ns = 0.0;  // completion - scheduled time
+    double lateness_ns = 0.0;  // send - scheduled time
+    int status = 0;            // 0 when the connection failed
+};
+
+double percentile_us(const std::vector<double>& sorted_ns, double p) {
+    if (sorted_ns.empty()) return 0.0;
+    return sorted_ns[static_cast<size_t>(p * static_cast<double>(sorted_ns.size() - 1))] / 1000.0;
+}
+
+void print_row(const std::string& label, std::vector<double> ns) {
+    std::sort(ns.begin(), ns.end());
+    std::printf("  %-24s %8zu %10.1f %10.1f %10.1f %10.1f %10.1f\n", label.c_str(), ns.size(),
+                percentile_us(ns, 0.5), percentile_us(ns, 0.9), percentile_us(ns, 0.99),
+                percentile_us(ns, 0.999), ns.empty() ? 0.0 : ns.back() / 1000.0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s CAPTURE HOST:PORT [--speed X] [--connections N] [--limit N]\n", argv[0]);
+        return 1;
+    }
+    std::string target = argv[2];
+    double speed = 1.0;
+    unsigned connections = 8;
+    size_t limit = 0;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--speed") == 0) {
+            speed = std::atof(argv[i + 1]);
+        } else if (std::strcmp(argv[i], "--connections") == 0) {
+            connections = std::max(1, std::atoi(argv[i + 1]));
+        } else if (std::strcmp(argv[i], "--limit") == 0) {
+            limit = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+    }
+    size_t colon = target.rfind(':');
+    if (colon == std::string::npos) {
+        std::fprintf(stderr, "target must be HOST:PORT\n");
+        return 1;
+    }
+    std::string host = target.substr(0, colon);
+    int port = std::atoi(target.c_str() + colon + 1);
+
+    simple_http::CaptureReader reader;
+    if (!reader.open(argv[1])) {
+        std::fprintf(stderr, "%s is not a capture file\n", argv[1]);
+        return 1;
+    }
+    std::vector<simple_http::CapturedRequest> requests;
+    simple_http::CapturedRequest captured;
+    while ((limit == 0 || requests.size() < limit) && reader.next(captured)) {
+        requests.push_back(std::move(captured));
+    }
+    if (requests.empty()) {
+        std::fprintf(stderr, "no requests in %s\n", argv[1]);
+        return 1;
+    }
+    uint64_t first_arrival = requests.front().arrival_ns;
+    double span_s = static_cast<double>(requests.back().arrival_ns - first_arrival) / 1e9;
+    std::printf("%zu requests spanning %.3f s, replayed at ", requests.size(), span_s);
+    if (speed > 0) {
+        std::printf("%gx speed on %u connection(s)\n", speed, connections);
+    } else {
+        std::printf("full speed on %u connection(s)\n", connections);
+    }
+
+    std::vector<Outcome> outcomes(requests.size());
+    auto start = Clock::now() + std::chrono::milliseconds(50);  // let every sender connect first
+    std::vector<std::thread> senders;
+    for (unsigned c = 0; c < connections; ++c) {
+        senders.emplace_back([&, c]() {
+            simple_http::Client client(host, port);
+            simple_http::Response response;
+            std::this_thread::sleep_until(start);
+            for (size_t i = c; i < requests.size(); i += connections) {
+                const simple_http::Request& request = requests[i].request;
+                auto scheduled = Clock::now();
+                if (speed > 0) {
+                    double offset_ns = static_cast<double>(requests[i].arrival_ns - first_arrival) / speed;
+                    scheduled = start + std::chrono::nanoseconds(static_cast<int64_t>(offset_ns));
+                    std::this_thread::sleep_until(scheduled);
+                }
+                // The client supplies its own framing headers
+                std::unordered_map<std::string, std::string> headers;
+                for (const auto& header : request.headers) {
+                    std::string name = header.first;
+                    std::transform(name.begin(), name.end(), name.begin(),
+                                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+                    if (name != "host" && name != "content-length" && name != "connection") {
+                        headers.insert(header);
+                    }
+                }
+                auto sent = Clock::now();
+                bool ok = client.request(request.method, request.query.empty() ? request.path : request.path + "?" + request.query,
+                                         request.body, response, headers);
+                auto done = Clock::now();
+                outcomes[i].latency_ns = std::chrono::duration<double, std::nano>(done - scheduled).count();
+                outcomes[i].lateness_ns = std::chrono::duration<double, std::nano>(sent - scheduled).count();
+                outcomes[i].status = ok ? response.status_code : 0;
+            }
+        });
+    }
+    for (auto& sender : senders) sender.join();
+    double wall_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::map<int, size_t> statuses;
+    std::vector<double> all;
+    std::vector<double> lateness;
+    std::map<std::string, std::vector<double>> by_path;
+    for (size_t i = 0; i < outcomes.size(); ++i) {
+        statuses[outcomes[i].status]++;
+        lateness.push_back(outcomes[i].lateness_ns);
+        if (outcomes[i].status == 0) continue;
+        all.push_back(outcomes[i].latency_ns);
+        by_path[requests[i].request.method + " " + requests[i].request.path].push_back(outcomes[i].latency_ns);
+    }
+
+    std::printf("finished in %.3f s (%.0f requests/s)\nstatus:", wall_s, static_cast<double>(requests.size()) / wall_s);
+    for (const auto& [status, count] : statuses) {
+        std::printf(" %s=%zu", status ? std::to_string(status).c_str() : "failed", count);
+    }
+    std::printf("\n\nlatency from schedule, us\n  %-24s %8s %10s %10s %10s %10s %10s\n", "", "count", "p50", "p90",
+                "p99", "p99.9", "max");
+    print_row("all", all);
+    for (const auto& [path, samples] : by_path) {
+        print_row(path, samples);
+    }
+    print_row("sender lateness", lateness);
+    return statuses.count(0) ? 2 : 0;
+}
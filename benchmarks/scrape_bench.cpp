@@ -0,0 +1,199 @@
+// /fuse latency while /metrics and /stats are scraped.
+//
+//   scrape_bench [seconds-per-cell] [fuse-rate] [connections] [--busy-poll N]
+//
+// Starts the real HttpServer in-process (blocking thread-per-connection
+// unless --busy-poll) and holds a steady open-loop /fuse load: `fuse-rate`
+// 8-reading requests per second (default 2000) spread over `connections`
+// (default 4), each latency measured from the request's scheduled send time
+// so a stalled server is charged for the queueing. Alongside it one client
+// scrapes /metrics and another /stats, each every `interval` - off, 1 s,
+// 100 ms, 10 ms, and back to back - while the registry holds 0, 1k, 10k and
+// 50k extra counter series (seeded straight into the global Metrics, as
+// per-sensor or per-endpoint labels would add them).
+//
+// Both exposition formats are rendered under the mutex every request-path
+// increment takes, so the table shows /fuse p50 / p99 / p99.9 per cell, p99
+// against the same series count with no scraping, and how long a /metrics
+// scrape took and how large it was.
+#include "http_server.hpp"
+#include "metrics.hpp"
+#include "service.hpp"
+#include "../third_party/simple_http.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using cpp_service::HttpServer;
+using cpp_service::Service;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Cell {
+    std::vector<double> fuse_ns;     // sorted
+    std::vector<double> scrape_ns;   // /metrics, sorted
+    size_t scrape_bytes = 0;         // last /metrics body
+    size_t scrapes = 0;              // /metrics and /stats together
+};
+
+double percentile_us(const std::vector<double>& sorted_ns, double p) {
+    if (sorted_ns.empty()) return 0.0;
+    return sorted_ns[static_cast<size_t>(p * static_cast<double>(sorted_ns.size() - 1))] / 1000.0;
+}
+
+// One cell: the steady /fuse load for `seconds`, with both endpoints scraped
+// every `interval` (negative: not at all)
+Cell run_cell(int port, double seconds, double rate, unsigned connections, std::chrono::microseconds interval) {
+    const std::string body = "{\"readings\": [12.1, 11.9, 12.0, 12.2, 11.8, 12.05, 11.95, 12.1]}";
+    Cell cell;
+    std::vector<std::vector<double>> samples(connections);
+    std::atomic<bool> failed{false};
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(connections) / rate));
+    const auto start = Clock::now() + std::chrono::milliseconds(100);
+    const auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+
+    std::vector<std::thread> threads;
+    for (unsigned c = 0; c < connections; ++c) {
+        threads.emplace_back([&, c]() {
+            simple_http::Client client("127.0.0.1", port);
+            simple_http::Response response;
+            for (int i = 0; i < 50; ++i) client.request("POST", "/fuse", body, response);  // warm up
+            // Connections are offset so the sends interleave evenly
+            auto scheduled = start + period * c / connections;
+            for (; scheduled < end; scheduled += period) {
+                std::this_thread::sleep_until(scheduled);
+                if (!client.request("POST", "/fuse", body, response) || response.status_code != 200) {
+                    failed = true;
+                    return;
+                }
+                samples[c].push_back(std::chrono::duration<double, std::nano>(Clock::now() - scheduled).count());
+            }
+        });
+    }
+
+    std::atomic<size_t> scrapes{0};
+    if (interval.count() >= 0) {
+        for (const char* path : {"/metrics", "/stats"}) {
+            threads.emplace_back([&, path]() {
+                bool metrics = std::strcmp(path, "/metrics") == 0;
+                simple_http::Client client("127.0.0.1", port);
+                simple_http::Response response;
+                std::this_thread::sleep_until(start);
+                for (auto next = start;; next += interval) {
+                    if (interval.count() > 0) std::this_thread::sleep_until(next);
+                    auto sent = Clock::now();
+                    if (sent >= end) break;
+                    if (!client.request("GET", path, "", response) || response.status_code != 200) {
+                        failed = true;
+                        return;
+                    }
+                    if (metrics) {
+                        cell.scrape_ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - sent).count());
+                        cell.scrape_bytes = response.body.size();
+                    }
+                    scrapes++;
+                }
+            });
+        }
+    }
+    for (auto& thread : threads) thread.join();
+    if (failed) {
+        std::fprintf(stderr, "request failed\n");
+        std::exit(1);
+    }
+
+    for (const auto& connection_samples : samples) {
+        cell.fuse_ns.insert(cell.fuse_ns.end(), connection_samples.begin(), connection_samples.end());
+    }
+    std::sort(cell.fuse_ns.begin(), cell.fuse_ns.end());
+    std::sort(cell.scrape_ns.begin(), cell.scrape_ns.end());
+    cell.scrapes = scrapes;
+    return cell;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    unsigned busy_poll = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--busy-poll") == 0 && i + 1 < argc) {
+            busy_poll = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    double seconds = args.size() > 0 ? std::atof(args[0].c_str()) : 1.0;
+    double rate = args.size() > 1 ? std::atof(args[1].c_str()) : 2000.0;
+    unsigned connections = args.size() > 2 ? static_cast<unsigned>(std::atoi(args[2].c_str())) : 4;
+    if (seconds <= 0.0 || rate <= 0.0 || connections == 0) {
+        std::fprintf(stderr, "usage: scrape_bench [seconds-per-cell] [fuse-rate] [connections] [--busy-poll N]\n");
+        return 1;
+    }
+
+    Service service;
+    HttpServer server(0, &service);
+    if (busy_poll > 0) {
+        HttpServer::BusyPollConfig config;
+        config.threads = busy_poll;
+        server.set_busy_poll(config);
+    }
+    std::thread server_thread([&server]() { server.run(); });
+    while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    int port = server.bound_port();
+
+    const size_t series_counts[] = {0, 1000, 10000, 50000};
+    struct Interval {
+        const char* name;
+        std::chrono::microseconds every;
+    };
+    const Interval intervals[] = {
+        {"off", std::chrono::microseconds(-1)},
+        {"1 s", std::chrono::microseconds(1000000)},
+        {"100 ms", std::chrono::microseconds(100000)},
+        {"10 ms", std::chrono::microseconds(10000)},
+        {"back to back", std::chrono::microseconds(0)},
+    };
+
+    std::printf("\n/fuse at %.0f req/s over %u connection(s), %s server, %.1f s per cell; latency in us\n", rate,
+                connections, busy_poll > 0 ? "busy-poll" : "blocking", seconds);
+    std::printf("  %8s %-13s %9s %9s %9s %8s %12s %10s %9s\n", "series", "scrape every", "p50", "p99", "p99.9",
+                "p99 x", "/metrics ms", "/metrics KB", "scrapes/s");
+    size_t seeded = 0;
+    for (size_t series : series_counts) {
+        for (; seeded < series; ++seeded) {
+            cpp_service::get_metrics().increment_counter("scrape_bench_series_total",
+                                                         "series=\"" + std::to_string(seeded) + "\"");
+        }
+        double baseline_p99 = 0.0;
+        for (const auto& interval : intervals) {
+            Cell cell = run_cell(port, seconds, rate, connections, interval.every);
+            double p99 = percentile_us(cell.fuse_ns, 0.99);
+            if (interval.every.count() < 0) baseline_p99 = p99;
+            std::printf("  %8zu %-13s %9.1f %9.1f %9.1f %7.1fx", series, interval.name,
+                        percentile_us(cell.fuse_ns, 0.5), p99, percentile_us(cell.fuse_ns, 0.999),
+                        baseline_p99 > 0.0 ? p99 / baseline_p99 : 1.0);
+            if (cell.scrape_ns.empty()) {
+                std::printf(" %12s %10s %9s\n", "-", "-", "-");
+            } else {
+                std::printf(" %12.2f %10.0f %9.0f\n", percentile_us(cell.scrape_ns, 0.5) / 1000.0,
+                            static_cast<double>(cell.scrape_bytes) / 1024.0,
+                            static_cast<double>(cell.scrapes) / seconds);
+            }
+            std::fflush(stdout);
+        }
+    }
+
+    server.stop();
+    server_thread.join();
+    return 0;
+}
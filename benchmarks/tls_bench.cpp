@@ -0,0 +1,167 @@
+// TLS termination cost in simple_http.
+//
+//   tls_bench [megabytes] [handshakes]
+//
+// Starts a one-loop busy-poll server three times - plain HTTP, TLS with the
+// record layer in user space, and TLS with kTLS requested - and measures
+// bulk transfer throughput both ways over one keep-alive connection, then
+// the rate of full and resumed handshakes (one request per connection).
+// Whether the kernel actually took over the record layer depends on the
+// kernel (the "tls" ULP), the OpenSSL build and the negotiated cipher; the
+// kTLS row reports how many connections got it.
+#include "../third_party/simple_http.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+#ifdef SIMPLE_HTTP_OPENSSL
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kChunk = 4 << 20;  // bytes per request
+
+struct Mode {
+    const char* name;
+    bool tls;
+    bool ktls;
+};
+
+class BenchServer {
+public:
+    BenchServer(const Mode& mode, const std::string& certificate, const std::string& key)
+        : server_(0), payload_(kChunk, 'x') {
+        server_.get("/source", [this](const simple_http::Request&, simple_http::Response& res) {
+            res.body = payload_;
+        });
+        server_.post("/sink", [](const simple_http::Request& req, simple_http::Response& res) {
+            res.text(std::to_string(req.body.size()));
+        });
+        server_.set_max_body_size(kChunk);
+        if (mode.tls) {
+            simple_http::TlsOptions tls;
+            tls.certificate_pem = certificate;
+            tls.private_key_pem = key;
+            tls.ktls = mode.ktls;
+            server_.set_tls(tls);
+        }
+        simple_http::BusyPollOptions options;
+        options.threads = 1;
+        server_.set_busy_poll(options);
+        thread_ = std::thread([this]() { server_.run(); });
+        while (server_.port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ~BenchServer() {
+        server_.stop();
+        thread_.join();
+    }
+
+    int port() const { return server_.port(); }
+    simple_http::TlsStats stats() const { return server_.tls_stats(); }
+
+private:
+    simple_http::Server server_;
+    std::string payload_;
+    std::thread thread_;
+};
+
+std::unique_ptr<simple_http::Client> make_client(int port, bool tls, const std::string& certificate,
+                                                 bool resume = true) {
+    if (!tls) return std::make_unique<simple_http::Client>("127.0.0.1", port);
+    simple_http::ClientTlsOptions options;
+    options.ca_pem = certificate;
+    options.server_name = "localhost";
+    options.resume_sessions = resume;
+    return std::make_unique<simple_http::Client>("127.0.0.1", port, options);
+}
+
+// MB/s over `requests` round trips of `method` on one connection
+double throughput(simple_http::Client& client, const char* method, const char* path, const std::string& body,
+                  size_t requests) {
+    simple_http::Response response;
+    client.request(method, path, body, response);  // connect and warm up
+    auto start = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        if (!client.request(method, path, body, response) || response.status_code != 200) {
+            std::fprintf(stderr, "%s %s failed\n", method, path);
+            std::exit(1);
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(requests * kChunk) / (1024.0 * 1024.0) / seconds;
+}
+
+// Requests per second with a new connection (and handshake) for each
+double handshake_rate(simple_http::Client& client, size_t handshakes, bool expect_resumed) {
+    simple_http::Response response;
+    client.request("POST", "/sink", "", response);  // first full handshake, receives a ticket
+    size_t resumed = 0;
+    auto start = Clock::now();
+    for (size_t i = 0; i < handshakes; ++i) {
+        client.disconnect();
+        if (!client.request("POST", "/sink", "", response)) {
+            std::fprintf(stderr, "handshake failed\n");
+            std::exit(1);
+        }
+        resumed += client.session_resumed();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (expect_resumed != (resumed == handshakes)) {
+        std::fprintf(stderr, "expected %s handshakes, %zu of %zu resumed\n", expect_resumed ? "resumed" : "full",
+                     resumed, handshakes);
+    }
+    return static_cast<double>(handshakes) / seconds;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+    size_t handshakes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 500;
+    size_t requests = std::max<size_t>(1, megabytes * 1024 * 1024 / kChunk);
+
+    std::string certificate;
+    std::string key;
+    if (!simple_http::make_self_signed_certificate("localhost", certificate, key)) {
+        std::fprintf(stderr, "cannot create a certificate\n");
+        return 1;
+    }
+    const std::string upload(kChunk, 'y');
+
+    const Mode modes[] = {{"plain", false, false}, {"tls", true, false}, {"tls+ktls", true, true}};
+    std::printf("\n%zu x %zu MiB over one connection, MB/s\n", requests, kChunk >> 20);
+    std::printf("  %-10s %12s %12s %16s\n", "mode", "download", "upload", "kTLS send/recv");
+    for (const Mode& mode : modes) {
+        BenchServer server(mode, certificate, key);
+        auto client = make_client(server.port(), mode.tls, certificate);
+        double down = throughput(*client, "GET", "/source", "", requests);
+        double up = throughput(*client, "POST", "/sink", upload, requests);
+        simple_http::TlsStats stats = server.stats();
+        std::string ktls = mode.tls ? std::to_string(stats.ktls_send) + "/" + std::to_string(stats.ktls_recv) + " of " +
+                                          std::to_string(stats.handshakes)
+                                    : "-";
+        std::printf("  %-10s %12.1f %12.1f %16s\n", mode.name, down, up, ktls.c_str());
+    }
+
+    std::printf("\nNew connection per request, %zu requests, per second\n", handshakes);
+    BenchServer server(modes[1], certificate, key);
+    auto full = make_client(server.port(), true, certificate, false);
+    auto resumed = make_client(server.port(), true, certificate, true);
+    std::printf("  %-10s %12.0f\n", "full", handshake_rate(*full, handshakes, false));
+    std::printf("  %-10s %12.0f\n", "resumed", handshake_rate(*resumed, handshakes, true));
+    return 0;
+}
+
+#else
+
+int main() {
+    std::printf("tls_bench needs a build with OpenSSL\n");
+    return 0;
+}
+
+#endif
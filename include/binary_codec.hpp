@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cpp_service {
+
+class ReadingValidator;
+
+// Self-describing binary encodings accepted on /fuse and /fuse/batch
+enum class BinaryFormat { msgpack, cbor };
+
+// Maps a Content-Type / Accept media type to a binary format.
+// Recognizes application/msgpack (plus x- and vnd. variants) and application/cbor.
+bool binary_format_for_media_type(const std::string& media_type, BinaryFormat& format);
+
+// Decodes {"readings": [...]} (other keys skipped) or a bare array of numbers.
+// The decoder walks the buffer once, never builds a DOM and writes numbers
+// straight into `readings`, through `validator` if given. Returns an empty
+// string on success, otherwise an error.
+std::string decode_binary_readings(BinaryFormat format, const std::string& body, std::vector<double>& readings,
+                                   ReadingValidator* validator = nullptr);
+
+// Decodes {"batches": [[...], ...]} or a bare array of number arrays
+std::string decode_binary_batches(BinaryFormat format, const std::string& body,
+                                  std::vector<std::vector<double>>& batches,
+                                  ReadingValidator* validator = nullptr);
+
+// Minimal streaming encoder for responses; containers are length-prefixed,
+// so callers announce element counts up front like the wire formats require.
+class BinaryWriter {
+public:
+    explicit BinaryWriter(BinaryFormat format) : format_(format) {}
+
+    BinaryWriter& begin_map(size_t entries);
+    BinaryWriter& begin_array(size_t elements);
+    BinaryWriter& string(const std::string& value);
+    BinaryWriter& number(double value);
+    BinaryWriter& integer(uint64_t value);
+
+    const std::string& data() const { return out_; }
+
+private:
+    void put_be(uint64_t value, int bytes);
+    void cbor_head(uint8_t major, uint64_t argument);
+
+    BinaryFormat format_;
+    std::string out_;
+};
+
+} // namespace cpp_service
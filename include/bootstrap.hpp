@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace cpp_service {
+
+// xoshiro256+ run as four independent streams laid out lane-by-word, so each
+// step is the same shift/xor/add on four adjacent 64-bit values and compiles
+// to vector instructions (2 x SSE2 or 1 x AVX2) without intrinsics.
+class Xoshiro256x4 {
+public:
+    explicit Xoshiro256x4(uint64_t seed);
+
+    // Fills `out` with `count` indices uniformly drawn from [0, bound)
+    void fill_indices(uint32_t bound, uint32_t* out, size_t count);
+
+private:
+    void next(uint64_t out[4]);
+
+    uint64_t s0_[4], s1_[4], s2_[4], s3_[4];
+};
+
+// Resample index patterns (row-major, `resamples` rows of `n` indices) shared
+// by every request with the same shape. Each pattern is generated once from a
+// seed derived from the shape, so identical inputs get identical intervals and
+// the PRNG cost is paid once per size rather than once per request.
+class BootstrapIndexCache {
+public:
+    using Pattern = std::shared_ptr<const std::vector<uint32_t>>;
+
+    // Patterns above `max_indices` are never materialised; when the cache
+    // holds `max_entries` patterns it is cleared before inserting.
+    explicit BootstrapIndexCache(size_t max_entries = 64, size_t max_indices = size_t{1} << 22);
+
+    // Null when the pattern is over max_indices: generate its rows with fill_row()
+    Pattern get(uint32_t n, uint32_t resamples);
+
+    // Row `row` of the (n, resamples) pattern too large to keep, seeded from
+    // the shape and the row so any split over threads gives the same rows
+    static void fill_row(uint32_t n, uint32_t resamples, uint32_t row, uint32_t* out);
+
+    size_t size() const;
+
+private:
+    size_t max_entries_;
+    size_t max_indices_;
+    mutable std::mutex mutex_;
+    std::map<std::pair<uint32_t, uint32_t>, Pattern> patterns_;
+};
+
+// Percentile interval at `level` (e.g. 0.95) from bootstrap replicates.
+// Uses selection, not a sort; reorders `estimates`, which must not be empty.
+void percentile_interval(std::vector<double>& estimates, double level, double& low, double& high);
+
+} // namespace cpp_service
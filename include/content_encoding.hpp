@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace cpp_service {
+
+// Outcome of decoding a request body according to its Content-Encoding
+enum class ContentDecodeError {
+    none,
+    unsupported_encoding,  // Encoding not known or not compiled in
+    too_large,             // Decoded size would exceed the configured limit
+    malformed              // Corrupt or truncated compressed stream
+};
+
+// Decodes `body` as described by a Content-Encoding header value into `decoded`.
+// Supports identity, gzip, deflate and (when built with libzstd) zstd.
+// Inflation is done in fixed-size chunks and stops as soon as the output would
+// exceed `max_decoded_bytes`, so a zip bomb never materializes in memory.
+ContentDecodeError decode_content(const std::string& content_encoding, const std::string& body,
+                                  std::string& decoded, size_t max_decoded_bytes);
+
+// Whether a given encoding token (e.g. "gzip") can be decoded by this build
+bool is_content_encoding_supported(const std::string& content_encoding);
+
+// Human readable description, suitable for error responses
+const char* to_string(ContentDecodeError error);
+
+} // namespace cpp_service
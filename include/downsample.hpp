@@ -0,0 +1,39 @@
+#pragma once
+
+#include "series_store.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cpp_service {
+
+// Visual downsampling for series reads. Both modes make one forward pass over
+// the snapshot's columns within [from, to], skipping segments outside the
+// range, and allocate nothing beyond the output and the decoded copies of
+// compacted segments in range.
+enum class DownsampleMode {
+    // Largest-Triangle-Three-Buckets (Steinarsson, 2013): the first and last
+    // points, plus from each of max_points - 2 equal-count buckets the point
+    // forming the largest triangle with the previous pick and the next
+    // bucket's centroid. Keeps the shape, peaks included.
+    lttb,
+    // For each of max_points / 2 equal-time buckets, its lowest and highest
+    // points in time order. Keeps every extreme; empty buckets stay gaps.
+    minmax,
+};
+
+const char* downsample_mode_name(DownsampleMode mode);
+bool parse_downsample_mode(const std::string& name, DownsampleMode& mode);
+
+struct DownsampleResult {
+    std::vector<SeriesStore::Point> points;
+    size_t in_range = 0;  // points of the series within [from, to]
+};
+
+// Points of `series` with from <= timestamp <= to, reduced to at most
+// `max_points` (returned unchanged when there are no more than that).
+// max_points is raised to 3 for lttb and 2 for minmax.
+DownsampleResult downsample(const SeriesStore::Snapshot& series, int64_t from, int64_t to, size_t max_points,
+                            DownsampleMode mode);
+
+} // namespace cpp_service
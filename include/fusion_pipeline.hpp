@@ -0,0 +1,85 @@
+#pragma once
+
+#include "service.hpp"
+#include "spsc_ring.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cpp_service {
+
+// Staged alternative to running fusion inside the request handler. I/O
+// threads ("lanes") parse requests into compact jobs and hand them over SPSC
+// rings to dedicated compute threads, which drain them in batches and pass
+// the finished jobs back on a second ring for the lane to serialize. Every
+// (lane, compute thread) pair has its own rings, so no queue ever sees two
+// producers or two consumers and neither stage takes a lock.
+class FusionPipeline {
+public:
+    struct Job {
+        uint64_t tag = 0;  // the lane's own handle, returned untouched
+        std::vector<double> readings;
+        std::vector<double> weights;
+        Service::FusionOptions options;
+
+        // Filled in by the compute stage
+        Service::FusionResult result;
+        std::string error;  // set instead of `result` when fusion throws
+        bool bad_request = false;  // the throw was std::invalid_argument
+    };
+
+    // first_cpu >= 0 pins compute thread i to CPU first_cpu + i
+    FusionPipeline(Service& service, unsigned lanes, unsigned compute_threads, int first_cpu = -1,
+                   size_t ring_capacity = 1024);
+    ~FusionPipeline();
+
+    FusionPipeline(const FusionPipeline&) = delete;
+    FusionPipeline& operator=(const FusionPipeline&) = delete;
+
+    unsigned lanes() const { return lanes_; }
+    unsigned compute_threads() const { return compute_threads_; }
+
+    // Called only from lane `lane`'s thread. Returns false, leaving `job`
+    // untouched, when every ring from this lane is full; the caller can then
+    // run the job itself with run().
+    bool submit(unsigned lane, Job& job);
+
+    // Moves up to `max` finished jobs for `lane` into `done` (appending);
+    // called only from that lane's thread
+    size_t collect(unsigned lane, std::vector<Job>& done, size_t max = 64);
+
+    // The compute stage for one job
+    static void run(Service& service, Job& job);
+
+private:
+    struct Channel {
+        explicit Channel(size_t capacity) : jobs(capacity), results(capacity) {}
+        SpscRing<Job> jobs;     // lane -> compute thread
+        SpscRing<Job> results;  // compute thread -> lane
+    };
+
+    struct Parking {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::atomic<bool> parked{false};
+    };
+
+    Channel& channel(unsigned lane, unsigned worker) { return *channels_[lane * compute_threads_ + worker]; }
+    void compute_loop(unsigned worker, int cpu);
+
+    Service& service_;
+    unsigned lanes_;
+    unsigned compute_threads_;
+    std::vector<std::unique_ptr<Channel>> channels_;  // lane-major
+    std::vector<unsigned> next_worker_;               // per lane, round robin
+    std::vector<std::unique_ptr<Parking>> parking_;   // per compute thread
+    std::atomic<bool> running_{true};
+    std::vector<std::thread> workers_;
+};
+
+} // namespace cpp_service
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace cpp_service {
+
+// Content-Type for Gorilla-compressed reading batches on /fuse
+constexpr const char* kGorillaContentType = "application/x-gorilla";
+
+// Location of one decoded series inside the flat output buffers
+struct GorillaSeriesView {
+    std::string sensor;
+    size_t first = 0;
+    size_t count = 0;
+};
+
+// Builds a Gorilla batch: per sensor, timestamps are delta-of-delta encoded and
+// values XOR-encoded against their predecessor (Pelkonen et al., VLDB 2015).
+//
+// Wire layout (integers little-endian):
+//   "TFG1" | u32 series_count | series...
+//   series: u16 sensor_len | sensor bytes | u32 point_count | u32 payload_bytes | bitstream
+class GorillaEncoder {
+public:
+    GorillaEncoder();
+
+    void add_series(const std::string& sensor, const std::vector<int64_t>& timestamps,
+                    const std::vector<double>& values);
+    std::string finish();
+
+private:
+    std::string out_;
+    uint32_t series_count_ = 0;
+};
+
+// Decodes every series of a Gorilla batch straight into `values` / `timestamps`
+// (appended, series after series). Returns an empty string on success,
+// otherwise an error message. A point takes two bits of payload but 16 bytes
+// decoded, so a batch whose points would take more than `max_decoded_bytes`
+// in `values` and `timestamps` is refused before anything is allocated.
+std::string decode_gorilla_batch(const std::string& payload, std::vector<double>& values,
+                                 std::vector<int64_t>& timestamps,
+                                 std::vector<GorillaSeriesView>* series = nullptr,
+                                 size_t max_decoded_bytes = std::numeric_limits<size_t>::max());
+
+} // namespace cpp_service
@@ -2,28 +2,199 @@
 
 #include "service.hpp"
 #include "metrics.hpp"
+#include "fusion_pipeline.hpp"
+#include "shadow_evaluator.hpp"
+#include "sensor_registry.hpp"
+#include "series_store.hpp"
+#include "series_compactor.hpp"
+#include "membership.hpp"
+#include "shard_router.hpp"
+#include "thread_pool.hpp"
 #include <string>
 #include <thread>
 #include <atomic>
+#include <cstdint>
 #include <vector>
 #include <map>
+#include <memory>
+#include <optional>
+
+namespace simple_http {
+struct Request;
+struct Response;
+class Server;
+}
 
 namespace cpp_service {
 
 class HttpServer {
 public:
     HttpServer(int port, Service* service);
-    ~HttpServer() = default;
+    ~HttpServer();
     
     void run();
     void stop();
     
+    // Listening port once run() has bound it (useful with port 0), else 0
+    int bound_port() const;
+    
+    // Fields extracted from a /fuse body, whatever its encoding
+    struct FuseRequest {
+        std::vector<double> readings;
+        std::vector<int64_t> timestamps;  // Optional, one per reading
+        std::vector<double> weights;      // Optional, one per reading
+        std::string sensor;               // Optional
+        Service::FusionOptions options;   // "algorithm", "tolerance", "interval": true | {"level", ...}
+    };
+    
+    // Limit applied to request bodies after Content-Encoding is removed
+    void set_max_decoded_body_bytes(size_t bytes) { max_decoded_body_bytes_ = bytes; }
+    
+    // Busy-polling event loops instead of the blocking thread-per-connection
+    // server; trades dedicated CPU for lower wakeup latency (see simple_http::BusyPollOptions)
+    struct BusyPollConfig {
+        unsigned threads = 0;          // 0 keeps the blocking server
+        int first_cpu = -1;            // pin loop i to CPU first_cpu + i
+        int socket_busy_poll_us = 50;  // SO_BUSY_POLL
+        uint32_t max_spin_us = 5000;   // longest idle spin before parking
+        // Compute threads for staged /fuse: the loops parse and serialize,
+        // fusion runs on these (pinned after the loops when first_cpu is set).
+        // 0 runs fusion inside the handler
+        unsigned pipeline_threads = 0;
+    };
+    void set_busy_poll(const BusyPollConfig& config) { busy_poll_ = config; }
+    
+    // Size-aware /fuse scheduling: a request whose body or reading count
+    // crosses a threshold is fused on a pool of its own, with the parallel
+    // median kernel, so a few bulk uploads cannot hold up the small-request
+    // lane. In busy-poll mode bulk bodies are also decoded off the event loop.
+    struct BulkLaneConfig {
+        unsigned threads = 0;                  // 0 keeps every request on one lane
+        size_t min_body_bytes = 1024 * 1024;   // by Content-Length, before decoding
+        size_t min_readings = 128 * 1024;      // by reading count, once decoded
+    };
+    void set_bulk_lane(const BulkLaneConfig& config) { bulk_lane_ = config; }
+    
+    // HTTPS termination in-process (PEM files); needs a build with OpenSSL.
+    // With ktls the kernel takes over record encryption after the handshake
+    // where it can; /metrics reports which connections got it.
+    struct TlsConfig {
+        std::string certificate_file;  // empty serves plain HTTP
+        std::string private_key_file;
+        bool ktls = true;
+        bool session_resumption = true;
+    };
+    void set_tls(const TlsConfig& config) { tls_ = config; }
+    
+    // Records a sample of incoming requests, with arrival times, for
+    // benchmarks/http_replay (see simple_http::CaptureOptions)
+    struct CaptureConfig {
+        std::string path;  // empty disables capture
+        double sample_rate = 1.0;
+    };
+    void set_capture(const CaptureConfig& config) { capture_ = config; }
+    
+    // Runs an alternative estimator on a sample of successful /fuse requests,
+    // off the response path, and exports its cost and disagreement
+    void set_shadow(const ShadowEvaluator::Config& config) { shadow_config_ = config; }
+    
+    // Staleness window and capacity for sensors named in /fuse requests,
+    // listed by GET /sensors; call before run()
+    void set_sensor_tracking(const SensorRegistry::Config& config) {
+        sensors_ = std::make_unique<SensorRegistry>(config);
+    }
+    
+    // Keeps every successful /fuse result that names a sensor, stamped with
+    // its newest reading timestamp (else the arrival time), and serves it
+    // downsampled from GET /series; call before run()
+    void set_series_store(const SeriesStore::Config& config) {
+        series_ = std::make_unique<SeriesStore>(config);
+    }
+    // Retention and background compaction for the series store, started by run()
+    void set_series_compaction(const SeriesCompactor::Config& config) { compaction_ = config; }
+    // Pool scanning segments for GET /query, alongside the handler's own
+    // thread; 0 sizes it to the hardware
+    void set_query_threads(unsigned threads) { query_threads_ = threads; }
+    
+    // Joins a cluster over SWIM gossip when run() starts (see Membership);
+    // GET /cluster lists the members. The HTTP port advertised defaults to
+    // the one served
+    void set_membership(const Membership::Config& config) { membership_config_ = config; }
+    // Shards sensors across the cluster (see ShardRouter): /fuse and /series
+    // requests for a sensor owned elsewhere are forwarded to its owner, and
+    // stored series follow their sensors when the membership changes.
+    // Needs set_membership()
+    void set_sharding(const ShardRouter::Config& config) { sharding_ = config; }
+    
 private:
     int port_;
     Service* service_;
     std::atomic<bool> running_;
+    size_t max_decoded_body_bytes_ = 64 * 1024 * 1024;
+    BusyPollConfig busy_poll_;
+    std::atomic<simple_http::Server*> server_{nullptr};
+    BulkLaneConfig bulk_lane_;
+    TlsConfig tls_;
+    CaptureConfig capture_;
+    std::optional<ShadowEvaluator::Config> shadow_config_;
+    std::unique_ptr<ThreadPool> bulk_pool_;
+    // Outlives run(): handlers on detached connection threads may still offer to it
+    std::unique_ptr<ShadowEvaluator> shadow_;
+    std::unique_ptr<SensorRegistry> sensors_;
+    std::unique_ptr<SeriesStore> series_;  // null unless set_series_store()
+    std::optional<SeriesCompactor::Config> compaction_;
+    std::unique_ptr<SeriesCompactor> compactor_;  // declared after series_, which it works on
+    unsigned query_threads_ = 0;
+    std::unique_ptr<ThreadPool> query_pool_;
+    std::optional<Membership::Config> membership_config_;
+    std::unique_ptr<Membership> membership_;
+    std::optional<ShardRouter::Config> sharding_;
+    std::unique_ptr<ShardRouter> router_;  // declared after what it uses
+    
+    // Per-loop bookkeeping for /fuse requests answered from the loop hook,
+    // whether they went to the fusion pipeline or the bulk lane
+    struct PendingFuse;
+    struct DeferredState;
+    std::unique_ptr<DeferredState> deferred_;
+    bool drain_deferred(simple_http::Server& server, unsigned loop);
+    void finish_pipelined_fuse(PendingFuse& pending, FusionPipeline::Job& job, simple_http::Response& res);
+    // Answers a /fuse request whose fusion threw: 400 with the message when
+    // the request itself was at fault (std::invalid_argument), else 500
+    void fail_fuse(simple_http::Response& res, const std::string& error, bool bad_request);
+    // Fuses `pending` on the bulk pool, decoding `raw` first when given, and
+    // queues the response for the ticket's loop
+    void submit_bulk_fuse(std::shared_ptr<PendingFuse> pending, std::shared_ptr<simple_http::Request> raw);
+    bool is_bulk_body(const simple_http::Request& req) const;
+    bool is_bulk_request(const FuseRequest& request) const;
+    
+    // /fuse in two stages: decode and validate (false once `res` holds an
+    // error), then build the response from the fused result
+    bool prepare_fuse(const simple_http::Request& req, simple_http::Response& res, FuseRequest& request);
+    void write_fuse_response(const std::string& accept, const FuseRequest& request,
+                             const Service::FusionResult& result, simple_http::Response& res);
+    // Records a served result in the series store, then hands the request to
+    // the shadow evaluator, which may take its readings
+    void after_fuse(FuseRequest& request, const Service::FusionResult& result);
+    
+    // Passes the request on to the owner of `sensor` when the router says
+    // so, filling `res` with the owner's answer; false to serve it here
+    bool forward_to_owner(const simple_http::Request& req, simple_http::Response& res,
+                          const std::string& sensor, const std::string& endpoint);
+    
+    // Strips Content-Encoding; on failure fills in the error response and returns false
+    bool decode_body(const simple_http::Request& req, simple_http::Response& res, const std::string& endpoint,
+                     std::string& decoded, const std::string*& body);
     
-    std::string parse_json_array(const std::string& json_str, std::vector<double>& readings);
+    // Readings pass through `validator` as they are decoded; entries it drops
+    // are removed from the parallel timestamps and weights as well
+    std::string parse_fuse_request(const std::string& content_type, const std::string& body,
+                                   FuseRequest& request, ReadingValidator& validator);
+    // `weights` is left empty unless some batch carries weights; `options` takes
+    // the top-level "algorithm" / "tolerance" that apply to every batch
+    std::string parse_batches(const std::string& content_type, const std::string& body,
+                              std::vector<std::vector<double>>& batches, std::vector<std::vector<double>>& weights,
+                              Service::FusionOptions& options, ReadingValidator& validator);
+    std::string parse_json_request(const std::string& json_str, FuseRequest& request, ReadingValidator& validator);
     std::string create_json_response(const std::string& status, const std::string& message = "", 
                                    const std::map<std::string, std::string>& data = {});
 };
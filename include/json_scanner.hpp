@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cpp_service {
+
+class ReadingValidator;
+
+// Forward-only pull scanner over a JSON document. Callers walk the members they
+// care about and skip the rest; skipped values are jumped over with a vectorized
+// search for structural characters instead of being parsed, so cost grows with
+// the data actually extracted. Skipped values are only checked for balanced
+// brackets and terminated strings, not fully validated.
+//
+// Every method returns false on error or when a container ends; check failed()
+// to tell the two apart.
+class JsonScanner {
+public:
+    // The scanner keeps pointers into `json`, which must outlive it
+    explicit JsonScanner(const std::string& json);
+    JsonScanner(std::string&&) = delete;
+
+    bool begin_object();
+    // Advances to the next member of the innermost object and decodes its key
+    bool next_member(std::string& key);
+
+    bool begin_array();
+    // Advances to the next element of the innermost array
+    bool next_element();
+
+    bool read_number(double& value);
+    bool read_integer(int64_t& value);
+    bool read_string(std::string& value);
+    bool read_bool(bool& value);
+    bool skip_value();
+
+    // Reads a whole array of numbers, appending to `values`
+    bool read_number_array(std::vector<double>& values);
+    // Same, passing each number through `validator` as it is converted; numbers
+    // too large for a double become +/-inf for the validator to judge, and a
+    // rejected reading fails the scan with the validator's message
+    bool read_number_array(std::vector<double>& values, ReadingValidator& validator);
+    bool read_integer_array(std::vector<int64_t>& values);
+
+    // Succeeds only if nothing but whitespace remains
+    bool finish();
+
+    bool failed() const { return !error_.empty(); }
+    const std::string& error() const { return error_; }
+
+    // Peeks at the next value without consuming it
+    bool at_array();
+    bool at_object();
+    bool at_null();
+
+private:
+    bool fail(const std::string& message);
+    void skip_whitespace();
+    bool scan_number_token(const char*& start, const char*& stop, bool& integral);
+    bool convert_number(double& value, bool saturate);
+    bool skip_string();
+    bool skip_container();
+
+    const char* p_;
+    const char* end_;
+    std::vector<bool> first_;  // per open container: no element consumed yet
+    std::string error_;
+};
+
+} // namespace cpp_service
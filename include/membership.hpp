@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+
+namespace cpp_service {
+
+// Cluster membership and failure detection over UDP, after SWIM (Das, Gupta
+// and Motivala, 2002) with the suspicion mechanism.
+//
+// Every protocol period a node pings one member, taking them in a shuffled
+// round-robin so each is probed within two periods. Without an ack inside
+// ack_timeout it asks `indirect_probes` others to ping the target for it;
+// without any ack by the end of the period the target becomes suspect, and
+// dead once suspicion_periods more pass unrefuted. A node that hears it is
+// suspected refutes by raising its incarnation number. State changes ride on
+// the protocol's own packets, each retransmitted retransmit_multiplier x
+// log2(n) times, so the load per node stays a few small packets per period
+// whatever the cluster size. A joining node asks its seeds for their member
+// list until one sends it.
+//
+// The gossip thread never blocks on DNS while holding its lock: a sender's
+// address is the datagram's source, numeric IDs are parsed, and only other
+// names are resolved, after the lock is released. Full member lists go only
+// to the known member that asked, from the address it is known at, and to a
+// few members per protocol period at most, so a stray datagram cannot turn
+// into a large reply.
+//
+// Member IDs are the advertised "host:port" of the gossip socket.
+// Incarnations start from the wall clock in seconds, so a restarted node
+// overrides its own death notice.
+class Membership {
+public:
+    enum class State : uint8_t { alive = 0, suspect = 1, dead = 2 };
+
+    struct Member {
+        std::string id;
+        uint16_t http_port = 0;
+        State state = State::alive;
+        uint32_t incarnation = 0;
+        std::string address;  // IPv4 its gossip is exchanged with, from members(); empty for the local node
+    };
+
+    struct Config {
+        std::string bind_host = "0.0.0.0";
+        uint16_t port = 0;                       // 0 picks a free port
+        std::string advertise_host = "127.0.0.1";
+        uint16_t http_port = 0;                  // shared with peers, for forwarding
+        std::vector<std::string> seeds;          // "host:port" of members to join through
+        std::chrono::milliseconds protocol_period{200};
+        std::chrono::milliseconds ack_timeout{80};
+        unsigned indirect_probes = 3;
+        unsigned suspicion_periods = 5;
+        unsigned retransmit_multiplier = 3;
+        std::chrono::milliseconds dead_retention{30000};  // dead members listed this long
+        // Called on the gossip thread, without locks held, for every change
+        // of a member's state (the local node excluded)
+        std::function<void(const Member&)> on_change;
+    };
+
+    struct Stats {
+        uint64_t messages_sent = 0;
+        uint64_t messages_received = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t bytes_received = 0;
+        uint64_t probes = 0;
+        uint64_t indirect_probes = 0;   // probes that needed help
+        uint64_t suspicions = 0;        // raised by this node
+        uint64_t refutations = 0;
+    };
+
+    // Binds the socket and starts gossiping; throws std::runtime_error when
+    // the socket cannot be set up
+    explicit Membership(const Config& config);
+    // Stops without notice, as a crash would look to the others
+    ~Membership();
+
+    Membership(const Membership&) = delete;
+    Membership& operator=(const Membership&) = delete;
+
+    const std::string& id() const { return self_id_; }
+    uint16_t port() const { return port_; }
+
+    // Known members, the local node first
+    std::vector<Member> members() const;
+    // Bumped whenever a member joins, is suspected, dies or recovers
+    uint64_t version() const { return version_.load(); }
+    Stats stats() const;
+
+private:
+    enum class Type : uint8_t { ping = 1, ack = 2, ping_req = 3, sync = 4, sync_request = 5 };
+
+    struct Entry {
+        Member member;
+        sockaddr_in address{};
+        std::chrono::steady_clock::time_point suspect_deadline;
+        std::chrono::steady_clock::time_point dead_since;
+        std::chrono::steady_clock::time_point last_sync;  // last member list sent to it
+    };
+
+    struct Broadcast {
+        Member member;
+        unsigned transmits = 0;
+    };
+
+    // A ping sent on behalf of a ping-req
+    struct Relay {
+        sockaddr_in requester{};
+        uint32_t requester_seq = 0;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    void loop();
+    void tick(Clock::time_point now);
+    void start_probe(Clock::time_point now);
+    void receive(const uint8_t* data, size_t size, const sockaddr_in& from, Clock::time_point now);
+
+    // SWIM's precedence rules; true when `update` changed the table. A new
+    // member is reached at `address`, or its ID's address; an ID naming a
+    // host is queued for resolve_pending() instead.
+    bool apply(const Member& update, Clock::time_point now, const sockaddr_in* address = nullptr);
+    // Resolves the queued host names without the lock, then applies them
+    void resolve_pending();
+    // Whether a member list may go to `entry` now; counts it when so
+    bool sync_allowed(Entry& entry, Clock::time_point now);
+    void set_state(Entry& entry, State state, uint32_t incarnation, Clock::time_point now);
+    void enqueue(const Member& member);
+
+    void send(Type type, uint32_t seq, const std::string& target, const sockaddr_in& to,
+              const std::vector<Member>* full_list = nullptr);
+    void send_sync(const sockaddr_in& to);
+    Member self() const;
+
+    Config config_;
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::string self_id_;
+
+    mutable std::mutex mutex_;
+    uint32_t incarnation_ = 0;
+    std::map<std::string, Entry> members_;  // others only
+    std::vector<Broadcast> broadcasts_;
+    std::map<uint32_t, Relay> relays_;
+    std::vector<Member> changes_;           // for on_change, delivered outside the lock
+    std::vector<Member> unresolved_;        // new members named by host, for resolve_pending()
+    std::vector<sockaddr_in> seeds_;
+    bool synced_ = false;                   // a seed has sent its member list
+    Clock::time_point next_knock_;
+    Clock::time_point sync_period_;         // start of the period syncs_sent_ counts
+    unsigned syncs_sent_ = 0;
+
+    // The probe of the current period
+    std::string probe_target_;
+    uint32_t probe_seq_ = 0;
+    Clock::time_point probe_start_;
+    bool probe_active_ = false;
+    bool probe_acked_ = false;
+    bool probe_indirect_ = false;
+    Clock::time_point next_probe_;
+    std::vector<std::string> probe_order_;
+    size_t probe_index_ = 0;
+
+    uint32_t next_seq_ = 1;
+    std::mt19937 rng_;
+    Stats stats_;
+    std::atomic<uint64_t> version_{0};
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
+
+const char* membership_state_name(Membership::State state);
+
+} // namespace cpp_service
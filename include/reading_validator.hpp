@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace cpp_service {
+
+// What to do with a reading that is NaN, infinite or outside the valid range
+enum class InvalidReadingPolicy {
+    reject,  // fail the whole request
+    drop,    // leave the reading out
+    clamp,   // pull it onto the nearest finite bound; NaN (and infinities without a
+             // finite bound on that side) cannot be clamped and are dropped
+};
+
+enum class InvalidReadingReason { nan, infinite, out_of_range };
+constexpr size_t kInvalidReadingReasons = 3;
+
+const char* to_string(InvalidReadingPolicy policy);
+const char* to_string(InvalidReadingReason reason);
+bool parse_invalid_reading_policy(const std::string& name, InvalidReadingPolicy& policy);
+
+struct ReadingLimits {
+    InvalidReadingPolicy policy = InvalidReadingPolicy::reject;
+    double min_value = -std::numeric_limits<double>::infinity();
+    double max_value = std::numeric_limits<double>::infinity();
+};
+
+// Applied by the decoders right where each reading is converted, so invalid
+// values never reach the statistics and no second validation scan is needed.
+// The common case is one inlined range check; everything else is out of line.
+class ReadingValidator {
+public:
+    explicit ReadingValidator(const ReadingLimits& limits = ReadingLimits()) : limits_(limits) {}
+
+    // Call once per converted reading. Returns true if `value` (possibly
+    // clamped in place) should be stored; false if it was dropped or, under
+    // the reject policy, rejected (see rejected()).
+    bool admit(double& value) {
+        ++position_;
+        if (std::isfinite(value) && value >= limits_.min_value && value <= limits_.max_value) {
+            return true;
+        }
+        return admit_invalid(value);
+    }
+
+    // Starts the next series (e.g. the next batch); positions restart, counts accumulate
+    void begin_series() {
+        position_ = 0;
+        dropped_.clear();
+    }
+
+    // Readings seen in the current series, and the positions that were dropped
+    size_t seen() const { return position_; }
+    const std::vector<size_t>& dropped() const { return dropped_; }
+
+    bool rejected() const { return !error_.empty(); }
+    const std::string& error() const { return error_; }
+
+    uint64_t count(InvalidReadingReason reason) const { return counts_[static_cast<size_t>(reason)]; }
+
+private:
+    bool admit_invalid(double& value);
+
+    ReadingLimits limits_;
+    size_t position_ = 0;
+    std::vector<size_t> dropped_;
+    uint64_t counts_[kInvalidReadingReasons] = {};
+    std::string error_;
+};
+
+// Removes the entries at the validator's dropped positions from a container
+// that runs parallel to the readings (weights, timestamps). Containers of any
+// other length are left alone for the caller's length check to report.
+template <typename T>
+void erase_dropped(const ReadingValidator& validator, std::vector<T>& parallel) {
+    const auto& dropped = validator.dropped();
+    if (dropped.empty() || parallel.size() != validator.seen()) return;
+
+    size_t next = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < parallel.size(); ++i) {
+        if (next < dropped.size() && dropped[next] == i) {
+            ++next;
+            continue;
+        }
+        parallel[kept++] = parallel[i];
+    }
+    parallel.resize(kept);
+}
+
+} // namespace cpp_service
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cpp_service {
+
+// Exact floating-point accumulator (a Kulisch-style "superaccumulator").
+// Every finite double is added as a fixed-point integer spread over 32-bit
+// limbs that span the full exponent range, so no rounding happens until
+// value() is called. The result therefore depends only on the multiset of
+// inputs: any ordering, chunking or merge tree of partial sums produces a
+// bit-identical double, which makes parallel and batched reductions
+// reproducible.
+class ReproducibleSum {
+public:
+    ReproducibleSum();
+
+    void add(double value);
+    void add(const double* values, size_t count);
+
+    // Folds another partial sum into this one (e.g. from another thread)
+    void merge(const ReproducibleSum& other);
+
+    // Correctly rounded (round-to-nearest-even) sum of everything added
+    double value() const;
+
+    void reset();
+
+private:
+    // Bits needed for any double (2^-1074 .. 2^1024) plus carry headroom
+    static constexpr int kLimbBits = 32;
+    static constexpr int kLimbs = 70;
+    static constexpr int kMinExponent = -1074;
+    // Limbs absorb < 2^32 per add; normalize well before int64 could overflow
+    static constexpr uint32_t kNormalizeInterval = 1u << 29;
+
+    void normalize();
+
+    int64_t limbs_[kLimbs];
+    uint32_t pending_ = 0;
+    bool nan_ = false;
+    bool pos_inf_ = false;
+    bool neg_inf_ = false;
+};
+
+} // namespace cpp_service
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cpp_service {
+
+// Last-seen bookkeeping for sensors named in /fuse requests, with expiry
+// driven by a hierarchical timer wheel instead of periodic scans.
+//
+// Each fresh sensor owns one timer for the moment it would go stale. A touch
+// only stores the new timestamp; the timer is not moved. When it fires, the
+// sensor is either re-armed at its real deadline (it was touched since) or
+// marked stale. That keeps an update at one hash lookup and a store, and an
+// expiry at O(1) amortized: the wheel has kLevels levels of kSlots slots, and
+// a timer is re-filed at most once per level on its way down. Time advances
+// in `tick_ms` steps whenever the registry is used, so there is no
+// background thread. Sensors hash to independent shards, each with its own
+// lock and wheel, so concurrent touches rarely contend.
+class SensorRegistry {
+public:
+    struct Config {
+        int64_t stale_after_ms = 60000;
+        int64_t tick_ms = 100;            // expiry resolution
+        size_t max_sensors = 1 << 20;     // further new IDs are counted, not tracked
+    };
+
+    struct Sensor {
+        std::string id;
+        int64_t last_seen_ms = 0;
+        uint64_t updates = 0;
+        bool stale = false;
+    };
+
+    struct Counts {
+        size_t tracked = 0;
+        size_t stale = 0;
+        uint64_t untracked = 0;  // touches refused by max_sensors
+        uint64_t expirations = 0;
+    };
+
+    SensorRegistry() : SensorRegistry(Config()) {}
+    explicit SensorRegistry(const Config& config);
+    ~SensorRegistry();
+
+    SensorRegistry(const SensorRegistry&) = delete;
+    SensorRegistry& operator=(const SensorRegistry&) = delete;
+
+    const Config& config() const { return config_; }
+
+    // Records activity from `id` at `now_ms` (any monotonic millisecond clock,
+    // the same for every call). False when the sensor could not be tracked.
+    bool touch(const std::string& id, int64_t now_ms);
+
+    // Runs the wheel up to `now_ms`, then reports
+    Counts counts(int64_t now_ms);
+
+    // Sensors as of `now_ms`, least recently seen first, at most `limit`
+    std::vector<Sensor> list(int64_t now_ms, bool stale_only, size_t limit);
+
+private:
+    static constexpr unsigned kBits = 6;
+    static constexpr uint32_t kSlots = 1u << kBits;
+    static constexpr unsigned kLevels = 4;  // 2^24 ticks before a timer is re-filed from the top
+    static constexpr uint32_t kNone = UINT32_MAX;
+    static constexpr size_t kShards = 16;
+
+    struct Entry {
+        Sensor sensor;
+        uint64_t expires = 0;  // tick the timer is filed under, while armed
+        uint32_t next = kNone; // next timer in the same slot
+        bool armed = false;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, uint32_t> index;
+        std::vector<Entry> entries;
+        std::array<std::array<uint32_t, kSlots>, kLevels> wheel;  // slot list heads
+        uint64_t current_tick = 0;
+        bool started = false;  // current_tick is set on first use
+        size_t armed = 0;
+        size_t stale = 0;
+        uint64_t expirations = 0;
+    };
+
+    Shard& shard_for(const std::string& id);
+    void arm(Shard& shard, uint32_t index, int64_t deadline_ms);
+    void file(Shard& shard, uint32_t index);
+    void advance(Shard& shard, int64_t now_ms);
+    void tick(Shard& shard);
+    void fire(Shard& shard, uint32_t head);
+
+    Config config_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<size_t> tracked_{0};
+    std::atomic<uint64_t> untracked_{0};
+};
+
+} // namespace cpp_service
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "series_store.hpp"
+#include "token_bucket.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cpp_service {
+
+// Background upkeep for a SeriesStore. Every pass, per sensor:
+//
+//   retention   segments whose newest point is older than the sensor's
+//               retention (longest matching ID prefix, else the default)
+//               are dropped
+//   compaction  runs of sealed segments, oldest first, are merged into
+//               Gorilla-encoded segments of up to merge_points points,
+//               leaving the newest `hot_segments` as plain columns
+//
+// The work is kept out of the way of serving: every byte read or written is
+// paid for from a token bucket refilled at bytes_per_second, so a backlog
+// drains at a steady rate instead of in bursts, and on Linux the merges
+// themselves run under SCHED_IDLE. Sensors are split between workers by hash.
+// A worker takes the store's locks, so it stays at normal priority - an idle
+// thread preempted while holding one would stall ingest and queries - and
+// hands each run to its own idle-priority merge thread, which holds no lock
+// anyone else waits on.
+class SeriesCompactor {
+public:
+    struct Config {
+        unsigned threads = 1;                      // 0: passes only through compact_now()
+        std::chrono::milliseconds interval{1000};  // pause between passes
+        double bytes_per_second = 8.0 * 1024 * 1024;
+        double burst_bytes = 1024 * 1024;
+        size_t merge_points = 64 * 1024;
+        size_t hot_segments = 2;
+        int64_t retention_ms = 0;                  // 0 keeps everything
+        std::vector<std::pair<std::string, int64_t>> retention_by_prefix;
+        std::function<int64_t()> clock;            // ms, same unit as timestamps; system clock when empty
+    };
+
+    struct Stats {
+        uint64_t passes = 0;
+        uint64_t merged_segments = 0;   // inputs to merges
+        uint64_t written_segments = 0;  // their outputs
+        uint64_t bytes_read = 0;
+        uint64_t bytes_written = 0;
+        uint64_t expired_points = 0;
+        uint64_t throttled_ms = 0;      // waiting for the token bucket
+        size_t backlog_segments = 0;    // uncompacted eligible segments, as of each worker's last pass
+    };
+
+    SeriesCompactor(SeriesStore& store, const Config& config);
+    ~SeriesCompactor();  // stops between merges
+
+    SeriesCompactor(const SeriesCompactor&) = delete;
+    SeriesCompactor& operator=(const SeriesCompactor&) = delete;
+
+    const Config& config() const { return config_; }
+
+    // One full pass over every sensor on the calling thread
+    void compact_now();
+
+    // Retention for `sensor`, 0 when kept forever
+    int64_t retention_for(const std::string& sensor) const;
+
+    Stats stats() const;
+
+private:
+    // One worker's merge thread and the run it is handed
+    struct Merger {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<SeriesStore::SegmentPtr> run;
+        SeriesStore::SegmentPtr merged;
+        bool busy = false;  // `run` handed over, `merged` not back yet
+        bool stopping = false;
+    };
+
+    void worker_loop(unsigned index);
+    void merger_loop(Merger& merger);
+    // Handles sensors with hash % stride == index, merging on `merger` or,
+    // without one, on the calling thread; false once stopping
+    bool pass(unsigned index, unsigned stride, Merger* merger);
+    // `run` merged on `merger`'s thread; null once stopping
+    SeriesStore::SegmentPtr merge_on(Merger& merger, const std::vector<SeriesStore::SegmentPtr>& run);
+    int64_t now_ms() const;
+
+    SeriesStore& store_;
+    Config config_;
+
+    TokenBucket bucket_;
+    std::mutex mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> passes_{0};
+    std::atomic<uint64_t> merged_segments_{0};
+    std::atomic<uint64_t> written_segments_{0};
+    std::atomic<uint64_t> bytes_read_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> expired_points_{0};
+    std::atomic<uint64_t> throttled_ms_{0};
+    std::vector<std::atomic<size_t>> backlog_;  // per worker
+    std::vector<std::unique_ptr<Merger>> mergers_;  // per worker
+    std::vector<std::thread> workers_;
+};
+
+} // namespace cpp_service
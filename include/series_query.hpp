@@ -0,0 +1,55 @@
+#pragma once
+
+#include "series_store.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cpp_service {
+
+class ThreadPool;
+
+enum class SeriesAggregate { count, sum, avg, min, max, quantile };
+
+const char* series_aggregate_name(SeriesAggregate aggregate);
+bool parse_series_aggregate(const std::string& name, SeriesAggregate& aggregate);
+
+// One aggregate over the stored series, grouped by sensor (or across all
+// selected sensors) and by time bucket
+struct SeriesQuery {
+    std::string prefix;             // sensors whose ID starts with this; empty selects all
+    int64_t from = INT64_MIN;       // inclusive
+    int64_t to = INT64_MAX;         // inclusive
+    int64_t step = 0;               // bucket width, buckets aligned to timestamp 0; 0: one bucket
+    bool by_sensor = true;
+    SeriesAggregate aggregate = SeriesAggregate::avg;
+    double quantile = 0.5;          // for SeriesAggregate::quantile, in [0, 1]
+};
+
+struct SeriesQueryResult {
+    struct Bucket {
+        int64_t start = 0;          // the first point's timestamp when step is 0
+        uint64_t count = 0;
+        double value = 0.0;
+    };
+    struct Group {
+        std::string sensor;         // empty when not grouped by sensor
+        std::vector<Bucket> buckets;  // ascending, non-empty ones only
+    };
+    std::vector<Group> groups;      // by sensor ID
+    size_t segments_scanned = 0;
+    size_t segments_skipped = 0;    // excluded by their time bounds alone
+    uint64_t points_scanned = 0;    // within [from, to]
+};
+
+// Snapshots the selected series, then scans their segments in parallel on
+// `pool` (the calling thread alone when null). Segments outside [from, to]
+// are skipped on their bounds and the rest are cut to the range by binary
+// search before any value is read; compacted segments are decoded whole.
+// Each task folds its segments into per-(group, bucket) partials - count,
+// sum, min, max, and the values themselves for quantiles - which are merged
+// at the end. Quantiles are exact, interpolated linearly between order
+// statistics like numpy and pandas do by default.
+SeriesQueryResult run_series_query(const SeriesStore& store, const SeriesQuery& query, ThreadPool* pool);
+
+} // namespace cpp_service
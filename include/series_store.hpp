@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cpp_service {
+
+// Fused values per sensor, kept as time-ordered columns. Each series is a run
+// of sealed, immutable segments plus an open head that seals once it holds
+// `segment_points`. Readers take a snapshot - shared pointers to the sealed
+// segments and a copy of the head - and scan it without holding any lock, so
+// a long query never stalls ingest. SeriesCompactor later merges sealed
+// segments into Gorilla-encoded ones and applies retention.
+class SeriesStore {
+public:
+    struct Config {
+        size_t segment_points = 4096;
+    };
+
+    struct Point {
+        int64_t timestamp = 0;
+        double value = 0.0;
+    };
+
+    // One column pair, sorted by timestamp. A compacted segment holds the
+    // columns Gorilla-encoded instead, with its bounds kept alongside
+    struct Segment {
+        std::vector<int64_t> timestamps;
+        std::vector<double> values;
+        std::string encoded;
+        size_t encoded_count = 0;
+        int64_t encoded_first = 0;
+        int64_t encoded_last = 0;
+
+        bool compacted() const { return !encoded.empty(); }
+        size_t size() const { return compacted() ? encoded_count : timestamps.size(); }
+        int64_t first() const { return compacted() ? encoded_first : timestamps.front(); }
+        int64_t last() const { return compacted() ? encoded_last : timestamps.back(); }
+        size_t bytes() const {
+            return compacted() ? encoded.size() : size() * (sizeof(int64_t) + sizeof(double));
+        }
+    };
+    using SegmentPtr = std::shared_ptr<const Segment>;
+
+    // `segment` when it holds plain columns, else a decoded copy
+    static SegmentPtr columns(const SegmentPtr& segment);
+    // Consecutive segments of one series as a single compacted segment
+    static SegmentPtr merge(const std::vector<SegmentPtr>& run);
+
+    // A series as of one moment; segments are non-empty and do not overlap
+    struct Snapshot {
+        std::vector<SegmentPtr> segments;
+        size_t points() const;
+    };
+
+    struct Stats {
+        size_t sensors = 0;
+        size_t points = 0;
+        size_t segments = 0;     // sealed
+        size_t compacted_segments = 0;
+        size_t bytes = 0;        // column or encoded payload
+        uint64_t late_points = 0;  // older than a sealed segment, not stored
+    };
+
+    SeriesStore() : SeriesStore(Config()) {}
+    explicit SeriesStore(const Config& config);
+
+    // Points arriving out of order are slotted into the open head; a point
+    // older than the newest sealed segment is counted and dropped (false)
+    bool append(const std::string& sensor, int64_t timestamp, double value);
+
+    // False for a sensor with no points
+    bool snapshot(const std::string& sensor, Snapshot& out) const;
+    // Points stored for `sensor`
+    size_t points(const std::string& sensor) const;
+
+    std::vector<std::string> sensors() const;
+    Stats stats() const;
+
+    // Shard migration (see ShardRouter)
+
+    // Snapshots a series and empties it in one step, so a point appended
+    // meanwhile is either in `out` or left behind, never lost. False when
+    // there was nothing to take
+    bool take(const std::string& sensor, Snapshot& out);
+    // Adds sorted history handed over by another node. History that ends
+    // before the stored points, the usual case, becomes one sealed segment
+    // in front; anything interleaved is merged and re-segmented, with exact
+    // repeats kept once. Returns the points added
+    size_t import(const std::string& sensor, const std::vector<int64_t>& timestamps,
+                  const std::vector<double>& values);
+
+    // Maintenance, for SeriesCompactor. Sealed segments other than the newest
+    // `hot` ones are eligible for compaction.
+
+    // Drops segments (the head included) whose newest point is before
+    // `cutoff`; returns the number of points dropped
+    size_t expire(const std::string& sensor, int64_t cutoff);
+    // Eligible segments that still hold plain columns
+    size_t compaction_backlog(const std::string& sensor, size_t hot) const;
+    // The oldest run of eligible segments worth merging: two or more that
+    // together stay within `max_points`, or a single uncompacted one
+    bool compaction_run(const std::string& sensor, size_t hot, size_t max_points,
+                        std::vector<SegmentPtr>& run) const;
+    // Swaps `run` for `merged`; false if the run changed meanwhile
+    bool replace_run(const std::string& sensor, const std::vector<SegmentPtr>& run, SegmentPtr merged);
+
+private:
+    struct Series {
+        mutable std::mutex mutex;
+        std::vector<SegmentPtr> sealed;
+        Segment head;
+    };
+
+    Series* find(const std::string& sensor) const;
+    Series& find_or_create(const std::string& sensor);
+
+    Config config_;
+    mutable std::shared_mutex map_mutex_;  // guards the map, not the series
+    std::unordered_map<std::string, std::unique_ptr<Series>> series_;
+    std::atomic<uint64_t> late_points_{0};
+};
+
+} // namespace cpp_service
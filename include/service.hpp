@@ -5,22 +5,108 @@
 #include <memory>
 #include <chrono>
 #include <atomic>
+#include <map>
+#include <mutex>
+#include <optional>
+#include "bootstrap.hpp"
+#include "reading_validator.hpp"
 
 namespace cpp_service {
 
+class ThreadPool;
+
 class Service {
 public:
+    // Central estimator applied after the outlier gate
+    enum class FusionAlgorithm {
+        median,           // median of >= 3 readings, weighted average below that
+        trimmed_mean,     // mean after dropping trim_fraction from each tail
+        winsorized_mean,  // mean after clamping each tail to its trim_fraction quantile
+        huber,            // Huber M-estimate of location (IRLS from the median, MAD scale)
+        weighted,         // weighted median with request weights, closeness-weighted average without
+        sketch,           // approximate median from two histogram passes; no copy, no reordering
+        automatic,        // cheapest of median / sketch meeting the requested tolerance
+    };
+    
+    static const char* algorithm_name(FusionAlgorithm algorithm);
+    // Accepts the names above ("auto" for automatic) and "trimmed"
+    static bool parse_algorithm(const std::string& name, FusionAlgorithm& algorithm);
+    
+    // Predicted estimator cost: fixed_ns + per_item_ns * n
+    struct CostModel {
+        double fixed_ns = 0.0;
+        double per_item_ns = 0.0;
+    };
+    
+    // Per-request fusion options
+    struct FusionOptions {
+        std::optional<FusionAlgorithm> algorithm;  // Overrides the configured algorithm
+        double tolerance = 0.0;        // Absolute error allowed from the exact median (auto mode)
+        bool interval = false;         // Bootstrap a confidence interval for the fused value
+        double interval_level = 0.95;  // Coverage of that interval, in (0, 1)
+        double deadline_ms = 10.0;     // Time budget that scales the resample count
+        uint32_t max_resamples = 2000;
+        bool parallel = false;         // Let a large exact median fan out over the worker pool
+        bool record = true;            // false leaves statistics and fusion metrics untouched (shadow runs)
+    };
+    
+    struct FusionResult {
+        double value = 0.0;
+        double confidence = 0.0;  // Heuristic in [0, 1]: retention rate x 1 / (1 + CV)
+        bool has_interval = false;
+        double interval_low = 0.0;
+        double interval_high = 0.0;
+        uint32_t resamples = 0;
+        FusionAlgorithm algorithm = FusionAlgorithm::median;  // Estimator actually used
+    };
+    
+    // Configuration
+    struct Config {
+        double outlier_threshold = 3.0;  // Standard deviations
+        double min_confidence = 0.8;     // Minimum confidence for fusion
+        bool enable_outlier_detection = true;
+        bool reproducible_summation = false;  // Exact, order-independent sums
+        FusionAlgorithm algorithm = FusionAlgorithm::median;
+        double trim_fraction = 0.1;      // Per tail, in [0, 0.5)
+        ReadingLimits reading_limits;
+        // Used by auto mode; defaults come from benchmarks/fusion_bench --cost-model
+        std::map<FusionAlgorithm, CostModel> cost_model = default_cost_model();
+    };
+    
     Service();
-    ~Service() = default;
+    ~Service();
     
     // Core service operations
     std::string health_check() const;
+    FusionResult fuse(const std::vector<double>& readings, const std::vector<double>& weights,
+                      const FusionOptions& options) const;
+    // Same, with a configuration taken earlier by config_snapshot(). Takes no
+    // lock unless `options` records, asks for an interval or allows parallel.
+    FusionResult fuse(const std::vector<double>& readings, const std::vector<double>& weights,
+                      const FusionOptions& options, const Config& config) const;
     double fuse_readings(const std::vector<double>& readings) const;
+    // Readings with caller-supplied reliability weights (one finite, non-negative
+    // weight per reading) are fused with the weighted median; an empty `weights`
+    // behaves like the overload above. Throws std::invalid_argument on bad weights.
+    double fuse_readings(const std::vector<double>& readings, const std::vector<double>& weights) const;
+    // `weights` is either empty or parallel to `batches`; an empty entry means unweighted
+    std::vector<double> fuse_batch(const std::vector<std::vector<double>>& batches,
+                                   const std::vector<std::vector<double>>& weights = {}) const;
+    std::vector<double> fuse_batch(const std::vector<std::vector<double>>& batches,
+                                   const std::vector<std::vector<double>>& weights,
+                                   const FusionOptions& options) const;
     
-    // Configuration
+    // Empty if `weights` is usable with `readings`, otherwise the reason it is not
+    static std::string validate_weights(const std::vector<double>& readings, const std::vector<double>& weights);
+    
+    // Configuration (JSON object; unknown keys are ignored, bad values throw std::invalid_argument)
     void set_config(const std::string& config_json);
     std::string get_config() const;
     
+    // Policy and range the request decoders apply to readings. fuse() itself
+    // trusts its input: validation happens once, while numbers are parsed.
+    ReadingLimits reading_limits() const;
+    
     // Statistics
     struct Stats {
         uint64_t total_requests = 0;
@@ -33,15 +119,14 @@ public:
     Stats get_stats() const;
     void reset_stats();
     
+    // Copy of the configuration taken once per request
+    Config config_snapshot() const;
+    
 private:
-    // Configuration
-    struct Config {
-        double outlier_threshold = 3.0;  // Standard deviations
-        double min_confidence = 0.8;     // Minimum confidence for fusion
-        bool enable_outlier_detection = true;
-    };
+    static std::map<FusionAlgorithm, CostModel> default_cost_model();
     
     Config config_;
+    mutable std::mutex config_mutex_;
     mutable std::atomic<uint64_t> total_requests_{0};
     mutable std::atomic<uint64_t> successful_requests_{0};
     mutable std::atomic<uint64_t> failed_requests_{0};
@@ -49,16 +134,46 @@ private:
     mutable std::atomic<uint64_t> fused_count_{0};
     const std::chrono::steady_clock::time_point start_time_;
     
+    // Bootstrap state shared across requests
+    mutable std::once_flag pool_once_;
+    mutable std::unique_ptr<ThreadPool> pool_;
+    mutable BootstrapIndexCache bootstrap_cache_;
+    mutable std::atomic<double> bootstrap_ns_per_point_{20.0};  // Measured cost model
+    
+    ThreadPool& pool() const;
+    
+    // Picks median or sketch for auto mode from the cost model and the
+    // sketch's error bound; other algorithms are returned unchanged
+    FusionAlgorithm resolve_algorithm(FusionAlgorithm algorithm, const std::vector<double>& values,
+                                      double tolerance, const Config& config) const;
+    // Runs `algorithm` on `values`, which may be reordered; weights always
+    // select the weighted median. `algorithm` is updated if sketch has to
+    // fall back to the exact median to honour `tolerance`. `parallel` lets a
+    // large exact median use the pool (never from inside a pool task).
+    double estimate(std::vector<double>& values, const std::vector<double>& weights, const Config& config,
+                    FusionAlgorithm& algorithm, double tolerance, bool parallel) const;
+    void bootstrap_interval(const std::vector<double>& values, const std::vector<double>& weights,
+                            const Config& config, FusionAlgorithm algorithm, const FusionOptions& options,
+                            FusionResult& result) const;
+    
     // Fusion algorithms
-    double weighted_average(const std::vector<double>& readings) const;
+    double weighted_average(const std::vector<double>& readings, const Config& config) const;
     double median_filter(const std::vector<double>& readings) const;
-    std::vector<double> detect_outliers(const std::vector<double>& readings) const;
-    double calculate_confidence(const std::vector<double>& readings, const std::vector<double>& filtered) const;
+    // Selection-based; reorder `values` in place
+    double trimmed_mean(std::vector<double>& values, const Config& config) const;
+    double winsorized_mean(std::vector<double>& values, const Config& config) const;
+    double huber_estimate(std::vector<double>& values, const Config& config) const;
+    double weighted_median(const std::vector<double>& values, const std::vector<double>& weights) const;
+    // Readings within outlier_threshold standard deviations of the mean; when
+    // `weights` is non-empty the weights of kept readings go to `kept_weights`
+    std::vector<double> filter_outliers(const std::vector<double>& readings, const std::vector<double>& weights,
+                                        const Config& config, std::vector<double>& kept_weights) const;
+    double calculate_confidence(const std::vector<double>& readings, const std::vector<double>& filtered,
+                                const Config& config) const;
     
     // Utility functions
-    double calculate_mean(const std::vector<double>& values) const;
-    double calculate_std_dev(const std::vector<double>& values, double mean) const;
-    void sort_vector(std::vector<double>& values) const;
+    double calculate_mean(const std::vector<double>& values, const Config& config) const;
+    double calculate_std_dev(const std::vector<double>& values, double mean, const Config& config) const;
 };
 
 } // namespace cpp_service
\ No newline at end of file
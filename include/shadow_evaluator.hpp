@@ -0,0 +1,122 @@
+#pragma once
+
+#include "service.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cpp_service {
+
+// Off-path comparison of an alternative estimator against the one serving
+// /fuse. An evenly spaced fraction of requests is handed over once their
+// response is built; worker threads then fuse the same readings with both the
+// served options and the alternative, timing each in thread CPU time, and
+// record how far the alternative lands from the value that was served:
+//
+//   shadow_cpu_us{pipeline="served"|"shadow",algorithm}   histogram
+//   shadow_diff_ppm{algorithm}     |shadow - served| / |served|, histogram
+//   shadow_requests_total{outcome="evaluated"|"queue_full"|"stale"|"failed"}
+//
+// Shadow work is the first thing shed under load. offer() never waits: a
+// full or contended queue drops the request, a job that sat in the queue past
+// max_delay is dropped unrun, and on Linux the workers run under SCHED_IDLE so
+// they only get CPU the serving threads leave unused. An idle-priority thread
+// can be preempted indefinitely, so the workers hold no lock a serving thread
+// waits on: each job carries the configuration captured when it was offered,
+// and outcomes reach Metrics through a normal-priority publisher thread.
+class ShadowEvaluator {
+public:
+    struct Config {
+        Service::FusionAlgorithm algorithm = Service::FusionAlgorithm::huber;
+        double tolerance = 0.0;     // for sketch / automatic
+        double sample_rate = 0.01;  // fraction of /fuse requests shadowed
+        unsigned threads = 1;
+        size_t max_queue = 64;
+        std::chrono::milliseconds max_delay{1000};
+    };
+
+    struct Stats {
+        uint64_t sampled = 0;
+        uint64_t evaluated = 0;
+        uint64_t shed_queue_full = 0;
+        uint64_t shed_stale = 0;
+        uint64_t failed = 0;
+    };
+
+    ShadowEvaluator(const Service& service, const Config& config);
+    ~ShadowEvaluator();  // drops whatever is still queued
+
+    ShadowEvaluator(const ShadowEvaluator&) = delete;
+    ShadowEvaluator& operator=(const ShadowEvaluator&) = delete;
+
+    const Config& config() const { return config_; }
+
+    // Called from any serving thread after `served` was computed from
+    // `readings` with `options`. Takes the readings (leaving `readings`
+    // empty) only when the request is sampled and queued. Weighted requests
+    // are skipped: weights always select the weighted median, so there is
+    // nothing to compare.
+    bool offer(std::vector<double>& readings, const std::vector<double>& weights,
+               const Service::FusionOptions& options, const Service::FusionResult& served);
+
+    Stats stats() const;
+
+    // Blocks until the queue is empty, no job is running and every outcome
+    // is published
+    void wait_idle();
+
+private:
+    struct Job {
+        std::vector<double> readings;
+        Service::FusionOptions options;
+        Service::Config config;
+        double served_value = 0.0;
+        std::chrono::steady_clock::time_point queued;
+    };
+
+    // What a worker hands the publisher
+    struct Outcome {
+        enum class Kind { evaluated, stale, failed };
+        Kind kind = Kind::evaluated;
+        Service::FusionAlgorithm served_algorithm = Service::FusionAlgorithm::median;
+        double served_cpu_us = 0.0;
+        double shadow_cpu_us = 0.0;
+        double diff_ppm = 0.0;
+    };
+
+    void worker_loop();
+    void publisher_loop();
+    Outcome evaluate(const Job& job);
+    void publish(const Outcome& outcome);
+
+    const Service& service_;
+    Config config_;
+    std::string algorithm_label_;
+    std::atomic<uint64_t> offered_{0};
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    std::condition_variable publish_cv_;
+    std::deque<Job> queue_;
+    std::vector<Outcome> outcomes_;  // not yet published
+    size_t running_jobs_ = 0;
+    bool publishing_ = false;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> sampled_{0};
+    std::atomic<uint64_t> evaluated_{0};
+    std::atomic<uint64_t> shed_queue_full_{0};
+    std::atomic<uint64_t> shed_stale_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::vector<std::thread> workers_;
+    std::thread publisher_;
+};
+
+} // namespace cpp_service
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "membership.hpp"
+#include "series_store.hpp"
+#include "token_bucket.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace simple_http {
+class Client;
+}
+
+namespace cpp_service {
+
+// Sensor-sharded routing over the gossip membership, with online rebalancing.
+//
+// Each sensor is owned by one member, picked by rendezvous hashing over the
+// alive and suspect members: the one scoring highest on hash(member, sensor).
+// A join or departure therefore moves only the sensors the changed member
+// wins or held, spread evenly over the others.
+//
+// When the ring changes, a background thread hands the local sensors that
+// moved away to their new owners. Per sensor it streams a snapshot of the
+// stored series, newest points first, as Gorilla batches of up to
+// chunk_points points to the owner's POST /cluster/migrate, paced by a token
+// bucket so the transfer cannot crowd out live traffic. Only once the
+// owner has it all does the sensor stop being served here; its series is
+// then taken from the store and whatever arrived since the snapshot follows.
+// Once its queue is empty the thread tells every member its handoff is done.
+// Until then ownership is dual: the old owner serves the sensors it has not
+// handed over, and the new owner forwards requests for sensors it gained to
+// their previous owner, so nothing is served from a half-copied series. A
+// handoff that never completes (a crashed peer) is abandoned after
+// handoff_timeout. Forwarded requests carry a hop count, and a request
+// that has been forwarded max_hops times is served wherever it lands, the
+// new owner's forward to the previous owner included, so differing ring
+// views cannot bounce a request between two members.
+//
+// POST /cluster/migrate shares the public HTTP port, so it is accepted only
+// from ring members (current or, mid-handoff, previous): the X-Fuser-Member
+// header must name one, and the connection must come from the address its
+// gossip does.
+class ShardRouter {
+public:
+    struct Config {
+        double bytes_per_second = 4.0 * 1024 * 1024;  // migration traffic, encoded; 0 is unthrottled
+        double burst_bytes = 256 * 1024;
+        size_t chunk_points = 16 * 1024;              // per migration request
+        std::chrono::milliseconds handoff_timeout{30000};
+        std::chrono::milliseconds poll_interval{50};  // membership checks
+        unsigned max_hops = 2;
+        // Called for every sensor whose history arrives, on the receiving thread
+        std::function<void(const std::string& sensor)> on_import;
+    };
+
+    // Where to serve a request: here, or at a member's HTTP port
+    struct Route {
+        bool local = true;
+        std::string host;
+        uint16_t port = 0;
+    };
+
+    struct Stats {
+        size_t ring_members = 0;
+        uint64_t ring_changes = 0;
+        size_t queued_sensors = 0;      // waiting to be handed over
+        size_t pending_handoffs = 0;    // members yet to finish handing over to this node
+        uint64_t sensors_sent = 0;
+        uint64_t points_sent = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t chunks_sent = 0;
+        uint64_t chunks_failed = 0;     // restored locally and retried
+        uint64_t points_received = 0;
+        uint64_t chunks_received = 0;
+        uint64_t throttled_ms = 0;
+    };
+
+    // `series` may be null, leaving no state to migrate
+    ShardRouter(Membership& membership, SeriesStore* series, const Config& config);
+    ~ShardRouter();  // stops between chunks
+
+    ShardRouter(const ShardRouter&) = delete;
+    ShardRouter& operator=(const ShardRouter&) = delete;
+
+    const Config& config() const { return config_; }
+
+    // For a request about `sensor` that has been forwarded `hops` times
+    Route route(const std::string& sensor, unsigned hops) const;
+
+    // Whether a POST /cluster/migrate claiming to be from member `id` may be
+    // taken from a connection at `address`
+    bool accepts_from(const std::string& id, const std::string& address) const;
+    // Body of a POST /cluster/migrate; false with `error` set when the
+    // batch does not decode, or would decode to more than `max_decoded_bytes`
+    bool receive(const std::string& body, std::string& error,
+                 size_t max_decoded_bytes = std::numeric_limits<size_t>::max());
+    // Member `from` has handed over everything it held that `ring` (its
+    // ring_fingerprint()) assigns elsewhere
+    void handoff_done(const std::string& from, uint64_t ring);
+    uint64_t ring_fingerprint() const;
+
+    Stats stats() const;
+
+    // Member ID owning `sensor` among `ring`; empty for an empty ring
+    static std::string owner(const std::vector<Membership::Member>& ring, const std::string& sensor);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Outbound points of one sensor
+    struct Piece {
+        std::string sensor;
+        std::vector<int64_t> timestamps;
+        std::vector<double> values;
+    };
+
+    void loop();
+    // Adopts the current membership as the ring; queues what moved away
+    void rebuild();
+    // Queues local sensors with points that this node no longer owns
+    void queue_moved();
+    // Queues a sensor whose handoff failed, to be streamed again
+    void requeue(const std::string& sensor);
+    // Streams queued sensors until the queue is empty; false when a batch
+    // failed (its sensors are queued again) or stopping
+    bool drain();
+    // Sends `pieces`, then hands over the sensors in `complete`, whose
+    // points were all in it or in earlier batches
+    bool flush(const std::string& target, std::vector<Piece>& pieces, std::vector<Piece>& complete);
+    // Stops serving a streamed sensor here, takes it from the store and
+    // sends the points `sent` is missing
+    bool hand_over(const std::string& target, const Piece& sent);
+    bool send_pieces(const std::string& target, const std::vector<Piece>& pieces);
+    void announce_done();
+    // POST /cluster/migrate to member `target`; an empty body is the done notice
+    bool post(const std::string& target, const std::string& body);
+    const Membership::Member* member(const std::string& id) const;  // in ring_, under mutex_
+
+    Membership& membership_;
+    SeriesStore* series_;
+    Config config_;
+    TokenBucket bucket_;
+
+    mutable std::shared_mutex mutex_;  // ring and ownership state
+    std::vector<Membership::Member> ring_;           // alive and suspect, by ID
+    std::vector<Membership::Member> previous_ring_;
+    uint64_t fingerprint_ = 0;
+    std::deque<std::string> queue_;
+    std::unordered_set<std::string> queued_;         // still served here, queued or streaming
+    std::unordered_map<std::string, Clock::time_point> handoffs_;  // from members, with deadlines
+    std::unordered_map<std::string, uint64_t> done_;  // latest done notice per member
+    bool announce_ = false;                          // owe members a done notice
+    Clock::time_point sweep_until_;                  // recheck for stragglers after a change
+
+    // Migration thread only
+    std::unordered_map<std::string, std::unique_ptr<simple_http::Client>> clients_;
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stopping_ = false;
+
+    std::atomic<uint64_t> ring_changes_{0};
+    std::atomic<uint64_t> sensors_sent_{0};
+    std::atomic<uint64_t> points_sent_{0};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> chunks_sent_{0};
+    std::atomic<uint64_t> chunks_failed_{0};
+    std::atomic<uint64_t> points_received_{0};
+    std::atomic<uint64_t> chunks_received_{0};
+    std::atomic<uint64_t> throttled_ms_{0};
+    std::thread thread_;
+};
+
+} // namespace cpp_service
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace cpp_service {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. The two indices sit on separate cache lines and each side keeps a
+// private copy of the other's index, refreshed only when the ring looks full
+// (or empty), so a steady stream of pushes and pops shares one line per slot.
+template <typename T>
+class SpscRing {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots_.reset(new T[size]);
+        mask_ = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Producer side; false (leaving `value` untouched) when full
+    bool try_push(T&& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; false when empty
+    bool try_pop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) return false;
+        }
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate unless called from the consumer
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    std::unique_ptr<T[]> slots_;
+    size_t mask_ = 0;
+    alignas(kCacheLine) std::atomic<size_t> head_{0};  // next slot to pop
+    size_t cached_tail_ = 0;                           // consumer's view of tail_
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};  // next slot to fill
+    size_t cached_head_ = 0;                           // producer's view of head_
+};
+
+} // namespace cpp_service
@@ -0,0 +1,128 @@
+/*
+ * C ABI for in-process fusion: libtelemetry_fuser.so.
+ *
+ * The same Service that backs POST /fuse and /fuse/batch, without HTTP, for
+ * consumers that embed it (Python through ctypes or cffi, Go through cgo).
+ * Only plain C types cross the boundary: readings go in as pointer plus
+ * length, results come back in caller-owned structs and buffers, and C++
+ * exceptions never escape - every call returns a tf_status, with the
+ * message for the calling thread in tf_last_error().
+ *
+ * Threads: a tf_service may be used from any number of threads at once. A
+ * tf_workspace holds the scratch a call needs, so repeated calls through
+ * one reuse its buffers instead of allocating; give each thread its own.
+ * Passing NULL for the workspace uses one kept per thread.
+ *
+ * Compatibility: functions are only ever added. tf_options carries its own
+ * size so fields can be appended; initialise it with tf_options_init().
+ */
+#ifndef TELEMETRY_FUSER_H
+#define TELEMETRY_FUSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define TF_API __declspec(dllexport)
+#else
+#define TF_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TF_ABI_VERSION 1
+
+typedef struct tf_service tf_service;
+typedef struct tf_workspace tf_workspace;
+
+typedef enum {
+    TF_OK = 0,
+    TF_INVALID_ARGUMENT = 1,  /* bad readings, weights, options or configuration */
+    TF_BUFFER_TOO_SMALL = 2,  /* the caller's output buffer cannot hold the result */
+    TF_OUT_OF_MEMORY = 3,
+    TF_INTERNAL_ERROR = 4
+} tf_status;
+
+/* Estimators, as named in the HTTP API ("algorithm") */
+typedef enum {
+    TF_ALGORITHM_DEFAULT = -1,  /* the service's configured fusion_algorithm */
+    TF_ALGORITHM_MEDIAN = 0,
+    TF_ALGORITHM_TRIMMED_MEAN = 1,
+    TF_ALGORITHM_WINSORIZED_MEAN = 2,
+    TF_ALGORITHM_HUBER = 3,
+    TF_ALGORITHM_WEIGHTED = 4,
+    TF_ALGORITHM_SKETCH = 5,
+    TF_ALGORITHM_AUTO = 6
+} tf_algorithm;
+
+typedef struct {
+    uint32_t struct_size;     /* sizeof(tf_options), set by tf_options_init() */
+    int32_t algorithm;        /* tf_algorithm */
+    double tolerance;         /* absolute error allowed from the exact median (auto) */
+    int32_t interval;         /* non-zero: bootstrap a confidence interval */
+    double interval_level;    /* its coverage, in (0, 1) */
+    double deadline_ms;       /* time budget that scales the resample count */
+    uint32_t max_resamples;
+    int32_t parallel;         /* non-zero: a large exact median may use the worker pool */
+} tf_options;
+
+typedef struct {
+    double value;
+    double confidence;
+    int32_t algorithm;        /* tf_algorithm actually used */
+    int32_t has_interval;
+    double interval_low;
+    double interval_high;
+    uint32_t resamples;
+} tf_result;
+
+/* TF_ABI_VERSION of the loaded library */
+TF_API uint32_t tf_abi_version(void);
+
+/* Message for the last failed call on this thread; "" after a success */
+TF_API const char* tf_last_error(void);
+
+/* Name of an algorithm as the HTTP API spells it, or NULL */
+TF_API const char* tf_algorithm_name(int32_t algorithm);
+
+TF_API void tf_options_init(tf_options* options);
+
+/* NULL on failure */
+TF_API tf_service* tf_service_create(void);
+TF_API void tf_service_destroy(tf_service* service);
+
+/* The JSON document POST /config accepts */
+TF_API tf_status tf_service_configure(tf_service* service, const char* config_json);
+
+/* Writes the JSON configuration, NUL-terminated, into `buffer`. `required`
+ * (if not NULL) receives the size needed including the terminator; with a
+ * smaller `capacity` the call returns TF_BUFFER_TOO_SMALL */
+TF_API tf_status tf_service_config(const tf_service* service, char* buffer, size_t capacity, size_t* required);
+
+/* NULL on failure */
+TF_API tf_workspace* tf_workspace_create(void);
+TF_API void tf_workspace_destroy(tf_workspace* workspace);
+
+/* Fuses `count` readings. `weights` is NULL or parallel to `readings`;
+ * `options` NULL means defaults. */
+TF_API tf_status tf_fuse(tf_service* service, tf_workspace* workspace,
+                         const double* readings, size_t count, const double* weights,
+                         const tf_options* options, tf_result* result);
+
+/* Fuses `batch_count` batches laid out back to back: batch i is
+ * readings[offsets[i]] up to readings[offsets[i + 1]], so `offsets` has
+ * batch_count + 1 non-decreasing entries and no batch may be empty.
+ * `weights` is NULL or indexed like `readings`. Fused values go to
+ * `values`, which must hold batch_count entries. */
+TF_API tf_status tf_fuse_batch(tf_service* service, tf_workspace* workspace,
+                               const double* readings, const size_t* offsets, size_t batch_count,
+                               const double* weights, const tf_options* options,
+                               double* values, size_t values_capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_FUSER_H */
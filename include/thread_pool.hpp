@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpp_service {
+
+// Fixed-size worker pool for CPU-bound fan-out inside a request. Tasks run in
+// FIFO order; the destructor drains the queue and joins the workers.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    std::future<void> submit(std::function<void()> task);
+
+    // Calls fn(begin, end) over contiguous chunks of [0, count), using the
+    // workers plus the calling thread, and returns when every chunk is done.
+    // The first exception thrown by a chunk is rethrown here. Must not be
+    // called from inside a pool task.
+    void parallel_for(size_t count, const std::function<void(size_t, size_t)>& fn);
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::packaged_task<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+} // namespace cpp_service
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace cpp_service {
+
+// Byte-rate budget shared by background jobs (compaction, shard migration).
+// take() never blocks: it spends first and returns how long the caller must
+// pause to pay off any debt, so one large item is never starved by a bucket
+// smaller than it. A rate of 0 or less is unlimited.
+class TokenBucket {
+public:
+    TokenBucket(double bytes_per_second, double burst_bytes);
+
+    std::chrono::nanoseconds take(size_t bytes);
+
+    // take(), then sleeps off the debt on `stop_cv` unless `stopping` (guarded
+    // by `stop_mutex`) is set first; false once stopping. The time slept is
+    // added to `throttled_ms`.
+    bool pay(size_t bytes, std::mutex& stop_mutex, std::condition_variable& stop_cv, const bool& stopping,
+             std::atomic<uint64_t>& throttled_ms);
+
+private:
+    std::mutex mutex_;
+    double rate_;
+    double burst_;
+    double tokens_;
+    std::chrono::steady_clock::time_point refilled_;
+};
+
+} // namespace cpp_service
@@ -0,0 +1,579 @@
+#include "binary_codec.hpp"
+#include "reading_validator.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+namespace cpp_service {
+
+namespace {
+
+constexpr int kMaxNestingDepth = 64;
+
+const char* format_name(BinaryFormat format) {
+    return format == BinaryFormat::msgpack ? "MessagePack" : "CBOR";
+}
+
+// Single-pass cursor over a MessagePack or CBOR buffer. Strings are returned as
+// views into the input; nothing is copied except the numbers the caller asks for.
+class BinaryReader {
+public:
+    BinaryReader(BinaryFormat format, const std::string& body)
+        : format_(format),
+          p_(reinterpret_cast<const uint8_t*>(body.data())),
+          end_(p_ + body.size()) {}
+
+    bool done() const { return p_ == end_; }
+    size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+
+    bool is_array() const {
+        if (done()) return false;
+        uint8_t b = *p_;
+        if (format_ == BinaryFormat::msgpack) return (b >= 0x90 && b <= 0x9f) || b == 0xdc || b == 0xdd;
+        return (b >> 5) == 4;
+    }
+
+    bool is_map() const {
+        if (done()) return false;
+        uint8_t b = *p_;
+        if (format_ == BinaryFormat::msgpack) return (b >= 0x80 && b <= 0x8f) || b == 0xde || b == 0xdf;
+        return (b >> 5) == 5;
+    }
+
+    // CBOR indefinite-length containers end with a 0xff "break"
+    bool consume_break() {
+        if (format_ == BinaryFormat::cbor && !done() && *p_ == 0xff) {
+            ++p_;
+            return true;
+        }
+        return false;
+    }
+
+    bool read_array(size_t& count, bool& indefinite) {
+        indefinite = false;
+        if (done()) return false;
+        uint8_t b = *p_;
+        if (format_ == BinaryFormat::msgpack) {
+            ++p_;
+            if (b >= 0x90 && b <= 0x9f) { count = b & 0x0f; return true; }
+            if (b == 0xdc) return read_be(2, count);
+            if (b == 0xdd) return read_be(4, count);
+            return false;
+        }
+        return cbor_container(4, count, indefinite);
+    }
+
+    bool read_map(size_t& count, bool& indefinite) {
+        indefinite = false;
+        if (done()) return false;
+        uint8_t b = *p_;
+        if (format_ == BinaryFormat::msgpack) {
+            ++p_;
+            if (b >= 0x80 && b <= 0x8f) { count = b & 0x0f; return true; }
+            if (b == 0xde) return read_be(2, count);
+            if (b == 0xdf) return read_be(4, count);
+            return false;
+        }
+        return cbor_container(5, count, indefinite);
+    }
+
+    bool read_string(const char*& data, size_t& length) {
+        if (done()) return false;
+        uint8_t b = *p_++;
+        if (format_ == BinaryFormat::msgpack) {
+            if (b >= 0xa0 && b <= 0xbf) {
+                length = b & 0x1f;
+            } else if (b == 0xd9 || b == 0xda || b == 0xdb) {
+                if (!read_be(1 << (b - 0xd9), length)) return false;
+            } else {
+                return false;
+            }
+        } else {
+            uint64_t argument = 0;
+            if ((b >> 5) != 3 || (b & 0x1f) == 31 || !cbor_argument(b & 0x1f, argument)) return false;
+            length = static_cast<size_t>(argument);
+        }
+        if (remaining() < length) return false;
+        data = reinterpret_cast<const char*>(p_);
+        p_ += length;
+        return true;
+    }
+
+    bool read_number(double& out) {
+        if (done()) return false;
+        uint8_t b = *p_++;
+        if (format_ == BinaryFormat::msgpack) {
+            if (b <= 0x7f) { out = b; return true; }
+            if (b >= 0xe0) { out = static_cast<int8_t>(b); return true; }
+            uint64_t raw = 0;
+            switch (b) {
+                case 0xca: {
+                    if (!read_raw(4, raw)) return false;
+                    auto bits = static_cast<uint32_t>(raw);
+                    float f;
+                    std::memcpy(&f, &bits, sizeof(f));
+                    out = static_cast<double>(f);
+                    return true;
+                }
+                case 0xcb:
+                    if (!read_raw(8, raw)) return false;
+                    std::memcpy(&out, &raw, sizeof(out));
+                    return true;
+                case 0xcc: case 0xcd: case 0xce: case 0xcf:
+                    if (!read_raw(1 << (b - 0xcc), raw)) return false;
+                    out = static_cast<double>(raw);
+                    return true;
+                case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+                    int bytes = 1 << (b - 0xd0);
+                    if (!read_raw(bytes, raw)) return false;
+                    // Sign-extend from the encoded width
+                    int shift = 64 - 8 * bytes;
+                    out = static_cast<double>(static_cast<int64_t>(raw << shift) >> shift);
+                    return true;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        uint8_t major = b >> 5;
+        uint8_t info = b & 0x1f;
+        uint64_t argument = 0;
+        // Tagged number (e.g. epoch time): a tag does not change the value. Tags
+        // are peeled in a loop, no more of them than skip() allows nesting
+        for (int tags = 0; major == 6; ++tags) {
+            if (tags >= kMaxNestingDepth || !cbor_argument(info, argument) || done()) return false;
+            b = *p_++;
+            major = b >> 5;
+            info = b & 0x1f;
+        }
+        switch (major) {
+            case 0:
+                if (!cbor_argument(info, argument)) return false;
+                out = static_cast<double>(argument);
+                return true;
+            case 1:
+                if (!cbor_argument(info, argument)) return false;
+                out = -1.0 - static_cast<double>(argument);
+                return true;
+            case 7:
+                if (info == 25) {
+                    if (!read_raw(2, argument)) return false;
+                    out = half_to_double(static_cast<uint16_t>(argument));
+                    return true;
+                }
+                if (info == 26) {
+                    if (!read_raw(4, argument)) return false;
+                    auto bits = static_cast<uint32_t>(argument);
+                    float f;
+                    std::memcpy(&f, &bits, sizeof(f));
+                    out = static_cast<double>(f);
+                    return true;
+                }
+                if (info == 27) {
+                    if (!read_raw(8, argument)) return false;
+                    std::memcpy(&out, &argument, sizeof(out));
+                    return true;
+                }
+                return false;
+            default:
+                return false;
+        }
+    }
+
+    bool skip(int depth = 0) {
+        if (done() || depth > kMaxNestingDepth) return false;
+        return format_ == BinaryFormat::msgpack ? skip_msgpack(depth) : skip_cbor(depth);
+    }
+
+private:
+    bool read_raw(int bytes, uint64_t& value) {
+        if (remaining() < static_cast<size_t>(bytes)) return false;
+        value = 0;
+        for (int i = 0; i < bytes; ++i) value = (value << 8) | *p_++;
+        return true;
+    }
+
+    bool read_be(int bytes, size_t& value) {
+        uint64_t raw = 0;
+        if (!read_raw(bytes, raw)) return false;
+        value = static_cast<size_t>(raw);
+        return true;
+    }
+
+    bool advance(uint64_t bytes) {
+        if (remaining() < bytes) return false;
+        p_ += bytes;
+        return true;
+    }
+
+    bool cbor_argument(uint8_t info, uint64_t& argument) {
+        if (info < 24) { argument = info; return true; }
+        if (info <= 27) return read_raw(1 << (info - 24), argument);
+        return false;
+    }
+
+    bool cbor_container(uint8_t expected_major, size_t& count, bool& indefinite) {
+        uint8_t b = *p_++;
+        if ((b >> 5) != expected_major) return false;
+        if ((b & 0x1f) == 31) {
+            indefinite = true;
+            count = 0;
+            return true;
+        }
+        uint64_t argument = 0;
+        if (!cbor_argument(b & 0x1f, argument)) return false;
+        count = static_cast<size_t>(argument);
+        return true;
+    }
+
+    static double half_to_double(uint16_t half) {
+        int exponent = (half >> 10) & 0x1f;
+        double mantissa = half & 0x3ff;
+        double value;
+        if (exponent == 0) {
+            value = std::ldexp(mantissa, -24);
+        } else if (exponent == 31) {
+            value = mantissa == 0 ? INFINITY : NAN;
+        } else {
+            value = std::ldexp(mantissa + 1024, exponent - 25);
+        }
+        return (half & 0x8000) ? -value : value;
+    }
+
+    bool skip_msgpack(int depth) {
+        uint8_t b = *p_++;
+        size_t length = 0;
+        if (b <= 0x7f || b >= 0xe0 || b == 0xc0 || b == 0xc2 || b == 0xc3) return true;
+        if (b >= 0xa0 && b <= 0xbf) return advance(b & 0x1f);
+        if (b >= 0x90 && b <= 0x9f) return skip_items(b & 0x0f, depth);
+        if (b >= 0x80 && b <= 0x8f) return skip_items(2 * static_cast<size_t>(b & 0x0f), depth);
+        switch (b) {
+            case 0xc4: case 0xd9: return read_be(1, length) && advance(length);
+            case 0xc5: case 0xda: return read_be(2, length) && advance(length);
+            case 0xc6: case 0xdb: return read_be(4, length) && advance(length);
+            case 0xc7: return read_be(1, length) && advance(length + 1);
+            case 0xc8: return read_be(2, length) && advance(length + 1);
+            case 0xc9: return read_be(4, length) && advance(length + 1);
+            case 0xca: return advance(4);
+            case 0xcb: return advance(8);
+            case 0xcc: case 0xd0: return advance(1);
+            case 0xcd: case 0xd1: return advance(2);
+            case 0xce: case 0xd2: return advance(4);
+            case 0xcf: case 0xd3: return advance(8);
+            case 0xd4: return advance(2);
+            case 0xd5: return advance(3);
+            case 0xd6: return advance(5);
+            case 0xd7: return advance(9);
+            case 0xd8: return advance(17);
+            case 0xdc: return read_be(2, length) && skip_items(length, depth);
+            case 0xdd: return read_be(4, length) && skip_items(length, depth);
+            case 0xde: return read_be(2, length) && skip_items(2 * length, depth);
+            case 0xdf: return read_be(4, length) && skip_items(2 * length, depth);
+            default: return false;
+        }
+    }
+
+    bool skip_cbor(int depth) {
+        uint8_t b = *p_++;
+        uint8_t major = b >> 5;
+        uint8_t info = b & 0x1f;
+        uint64_t argument = 0;
+
+        if (info == 31) {
+            // Indefinite length: strings are chunked, containers run until break
+            if (major == 2 || major == 3 || major == 4 || major == 5) {
+                while (!consume_break()) {
+                    if (!skip(depth + 1)) return false;
+                }
+                return true;
+            }
+            return false;
+        }
+        if (major == 7) {
+            if (info < 24) return true;
+            return info <= 27 && advance(static_cast<uint64_t>(1) << (info - 24));
+        }
+        if (!cbor_argument(info, argument)) return false;
+        switch (major) {
+            case 0: case 1: return true;
+            case 2: case 3: return advance(argument);
+            case 4: return skip_items(static_cast<size_t>(argument), depth);
+            case 5: return argument <= remaining() && skip_items(2 * static_cast<size_t>(argument), depth);
+            case 6: return skip(depth + 1);
+            default: return false;
+        }
+    }
+
+    bool skip_items(size_t count, int depth) {
+        // Every item takes at least one byte; reject impossible counts early
+        if (count > remaining()) return false;
+        for (size_t i = 0; i < count; ++i) {
+            if (!skip(depth + 1)) return false;
+        }
+        return true;
+    }
+
+    BinaryFormat format_;
+    const uint8_t* p_;
+    const uint8_t* end_;
+};
+
+// Passes each converted number through `validator` when there is one
+bool read_number_array(BinaryReader& reader, std::vector<double>& out, ReadingValidator* validator) {
+    size_t count = 0;
+    bool indefinite = false;
+    if (!reader.read_array(count, indefinite)) return false;
+
+    if (indefinite) {
+        double value = 0.0;
+        while (!reader.consume_break()) {
+            if (!reader.read_number(value)) return false;
+            if (!validator || validator->admit(value)) {
+                out.push_back(value);
+            } else if (validator->rejected()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (count > reader.remaining()) return false;
+    size_t first = out.size();
+    out.resize(first + count);
+    double* dest = out.data() + first;
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!reader.read_number(dest[kept])) return false;
+        if (!validator || validator->admit(dest[kept])) {
+            ++kept;
+        } else if (validator->rejected()) {
+            return false;
+        }
+    }
+    out.resize(first + kept);
+    return true;
+}
+
+// Walks the top-level map, handing the value of `key` to `on_value` and skipping the rest
+template <typename OnValue>
+std::string find_top_level_key(BinaryReader& reader, BinaryFormat format, const char* key, OnValue on_value) {
+    size_t entries = 0;
+    bool indefinite = false;
+    if (!reader.read_map(entries, indefinite)) {
+        return std::string("Invalid ") + format_name(format) + " body";
+    }
+
+    size_t key_length = std::strlen(key);
+    bool found = false;
+    for (size_t i = 0; indefinite || i < entries; ++i) {
+        if (indefinite && reader.consume_break()) break;
+
+        const char* name = nullptr;
+        size_t name_length = 0;
+        if (!reader.read_string(name, name_length)) {
+            return std::string("Invalid ") + format_name(format) + " map key";
+        }
+        if (!found && name_length == key_length && std::memcmp(name, key, key_length) == 0) {
+            if (!on_value()) {
+                return std::string("Invalid '") + key + "' array in " + format_name(format) + " body";
+            }
+            found = true;
+        } else if (!reader.skip()) {
+            return std::string("Invalid ") + format_name(format) + " body";
+        }
+    }
+
+    if (!found) {
+        return std::string("Missing '") + key + "' field";
+    }
+    return "";
+}
+
+} // namespace
+
+bool binary_format_for_media_type(const std::string& media_type, BinaryFormat& format) {
+    std::string type = media_type.substr(0, media_type.find(';'));
+    type.erase(0, type.find_first_not_of(" \t"));
+    type.erase(type.find_last_not_of(" \t") + 1);
+    std::transform(type.begin(), type.end(), type.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if (type == "application/msgpack" || type == "application/x-msgpack" || type == "application/vnd.msgpack") {
+        format = BinaryFormat::msgpack;
+        return true;
+    }
+    if (type == "application/cbor") {
+        format = BinaryFormat::cbor;
+        return true;
+    }
+    return false;
+}
+
+std::string decode_binary_readings(BinaryFormat format, const std::string& body, std::vector<double>& readings,
+                                   ReadingValidator* validator) {
+    readings.clear();
+    BinaryReader reader(format, body);
+
+    std::string error;
+    if (reader.is_array()) {
+        if (!read_number_array(reader, readings, validator)) {
+            error = std::string("Invalid readings array in ") + format_name(format) + " body";
+        }
+    } else {
+        error = find_top_level_key(reader, format, "readings",
+                                   [&]() { return read_number_array(reader, readings, validator); });
+    }
+    if (validator && validator->rejected()) {
+        return validator->error();
+    }
+
+    if (error.empty() && !reader.done()) {
+        error = std::string("Trailing bytes after ") + format_name(format) + " body";
+    }
+    return error;
+}
+
+std::string decode_binary_batches(BinaryFormat format, const std::string& body,
+                                  std::vector<std::vector<double>>& batches, ReadingValidator* validator) {
+    batches.clear();
+    BinaryReader reader(format, body);
+
+    auto read_batches = [&]() {
+        size_t count = 0;
+        bool indefinite = false;
+        if (!reader.read_array(count, indefinite)) return false;
+        if (!indefinite && count > reader.remaining()) return false;
+        for (size_t i = 0; indefinite || i < count; ++i) {
+            if (indefinite && reader.consume_break()) break;
+            batches.emplace_back();
+            if (validator) validator->begin_series();
+            if (!read_number_array(reader, batches.back(), validator)) return false;
+        }
+        return true;
+    };
+
+    std::string error;
+    if (reader.is_array()) {
+        if (!read_batches()) {
+            error = std::string("Invalid batches array in ") + format_name(format) + " body";
+        }
+    } else {
+        error = find_top_level_key(reader, format, "batches", read_batches);
+    }
+    if (validator && validator->rejected()) {
+        return validator->error();
+    }
+
+    if (error.empty() && !reader.done()) {
+        error = std::string("Trailing bytes after ") + format_name(format) + " body";
+    }
+    return error;
+}
+
+void BinaryWriter::put_be(uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        out_.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+void BinaryWriter::cbor_head(uint8_t major, uint64_t argument) {
+    auto type = static_cast<uint8_t>(major << 5);
+    if (argument < 24) {
+        out_.push_back(static_cast<char>(type | argument));
+    } else if (argument <= 0xff) {
+        out_.push_back(static_cast<char>(type | 24));
+        put_be(argument, 1);
+    } else if (argument <= 0xffff) {
+        out_.push_back(static_cast<char>(type | 25));
+        put_be(argument, 2);
+    } else if (argument <= 0xffffffffULL) {
+        out_.push_back(static_cast<char>(type | 26));
+        put_be(argument, 4);
+    } else {
+        out_.push_back(static_cast<char>(type | 27));
+        put_be(argument, 8);
+    }
+}
+
+BinaryWriter& BinaryWriter::begin_map(size_t entries) {
+    if (format_ == BinaryFormat::cbor) {
+        cbor_head(5, entries);
+    } else if (entries < 16) {
+        out_.push_back(static_cast<char>(0x80 | entries));
+    } else if (entries <= 0xffff) {
+        out_.push_back(static_cast<char>(0xde));
+        put_be(entries, 2);
+    } else {
+        out_.push_back(static_cast<char>(0xdf));
+        put_be(entries, 4);
+    }
+    return *this;
+}
+
+BinaryWriter& BinaryWriter::begin_array(size_t elements) {
+    if (format_ == BinaryFormat::cbor) {
+        cbor_head(4, elements);
+    } else if (elements < 16) {
+        out_.push_back(static_cast<char>(0x90 | elements));
+    } else if (elements <= 0xffff) {
+        out_.push_back(static_cast<char>(0xdc));
+        put_be(elements, 2);
+    } else {
+        out_.push_back(static_cast<char>(0xdd));
+        put_be(elements, 4);
+    }
+    return *this;
+}
+
+BinaryWriter& BinaryWriter::string(const std::string& value) {
+    size_t length = value.size();
+    if (format_ == BinaryFormat::cbor) {
+        cbor_head(3, length);
+    } else if (length < 32) {
+        out_.push_back(static_cast<char>(0xa0 | length));
+    } else if (length <= 0xff) {
+        out_.push_back(static_cast<char>(0xd9));
+        put_be(length, 1);
+    } else if (length <= 0xffff) {
+        out_.push_back(static_cast<char>(0xda));
+        put_be(length, 2);
+    } else {
+        out_.push_back(static_cast<char>(0xdb));
+        put_be(length, 4);
+    }
+    out_ += value;
+    return *this;
+}
+
+BinaryWriter& BinaryWriter::number(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    out_.push_back(static_cast<char>(format_ == BinaryFormat::cbor ? 0xfb : 0xcb));
+    put_be(bits, 8);
+    return *this;
+}
+
+BinaryWriter& BinaryWriter::integer(uint64_t value) {
+    if (format_ == BinaryFormat::cbor) {
+        cbor_head(0, value);
+    } else if (value < 0x80) {
+        out_.push_back(static_cast<char>(value));
+    } else if (value <= 0xff) {
+        out_.push_back(static_cast<char>(0xcc));
+        put_be(value, 1);
+    } else if (value <= 0xffff) {
+        out_.push_back(static_cast<char>(0xcd));
+        put_be(value, 2);
+    } else if (value <= 0xffffffffULL) {
+        out_.push_back(static_cast<char>(0xce));
+        put_be(value, 4);
+    } else {
+        out_.push_back(static_cast<char>(0xcf));
+        put_be(value, 8);
+    }
+    return *this;
+}
+
+} // namespace cpp_service
@@ -0,0 +1,124 @@
+#include "bootstrap.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace cpp_service {
+
+namespace {
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+} // namespace
+
+Xoshiro256x4::Xoshiro256x4(uint64_t seed) {
+    uint64_t state = seed;
+    for (int lane = 0; lane < 4; ++lane) {
+        s0_[lane] = splitmix64(state);
+        s1_[lane] = splitmix64(state);
+        s2_[lane] = splitmix64(state);
+        s3_[lane] = splitmix64(state);
+    }
+}
+
+void Xoshiro256x4::next(uint64_t out[4]) {
+    for (int lane = 0; lane < 4; ++lane) {
+        out[lane] = s0_[lane] + s3_[lane];
+        uint64_t t = s1_[lane] << 17;
+        s2_[lane] ^= s0_[lane];
+        s3_[lane] ^= s1_[lane];
+        s1_[lane] ^= s2_[lane];
+        s0_[lane] ^= s3_[lane];
+        s2_[lane] ^= t;
+        s3_[lane] = rotl(s3_[lane], 45);
+    }
+}
+
+void Xoshiro256x4::fill_indices(uint32_t bound, uint32_t* out, size_t count) {
+    // Each 64-bit output yields two indices; the high 32 bits of each half
+    // are the best ones in xoshiro256+, and a multiply-shift maps them onto
+    // [0, bound) without division (bias < bound / 2^32, irrelevant here).
+    uint64_t block[4];
+    size_t i = 0;
+    while (i < count) {
+        next(block);
+        for (int lane = 0; lane < 4 && i < count; ++lane) {
+            out[i++] = static_cast<uint32_t>(((block[lane] >> 32) * bound) >> 32);
+            if (i < count) {
+                out[i++] = static_cast<uint32_t>(((block[lane] & 0xffffffffULL) * bound) >> 32);
+            }
+        }
+    }
+}
+
+BootstrapIndexCache::BootstrapIndexCache(size_t max_entries, size_t max_indices)
+    : max_entries_(max_entries), max_indices_(max_indices) {
+}
+
+BootstrapIndexCache::Pattern BootstrapIndexCache::get(uint32_t n, uint32_t resamples) {
+    auto key = std::make_pair(n, resamples);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = patterns_.find(key);
+        if (it != patterns_.end()) {
+            return it->second;
+        }
+    }
+
+    if (static_cast<size_t>(n) * resamples > max_indices_) {
+        return nullptr;
+    }
+
+    // Build outside the lock; a racing builder produces the same pattern
+    auto indices = std::make_shared<std::vector<uint32_t>>(static_cast<size_t>(n) * resamples);
+    Xoshiro256x4 rng((static_cast<uint64_t>(n) << 32) | resamples);
+    rng.fill_indices(n, indices->data(), indices->size());
+    Pattern pattern = std::move(indices);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (patterns_.size() >= max_entries_) {
+        patterns_.clear();
+    }
+    return patterns_.emplace(key, pattern).first->second;
+}
+
+void BootstrapIndexCache::fill_row(uint32_t n, uint32_t resamples, uint32_t row, uint32_t* out) {
+    uint64_t shape = (static_cast<uint64_t>(n) << 32) | resamples;
+    Xoshiro256x4 rng(shape ^ (0x9e3779b97f4a7c15ULL * (static_cast<uint64_t>(row) + 1)));
+    rng.fill_indices(n, out, n);
+}
+
+size_t BootstrapIndexCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return patterns_.size();
+}
+
+void percentile_interval(std::vector<double>& estimates, double level, double& low, double& high) {
+    size_t last = estimates.size() - 1;
+    // The slack keeps e.g. (1 - 0.9) / 2 * 100 = 4.999... from losing a rank
+    double alpha = (1.0 - level) / 2.0;
+    auto low_index = static_cast<size_t>(std::floor(alpha * last + 1e-9));
+    auto high_index = static_cast<size_t>(std::ceil((1.0 - alpha) * last - 1e-9));
+    high_index = std::max(low_index, std::min(high_index, last));
+
+    auto low_it = estimates.begin() + low_index;
+    std::nth_element(estimates.begin(), low_it, estimates.end());
+    low = *low_it;
+    if (high_index > low_index) {
+        auto high_it = estimates.begin() + high_index;
+        std::nth_element(low_it + 1, high_it, estimates.end());
+        high = *high_it;
+    } else {
+        high = low;
+    }
+}
+
+} // namespace cpp_service
@@ -0,0 +1,168 @@
+#include "content_encoding.hpp"
+#include "config.h"
+#include <algorithm>
+#include <cctype>
+
+#ifdef CPP_SERVICE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef CPP_SERVICE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace cpp_service {
+
+namespace {
+
+constexpr size_t kChunkSize = 16 * 1024;
+
+std::string normalize_encoding(const std::string& content_encoding) {
+    std::string token = content_encoding;
+    token.erase(0, token.find_first_not_of(" \t"));
+    token.erase(token.find_last_not_of(" \t") + 1);
+    std::transform(token.begin(), token.end(), token.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (token == "x-gzip") token = "gzip";
+    return token;
+}
+
+#ifdef CPP_SERVICE_HAVE_ZLIB
+ContentDecodeError inflate_body(const std::string& body, std::string& decoded, size_t max_decoded_bytes,
+                                int window_bits) {
+    z_stream stream{};
+    if (inflateInit2(&stream, window_bits) != Z_OK) {
+        return ContentDecodeError::malformed;
+    }
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+    stream.avail_in = static_cast<uInt>(body.size());
+
+    char chunk[kChunkSize];
+    int ret = Z_OK;
+    while (true) {
+        stream.next_out = reinterpret_cast<Bytef*>(chunk);
+        stream.avail_out = sizeof(chunk);
+        ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            inflateEnd(&stream);
+            return ContentDecodeError::malformed;
+        }
+
+        size_t produced = sizeof(chunk) - stream.avail_out;
+        if (decoded.size() + produced > max_decoded_bytes) {
+            inflateEnd(&stream);
+            return ContentDecodeError::too_large;
+        }
+        decoded.append(chunk, produced);
+
+        if (ret == Z_STREAM_END) {
+            // Concatenated gzip members are valid; keep going if input remains
+            if (stream.avail_in == 0) break;
+            if (inflateReset(&stream) != Z_OK) {
+                inflateEnd(&stream);
+                return ContentDecodeError::malformed;
+            }
+        } else if (ret == Z_BUF_ERROR || (stream.avail_in == 0 && produced == 0)) {
+            // No progress possible: the stream was truncated
+            inflateEnd(&stream);
+            return ContentDecodeError::malformed;
+        }
+    }
+
+    inflateEnd(&stream);
+    return ContentDecodeError::none;
+}
+#endif
+
+#ifdef CPP_SERVICE_HAVE_ZSTD
+ContentDecodeError zstd_decompress_body(const std::string& body, std::string& decoded, size_t max_decoded_bytes) {
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (stream == nullptr) {
+        return ContentDecodeError::malformed;
+    }
+    ZSTD_initDStream(stream);
+
+    ZSTD_inBuffer input{body.data(), body.size(), 0};
+    char chunk[kChunkSize];
+    size_t last_ret = 0;
+    while (input.pos < input.size || last_ret != 0) {
+        ZSTD_outBuffer output{chunk, sizeof(chunk), 0};
+        last_ret = ZSTD_decompressStream(stream, &output, &input);
+        if (ZSTD_isError(last_ret)) {
+            ZSTD_freeDStream(stream);
+            return ContentDecodeError::malformed;
+        }
+        if (decoded.size() + output.pos > max_decoded_bytes) {
+            ZSTD_freeDStream(stream);
+            return ContentDecodeError::too_large;
+        }
+        decoded.append(chunk, output.pos);
+        if (input.pos == input.size && output.pos == 0 && last_ret != 0) {
+            // Frame incomplete and no more input
+            ZSTD_freeDStream(stream);
+            return ContentDecodeError::malformed;
+        }
+    }
+
+    ZSTD_freeDStream(stream);
+    return ContentDecodeError::none;
+}
+#endif
+
+} // namespace
+
+ContentDecodeError decode_content(const std::string& content_encoding, const std::string& body,
+                                  std::string& decoded, size_t max_decoded_bytes) {
+    decoded.clear();
+    std::string encoding = normalize_encoding(content_encoding);
+
+    if (encoding.empty() || encoding == "identity") {
+        if (body.size() > max_decoded_bytes) {
+            return ContentDecodeError::too_large;
+        }
+        decoded = body;
+        return ContentDecodeError::none;
+    }
+
+#ifdef CPP_SERVICE_HAVE_ZLIB
+    if (encoding == "gzip") {
+        return inflate_body(body, decoded, max_decoded_bytes, 16 + MAX_WBITS);
+    }
+    if (encoding == "deflate") {
+        return inflate_body(body, decoded, max_decoded_bytes, MAX_WBITS);
+    }
+#endif
+
+#ifdef CPP_SERVICE_HAVE_ZSTD
+    if (encoding == "zstd") {
+        return zstd_decompress_body(body, decoded, max_decoded_bytes);
+    }
+#endif
+
+    return ContentDecodeError::unsupported_encoding;
+}
+
+bool is_content_encoding_supported(const std::string& content_encoding) {
+    std::string encoding = normalize_encoding(content_encoding);
+    if (encoding.empty() || encoding == "identity") return true;
+#ifdef CPP_SERVICE_HAVE_ZLIB
+    if (encoding == "gzip" || encoding == "deflate") return true;
+#endif
+#ifdef CPP_SERVICE_HAVE_ZSTD
+    if (encoding == "zstd") return true;
+#endif
+    return false;
+}
+
+const char* to_string(ContentDecodeError error) {
+    switch (error) {
+        case ContentDecodeError::none: return "ok";
+        case ContentDecodeError::unsupported_encoding: return "Unsupported Content-Encoding";
+        case ContentDecodeError::too_large: return "Decoded request body exceeds size limit";
+        case ContentDecodeError::malformed: return "Malformed compressed request body";
+    }
+    return "unknown";
+}
+
+} // namespace cpp_service
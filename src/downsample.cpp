@@ -0,0 +1,199 @@
+#include "downsample.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace cpp_service {
+
+namespace {
+
+using Point = SeriesStore::Point;
+
+// The part of one segment inside the requested range
+struct Span {
+    const int64_t* timestamps;
+    const double* values;
+    size_t count;
+};
+
+// Segments entirely outside [from, to] are skipped on their bounds alone;
+// compacted ones in range are decoded into `decoded`, which the spans point into
+std::vector<Span> spans_in_range(const SeriesStore::Snapshot& series, int64_t from, int64_t to, size_t& total,
+                                 std::vector<SeriesStore::SegmentPtr>& decoded) {
+    std::vector<Span> spans;
+    total = 0;
+    for (const auto& stored : series.segments) {
+        if (stored->size() == 0 || stored->last() < from || stored->first() > to) continue;
+        SeriesStore::SegmentPtr segment = SeriesStore::columns(stored);
+        if (segment != stored) decoded.push_back(segment);
+        const auto& ts = segment->timestamps;
+        size_t lo = static_cast<size_t>(std::lower_bound(ts.begin(), ts.end(), from) - ts.begin());
+        size_t hi = static_cast<size_t>(std::upper_bound(ts.begin(), ts.end(), to) - ts.begin());
+        if (hi > lo) {
+            spans.push_back({ts.data() + lo, segment->values.data() + lo, hi - lo});
+            total += hi - lo;
+        }
+    }
+    return spans;
+}
+
+// Forward-only reader over the spans; callers never read past the end
+class Cursor {
+public:
+    explicit Cursor(const std::vector<Span>& spans) : spans_(spans) {}
+
+    Point next() {
+        const Span& span = spans_[span_];
+        Point point{span.timestamps[offset_], span.values[offset_]};
+        if (++offset_ == span.count) {
+            ++span_;
+            offset_ = 0;
+        }
+        return point;
+    }
+
+    void skip(size_t count) {
+        while (count > 0 && span_ < spans_.size()) {
+            size_t left = spans_[span_].count - offset_;
+            if (count < left) {
+                offset_ += count;
+                return;
+            }
+            count -= left;
+            ++span_;
+            offset_ = 0;
+        }
+    }
+
+private:
+    const std::vector<Span>& spans_;
+    size_t span_ = 0;
+    size_t offset_ = 0;
+};
+
+void lttb(const std::vector<Span>& spans, size_t n, size_t threshold, std::vector<Point>& out) {
+    // Bucket k spans indexes [bound(k), bound(k + 1)); bound(0) = 1 and
+    // bound(threshold - 2) = n - 1 leave the first and last points out
+    auto bound = [n, threshold](size_t k) { return 1 + k * (n - 2) / (threshold - 2); };
+
+    // `current` walks the bucket being chosen from, `ahead` the next one for
+    // its centroid; each point is read once by each
+    Cursor current(spans);
+    Cursor ahead(spans);
+    Point a = current.next();
+    out.push_back(a);
+    ahead.skip(bound(1));
+    for (size_t k = 0; k + 2 < threshold; ++k) {
+        size_t start = bound(k);
+        size_t end = bound(k + 1);
+        size_t ahead_end = std::min(bound(k + 2), n);
+
+        // Timestamps relative to `a` keep the products well inside double precision
+        double centroid_x = 0.0;
+        double centroid_y = 0.0;
+        for (size_t i = end; i < ahead_end; ++i) {
+            Point p = ahead.next();
+            centroid_x += static_cast<double>(p.timestamp - a.timestamp);
+            centroid_y += p.value;
+        }
+        centroid_x /= static_cast<double>(ahead_end - end);
+        centroid_y /= static_cast<double>(ahead_end - end);
+
+        Point best = a;
+        double best_area = -1.0;
+        for (size_t i = start; i < end; ++i) {
+            Point p = current.next();
+            double area = std::abs(static_cast<double>(p.timestamp - a.timestamp) * (centroid_y - a.value) -
+                                   centroid_x * (p.value - a.value));
+            if (area > best_area) {
+                best_area = area;
+                best = p;
+            }
+        }
+        out.push_back(best);
+        a = best;
+    }
+    out.push_back(current.next());
+}
+
+void minmax(const std::vector<Span>& spans, size_t n, size_t threshold, std::vector<Point>& out) {
+    size_t buckets = threshold / 2;
+    int64_t first = spans.front().timestamps[0];
+    const Span& tail = spans.back();
+    double width = static_cast<double>(tail.timestamps[tail.count - 1] - first) + 1.0;
+
+    Cursor cursor(spans);
+    size_t bucket = 0;
+    Point low;
+    Point high;
+    size_t low_index = 0;
+    size_t high_index = 0;
+    auto flush = [&]() {
+        const Point& early = low_index <= high_index ? low : high;
+        const Point& late = low_index <= high_index ? high : low;
+        out.push_back(early);
+        if (low_index != high_index) out.push_back(late);
+    };
+    for (size_t i = 0; i < n; ++i) {
+        Point p = cursor.next();
+        size_t b = std::min(buckets - 1, static_cast<size_t>(static_cast<double>(p.timestamp - first) / width *
+                                                             static_cast<double>(buckets)));
+        if (i == 0 || b != bucket) {
+            if (i > 0) flush();
+            bucket = b;
+            low = high = p;
+            low_index = high_index = i;
+            continue;
+        }
+        if (p.value < low.value) {
+            low = p;
+            low_index = i;
+        }
+        if (p.value > high.value) {
+            high = p;
+            high_index = i;
+        }
+    }
+    flush();
+}
+
+} // namespace
+
+const char* downsample_mode_name(DownsampleMode mode) {
+    return mode == DownsampleMode::lttb ? "lttb" : "minmax";
+}
+
+bool parse_downsample_mode(const std::string& name, DownsampleMode& mode) {
+    if (name == "lttb") {
+        mode = DownsampleMode::lttb;
+    } else if (name == "minmax") {
+        mode = DownsampleMode::minmax;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+DownsampleResult downsample(const SeriesStore::Snapshot& series, int64_t from, int64_t to, size_t max_points,
+                            DownsampleMode mode) {
+    DownsampleResult result;
+    std::vector<SeriesStore::SegmentPtr> decoded;
+    std::vector<Span> spans = spans_in_range(series, from, to, result.in_range, decoded);
+    size_t n = result.in_range;
+    size_t threshold = std::max<size_t>(max_points, mode == DownsampleMode::lttb ? 3 : 2);
+
+    if (n <= threshold) {
+        result.points.reserve(n);
+        Cursor cursor(spans);
+        for (size_t i = 0; i < n; ++i) result.points.push_back(cursor.next());
+        return result;
+    }
+    result.points.reserve(threshold);
+    if (mode == DownsampleMode::lttb) {
+        lttb(spans, n, threshold, result.points);
+    } else {
+        minmax(spans, n, threshold, result.points);
+    }
+    return result;
+}
+
+} // namespace cpp_service
@@ -0,0 +1,147 @@
+#include "fusion_pipeline.hpp"
+#include "../third_party/simple_http.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+
+namespace cpp_service {
+
+namespace {
+
+// Jobs a compute thread takes from one ring before moving to the next
+constexpr size_t kComputeBatch = 32;
+// Idle time before a compute thread parks; a submit wakes it early
+constexpr auto kSpinBeforePark = std::chrono::milliseconds(2);
+
+} // namespace
+
+FusionPipeline::FusionPipeline(Service& service, unsigned lanes, unsigned compute_threads, int first_cpu,
+                               size_t ring_capacity)
+    : service_(service), lanes_(std::max(1u, lanes)), compute_threads_(std::max(1u, compute_threads)) {
+    for (unsigned i = 0; i < lanes_ * compute_threads_; ++i) {
+        channels_.push_back(std::make_unique<Channel>(ring_capacity));
+    }
+    for (unsigned lane = 0; lane < lanes_; ++lane) {
+        next_worker_.push_back(lane % compute_threads_);
+    }
+    for (unsigned worker = 0; worker < compute_threads_; ++worker) {
+        parking_.push_back(std::make_unique<Parking>());
+    }
+    for (unsigned worker = 0; worker < compute_threads_; ++worker) {
+        int cpu = first_cpu >= 0 ? first_cpu + static_cast<int>(worker) : -1;
+        workers_.emplace_back([this, worker, cpu]() { compute_loop(worker, cpu); });
+    }
+}
+
+FusionPipeline::~FusionPipeline() {
+    running_ = false;
+    for (auto& parking : parking_) {
+        std::lock_guard<std::mutex> lock(parking->mutex);
+        parking->cv.notify_all();
+    }
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+bool FusionPipeline::submit(unsigned lane, Job& job) {
+    // Round robin across compute threads, skipping full rings
+    unsigned& next = next_worker_[lane];
+    for (unsigned attempt = 0; attempt < compute_threads_; ++attempt) {
+        unsigned worker = next;
+        next = (next + 1) % compute_threads_;
+        if (channel(lane, worker).jobs.try_push(std::move(job))) {
+            Parking& parking = *parking_[worker];
+            if (parking.parked.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(parking.mutex);
+                parking.cv.notify_one();
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t FusionPipeline::collect(unsigned lane, std::vector<Job>& done, size_t max) {
+    size_t collected = 0;
+    Job job;
+    for (unsigned worker = 0; worker < compute_threads_ && collected < max; ++worker) {
+        auto& results = channel(lane, worker).results;
+        while (collected < max && results.try_pop(job)) {
+            done.push_back(std::move(job));
+            ++collected;
+        }
+    }
+    return collected;
+}
+
+void FusionPipeline::run(Service& service, Job& job) {
+    try {
+        job.result = service.fuse(job.readings, job.weights, job.options);
+    } catch (const std::invalid_argument& e) {
+        job.error = e.what();
+        job.bad_request = true;
+    } catch (const std::exception& e) {
+        job.error = e.what();
+    }
+}
+
+void FusionPipeline::compute_loop(unsigned worker, int cpu) {
+    simple_http::pin_thread_to_cpu(cpu);
+    using Clock = std::chrono::steady_clock;
+    std::vector<Job> batch(kComputeBatch);
+    Parking& parking = *parking_[worker];
+    auto last_work = Clock::now();
+
+    while (running_.load(std::memory_order_relaxed)) {
+        bool worked = false;
+        for (unsigned lane = 0; lane < lanes_; ++lane) {
+            Channel& ch = channel(lane, worker);
+            size_t count = 0;
+            while (count < kComputeBatch && ch.jobs.try_pop(batch[count])) ++count;
+            if (count == 0) continue;
+            worked = true;
+
+            // Run the batch back to back so the estimator code and the
+            // service's state stay hot, then return the results together
+            for (size_t i = 0; i < count; ++i) {
+                run(service_, batch[i]);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                // The lane drains results every loop iteration, so a full ring is brief
+                while (!ch.results.try_push(std::move(batch[i]))) {
+                    if (!running_.load(std::memory_order_relaxed)) return;
+                    std::this_thread::yield();
+                }
+                batch[i] = Job();
+            }
+        }
+
+        auto now = Clock::now();
+        if (worked) {
+            last_work = now;
+            continue;
+        }
+        if (now - last_work < kSpinBeforePark) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Park; submit() notifies, and the timeout covers a notify that
+        // raced with parking
+        std::unique_lock<std::mutex> lock(parking.mutex);
+        parking.parked.store(true, std::memory_order_release);
+        bool pending = false;
+        for (unsigned lane = 0; lane < lanes_ && !pending; ++lane) {
+            pending = !channel(lane, worker).jobs.empty();
+        }
+        if (!pending && running_.load(std::memory_order_relaxed)) {
+            parking.cv.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        parking.parked.store(false, std::memory_order_relaxed);
+        last_work = Clock::now();
+    }
+}
+
+} // namespace cpp_service
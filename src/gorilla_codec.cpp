@@ -0,0 +1,380 @@
+#include "gorilla_codec.hpp"
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace cpp_service {
+
+namespace {
+
+constexpr char kMagic[4] = {'T', 'F', 'G', '1'};
+
+uint64_t double_to_bits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double bits_to_double(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint64_t load_be64(const uint8_t* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap64(word);
+#else
+    uint64_t result = 0;
+    for (int i = 0; i < 8; ++i) result = (result << 8) | p[i];
+    return result;
+#endif
+}
+
+unsigned leading_zeros(uint64_t x) {
+#if defined(__GNUC__)
+    return x == 0 ? 64u : static_cast<unsigned>(__builtin_clzll(x));
+#else
+    unsigned n = 0;
+    for (uint64_t mask = 1ull << 63; mask != 0 && (x & mask) == 0; mask >>= 1) ++n;
+    return n;
+#endif
+}
+
+unsigned trailing_zeros(uint64_t x) {
+#if defined(__GNUC__)
+    return x == 0 ? 64u : static_cast<unsigned>(__builtin_ctzll(x));
+#else
+    unsigned n = 0;
+    for (uint64_t mask = 1; mask != 0 && (x & mask) == 0; mask <<= 1) ++n;
+    return n;
+#endif
+}
+
+void put_u16(std::string& out, uint16_t v) {
+    out.push_back(static_cast<char>(v & 0xff));
+    out.push_back(static_cast<char>(v >> 8));
+}
+
+void put_u32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+uint32_t get_u32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// MSB-first bit writer
+class BitWriter {
+public:
+    void write(uint64_t value, unsigned n) {
+        while (n > 0) {
+            unsigned space = 64 - bits_;
+            unsigned take = n < space ? n : space;
+            uint64_t chunk = value >> (n - take);
+            if (take < 64) chunk &= (1ull << take) - 1;
+            acc_ = (take == 64) ? chunk : (acc_ << take) | chunk;
+            bits_ += take;
+            n -= take;
+            if (bits_ == 64) {
+                for (int shift = 56; shift >= 0; shift -= 8) {
+                    out_.push_back(static_cast<char>((acc_ >> shift) & 0xff));
+                }
+                acc_ = 0;
+                bits_ = 0;
+            }
+        }
+    }
+
+    std::string finish() {
+        if (bits_ > 0) {
+            uint64_t aligned = acc_ << (64 - bits_);
+            for (unsigned i = 0; i < (bits_ + 7) / 8; ++i) {
+                out_.push_back(static_cast<char>((aligned >> (56 - 8 * i)) & 0xff));
+            }
+        }
+        acc_ = 0;
+        bits_ = 0;
+        return std::move(out_);
+    }
+
+private:
+    std::string out_;
+    uint64_t acc_ = 0;
+    unsigned bits_ = 0;
+};
+
+// MSB-first bit reader over a 64-bit window. Refills load eight bytes at a time
+// and peeks past the end read as zero bits, so the decode loop only has to
+// check `overrun()` once per series rather than per field.
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : pos_(data), end_(data + size) {}
+
+    uint64_t peek(unsigned n) {
+        if (count_ < n) refill();
+        return buf_ >> (64 - n);
+    }
+
+    void consume(unsigned n) {
+        if (n > count_) {
+            overrun_ = true;
+            n = count_;
+        }
+        buf_ = (n == 64) ? 0 : buf_ << n;
+        count_ -= n;
+    }
+
+    uint64_t read(unsigned n) {
+        if (n == 0) return 0;
+        if (n > 56) {
+            uint64_t high = read(n - 32);
+            return (high << 32) | read(32);
+        }
+        uint64_t value = peek(n);
+        consume(n);
+        return value;
+    }
+
+    bool overrun() const { return overrun_; }
+
+private:
+    void refill() {
+        if (end_ - pos_ >= 8) {
+            buf_ |= load_be64(pos_) >> count_;
+            unsigned bytes = (63 - count_) >> 3;
+            pos_ += bytes;
+            count_ += bytes << 3;
+        } else {
+            while (count_ <= 56 && pos_ < end_) {
+                buf_ |= static_cast<uint64_t>(*pos_++) << (56 - count_);
+                count_ += 8;
+            }
+        }
+    }
+
+    const uint8_t* pos_;
+    const uint8_t* end_;
+    uint64_t buf_ = 0;
+    unsigned count_ = 0;
+    bool overrun_ = false;
+};
+
+// Delta-of-delta buckets indexed by the next four bits of the stream:
+// '0' -> 0, '10' -> 7 bits, '110' -> 9 bits, '1110' -> 12 bits, '1111' -> 64 bits
+struct DodBucket {
+    uint8_t prefix_bits;
+    uint8_t value_bits;
+    int64_t bias;
+};
+
+constexpr DodBucket kDodBuckets[16] = {
+    {1, 0, 0},     {1, 0, 0},     {1, 0, 0},     {1, 0, 0},
+    {1, 0, 0},     {1, 0, 0},     {1, 0, 0},     {1, 0, 0},
+    {2, 7, 63},    {2, 7, 63},    {2, 7, 63},    {2, 7, 63},
+    {3, 9, 255},   {3, 9, 255},   {4, 12, 2047}, {4, 64, 0},
+};
+
+void encode_dod(BitWriter& writer, int64_t dod) {
+    if (dod == 0) {
+        writer.write(0b0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        writer.write(0b10, 2);
+        writer.write(static_cast<uint64_t>(dod + 63), 7);
+    } else if (dod >= -255 && dod <= 256) {
+        writer.write(0b110, 3);
+        writer.write(static_cast<uint64_t>(dod + 255), 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        writer.write(0b1110, 4);
+        writer.write(static_cast<uint64_t>(dod + 2047), 12);
+    } else {
+        writer.write(0b1111, 4);
+        writer.write(static_cast<uint64_t>(dod), 64);
+    }
+}
+
+std::string encode_series(const std::vector<int64_t>& timestamps, const std::vector<double>& values) {
+    BitWriter writer;
+    if (values.empty()) return writer.finish();
+
+    uint64_t prev_ts = static_cast<uint64_t>(timestamps[0]);
+    uint64_t prev_delta = 0;
+    uint64_t prev_bits = double_to_bits(values[0]);
+    unsigned prev_lead = 65;  // no window yet
+    unsigned prev_trail = 0;
+
+    writer.write(prev_ts, 64);
+    writer.write(prev_bits, 64);
+
+    for (size_t i = 1; i < values.size(); ++i) {
+        // Unsigned arithmetic: wraps instead of overflowing on extreme inputs
+        uint64_t ts = static_cast<uint64_t>(timestamps[i]);
+        uint64_t delta = ts - prev_ts;
+        encode_dod(writer, static_cast<int64_t>(delta - prev_delta));
+        prev_ts = ts;
+        prev_delta = delta;
+
+        uint64_t bits = double_to_bits(values[i]);
+        uint64_t x = bits ^ prev_bits;
+        prev_bits = bits;
+        if (x == 0) {
+            writer.write(0b0, 1);
+            continue;
+        }
+
+        unsigned lead = leading_zeros(x);
+        unsigned trail = trailing_zeros(x);
+        if (lead > 31) lead = 31;
+
+        if (prev_lead <= lead && prev_trail <= trail) {
+            writer.write(0b10, 2);
+            writer.write(x >> prev_trail, 64 - prev_lead - prev_trail);
+        } else {
+            unsigned meaningful = 64 - lead - trail;
+            writer.write(0b11, 2);
+            writer.write(lead, 5);
+            writer.write(meaningful - 1, 6);
+            writer.write(x >> trail, meaningful);
+            prev_lead = lead;
+            prev_trail = trail;
+        }
+    }
+
+    return writer.finish();
+}
+
+bool decode_series(const uint8_t* data, size_t size, size_t count, double* values, int64_t* timestamps) {
+    BitReader reader(data, size);
+
+    uint64_t ts = reader.read(64);
+    uint64_t bits = reader.read(64);
+    uint64_t delta = 0;
+    unsigned lead = 0;
+    unsigned window = 0;  // meaningful bits of the current XOR window, 0 = none
+
+    timestamps[0] = static_cast<int64_t>(ts);
+    values[0] = bits_to_double(bits);
+
+    for (size_t i = 1; i < count; ++i) {
+        const DodBucket& bucket = kDodBuckets[reader.peek(4)];
+        reader.consume(bucket.prefix_bits);
+        uint64_t dod = reader.read(bucket.value_bits) - static_cast<uint64_t>(bucket.bias);
+        delta += dod;
+        ts += delta;
+        timestamps[i] = static_cast<int64_t>(ts);
+
+        uint64_t control = reader.peek(2);
+        if (control < 0b10) {
+            reader.consume(1);
+        } else {
+            reader.consume(2);
+            if (control == 0b11) {
+                lead = static_cast<unsigned>(reader.read(5));
+                window = static_cast<unsigned>(reader.read(6)) + 1;
+                if (lead + window > 64) return false;
+            } else if (window == 0) {
+                return false;
+            }
+            bits ^= reader.read(window) << (64 - lead - window);
+        }
+        values[i] = bits_to_double(bits);
+    }
+
+    return !reader.overrun();
+}
+
+} // namespace
+
+GorillaEncoder::GorillaEncoder() {
+    out_.append(kMagic, sizeof(kMagic));
+    put_u32(out_, 0);  // series count, patched in finish()
+}
+
+void GorillaEncoder::add_series(const std::string& sensor, const std::vector<int64_t>& timestamps,
+                                const std::vector<double>& values) {
+    if (timestamps.size() != values.size()) {
+        throw std::invalid_argument("timestamps and values must have the same length");
+    }
+    if (sensor.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::invalid_argument("sensor id too long");
+    }
+
+    std::string payload = encode_series(timestamps, values);
+    put_u16(out_, static_cast<uint16_t>(sensor.size()));
+    out_ += sensor;
+    put_u32(out_, static_cast<uint32_t>(values.size()));
+    put_u32(out_, static_cast<uint32_t>(payload.size()));
+    out_ += payload;
+    ++series_count_;
+}
+
+std::string GorillaEncoder::finish() {
+    for (int i = 0; i < 4; ++i) {
+        out_[sizeof(kMagic) + static_cast<size_t>(i)] = static_cast<char>((series_count_ >> (8 * i)) & 0xff);
+    }
+    std::string result = std::move(out_);
+    out_.clear();
+    out_.append(kMagic, sizeof(kMagic));
+    put_u32(out_, 0);
+    series_count_ = 0;
+    return result;
+}
+
+std::string decode_gorilla_batch(const std::string& payload, std::vector<double>& values,
+                                 std::vector<int64_t>& timestamps,
+                                 std::vector<GorillaSeriesView>* series, size_t max_decoded_bytes) {
+    constexpr size_t kPointBytes = sizeof(double) + sizeof(int64_t);
+    const auto* data = reinterpret_cast<const uint8_t*>(payload.data());
+    size_t size = payload.size();
+
+    if (size < 8 || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        return "Invalid Gorilla batch header";
+    }
+    uint32_t series_count = get_u32(data + 4);
+    size_t pos = 8;
+
+    for (uint32_t s = 0; s < series_count; ++s) {
+        if (size - pos < 2) return "Truncated Gorilla series header";
+        size_t sensor_len = static_cast<size_t>(data[pos]) | (static_cast<size_t>(data[pos + 1]) << 8);
+        pos += 2;
+        if (size - pos < sensor_len + 8) return "Truncated Gorilla series header";
+        std::string sensor(payload, pos, sensor_len);
+        pos += sensor_len;
+
+        size_t count = get_u32(data + pos);
+        size_t payload_bytes = get_u32(data + pos + 4);
+        pos += 8;
+        if (size - pos < payload_bytes) return "Truncated Gorilla series payload";
+
+        if (count > 0) {
+            // 128 header bits plus at least two bits per further point
+            if (payload_bytes < 16 || count - 1 > (payload_bytes - 16) * 4) {
+                return "Gorilla point count does not match payload size";
+            }
+
+            size_t first = values.size();
+            if (first + count > max_decoded_bytes / kPointBytes) {
+                return "Gorilla batch decodes to more than " + std::to_string(max_decoded_bytes) + " bytes";
+            }
+            values.resize(first + count);
+            timestamps.resize(first + count);
+            if (!decode_series(data + pos, payload_bytes, count, values.data() + first, timestamps.data() + first)) {
+                return "Corrupt Gorilla bitstream for sensor '" + sensor + "'";
+            }
+            if (series) {
+                series->push_back({std::move(sensor), first, count});
+            }
+        }
+        pos += payload_bytes;
+    }
+
+    if (pos != size) {
+        return "Trailing bytes after Gorilla batch";
+    }
+    return "";
+}
+
+} // namespace cpp_service
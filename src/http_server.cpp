@@ -1,14 +1,259 @@
 #include "http_server.hpp"
+#include "content_encoding.hpp"
+#include "gorilla_codec.hpp"
+#include "binary_codec.hpp"
+#include "fusion_pipeline.hpp"
+#include "json_scanner.hpp"
+#include "reading_validator.hpp"
+#include "downsample.hpp"
+#include "series_query.hpp"
 #include "../third_party/simple_http.hpp"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <stdexcept>
 
 namespace cpp_service {
 
-HttpServer::HttpServer(int port, Service* service) : port_(port), service_(service), running_(false) {
+namespace {
+
+// Compares the media type of a Content-Type header, ignoring parameters and case
+bool media_type_is(const std::string& content_type, const std::string& media_type) {
+    size_t end = content_type.find(';');
+    std::string type = content_type.substr(0, end);
+    type.erase(0, type.find_first_not_of(" \t"));
+    type.erase(type.find_last_not_of(" \t") + 1);
+    return type.size() == media_type.size() &&
+           std::equal(type.begin(), type.end(), media_type.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+           });
+}
+
+// Escapes a client-supplied string for embedding in a JSON response
+std::string json_escape(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\r': escaped += "\\r"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    escaped += buffer;
+                } else {
+                    escaped.push_back(c);
+                }
+        }
+    }
+    return escaped;
+}
+
+// Decodes %XX escapes and '+' in a query parameter; false on a malformed escape
+bool percent_decode(const std::string& value, std::string& decoded) {
+    decoded.clear();
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '+') {
+            decoded.push_back(' ');
+        } else if (value[i] != '%') {
+            decoded.push_back(value[i]);
+        } else if (i + 2 < value.size() && std::isxdigit(static_cast<unsigned char>(value[i + 1])) &&
+                   std::isxdigit(static_cast<unsigned char>(value[i + 2]))) {
+            decoded.push_back(static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Strict base-10 integer for query parameters: optional '-', digits only
+bool parse_query_integer(const std::string& value, int64_t& out) {
+    size_t digits = value.size() - (!value.empty() && value[0] == '-' ? 1 : 0);
+    if (digits == 0 || digits > 18 ||
+        !std::all_of(value.end() - static_cast<std::ptrdiff_t>(digits), value.end(),
+                     [](char c) { return c >= '0' && c <= '9'; })) {
+        return false;
+    }
+    out = std::stoll(value);
+    return true;
+}
+
+// Picks the first binary media type listed in Accept, unless JSON is listed before it
+bool accepts_binary(const std::string& accept, BinaryFormat& format) {
+    std::istringstream stream(accept);
+    std::string media_type;
+    while (std::getline(stream, media_type, ',')) {
+        if (binary_format_for_media_type(media_type, format)) {
+            return true;
+        }
+        if (media_type_is(media_type, "application/json") || media_type_is(media_type, "*/*")) {
+            return false;
+        }
+    }
+    return false;
+}
+
+void send_binary(simple_http::Response& res, BinaryFormat format, const std::string& payload) {
+    res.body = payload;
+    res.set_header("Content-Type", format == BinaryFormat::msgpack ? "application/msgpack" : "application/cbor");
+}
+
+// Reads "interval": true/false or {"level": 0.9, "deadline_ms": 5, "max_resamples": 1000}
+bool parse_interval_options(JsonScanner& scanner, Service::FusionOptions& options) {
+    if (!scanner.at_object()) {
+        return scanner.read_bool(options.interval);
+    }
+    options.interval = true;
+    if (!scanner.begin_object()) return false;
+    std::string key;
+    while (scanner.next_member(key)) {
+        bool ok;
+        if (key == "level") {
+            ok = scanner.read_number(options.interval_level);
+        } else if (key == "deadline_ms") {
+            ok = scanner.read_number(options.deadline_ms);
+        } else if (key == "max_resamples") {
+            int64_t max_resamples = 0;
+            ok = scanner.read_integer(max_resamples);
+            options.max_resamples = static_cast<uint32_t>(std::clamp<int64_t>(max_resamples, 0, UINT32_MAX));
+        } else {
+            ok = scanner.skip_value();
+        }
+        if (!ok) return false;
+    }
+    return !scanner.failed();
+}
+
+// Handles the per-request "algorithm" and "tolerance" members shared by /fuse
+// and /fuse/batch; returns false if `key` is neither
+bool parse_algorithm_member(JsonScanner& scanner, const std::string& key, Service::FusionOptions& options,
+                            std::string& algorithm_name, bool& ok) {
+    if (key == "algorithm") {
+        ok = scanner.read_string(algorithm_name);
+        return true;
+    }
+    if (key == "tolerance") {
+        ok = scanner.read_number(options.tolerance);
+        return true;
+    }
+    return false;
+}
+
+// Resolves a name read by parse_algorithm_member and checks the tolerance
+std::string validate_algorithm_options(const std::string& algorithm_name, Service::FusionOptions& options) {
+    if (!algorithm_name.empty()) {
+        Service::FusionAlgorithm algorithm;
+        if (!Service::parse_algorithm(algorithm_name, algorithm)) {
+            return "Unknown algorithm: " + algorithm_name;
+        }
+        options.algorithm = algorithm;
+    }
+    if (!(options.tolerance >= 0.0)) {
+        return "'tolerance' must be non-negative";
+    }
+    return "";
+}
+
+// Request weights only combine with the weighted (or auto) estimator
+bool weights_allowed(const Service::FusionOptions& options) {
+    return !options.algorithm || *options.algorithm == Service::FusionAlgorithm::weighted ||
+           *options.algorithm == Service::FusionAlgorithm::automatic;
+}
+
+// Latency of /fuse per scheduling lane, measured from the start of the handler
+void observe_lane_duration(bool bulk, std::chrono::steady_clock::time_point start) {
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    get_metrics().observe_histogram("fuse_lane_duration_ms", duration.count() / 1000.0,
+                                    bulk ? "lane=\"bulk\"" : "lane=\"small\"");
+}
+
+// What RequestTimer records, plus the lane, for requests that finish on another stack
+void observe_fuse_duration(std::chrono::steady_clock::time_point start, bool bulk) {
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    get_metrics().observe_histogram("request_duration_ms", duration.count() / 1000.0, "endpoint=\"/fuse\"");
+    observe_lane_duration(bulk, start);
+}
+
+// Lane latency for the synchronous /fuse handler, recorded on every return path
+class LaneTimer {
+public:
+    ~LaneTimer() { observe_lane_duration(bulk, start_); }
+    bool bulk = false;
+    
+private:
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+};
+
+// Clock for sensor last-seen times
+int64_t steady_now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record_invalid_readings(const ReadingValidator& validator) {
+    for (auto reason : {InvalidReadingReason::nan, InvalidReadingReason::infinite,
+                        InvalidReadingReason::out_of_range}) {
+        if (uint64_t count = validator.count(reason)) {
+            get_metrics().add_to_counter("invalid_readings_total", static_cast<double>(count),
+                                         std::string("reason=\"") + to_string(reason) + "\"");
+        }
+    }
+}
+
+} // namespace
+
+// A /fuse request waiting for its job to come back from the pipeline or the
+// bulk lane
+struct HttpServer::PendingFuse {
+    simple_http::Ticket ticket;
+    std::string accept;
+    std::chrono::steady_clock::time_point start;
+    FuseRequest request;  // readings and weights travel with the job
+};
+
+struct HttpServer::DeferredState {
+    struct Loop {
+        // Touched only by its own event loop
+        uint64_t next_tag = 0;
+        std::unordered_map<uint64_t, PendingFuse> pending;
+        std::vector<FusionPipeline::Job> done;
+        std::vector<std::pair<simple_http::Ticket, simple_http::Response>> bulk_completed;
+        
+        // Responses from the bulk lane, handed over under the mutex; the flag
+        // spares the loop a lock on every iteration
+        std::mutex bulk_mutex;
+        std::vector<std::pair<simple_http::Ticket, simple_http::Response>> bulk_done;
+        std::atomic<bool> bulk_ready{false};
+    };
+    
+    explicit DeferredState(unsigned loop_count) : loops(loop_count) {}
+    
+    std::unique_ptr<FusionPipeline> pipeline;  // null without pipeline threads
+    std::vector<Loop> loops;
+};
+
+HttpServer::HttpServer(int port, Service* service)
+    : port_(port), service_(service), running_(false), sensors_(std::make_unique<SensorRegistry>()) {
+}
+
+HttpServer::~HttpServer() = default;
+
+int HttpServer::bound_port() const {
+    simple_http::Server* server = server_.load();
+    return server ? server->port() : 0;
 }
 
 void HttpServer::run() {
@@ -18,8 +263,14 @@ void HttpServer::run() {
     std::cout << "Available endpoints:" << std::endl;
     std::cout << "  GET  /health" << std::endl;
     std::cout << "  POST /fuse" << std::endl;
+    std::cout << "  POST /fuse/batch" << std::endl;
     std::cout << "  GET  /metrics" << std::endl;
     std::cout << "  GET  /stats" << std::endl;
+    std::cout << "  GET  /sensors" << std::endl;
+    if (series_) std::cout << "  GET  /series" << std::endl;
+    if (series_) std::cout << "  GET  /query" << std::endl;
+    if (membership_config_) std::cout << "  GET  /cluster" << std::endl;
+    if (sharding_) std::cout << "  POST /cluster/migrate" << std::endl;
     std::cout << "  GET  /config" << std::endl;
     std::cout << "  POST /config" << std::endl;
     std::cout << std::endl;
@@ -31,6 +282,61 @@ void HttpServer::run() {
     
     try {
         simple_http::Server server(port_);
+        if (busy_poll_.threads > 0) {
+            simple_http::BusyPollOptions options;
+            options.threads = busy_poll_.threads;
+            options.first_cpu = busy_poll_.first_cpu;
+            options.socket_busy_poll_us = busy_poll_.socket_busy_poll_us;
+            options.max_spin = std::chrono::microseconds(std::max<uint32_t>(busy_poll_.max_spin_us, 50));
+            server.set_busy_poll(options);
+            if (busy_poll_.pipeline_threads > 0 || bulk_lane_.threads > 0) {
+                deferred_ = std::make_unique<DeferredState>(busy_poll_.threads);
+            }
+            if (busy_poll_.pipeline_threads > 0) {
+                int first_compute_cpu = busy_poll_.first_cpu >= 0
+                    ? busy_poll_.first_cpu + static_cast<int>(busy_poll_.threads) : -1;
+                deferred_->pipeline = std::make_unique<FusionPipeline>(*service_, busy_poll_.threads,
+                                                                       busy_poll_.pipeline_threads, first_compute_cpu);
+            }
+        }
+        if (bulk_lane_.threads > 0) {
+            bulk_pool_ = std::make_unique<ThreadPool>(bulk_lane_.threads);
+        }
+        if (shadow_config_ && !shadow_) {
+            shadow_ = std::make_unique<ShadowEvaluator>(*service_, *shadow_config_);
+        }
+        if (series_ && compaction_ && !compactor_) {
+            compactor_ = std::make_unique<SeriesCompactor>(*series_, *compaction_);
+        }
+        if (series_ && !query_pool_) {
+            unsigned threads = query_threads_ > 0 ? query_threads_ : std::max(1u, std::thread::hardware_concurrency());
+            query_pool_ = std::make_unique<ThreadPool>(threads - 1);  // the handler thread scans too
+        }
+        if (membership_config_ && !membership_) {
+            Membership::Config config = *membership_config_;
+            if (config.http_port == 0) config.http_port = static_cast<uint16_t>(port_);
+            membership_ = std::make_unique<Membership>(config);
+            std::cout << "Gossiping as " << membership_->id() << std::endl;
+        }
+        if (sharding_ && membership_ && !router_) {
+            ShardRouter::Config config = *sharding_;
+            config.on_import = [this](const std::string& sensor) { sensors_->touch(sensor, steady_now_ms()); };
+            router_ = std::make_unique<ShardRouter>(*membership_, series_.get(), config);
+        }
+        if (!tls_.certificate_file.empty()) {
+            simple_http::TlsOptions options;
+            options.certificate_file = tls_.certificate_file;
+            options.private_key_file = tls_.private_key_file;
+            options.ktls = tls_.ktls;
+            options.session_resumption = tls_.session_resumption;
+            server.set_tls(options);
+        }
+        if (!capture_.path.empty()) {
+            simple_http::CaptureOptions options;
+            options.path = capture_.path;
+            options.sample_rate = capture_.sample_rate;
+            server.set_capture(options);
+        }
         
         // Set up routes
         server.get("/health", [this](const simple_http::Request& req, simple_http::Response& res) {
@@ -46,48 +352,272 @@ void HttpServer::run() {
         
         server.post("/fuse", [this](const simple_http::Request& req, simple_http::Response& res) {
             RequestTimer timer("request_duration_ms", "endpoint=\"/fuse\"");
+            LaneTimer lane;
             get_metrics().increment_counter("requests_total", "endpoint=\"/fuse\"");
             
             try {
-                std::vector<double> readings;
-                std::string error = parse_json_array(req.body, readings);
+                FuseRequest request;
+                lane.bulk = is_bulk_body(req);
+                if (!prepare_fuse(req, res, request)) {
+                    return;
+                }
+                lane.bulk = lane.bulk || is_bulk_request(request);
                 
-                if (!error.empty()) {
-                    res.status_code = 400;
-                    res.json(create_json_response("error", error));
-                    get_metrics().increment_counter("errors_total", "endpoint=\"/fuse\",error=\"bad_request\"");
+                Service::FusionResult result;
+                if (lane.bulk) {
+                    // Bulk fusion waits for the bulk pool, so however many
+                    // connections upload at once they hold only its threads
+                    request.options.parallel = true;
+                    bulk_pool_->submit([&]() {
+                        result = service_->fuse(request.readings, request.weights, request.options);
+                    }).get();
+                } else {
+                    result = service_->fuse(request.readings, request.weights, request.options);
+                }
+                write_fuse_response(req.get_header("Accept"), request, result, res);
+                after_fuse(request, result);
+                
+            } catch (const std::invalid_argument& e) {
+                fail_fuse(res, e.what(), true);
+            } catch (const std::exception& e) {
+                fail_fuse(res, e.what(), false);
+            }
+        });
+        
+        if (deferred_) {
+            // Deferred /fuse: small requests are parsed here and fused on a
+            // compute thread (or inline), bulk ones go to the bulk pool; both
+            // are answered from drain_deferred() back on this loop
+            server.post_deferred("/fuse", [this](simple_http::Request& req, simple_http::Response& res,
+                                                 const simple_http::Ticket& ticket) {
+                auto start = std::chrono::steady_clock::now();
+                get_metrics().increment_counter("requests_total", "endpoint=\"/fuse\"");
+                
+                try {
+                    if (is_bulk_body(req)) {
+                        // Leave even the decoding to the bulk lane
+                        auto pending = std::make_shared<PendingFuse>(
+                            PendingFuse{ticket, req.get_header("Accept"), start, FuseRequest()});
+                        submit_bulk_fuse(std::move(pending), std::make_shared<simple_http::Request>(std::move(req)));
+                        return true;
+                    }
+                    
+                    PendingFuse pending{ticket, req.get_header("Accept"), start, FuseRequest()};
+                    if (!prepare_fuse(req, res, pending.request)) {
+                        observe_fuse_duration(start, false);
+                        return false;
+                    }
+                    if (is_bulk_request(pending.request)) {
+                        submit_bulk_fuse(std::make_shared<PendingFuse>(std::move(pending)), nullptr);
+                        return true;
+                    }
+                    if (!deferred_->pipeline) {
+                        auto result = service_->fuse(pending.request.readings, pending.request.weights,
+                                                     pending.request.options);
+                        write_fuse_response(pending.accept, pending.request, result, res);
+                        after_fuse(pending.request, result);
+                        observe_fuse_duration(start, false);
+                        return false;
+                    }
+                    
+                    auto& loop = deferred_->loops[ticket.loop];
+                    FusionPipeline::Job job;
+                    job.tag = loop.next_tag++;
+                    job.readings = std::move(pending.request.readings);
+                    job.weights = std::move(pending.request.weights);
+                    job.options = pending.request.options;
+                    
+                    if (!deferred_->pipeline->submit(ticket.loop, job)) {
+                        // Every ring is full: run to completion on this loop instead
+                        FusionPipeline::run(*service_, job);
+                        finish_pipelined_fuse(pending, job, res);
+                        return false;
+                    }
+                    loop.pending.emplace(job.tag, std::move(pending));
+                    return true;
+                    
+                } catch (const std::invalid_argument& e) {
+                    fail_fuse(res, e.what(), true);
+                } catch (const std::exception& e) {
+                    fail_fuse(res, e.what(), false);
+                }
+                observe_fuse_duration(start, false);
+                return false;
+            });
+            server.set_loop_hook([this, &server](unsigned loop) { return drain_deferred(server, loop); });
+        }
+        
+        server.post("/fuse/batch", [this](const simple_http::Request& req, simple_http::Response& res) {
+            RequestTimer timer("request_duration_ms", "endpoint=\"/fuse/batch\"");
+            get_metrics().increment_counter("requests_total", "endpoint=\"/fuse/batch\"");
+            
+            try {
+                std::string decoded_body;
+                const std::string* body = &req.body;
+                if (!decode_body(req, res, "/fuse/batch", decoded_body, body)) {
                     return;
                 }
                 
-                if (readings.empty()) {
+                std::vector<std::vector<double>> batches;
+                std::vector<std::vector<double>> weights;
+                Service::FusionOptions options;
+                ReadingValidator validator(service_->reading_limits());
+                std::string error = parse_batches(req.get_header("Content-Type"), *body, batches, weights, options,
+                                                  validator);
+                record_invalid_readings(validator);
+                
+                if (error.empty() && batches.empty()) {
+                    error = "batches array cannot be empty";
+                }
+                for (size_t i = 0; error.empty() && i < batches.size(); ++i) {
+                    if (batches[i].empty()) {
+                        error = "batch " + std::to_string(i) + " has no readings";
+                    } else if (!weights.empty() && !weights[i].empty()) {
+                        std::string weights_error = Service::validate_weights(batches[i], weights[i]);
+                        if (!weights_error.empty()) {
+                            error = "batch " + std::to_string(i) + ": " + weights_error;
+                        }
+                    }
+                }
+                
+                if (!error.empty()) {
                     res.status_code = 400;
-                    res.json(create_json_response("error", "readings array cannot be empty"));
-                    get_metrics().increment_counter("errors_total", "endpoint=\"/fuse\",error=\"empty_readings\"");
+                    res.json(create_json_response("error", error));
+                    get_metrics().increment_counter("errors_total", validator.rejected()
+                        ? "endpoint=\"/fuse/batch\",error=\"invalid_reading\""
+                        : "endpoint=\"/fuse/batch\",error=\"bad_request\"");
                     return;
                 }
                 
-                double fused_value = service_->fuse_readings(readings);
+                std::vector<double> fused_values = service_->fuse_batch(batches, weights, options);
                 
-                std::map<std::string, std::string> data;
-                data["fused_value"] = std::to_string(fused_value);
-                data["input_count"] = std::to_string(readings.size());
-                data["timestamp"] = std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::system_clock::now().time_since_epoch()).count());
+                BinaryFormat format;
+                if (accepts_binary(req.get_header("Accept"), format)) {
+                    BinaryWriter writer(format);
+                    writer.begin_map(2).string("status").string("success");
+                    writer.string("data").begin_map(2);
+                    writer.string("batch_count").integer(fused_values.size());
+                    writer.string("fused_values").begin_array(fused_values.size());
+                    for (double value : fused_values) {
+                        writer.number(value);
+                    }
+                    send_binary(res, format, writer.data());
+                    return;
+                }
                 
-                res.json(create_json_response("success", "", data));
+                std::ostringstream oss;
+                oss << "{\n";
+                oss << "  \"status\": \"success\",\n";
+                oss << "  \"data\": {\n";
+                oss << "    \"batch_count\": \"" << fused_values.size() << "\",\n";
+                oss << "    \"fused_values\": [";
+                for (size_t i = 0; i < fused_values.size(); ++i) {
+                    if (i > 0) oss << ", ";
+                    oss << std::to_string(fused_values[i]);
+                }
+                oss << "]\n";
+                oss << "  }\n";
+                oss << "}";
+                res.json(oss.str());
                 
             } catch (const std::exception& e) {
-                std::cerr << "Error processing fusion request: " << e.what() << std::endl;
+                std::cerr << "Error processing batch fusion request: " << e.what() << std::endl;
                 res.status_code = 500;
                 res.json(create_json_response("error", "Internal server error"));
-                get_metrics().increment_counter("errors_total", "endpoint=\"/fuse\",error=\"internal_error\"");
+                get_metrics().increment_counter("errors_total", "endpoint=\"/fuse/batch\",error=\"internal_error\"");
             }
         });
         
-        server.get("/metrics", [this](const simple_http::Request& req, simple_http::Response& res) {
+        server.get("/metrics", [this, &server](const simple_http::Request& req, simple_http::Response& res) {
             RequestTimer timer("request_duration_ms", "endpoint=\"/metrics\"");
             get_metrics().increment_counter("requests_total", "endpoint=\"/metrics\"");
             
+            if (!tls_.certificate_file.empty()) {
+                // Counted by simple_http; mirrored here when scraped
+                simple_http::TlsStats tls = server.tls_stats();
+                get_metrics().set_gauge("tls_handshakes", static_cast<double>(tls.handshakes));
+                get_metrics().set_gauge("tls_resumed_handshakes", static_cast<double>(tls.resumed));
+                get_metrics().set_gauge("tls_handshake_failures", static_cast<double>(tls.failures));
+                get_metrics().set_gauge("tls_ktls_connections", static_cast<double>(tls.ktls_send),
+                                        "direction=\"send\"");
+                get_metrics().set_gauge("tls_ktls_connections", static_cast<double>(tls.ktls_recv),
+                                        "direction=\"recv\"");
+            }
+            if (!capture_.path.empty()) {
+                simple_http::CaptureStats capture = server.capture_stats();
+                get_metrics().set_gauge("capture_requests", static_cast<double>(capture.captured));
+                get_metrics().set_gauge("capture_dropped_requests", static_cast<double>(capture.dropped));
+                get_metrics().set_gauge("capture_bytes_written", static_cast<double>(capture.bytes_written));
+            }
+            SensorRegistry::Counts sensors = sensors_->counts(steady_now_ms());
+            get_metrics().set_gauge("sensors_tracked", static_cast<double>(sensors.tracked));
+            get_metrics().set_gauge("sensors_stale", static_cast<double>(sensors.stale));
+            get_metrics().set_gauge("sensors_untracked", static_cast<double>(sensors.untracked));
+            get_metrics().set_gauge("sensor_expirations", static_cast<double>(sensors.expirations));
+            if (series_) {
+                SeriesStore::Stats series = series_->stats();
+                get_metrics().set_gauge("series_sensors", static_cast<double>(series.sensors));
+                get_metrics().set_gauge("series_points", static_cast<double>(series.points));
+                get_metrics().set_gauge("series_segments", static_cast<double>(series.segments));
+                get_metrics().set_gauge("series_late_points", static_cast<double>(series.late_points));
+                get_metrics().set_gauge("series_bytes", static_cast<double>(series.bytes));
+                get_metrics().set_gauge("series_compacted_segments", static_cast<double>(series.compacted_segments));
+            }
+            if (membership_) {
+                size_t by_state[3] = {0, 0, 0};
+                for (const auto& member : membership_->members()) by_state[static_cast<int>(member.state)]++;
+                for (auto state : {Membership::State::alive, Membership::State::suspect, Membership::State::dead}) {
+                    get_metrics().set_gauge("cluster_members", static_cast<double>(by_state[static_cast<int>(state)]),
+                                            std::string("state=\"") + membership_state_name(state) + "\"");
+                }
+                Membership::Stats gossip = membership_->stats();
+                get_metrics().set_gauge("gossip_messages", static_cast<double>(gossip.messages_sent),
+                                        "direction=\"sent\"");
+                get_metrics().set_gauge("gossip_messages", static_cast<double>(gossip.messages_received),
+                                        "direction=\"received\"");
+                get_metrics().set_gauge("gossip_bytes", static_cast<double>(gossip.bytes_sent), "direction=\"sent\"");
+                get_metrics().set_gauge("gossip_bytes", static_cast<double>(gossip.bytes_received),
+                                        "direction=\"received\"");
+                get_metrics().set_gauge("gossip_probes", static_cast<double>(gossip.probes));
+                get_metrics().set_gauge("gossip_indirect_probes", static_cast<double>(gossip.indirect_probes));
+                get_metrics().set_gauge("gossip_suspicions", static_cast<double>(gossip.suspicions));
+                get_metrics().set_gauge("gossip_refutations", static_cast<double>(gossip.refutations));
+            }
+            if (router_) {
+                ShardRouter::Stats shard = router_->stats();
+                get_metrics().set_gauge("shard_ring_members", static_cast<double>(shard.ring_members));
+                get_metrics().set_gauge("shard_ring_changes", static_cast<double>(shard.ring_changes));
+                get_metrics().set_gauge("shard_migration_queued_sensors", static_cast<double>(shard.queued_sensors));
+                get_metrics().set_gauge("shard_migration_pending_handoffs", static_cast<double>(shard.pending_handoffs));
+                get_metrics().set_gauge("shard_migration_sensors_sent", static_cast<double>(shard.sensors_sent));
+                get_metrics().set_gauge("shard_migration_points", static_cast<double>(shard.points_sent),
+                                        "direction=\"sent\"");
+                get_metrics().set_gauge("shard_migration_points", static_cast<double>(shard.points_received),
+                                        "direction=\"received\"");
+                get_metrics().set_gauge("shard_migration_chunks", static_cast<double>(shard.chunks_sent),
+                                        "outcome=\"sent\"");
+                get_metrics().set_gauge("shard_migration_chunks", static_cast<double>(shard.chunks_failed),
+                                        "outcome=\"failed\"");
+                get_metrics().set_gauge("shard_migration_chunks", static_cast<double>(shard.chunks_received),
+                                        "outcome=\"received\"");
+                get_metrics().set_gauge("shard_migration_bytes_sent", static_cast<double>(shard.bytes_sent));
+                get_metrics().set_gauge("shard_migration_throttled_ms", static_cast<double>(shard.throttled_ms));
+            }
+            if (compactor_) {
+                SeriesCompactor::Stats compaction = compactor_->stats();
+                get_metrics().set_gauge("series_compaction_passes", static_cast<double>(compaction.passes));
+                get_metrics().set_gauge("series_compaction_merged_segments",
+                                        static_cast<double>(compaction.merged_segments));
+                get_metrics().set_gauge("series_compaction_bytes", static_cast<double>(compaction.bytes_read),
+                                        "direction=\"read\"");
+                get_metrics().set_gauge("series_compaction_bytes", static_cast<double>(compaction.bytes_written),
+                                        "direction=\"written\"");
+                get_metrics().set_gauge("series_compaction_throttled_ms", static_cast<double>(compaction.throttled_ms));
+                get_metrics().set_gauge("series_compaction_backlog_segments",
+                                        static_cast<double>(compaction.backlog_segments));
+                get_metrics().set_gauge("series_expired_points", static_cast<double>(compaction.expired_points));
+            }
+            
             res.set_header("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
             res.text(get_metrics().get_prometheus_metrics());
         });
@@ -113,6 +643,245 @@ void HttpServer::run() {
             res.json(create_json_response("success", "", data));
         });
         
+        server.get("/sensors", [this](const simple_http::Request& req, simple_http::Response& res) {
+            RequestTimer timer("request_duration_ms", "endpoint=\"/sensors\"");
+            get_metrics().increment_counter("requests_total", "endpoint=\"/sensors\"");
+            
+            std::string stale = req.query_param("stale", "false");
+            std::string limit_param = req.query_param("limit", "100");
+            bool limit_ok = !limit_param.empty() && limit_param.size() <= 9 &&
+                std::all_of(limit_param.begin(), limit_param.end(), [](char c) { return c >= '0' && c <= '9'; });
+            if ((stale != "true" && stale != "false") || !limit_ok) {
+                res.status_code = 400;
+                res.json(create_json_response("error", "expected stale=true|false and a numeric limit"));
+                get_metrics().increment_counter("errors_total", "endpoint=\"/sensors\",error=\"bad_request\"");
+                return;
+            }
+            
+            int64_t now = steady_now_ms();
+            SensorRegistry::Counts counts = sensors_->counts(now);
+            auto sensors = sensors_->list(now, stale == "true", std::stoul(limit_param));
+            std::ostringstream oss;
+            oss << "{\n";
+            oss << "  \"status\": \"success\",\n";
+            oss << "  \"data\": {\n";
+            oss << "    \"tracked\": " << counts.tracked << ",\n";
+            oss << "    \"stale\": " << counts.stale << ",\n";
+            oss << "    \"stale_after_ms\": " << sensors_->config().stale_after_ms << ",\n";
+            oss << "    \"sensors\": [";
+            for (size_t i = 0; i < sensors.size(); ++i) {
+                if (i > 0) oss << ",";
+                oss << "\n      {\"id\": \"" << json_escape(sensors[i].id) << "\", \"last_seen_ms_ago\": "
+                    << now - sensors[i].last_seen_ms << ", \"updates\": " << sensors[i].updates
+                    << ", \"stale\": " << (sensors[i].stale ? "true" : "false") << "}";
+            }
+            oss << (sensors.empty() ? "]\n" : "\n    ]\n");
+            oss << "  }\n";
+            oss << "}";
+            res.json(oss.str());
+        });
+        
+        server.get("/series", [this](const simple_http::Request& req, simple_http::Response& res) {
+            RequestTimer timer("request_duration_ms", "endpoint=\"/series\"");
+            get_metrics().increment_counter("requests_total", "endpoint=\"/series\"");
+            
+            if (!series_) {
+                res.status_code = 404;
+                res.json(create_json_response("error", "series storage is disabled"));
+                get_metrics().increment_counter("errors_total", "endpoint=\"/series\",error=\"disabled\"");
+                return;
+            }
+            std::string sensor;
+            int64_t from = INT64_MIN;
+            int64_t to = INT64_MAX;
+            int64_t points = 1000;
+            DownsampleMode mode = DownsampleMode::lttb;
+            std::string from_param = req.query_param("from", "");
+            std::string to_param = req.query_param("to", "");
+            if (!percent_decode(req.query_param("sensor", ""), sensor) || sensor.empty() ||
+                (!from_param.empty() && !parse_query_integer(from_param, from)) ||
+                (!to_param.empty() && !parse_query_integer(to_param, to)) ||
+                !parse_query_integer(req.query_param("points", "1000"), points) || points < 1 ||
+                !parse_downsample_mode(req.query_param("mode", "lttb"), mode)) {
+                res.status_code = 400;
+                res.json(create_json_response("error",
+                    "expected sensor=ID, optional from/to timestamps, points >= 1 and mode=lttb|minmax"));
+                get_metrics().increment_counter("errors_total", "endpoint=\"/series\",error=\"bad_request\"");
+                return;
+            }
+            if (router_ && forward_to_owner(req, res, sensor, "/series")) {
+                return;
+            }
+            
+            SeriesStore::Snapshot snapshot;
+            if (!series_->snapshot(sensor, snapshot)) {
+                res.status_code = 404;
+                res.json(create_json_response("error", "no series for sensor: " + sensor));
+                get_metrics().increment_counter("errors_total", "endpoint=\"/series\",error=\"unknown_sensor\"");
+                return;
+            }
+            DownsampleResult result = downsample(snapshot, from, to, static_cast<size_t>(points), mode);
+            
+            // Built directly: the point array is the bulk of the response
+            std::string body;
+            body.reserve(160 + result.points.size() * 40);
+            body += "{\n  \"status\": \"success\",\n  \"data\": {\n";
+            body += "    \"sensor\": \"" + json_escape(sensor) + "\",\n";
+            body += std::string("    \"mode\": \"") + downsample_mode_name(mode) + "\",\n";
+            body += "    \"in_range\": " + std::to_string(result.in_range) + ",\n";
+            body += "    \"returned\": " + std::to_string(result.points.size()) + ",\n";
+            body += "    \"points\": [";
+            char buffer[64];
+            for (size_t i = 0; i < result.points.size(); ++i) {
+                int length = std::snprintf(buffer, sizeof(buffer), "%s[%lld,%.10g]", i > 0 ? "," : "",
+                                           static_cast<long long>(result.points[i].timestamp),
+                                           result.points[i].value);
+                body.append(buffer, static_cast<size_t>(length));
+            }
+            body += "]\n  }\n}";
+            res.body = std::move(body);
+            res.set_header("Content-Type", "application/json");
+        });
+        
+        server.get("/query", [this](const simple_http::Request& req, simple_http::Response& res) {
+            RequestTimer timer("request_duration_ms", "endpoint=\"/query\"");
+            get_metrics().increment_counter("requests_total", "endpoint=\"/query\"");
+            
+            if (!series_) {
+                res.status_code = 404;
+                res.json(create_json_response("error", "series storage is disabled"));
+                get_metrics().increment_counter("errors_total", "endpoint=\"/query\",error=\"disabled\"");
+                return;
+            }
+            SeriesQuery query;
+            std::string from_param = req.query_param("from", "");
+            std::string to_param = req.query_param("to", "");
+            std::string group = req.query_param("group", "sensor");
+            std::string quantile_param = req.query_param("q", "0.5");
+            char* quantile_end = nullptr;
+            query.quantile = std::strtod(quantile_param.c_str(), &quantile_end);
+            if (!percent_decode(req.query_param("prefix", ""), query.prefix) ||
+                !parse_series_aggregate(req.query_param("agg", "avg"), query.aggregate) ||
+                (!from_param.empty() && !parse_query_integer(from_param, query.from)) ||
+                (!to_param.empty() && !parse_query_integer(to_param, query.to)) ||
+                !parse_query_integer(req.query_param("step", "0"), query.step) || query.step < 0 ||
+                (group != "sensor" && group != "all") || quantile_param.empty() || *quantile_end != '\0' ||
+                !(query.quantile >= 0.0 && query.quantile <= 1.0)) {
+                res.status_code = 400;
+                res.json(create_json_response("error",
+                    "expected agg=count|sum|avg|min|max|quantile, q in [0, 1], optional prefix, from/to "
+                    "timestamps, step >= 0 and group=sensor|all"));
+                get_metrics().increment_counter("errors_total", "endpoint=\"/query\",error=\"bad_request\"");
+                return;
+            }
+            query.by_sensor = group == "sensor";
+            
+            SeriesQueryResult result = run_series_query(*series_, query, query_pool_.get());
+            get_metrics().add_to_counter("query_points_scanned_total", static_cast<double>(result.points_scanned));
+            get_metrics().add_to_counter("query_segments_total", static_cast<double>(result.segments_scanned),
+                                         "outcome=\"scanned\"");
+            get_metrics().add_to_counter("query_segments_total", static_cast<double>(result.segments_skipped),
+                                         "outcome=\"skipped\"");
+            
+            std::ostringstream oss;
+            oss << "{\n";
+            oss << "  \"status\": \"success\",\n";
+            oss << "  \"data\": {\n";
+            oss << "    \"aggregate\": \"" << series_aggregate_name(query.aggregate) << "\",\n";
+            oss << "    \"step\": " << query.step << ",\n";
+            oss << "    \"points_scanned\": " << result.points_scanned << ",\n";
+            oss << "    \"segments_scanned\": " << result.segments_scanned << ",\n";
+            oss << "    \"segments_skipped\": " << result.segments_skipped << ",\n";
+            oss << "    \"groups\": [";
+            char buffer[96];
+            for (size_t g = 0; g < result.groups.size(); ++g) {
+                const auto& entry = result.groups[g];
+                oss << (g > 0 ? "," : "") << "\n      {\"sensor\": ";
+                if (query.by_sensor) {
+                    oss << "\"" << json_escape(entry.sensor) << "\"";
+                } else {
+                    oss << "null";
+                }
+                oss << ", \"buckets\": [";
+                for (size_t b = 0; b < entry.buckets.size(); ++b) {
+                    // [start, value, count]
+                    std::snprintf(buffer, sizeof(buffer), "%s[%lld,%.10g,%llu]", b > 0 ? "," : "",
+                                  static_cast<long long>(entry.buckets[b].start), entry.buckets[b].value,
+                                  static_cast<unsigned long long>(entry.buckets[b].count));
+                    oss << buffer;
+                }
+                oss << "]}";
+            }
+            oss << (result.groups.empty() ? "]\n" : "\n    ]\n");
+            oss << "  }\n";
+            oss << "}";
+            res.json(oss.str());
+        });
+        
+        server.get("/cluster", [this](const simple_http::Request& req, simple_http::Response& res) {
+            RequestTimer timer("request_duration_ms", "endpoint=\"/cluster\"");
+            get_metrics().increment_counter("requests_total", "endpoint=\"/cluster\"");
+            
+            if (!membership_) {
+                res.status_code = 404;
+                res.json(create_json_response("error", "clustering is disabled"));
+                get_metrics().increment_counter("errors_total", "endpoint=\"/cluster\",error=\"disabled\"");
+                return;
+            }
+            auto members = membership_->members();
+            std::ostringstream oss;
+            oss << "{\n";
+            oss << "  \"status\": \"success\",\n";
+            oss << "  \"data\": {\n";
+            oss << "    \"self\": \"" << json_escape(membership_->id()) << "\",\n";
+            oss << "    \"version\": " << membership_->version() << ",\n";
+            oss << "    \"members\": [";
+            for (size_t i = 0; i < members.size(); ++i) {
+                if (i > 0) oss << ",";
+                oss << "\n      {\"id\": \"" << json_escape(members[i].id) << "\", \"http_port\": "
+                    << members[i].http_port << ", \"state\": \"" << membership_state_name(members[i].state)
+                    << "\", \"incarnation\": " << members[i].incarnation << "}";
+            }
+            oss << "\n    ]\n";
+            oss << "  }\n";
+            oss << "}";
+            res.json(oss.str());
+        });
+        
+        // Shard handoff from another member: a Gorilla batch of series, or
+        // with X-Fuser-Handoff: done, the end of that member's handoff
+        server.post("/cluster/migrate", [this](const simple_http::Request& req, simple_http::Response& res) {
+            RequestTimer timer("request_duration_ms", "endpoint=\"/cluster/migrate\"");
+            get_metrics().increment_counter("requests_total", "endpoint=\"/cluster/migrate\"");
+            
+            if (!router_) {
+                res.status_code = 404;
+                res.json(create_json_response("error", "sharding is disabled"));
+                get_metrics().increment_counter("errors_total", "endpoint=\"/cluster/migrate\",error=\"disabled\"");
+                return;
+            }
+            if (!router_->accepts_from(req.get_header("X-Fuser-Member"), req.remote_address)) {
+                res.status_code = 403;
+                res.json(create_json_response("error", "only cluster members may migrate series"));
+                get_metrics().increment_counter("errors_total", "endpoint=\"/cluster/migrate\",error=\"forbidden\"");
+                return;
+            }
+            if (req.get_header("X-Fuser-Handoff") == "done") {
+                router_->handoff_done(req.get_header("X-Fuser-Member"),
+                                      std::strtoull(req.get_header("X-Fuser-Ring").c_str(), nullptr, 10));
+                res.json(create_json_response("success"));
+                return;
+            }
+            std::string error;
+            if (!router_->receive(req.body, error, max_decoded_body_bytes_)) {
+                res.status_code = 400;
+                res.json(create_json_response("error", error));
+                get_metrics().increment_counter("errors_total", "endpoint=\"/cluster/migrate\",error=\"bad_request\"");
+                return;
+            }
+            res.json(create_json_response("success"));
+        });
+        
         server.get("/config", [this](const simple_http::Request& req, simple_http::Response& res) {
             RequestTimer timer("request_duration_ms", "endpoint=\"/config\"");
             get_metrics().increment_counter("requests_total", "endpoint=\"/config\"");
@@ -135,61 +904,488 @@ void HttpServer::run() {
         });
         
         std::cout << "HTTP Server running on port " << port_ << std::endl;
+        server_ = &server;
         server.run();
+        server_ = nullptr;
+        // Bulk tasks still running post into deferred_, so drain them first
+        bulk_pool_.reset();
+        deferred_.reset();
         
     } catch (const std::exception& e) {
         std::cerr << "Failed to start HTTP server: " << e.what() << std::endl;
+        server_ = nullptr;
+        bulk_pool_.reset();
+        deferred_.reset();
         running_ = false;
     }
 }
 
 void HttpServer::stop() {
     running_ = false;
+    if (simple_http::Server* server = server_.load()) {
+        server->stop();
+    }
 }
 
-std::string HttpServer::parse_json_array(const std::string& json_str, std::vector<double>& readings) {
-    // Simple JSON array parsing for demo purposes
-    // In production, use a proper JSON library
+bool HttpServer::prepare_fuse(const simple_http::Request& req, simple_http::Response& res, FuseRequest& request) {
+    std::string decoded_body;
+    const std::string* body = &req.body;
+    if (!decode_body(req, res, "/fuse", decoded_body, body)) {
+        return false;
+    }
     
-    readings.clear();
+    ReadingValidator validator(service_->reading_limits());
+    std::string error = parse_fuse_request(req.get_header("Content-Type"), *body, request, validator);
+    record_invalid_readings(validator);
     
-    // Find the "readings" array
-    size_t readings_pos = json_str.find("\"readings\"");
-    if (readings_pos == std::string::npos) {
-        return "Missing 'readings' field";
+    if (!error.empty()) {
+        res.status_code = 400;
+        res.json(create_json_response("error", error));
+        get_metrics().increment_counter("errors_total", validator.rejected()
+            ? "endpoint=\"/fuse\",error=\"invalid_reading\""
+            : "endpoint=\"/fuse\",error=\"bad_request\"");
+        return false;
     }
     
-    size_t array_start = json_str.find('[', readings_pos);
-    if (array_start == std::string::npos) {
-        return "Invalid JSON array format";
+    if (request.readings.empty()) {
+        res.status_code = 400;
+        res.json(create_json_response("error", "readings array cannot be empty"));
+        get_metrics().increment_counter("errors_total", "endpoint=\"/fuse\",error=\"empty_readings\"");
+        return false;
+    }
+    if (!request.sensor.empty()) {
+        if (router_ && forward_to_owner(req, res, request.sensor, "/fuse")) {
+            return false;
+        }
+        sensors_->touch(request.sensor, steady_now_ms());
+    }
+    return true;
+}
+
+bool HttpServer::forward_to_owner(const simple_http::Request& req, simple_http::Response& res,
+                                  const std::string& sensor, const std::string& endpoint) {
+    unsigned hops = static_cast<unsigned>(std::strtoul(req.get_header("X-Fuser-Hops").c_str(), nullptr, 10));
+    ShardRouter::Route route = router_->route(sensor, hops);
+    if (route.local) {
+        return false;
     }
     
-    size_t array_end = json_str.find(']', array_start);
-    if (array_end == std::string::npos) {
-        return "Unclosed JSON array";
+    // One kept-alive connection per owner and serving thread
+    thread_local std::unordered_map<std::string, std::unique_ptr<simple_http::Client>> clients;
+    auto& client = clients[route.host + ":" + std::to_string(route.port)];
+    if (!client) {
+        client = std::make_unique<simple_http::Client>(route.host, route.port);
+    }
+    std::unordered_map<std::string, std::string> headers = {{"X-Fuser-Hops", std::to_string(hops + 1)}};
+    for (const char* name : {"Content-Type", "Content-Encoding", "Accept"}) {
+        std::string value = req.get_header(name);
+        if (!value.empty()) headers[name] = value;
+    }
+    std::string target = req.query.empty() ? req.path : req.path + "?" + req.query;
+    simple_http::Response forwarded;
+    if (!client->request(req.method, target, req.body, forwarded, headers)) {
+        client->disconnect();
+        res.status_code = 502;
+        res.json(create_json_response("error", "sensor owner unreachable"));
+        get_metrics().increment_counter("errors_total", "endpoint=\"" + endpoint + "\",error=\"forward_failed\"");
+        return true;
+    }
+    res.status_code = forwarded.status_code;
+    res.body = std::move(forwarded.body);
+    for (const char* name : {"Content-Type", "Content-Encoding"}) {
+        auto header = forwarded.headers.find(name);
+        if (header != forwarded.headers.end()) res.set_header(name, header->second);
     }
+    get_metrics().increment_counter("forwarded_requests_total", "endpoint=\"" + endpoint + "\"");
+    return true;
+}
+
+void HttpServer::write_fuse_response(const std::string& accept, const FuseRequest& request,
+                                     const Service::FusionResult& result, simple_http::Response& res) {
+    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
     
-    std::string array_content = json_str.substr(array_start + 1, array_end - array_start - 1);
+    BinaryFormat format;
+    if (accepts_binary(accept, format)) {
+        BinaryWriter writer(format);
+        writer.begin_map(2).string("status").string("success");
+        writer.string("data").begin_map(5u + (request.sensor.empty() ? 0u : 1u) +
+                                         (result.has_interval ? 4u : 0u));
+        writer.string("fused_value").number(result.value);
+        writer.string("algorithm").string(Service::algorithm_name(result.algorithm));
+        writer.string("confidence").number(result.confidence);
+        writer.string("input_count").integer(request.readings.size());
+        writer.string("timestamp").integer(static_cast<uint64_t>(timestamp));
+        if (!request.sensor.empty()) {
+            writer.string("sensor").string(request.sensor);
+        }
+        if (result.has_interval) {
+            writer.string("interval_low").number(result.interval_low);
+            writer.string("interval_high").number(result.interval_high);
+            writer.string("interval_level").number(request.options.interval_level);
+            writer.string("resamples").integer(result.resamples);
+        }
+        send_binary(res, format, writer.data());
+        return;
+    }
     
-    // Parse numbers from the array
-    std::istringstream array_stream(array_content);
-    std::string number_str;
+    std::map<std::string, std::string> data;
+    data["fused_value"] = std::to_string(result.value);
+    data["algorithm"] = Service::algorithm_name(result.algorithm);
+    data["confidence"] = std::to_string(result.confidence);
+    data["input_count"] = std::to_string(request.readings.size());
+    data["timestamp"] = std::to_string(timestamp);
+    if (!request.sensor.empty()) {
+        data["sensor"] = json_escape(request.sensor);
+    }
+    if (result.has_interval) {
+        data["interval_low"] = std::to_string(result.interval_low);
+        data["interval_high"] = std::to_string(result.interval_high);
+        data["interval_level"] = std::to_string(request.options.interval_level);
+        data["resamples"] = std::to_string(result.resamples);
+    }
     
-    while (std::getline(array_stream, number_str, ',')) {
-        // Trim whitespace
-        number_str.erase(0, number_str.find_first_not_of(" \t"));
-        number_str.erase(number_str.find_last_not_of(" \t") + 1);
+    res.json(create_json_response("success", "", data));
+}
+
+void HttpServer::after_fuse(FuseRequest& request, const Service::FusionResult& result) {
+    if (series_ && !request.sensor.empty()) {
+        int64_t timestamp = request.timestamps.empty()
+            ? std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::system_clock::now().time_since_epoch()).count()
+            : *std::max_element(request.timestamps.begin(), request.timestamps.end());
+        series_->append(request.sensor, timestamp, result.value);
+    }
+    if (shadow_) {
+        shadow_->offer(request.readings, request.weights, request.options, result);
+    }
+}
+
+void HttpServer::finish_pipelined_fuse(PendingFuse& pending, FusionPipeline::Job& job, simple_http::Response& res) {
+    if (!job.error.empty()) {
+        fail_fuse(res, job.error, job.bad_request);
+    } else {
+        pending.request.readings = std::move(job.readings);
+        pending.request.weights = std::move(job.weights);
+        write_fuse_response(pending.accept, pending.request, job.result, res);
+        after_fuse(pending.request, job.result);
+    }
+    observe_fuse_duration(pending.start, false);
+}
+
+void HttpServer::fail_fuse(simple_http::Response& res, const std::string& error, bool bad_request) {
+    if (bad_request) {
+        res.status_code = 400;
+        res.json(create_json_response("error", error));
+        get_metrics().increment_counter("errors_total", "endpoint=\"/fuse\",error=\"bad_request\"");
+        return;
+    }
+    std::cerr << "Error processing fusion request: " << error << std::endl;
+    res.status_code = 500;
+    res.json(create_json_response("error", "Internal server error"));
+    get_metrics().increment_counter("errors_total", "endpoint=\"/fuse\",error=\"internal_error\"");
+}
+
+bool HttpServer::is_bulk_body(const simple_http::Request& req) const {
+    return bulk_pool_ && req.body.size() >= bulk_lane_.min_body_bytes;
+}
+
+bool HttpServer::is_bulk_request(const FuseRequest& request) const {
+    return bulk_pool_ && request.readings.size() >= bulk_lane_.min_readings;
+}
+
+void HttpServer::submit_bulk_fuse(std::shared_ptr<PendingFuse> pending, std::shared_ptr<simple_http::Request> raw) {
+    bulk_pool_->submit([this, pending, raw]() {
+        simple_http::Response res;
+        try {
+            if (!raw || prepare_fuse(*raw, res, pending->request)) {
+                FuseRequest& request = pending->request;
+                request.options.parallel = true;
+                auto result = service_->fuse(request.readings, request.weights, request.options);
+                write_fuse_response(pending->accept, request, result, res);
+                after_fuse(request, result);
+            }
+        } catch (const std::invalid_argument& e) {
+            res = simple_http::Response();
+            fail_fuse(res, e.what(), true);
+        } catch (const std::exception& e) {
+            res = simple_http::Response();
+            fail_fuse(res, e.what(), false);
+        }
+        observe_fuse_duration(pending->start, true);
         
-        if (!number_str.empty()) {
-            try {
-                double value = std::stod(number_str);
-                readings.push_back(value);
-            } catch (const std::exception&) {
-                return "Invalid number in readings array: " + number_str;
+        auto& loop = deferred_->loops[pending->ticket.loop];
+        std::lock_guard<std::mutex> lock(loop.bulk_mutex);
+        loop.bulk_done.emplace_back(pending->ticket, std::move(res));
+        loop.bulk_ready.store(true, std::memory_order_release);
+    });
+}
+
+bool HttpServer::drain_deferred(simple_http::Server& server, unsigned loop_index) {
+    auto& loop = deferred_->loops[loop_index];
+    bool worked = false;
+    
+    if (deferred_->pipeline) {
+        loop.done.clear();
+        if (deferred_->pipeline->collect(loop_index, loop.done) > 0) {
+            worked = true;
+        }
+        for (auto& job : loop.done) {
+            auto it = loop.pending.find(job.tag);
+            if (it == loop.pending.end()) continue;
+            simple_http::Response res;
+            finish_pipelined_fuse(it->second, job, res);
+            server.complete(it->second.ticket, res);
+            loop.pending.erase(it);
+        }
+    }
+    
+    if (loop.bulk_ready.load(std::memory_order_acquire)) {
+        loop.bulk_completed.clear();
+        {
+            std::lock_guard<std::mutex> lock(loop.bulk_mutex);
+            loop.bulk_completed.swap(loop.bulk_done);
+            loop.bulk_ready.store(false, std::memory_order_relaxed);
+        }
+        for (const auto& [ticket, res] : loop.bulk_completed) {
+            server.complete(ticket, res);
+        }
+        worked = true;
+    }
+    return worked;
+}
+
+bool HttpServer::decode_body(const simple_http::Request& req, simple_http::Response& res,
+                             const std::string& endpoint, std::string& decoded, const std::string*& body) {
+    // Undo any Content-Encoding before parsing (bounded against zip bombs)
+    body = &req.body;
+    std::string content_encoding = req.get_header("Content-Encoding");
+    if (!content_encoding.empty()) {
+        auto decode_error = decode_content(content_encoding, req.body, decoded, max_decoded_body_bytes_);
+        if (decode_error != ContentDecodeError::none) {
+            std::string error_label;
+            switch (decode_error) {
+                case ContentDecodeError::unsupported_encoding:
+                    res.status_code = 415;
+                    error_label = "unsupported_encoding";
+                    break;
+                case ContentDecodeError::too_large:
+                    res.status_code = 413;
+                    error_label = "body_too_large";
+                    break;
+                default:
+                    res.status_code = 400;
+                    error_label = "malformed_encoding";
+                    break;
             }
+            res.json(create_json_response("error", to_string(decode_error)));
+            get_metrics().increment_counter("errors_total",
+                                            "endpoint=\"" + endpoint + "\",error=\"" + error_label + "\"");
+            return false;
         }
+        get_metrics().add_to_counter("request_body_bytes_total", static_cast<double>(req.body.size()),
+                                     "encoding=\"compressed\"");
+        body = &decoded;
     }
+    get_metrics().add_to_counter("request_body_bytes_total", static_cast<double>(body->size()),
+                                 "encoding=\"decoded\"");
+    return true;
+}
+
+std::string HttpServer::parse_fuse_request(const std::string& content_type, const std::string& body,
+                                           FuseRequest& request, ReadingValidator& validator) {
+    request = FuseRequest();
     
+    if (media_type_is(content_type, kGorillaContentType)) {
+        std::vector<GorillaSeriesView> series;
+        std::string error = decode_gorilla_batch(body, request.readings, request.timestamps, &series,
+                                                 max_decoded_body_bytes_);
+        if (!error.empty()) {
+            return error;
+        }
+        if (series.size() == 1) {
+            request.sensor = series[0].sensor;
+        }
+        // The XOR decoder reconstructs values from bit patterns, so it is
+        // validated in one compaction pass afterwards rather than inline
+        size_t kept = 0;
+        for (size_t i = 0; i < request.readings.size(); ++i) {
+            double value = request.readings[i];
+            if (!validator.admit(value)) {
+                if (validator.rejected()) return validator.error();
+                continue;
+            }
+            request.readings[kept] = value;
+            request.timestamps[kept] = request.timestamps[i];
+            ++kept;
+        }
+        request.readings.resize(kept);
+        request.timestamps.resize(kept);
+        return "";
+    }
+    
+    BinaryFormat format;
+    if (binary_format_for_media_type(content_type, format)) {
+        return decode_binary_readings(format, body, request.readings, &validator);
+    }
+    
+    return parse_json_request(body, request, validator);
+}
+
+std::string HttpServer::parse_batches(const std::string& content_type, const std::string& body,
+                                      std::vector<std::vector<double>>& batches,
+                                      std::vector<std::vector<double>>& weights,
+                                      Service::FusionOptions& options, ReadingValidator& validator) {
+    batches.clear();
+    weights.clear();
+    options = Service::FusionOptions();
+    
+    BinaryFormat format;
+    if (binary_format_for_media_type(content_type, format)) {
+        return decode_binary_batches(format, body, batches, &validator);
+    }
+    
+    // Expect {"batches": [...]} where each batch is a readings array or a
+    // {"readings": [...], "weights": [...]} object; other members are skipped
+    JsonScanner scanner(body);
+    bool has_batches = false;
+    bool any_weights = false;
+    std::string algorithm_name;
+    std::string key;
+    
+    auto read_batch = [&]() {
+        batches.emplace_back();
+        weights.emplace_back();
+        validator.begin_series();
+        if (!scanner.at_object()) {
+            return scanner.read_number_array(batches.back(), validator);
+        }
+        bool has_readings = false;
+        if (!scanner.begin_object()) return false;
+        while (scanner.next_member(key)) {
+            bool ok;
+            if (key == "readings") {
+                has_readings = true;
+                ok = scanner.read_number_array(batches.back(), validator);
+            } else if (key == "weights") {
+                any_weights = true;
+                ok = scanner.read_number_array(weights.back());
+            } else {
+                ok = scanner.skip_value();
+            }
+            if (!ok) return false;
+        }
+        if (!scanner.failed() && !has_readings) {
+            batches.back().clear();  // reported as a batch with no readings
+        }
+        erase_dropped(validator, weights.back());
+        return !scanner.failed();
+    };
+    
+    if (scanner.begin_object()) {
+        while (scanner.next_member(key)) {
+            if (key == "batches" && !has_batches) {
+                has_batches = true;
+                if (!scanner.begin_array()) break;
+                while (scanner.next_element()) {
+                    if (!read_batch()) break;
+                }
+            } else if (bool ok; parse_algorithm_member(scanner, key, options, algorithm_name, ok)) {
+                if (!ok) break;
+            } else if (!scanner.skip_value()) {
+                break;
+            }
+        }
+    }
+    
+    if (!scanner.finish()) {
+        return scanner.error();
+    }
+    if (!has_batches) {
+        return "Missing 'batches' field";
+    }
+    if (!any_weights) {
+        weights.clear();
+    }
+    std::string algorithm_error = validate_algorithm_options(algorithm_name, options);
+    if (!algorithm_error.empty()) {
+        return algorithm_error;
+    }
+    if (any_weights && !weights_allowed(options)) {
+        return "'weights' require the weighted or auto algorithm";
+    }
+    return "";
+}
+
+std::string HttpServer::parse_json_request(const std::string& json_str, FuseRequest& request,
+                                           ReadingValidator& validator) {
+    // Only the top-level members /fuse uses are decoded; metadata, tags and any
+    // nested objects are skipped by a structural scan without being parsed.
+    JsonScanner scanner(json_str);
+    bool has_readings = false;
+    bool has_weights = false;
+    std::string algorithm_name;
+    std::string key;
+    
+    if (scanner.begin_object()) {
+        while (scanner.next_member(key)) {
+            bool ok;
+            if (key == "readings") {
+                has_readings = true;
+                request.readings.clear();
+                validator.begin_series();
+                ok = scanner.read_number_array(request.readings, validator);
+            } else if (key == "sensor") {
+                ok = scanner.read_string(request.sensor);
+            } else if (key == "timestamps") {
+                request.timestamps.clear();
+                ok = scanner.read_integer_array(request.timestamps);
+            } else if (key == "weights") {
+                has_weights = true;
+                request.weights.clear();
+                ok = scanner.read_number_array(request.weights);
+            } else if (key == "interval") {
+                ok = parse_interval_options(scanner, request.options);
+            } else if (parse_algorithm_member(scanner, key, request.options, algorithm_name, ok)) {
+                // algorithm / tolerance
+            } else {
+                ok = scanner.skip_value();
+            }
+            if (!ok) break;
+        }
+    }
+    
+    if (!scanner.finish()) {
+        return scanner.error();
+    }
+    if (!has_readings) {
+        return "Missing 'readings' field";
+    }
+    erase_dropped(validator, request.timestamps);
+    erase_dropped(validator, request.weights);
+    if (!request.timestamps.empty() && request.timestamps.size() != request.readings.size()) {
+        return "'timestamps' must have one entry per reading";
+    }
+    auto& options = request.options;
+    std::string algorithm_error = validate_algorithm_options(algorithm_name, options);
+    if (!algorithm_error.empty()) {
+        return algorithm_error;
+    }
+    if (has_weights && !weights_allowed(options)) {
+        return "'weights' require the weighted or auto algorithm";
+    }
+    if (options.interval && !(options.interval_level > 0.0 && options.interval_level < 1.0)) {
+        return "'interval.level' must be between 0 and 1";
+    }
+    if (options.interval && !(options.deadline_ms > 0.0 && options.deadline_ms <= 10000.0)) {
+        return "'interval.deadline_ms' must be in (0, 10000]";
+    }
+    if (options.interval && (options.max_resamples < 100 || options.max_resamples > 10000)) {
+        return "'interval.max_resamples' must be in [100, 10000]";
+    }
+    if (has_weights && !request.readings.empty()) {
+        return Service::validate_weights(request.readings, request.weights);
+    }
     return "";
 }
 
@@ -200,7 +1396,8 @@ std::string HttpServer::create_json_response(const std::string& status, const st
     oss << "  \"status\": \"" << status << "\"";
     
     if (!message.empty()) {
-        oss << ",\n  \"message\": \"" << message << "\"";
+        // Error messages quote client input (keys, tokens, names)
+        oss << ",\n  \"message\": \"" << json_escape(message) << "\"";
     }
     
     if (!data.empty()) {
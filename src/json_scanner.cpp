@@ -0,0 +1,438 @@
+#include "json_scanner.hpp"
+#include "reading_validator.hpp"
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cpp_service {
+
+namespace {
+
+constexpr size_t kMaxNestingDepth = 256;
+
+// First '"' or '\\' at or after p (end if none)
+const char* find_quote_or_backslash(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\') ++p;
+    return p;
+}
+
+// First '"', '[', ']', '{' or '}' at or after p (end if none).
+// Brackets and braces differ only in bit 0x20, so one OR folds them together.
+const char* find_structural(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i folded = _mm_or_si128(chunk, case_bit);
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                    _mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+#endif
+    while (p < end) {
+        char folded = static_cast<char>(*p | 0x20);
+        if (*p == '"' || folded == '{' || folded == '}') break;
+        ++p;
+    }
+    return p;
+}
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+void append_utf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else {
+        out.push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+}
+
+bool parse_hex4(const char* p, uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= static_cast<uint32_t>(c - '0');
+        else if (c >= 'a' && c <= 'f') value |= static_cast<uint32_t>(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') value |= static_cast<uint32_t>(c - 'A' + 10);
+        else return false;
+    }
+    return true;
+}
+
+} // namespace
+
+JsonScanner::JsonScanner(const std::string& json) : p_(json.data()), end_(json.data() + json.size()) {}
+
+bool JsonScanner::fail(const std::string& message) {
+    if (error_.empty()) {
+        error_ = message;
+    }
+    p_ = end_;
+    return false;
+}
+
+void JsonScanner::skip_whitespace() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+}
+
+bool JsonScanner::at_array() {
+    skip_whitespace();
+    return p_ < end_ && *p_ == '[';
+}
+
+bool JsonScanner::at_object() {
+    skip_whitespace();
+    return p_ < end_ && *p_ == '{';
+}
+
+bool JsonScanner::at_null() {
+    skip_whitespace();
+    return end_ - p_ >= 4 && std::memcmp(p_, "null", 4) == 0;
+}
+
+bool JsonScanner::begin_object() {
+    skip_whitespace();
+    if (p_ == end_ || *p_ != '{') return fail("Expected JSON object");
+    if (first_.size() >= kMaxNestingDepth) return fail("JSON nesting too deep");
+    ++p_;
+    first_.push_back(true);
+    return true;
+}
+
+bool JsonScanner::next_member(std::string& key) {
+    skip_whitespace();
+    if (p_ == end_ || first_.empty()) return fail("Unterminated JSON object");
+    if (*p_ == '}') {
+        ++p_;
+        first_.pop_back();
+        return false;
+    }
+    if (!first_.back()) {
+        if (*p_ != ',') return fail("Expected ',' between object members");
+        ++p_;
+        skip_whitespace();
+    }
+    first_.back() = false;
+
+    if (p_ == end_ || *p_ != '"') return fail("Expected string key in JSON object");
+    if (!read_string(key)) return false;
+    skip_whitespace();
+    if (p_ == end_ || *p_ != ':') return fail("Expected ':' after key '" + key + "'");
+    ++p_;
+    return true;
+}
+
+bool JsonScanner::begin_array() {
+    skip_whitespace();
+    if (p_ == end_ || *p_ != '[') return fail("Expected JSON array");
+    if (first_.size() >= kMaxNestingDepth) return fail("JSON nesting too deep");
+    ++p_;
+    first_.push_back(true);
+    return true;
+}
+
+bool JsonScanner::next_element() {
+    skip_whitespace();
+    if (p_ == end_ || first_.empty()) return fail("Unclosed JSON array");
+    if (*p_ == ']') {
+        ++p_;
+        first_.pop_back();
+        return false;
+    }
+    if (!first_.back()) {
+        if (*p_ != ',') return fail("Expected ',' between array elements");
+        ++p_;
+        skip_whitespace();
+        if (p_ < end_ && *p_ == ']') return fail("Trailing ',' in JSON array");
+    }
+    first_.back() = false;
+    return true;
+}
+
+bool JsonScanner::scan_number_token(const char*& start, const char*& stop, bool& integral) {
+    // JSON grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    const char* p = p_;
+    integral = true;
+    start = p;
+    if (p < end_ && *p == '-') ++p;
+    if (p < end_ && *p == '0') {
+        ++p;
+    } else if (p < end_ && is_digit(*p)) {
+        while (p < end_ && is_digit(*p)) ++p;
+    } else {
+        return false;
+    }
+    if (p < end_ && *p == '.') {
+        integral = false;
+        ++p;
+        if (p == end_ || !is_digit(*p)) return false;
+        while (p < end_ && is_digit(*p)) ++p;
+    }
+    if (p < end_ && (*p == 'e' || *p == 'E')) {
+        integral = false;
+        ++p;
+        if (p < end_ && (*p == '+' || *p == '-')) ++p;
+        if (p == end_ || !is_digit(*p)) return false;
+        while (p < end_ && is_digit(*p)) ++p;
+    }
+    stop = p;
+    return true;
+}
+
+bool JsonScanner::read_number(double& value) {
+    return convert_number(value, false);
+}
+
+bool JsonScanner::convert_number(double& value, bool saturate) {
+    skip_whitespace();
+    const char* start = nullptr;
+    const char* stop = nullptr;
+    bool integral = false;
+    if (!scan_number_token(start, stop, integral)) {
+        const char* token_end = p_;
+        while (token_end < end_ && *token_end != ',' && *token_end != ']' && *token_end != '}' &&
+               *token_end != ' ' && *token_end != '\n') {
+            ++token_end;
+        }
+        return fail("Invalid number: " + std::string(p_, token_end));
+    }
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto result = std::from_chars(start, stop, value);
+    if (result.ec == std::errc::result_out_of_range && saturate) {
+        // The token is valid JSON, just not representable: strtod yields
+        // +/-HUGE_VAL (or an underflowed value) for the caller to judge
+        value = std::strtod(std::string(start, stop).c_str(), nullptr);
+    } else if (result.ec != std::errc() || result.ptr != stop) {
+        return fail("Number out of range: " + std::string(start, stop));
+    }
+#else
+    std::string token(start, stop);
+    char* parsed_end = nullptr;
+    errno = 0;
+    value = std::strtod(token.c_str(), &parsed_end);
+    if (parsed_end != token.c_str() + token.size() || (errno == ERANGE && !saturate)) {
+        return fail("Number out of range: " + token);
+    }
+#endif
+    p_ = stop;
+    return true;
+}
+
+bool JsonScanner::read_integer(int64_t& value) {
+    skip_whitespace();
+    const char* start = nullptr;
+    const char* stop = nullptr;
+    bool integral = false;
+    if (!scan_number_token(start, stop, integral) || !integral) {
+        return fail("Expected integer");
+    }
+    auto result = std::from_chars(start, stop, value);
+    if (result.ec != std::errc() || result.ptr != stop) {
+        return fail("Integer out of range: " + std::string(start, stop));
+    }
+    p_ = stop;
+    return true;
+}
+
+bool JsonScanner::read_string(std::string& value) {
+    skip_whitespace();
+    if (p_ == end_ || *p_ != '"') return fail("Expected JSON string");
+    ++p_;
+    value.clear();
+
+    while (true) {
+        const char* hit = find_quote_or_backslash(p_, end_);
+        value.append(p_, hit);
+        p_ = hit;
+        if (p_ == end_) return fail("Unterminated JSON string");
+        if (*p_ == '"') {
+            ++p_;
+            return true;
+        }
+
+        // Escape sequence
+        if (end_ - p_ < 2) return fail("Unterminated JSON string");
+        char escape = p_[1];
+        p_ += 2;
+        switch (escape) {
+            case '"': value.push_back('"'); break;
+            case '\\': value.push_back('\\'); break;
+            case '/': value.push_back('/'); break;
+            case 'b': value.push_back('\b'); break;
+            case 'f': value.push_back('\f'); break;
+            case 'n': value.push_back('\n'); break;
+            case 'r': value.push_back('\r'); break;
+            case 't': value.push_back('\t'); break;
+            case 'u': {
+                uint32_t code_point = 0;
+                if (end_ - p_ < 4 || !parse_hex4(p_, code_point)) return fail("Invalid \\u escape");
+                p_ += 4;
+                if (code_point >= 0xd800 && code_point <= 0xdbff) {
+                    uint32_t low = 0;
+                    if (end_ - p_ < 6 || p_[0] != '\\' || p_[1] != 'u' || !parse_hex4(p_ + 2, low) ||
+                        low < 0xdc00 || low > 0xdfff) {
+                        return fail("Invalid surrogate pair");
+                    }
+                    p_ += 6;
+                    code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+                }
+                append_utf8(value, code_point);
+                break;
+            }
+            default:
+                return fail("Invalid escape sequence");
+        }
+    }
+}
+
+bool JsonScanner::read_bool(bool& value) {
+    skip_whitespace();
+    if (end_ - p_ >= 4 && std::memcmp(p_, "true", 4) == 0) {
+        value = true;
+        p_ += 4;
+        return true;
+    }
+    if (end_ - p_ >= 5 && std::memcmp(p_, "false", 5) == 0) {
+        value = false;
+        p_ += 5;
+        return true;
+    }
+    return fail("Expected boolean");
+}
+
+bool JsonScanner::skip_string() {
+    ++p_;  // opening quote
+    while (true) {
+        p_ = find_quote_or_backslash(p_, end_);
+        if (p_ == end_) return fail("Unterminated JSON string");
+        if (*p_ == '"') {
+            ++p_;
+            return true;
+        }
+        if (end_ - p_ < 2) return fail("Unterminated JSON string");
+        p_ += 2;  // escaped character
+    }
+}
+
+bool JsonScanner::skip_container() {
+    size_t depth = 0;
+    while (true) {
+        p_ = find_structural(p_, end_);
+        if (p_ == end_) return fail("Unbalanced JSON brackets");
+        char c = *p_;
+        if (c == '"') {
+            if (!skip_string()) return false;
+            continue;
+        }
+        ++p_;
+        if (c == '[' || c == '{') {
+            if (++depth > kMaxNestingDepth) return fail("JSON nesting too deep");
+        } else if (--depth == 0) {
+            return true;
+        }
+    }
+}
+
+bool JsonScanner::skip_value() {
+    skip_whitespace();
+    if (p_ == end_) return fail("Expected JSON value");
+
+    switch (*p_) {
+        case '"':
+            return skip_string();
+        case '[':
+        case '{':
+            return skip_container();
+        case 't':
+        case 'f': {
+            bool ignored = false;
+            return read_bool(ignored);
+        }
+        case 'n':
+            if (end_ - p_ >= 4 && std::memcmp(p_, "null", 4) == 0) {
+                p_ += 4;
+                return true;
+            }
+            return fail("Invalid JSON literal");
+        default: {
+            double ignored = 0.0;
+            return read_number(ignored);
+        }
+    }
+}
+
+bool JsonScanner::read_number_array(std::vector<double>& values) {
+    if (!begin_array()) return false;
+    double value = 0.0;
+    while (next_element()) {
+        if (!read_number(value)) return false;
+        values.push_back(value);
+    }
+    return !failed();
+}
+
+bool JsonScanner::read_number_array(std::vector<double>& values, ReadingValidator& validator) {
+    if (!begin_array()) return false;
+    double value = 0.0;
+    while (next_element()) {
+        if (!convert_number(value, true)) return false;
+        if (validator.admit(value)) {
+            values.push_back(value);
+        } else if (validator.rejected()) {
+            return fail(validator.error());
+        }
+    }
+    return !failed();
+}
+
+bool JsonScanner::read_integer_array(std::vector<int64_t>& values) {
+    if (!begin_array()) return false;
+    int64_t value = 0;
+    while (next_element()) {
+        if (!read_integer(value)) return false;
+        values.push_back(value);
+    }
+    return !failed();
+}
+
+bool JsonScanner::finish() {
+    skip_whitespace();
+    if (p_ != end_) return fail("Unexpected trailing characters after JSON value");
+    return !failed();
+}
+
+} // namespace cpp_service
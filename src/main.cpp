@@ -21,6 +21,22 @@ namespace {
 int main(int argc, char* argv[]) {
     // Parse command line arguments
     int port = 8080;
+    size_t max_decoded_body = 0;
+    cpp_service::HttpServer::BusyPollConfig busy_poll;
+    cpp_service::HttpServer::BulkLaneConfig bulk_lane;
+    cpp_service::HttpServer::TlsConfig tls;
+    cpp_service::HttpServer::CaptureConfig capture;
+    std::string shadow_algorithm;
+    cpp_service::ShadowEvaluator::Config shadow;
+    cpp_service::SensorRegistry::Config sensors;
+    bool series = false;
+    cpp_service::SeriesStore::Config series_config;
+    cpp_service::SeriesCompactor::Config compaction;
+    unsigned query_threads = 0;
+    bool gossip = false;
+    cpp_service::Membership::Config membership;
+    bool shard = false;
+    cpp_service::ShardRouter::Config sharding;
     std::string config_file;
     
     for (int i = 1; i < argc; ++i) {
@@ -29,11 +45,112 @@ int main(int argc, char* argv[]) {
             port = std::stoi(argv[++i]);
         } else if (arg == "--config" && i + 1 < argc) {
             config_file = argv[++i];
+        } else if (arg == "--max-decoded-body" && i + 1 < argc) {
+            max_decoded_body = std::stoull(argv[++i]);
+        } else if (arg == "--busy-poll" && i + 1 < argc) {
+            busy_poll.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--pin-cpu" && i + 1 < argc) {
+            busy_poll.first_cpu = std::stoi(argv[++i]);
+        } else if (arg == "--pipeline" && i + 1 < argc) {
+            busy_poll.pipeline_threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--max-spin-us" && i + 1 < argc) {
+            busy_poll.max_spin_us = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--bulk-threads" && i + 1 < argc) {
+            bulk_lane.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--bulk-bytes" && i + 1 < argc) {
+            bulk_lane.min_body_bytes = std::stoull(argv[++i]);
+        } else if (arg == "--bulk-readings" && i + 1 < argc) {
+            bulk_lane.min_readings = std::stoull(argv[++i]);
+        } else if (arg == "--tls-cert" && i + 1 < argc) {
+            tls.certificate_file = argv[++i];
+        } else if (arg == "--tls-key" && i + 1 < argc) {
+            tls.private_key_file = argv[++i];
+        } else if (arg == "--no-ktls") {
+            tls.ktls = false;
+        } else if (arg == "--capture" && i + 1 < argc) {
+            capture.path = argv[++i];
+        } else if (arg == "--capture-sample" && i + 1 < argc) {
+            capture.sample_rate = std::stod(argv[++i]);
+        } else if (arg == "--shadow" && i + 1 < argc) {
+            shadow_algorithm = argv[++i];
+        } else if (arg == "--shadow-sample" && i + 1 < argc) {
+            shadow.sample_rate = std::stod(argv[++i]);
+        } else if (arg == "--shadow-threads" && i + 1 < argc) {
+            shadow.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--sensor-stale-ms" && i + 1 < argc) {
+            sensors.stale_after_ms = std::stoll(argv[++i]);
+        } else if (arg == "--max-sensors" && i + 1 < argc) {
+            sensors.max_sensors = std::stoull(argv[++i]);
+        } else if (arg == "--series") {
+            series = true;
+        } else if (arg == "--series-segment-points" && i + 1 < argc) {
+            series_config.segment_points = std::stoull(argv[++i]);
+        } else if (arg == "--series-retention-ms" && i + 1 < argc) {
+            // MS for every sensor, or PREFIX=MS for sensors whose ID starts with PREFIX
+            std::string rule = argv[++i];
+            size_t equals = rule.rfind('=');
+            if (equals == std::string::npos) {
+                compaction.retention_ms = std::stoll(rule);
+            } else {
+                compaction.retention_by_prefix.emplace_back(rule.substr(0, equals), std::stoll(rule.substr(equals + 1)));
+            }
+        } else if (arg == "--compaction-threads" && i + 1 < argc) {
+            compaction.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--compaction-rate" && i + 1 < argc) {
+            compaction.bytes_per_second = std::stod(argv[++i]);
+        } else if (arg == "--query-threads" && i + 1 < argc) {
+            query_threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--gossip-port" && i + 1 < argc) {
+            gossip = true;
+            membership.port = static_cast<uint16_t>(std::stoul(argv[++i]));
+        } else if (arg == "--gossip-seed" && i + 1 < argc) {
+            gossip = true;
+            membership.seeds.push_back(argv[++i]);
+        } else if (arg == "--gossip-advertise" && i + 1 < argc) {
+            membership.advertise_host = argv[++i];
+        } else if (arg == "--gossip-period-ms" && i + 1 < argc) {
+            membership.protocol_period = std::chrono::milliseconds(std::stoll(argv[++i]));
+            membership.ack_timeout = membership.protocol_period * 2 / 5;
+        } else if (arg == "--shard") {
+            shard = true;
+        } else if (arg == "--migration-rate" && i + 1 < argc) {
+            sharding.bytes_per_second = std::stod(argv[++i]);
         } else if (arg == "--help") {
             std::cout << "Usage: " << argv[0] << " [options]\n";
             std::cout << "Options:\n";
             std::cout << "  --port PORT      Port to listen on (default: 8080)\n";
             std::cout << "  --config FILE    Configuration file (JSON)\n";
+            std::cout << "  --max-decoded-body BYTES  Limit for decoded bodies and Gorilla batches (default: 64 MiB)\n";
+            std::cout << "  --busy-poll LOOPS  Serve from LOOPS busy-polling event loops (keep-alive, one core each)\n";
+            std::cout << "  --pin-cpu FIRST    Pin busy-poll loop i to CPU FIRST + i\n";
+            std::cout << "  --max-spin-us US   Longest idle spin before a loop parks (default: 5000)\n";
+            std::cout << "  --pipeline N       Fuse on N compute threads fed by the busy-poll loops over SPSC rings\n";
+            std::cout << "  --bulk-threads N   Fuse bulk /fuse requests on a separate pool of N threads\n";
+            std::cout << "  --bulk-bytes B     Bodies of at least B bytes are bulk (default: 1 MiB)\n";
+            std::cout << "  --bulk-readings R  Requests with at least R readings are bulk (default: 131072)\n";
+            std::cout << "  --tls-cert FILE    Serve HTTPS with this PEM certificate chain (needs --tls-key)\n";
+            std::cout << "  --tls-key FILE     PEM private key for --tls-cert\n";
+            std::cout << "  --no-ktls          Keep TLS record encryption in user space\n";
+            std::cout << "  --capture FILE     Record requests and arrival times to FILE for http_replay\n";
+            std::cout << "  --capture-sample P Fraction of requests to capture (default: 1)\n";
+            std::cout << "  --shadow ALGO      Also fuse sampled /fuse requests with ALGO, off the response path\n";
+            std::cout << "  --shadow-sample P  Fraction of /fuse requests shadowed (default: 0.01)\n";
+            std::cout << "  --shadow-threads N Low-priority threads for shadow work (default: 1)\n";
+            std::cout << "  --sensor-stale-ms MS  A sensor silent for MS is stale in /sensors (default: 60000)\n";
+            std::cout << "  --max-sensors N    Sensor IDs tracked at most (default: 1048576)\n";
+            std::cout << "  --series           Keep fused values per sensor for GET /series\n";
+            std::cout << "  --series-segment-points N  Points per sealed series segment (default: 4096)\n";
+            std::cout << "  --series-retention-ms [PREFIX=]MS  Drop series data older than MS, for all sensors\n";
+            std::cout << "                     or those whose ID starts with PREFIX (repeatable; default: keep)\n";
+            std::cout << "  --compaction-threads N  Low-priority threads compacting the series store (default: 1)\n";
+            std::cout << "  --compaction-rate B  Compaction budget in bytes read + written per second (default: 8388608)\n";
+            std::cout << "  --query-threads N  Threads scanning segments for GET /query (default: all cores)\n";
+            std::cout << "  --gossip-port P    Join a cluster over SWIM gossip on UDP port P (0: any)\n";
+            std::cout << "  --gossip-seed H:P  Gossip address of a member to join through (repeatable)\n";
+            std::cout << "  --gossip-advertise H  Address peers reach this node on (default: 127.0.0.1)\n";
+            std::cout << "  --gossip-period-ms MS  Failure-detection protocol period (default: 200)\n";
+            std::cout << "  --shard          Shard sensors across the cluster, forwarding to their owners\n";
+            std::cout << "  --migration-rate B  Bytes/s for moving series between members (default: 4194304, 0: unthrottled)\n";
             std::cout << "  --help           Show this help message\n";
             return 0;
         }
@@ -61,6 +178,51 @@ int main(int argc, char* argv[]) {
         
         // Initialize HTTP server
         server = std::make_unique<cpp_service::HttpServer>(port, service.get());
+        if (max_decoded_body > 0) {
+            server->set_max_decoded_body_bytes(max_decoded_body);
+        }
+        if (busy_poll.pipeline_threads > 0 && busy_poll.threads == 0) {
+            busy_poll.threads = 1;  // the pipeline is fed by the event loops
+        }
+        server->set_busy_poll(busy_poll);
+        server->set_bulk_lane(bulk_lane);
+        server->set_sensor_tracking(sensors);
+        if (gossip) {
+            server->set_membership(membership);
+        }
+        if (shard) {
+            if (!gossip) {
+                std::cerr << "--shard needs --gossip-port or --gossip-seed" << std::endl;
+                return 1;
+            }
+            server->set_sharding(sharding);
+        }
+        if (series) {
+            server->set_series_store(series_config);
+            server->set_series_compaction(compaction);
+            server->set_query_threads(query_threads);
+        }
+        if (tls.certificate_file.empty() != tls.private_key_file.empty()) {
+            std::cerr << "--tls-cert and --tls-key must be given together" << std::endl;
+            return 1;
+        }
+        server->set_tls(tls);
+        if (!(capture.sample_rate >= 0.0 && capture.sample_rate <= 1.0)) {
+            std::cerr << "--capture-sample must be between 0 and 1" << std::endl;
+            return 1;
+        }
+        server->set_capture(capture);
+        if (!shadow_algorithm.empty()) {
+            if (!cpp_service::Service::parse_algorithm(shadow_algorithm, shadow.algorithm)) {
+                std::cerr << "Unknown --shadow algorithm: " << shadow_algorithm << std::endl;
+                return 1;
+            }
+            if (!(shadow.sample_rate >= 0.0 && shadow.sample_rate <= 1.0)) {
+                std::cerr << "--shadow-sample must be between 0 and 1" << std::endl;
+                return 1;
+            }
+            server->set_shadow(shadow);
+        }
         
         std::cout << "Starting C++ service on port " << port << std::endl;
         server->run();
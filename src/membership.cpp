@@ -0,0 +1,543 @@
+#include "membership.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace cpp_service {
+
+namespace {
+
+// Wire layout (integers little-endian, strings as u16 length + bytes):
+//   "SWM1" | u8 type | u32 seq | sender id | u32 incarnation | u16 http_port
+//   [target id, for ping and ping-req] | u8 update_count | updates...
+//   update: u8 state | u32 incarnation | u16 http_port | id
+constexpr char kMagic[4] = {'S', 'W', 'M', '1'};
+constexpr size_t kMaxPacket = 1400;  // stays inside one Ethernet frame
+constexpr size_t kMaxUnresolved = 64;  // host names waiting for resolve_pending()
+constexpr unsigned kMaxSyncsPerPeriod = 4;
+
+void put_u16(std::string& out, uint16_t v) {
+    out.push_back(static_cast<char>(v & 0xff));
+    out.push_back(static_cast<char>(v >> 8));
+}
+
+void put_u32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+void put_string(std::string& out, const std::string& value) {
+    put_u16(out, static_cast<uint16_t>(value.size()));
+    out += value;
+}
+
+size_t update_size(const Membership::Member& member) {
+    return 1 + 4 + 2 + 2 + member.id.size();
+}
+
+void put_update(std::string& out, const Membership::Member& member) {
+    out.push_back(static_cast<char>(member.state));
+    put_u32(out, member.incarnation);
+    put_u16(out, member.http_port);
+    put_string(out, member.id);
+}
+
+// Bounds-checked reads; a short packet clears `ok` and reads as zeros
+struct Reader {
+    const uint8_t* pos;
+    const uint8_t* end;
+    bool ok = true;
+
+    bool take(size_t n) {
+        if (!ok || static_cast<size_t>(end - pos) < n) {
+            ok = false;
+            return false;
+        }
+        return true;
+    }
+    uint8_t u8() {
+        if (!take(1)) return 0;
+        return *pos++;
+    }
+    uint16_t u16() {
+        if (!take(2)) return 0;
+        uint16_t v = static_cast<uint16_t>(pos[0] | (pos[1] << 8));
+        pos += 2;
+        return v;
+    }
+    uint32_t u32() {
+        if (!take(4)) return 0;
+        uint32_t v = static_cast<uint32_t>(pos[0]) | (static_cast<uint32_t>(pos[1]) << 8) |
+                     (static_cast<uint32_t>(pos[2]) << 16) | (static_cast<uint32_t>(pos[3]) << 24);
+        pos += 4;
+        return v;
+    }
+    std::string str() {
+        uint16_t length = u16();
+        if (!take(length)) return std::string();
+        std::string value(reinterpret_cast<const char*>(pos), length);
+        pos += length;
+        return value;
+    }
+};
+
+// "host:port" to an IPv4 address; without `lookup`, only a numeric host
+bool resolve(const std::string& host_port, sockaddr_in& out, bool lookup = true) {
+    size_t colon = host_port.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == host_port.size()) return false;
+    std::string host = host_port.substr(0, colon);
+    std::string port = host_port.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = lookup ? 0 : AI_NUMERICHOST | AI_NUMERICSERV;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 || !result) return false;
+    std::memcpy(&out, result->ai_addr, sizeof(out));
+    freeaddrinfo(result);
+    return true;
+}
+
+bool same_address(const sockaddr_in& a, const sockaddr_in& b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+} // namespace
+
+const char* membership_state_name(Membership::State state) {
+    switch (state) {
+        case Membership::State::alive: return "alive";
+        case Membership::State::suspect: return "suspect";
+        case Membership::State::dead: return "dead";
+    }
+    return "unknown";
+}
+
+Membership::Membership(const Config& config) : config_(config), rng_(std::random_device{}()) {
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ == -1) {
+        throw std::runtime_error("Failed to create gossip socket");
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config_.port);
+    if (inet_pton(AF_INET, config_.bind_host.c_str(), &address.sin_addr) != 1 ||
+        bind(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+        close(fd_);
+        throw std::runtime_error("Failed to bind gossip socket to " + config_.bind_host + ":" +
+                                 std::to_string(config_.port));
+    }
+    socklen_t length = sizeof(address);
+    getsockname(fd_, reinterpret_cast<sockaddr*>(&address), &length);
+    port_ = ntohs(address.sin_port);
+    self_id_ = config_.advertise_host + ":" + std::to_string(port_);
+    incarnation_ = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    for (const auto& seed : config_.seeds) {
+        sockaddr_in seed_address{};
+        if (seed != self_id_ && resolve(seed, seed_address)) seeds_.push_back(seed_address);
+    }
+    next_probe_ = Clock::now();
+    next_knock_ = next_probe_;
+    thread_ = std::thread([this]() { loop(); });
+}
+
+Membership::~Membership() {
+    stopping_ = true;
+    thread_.join();
+    close(fd_);
+}
+
+std::vector<Membership::Member> Membership::members() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Member> members;
+    members.reserve(members_.size() + 1);
+    members.push_back(self());
+    for (const auto& entry : members_) {
+        members.push_back(entry.second.member);
+        char address[INET_ADDRSTRLEN] = {};
+        inet_ntop(AF_INET, &entry.second.address.sin_addr, address, sizeof(address));
+        members.back().address = address;
+    }
+    return members;
+}
+
+Membership::Stats Membership::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+Membership::Member Membership::self() const {
+    Member member;
+    member.id = self_id_;
+    member.http_port = config_.http_port;
+    member.incarnation = incarnation_;
+    return member;
+}
+
+void Membership::loop() {
+    std::vector<uint8_t> buffer(65536);
+    std::vector<Member> changes;
+    while (!stopping_) {
+        // Sleep until the next protocol deadline, or a packet
+        int timeout_ms = 100;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Clock::time_point next = next_probe_;
+            if (probe_active_) {
+                next = std::min(next, probe_start_ + (probe_indirect_ || probe_acked_ ? config_.protocol_period
+                                                                                      : config_.ack_timeout));
+            }
+            for (const auto& entry : members_) {
+                if (entry.second.member.state == State::suspect) next = std::min(next, entry.second.suspect_deadline);
+            }
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - Clock::now()).count() + 1;
+            timeout_ms = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(timeout_ms, wait)));
+        }
+        pollfd poll_fd{fd_, POLLIN, 0};
+        poll(&poll_fd, 1, timeout_ms);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Clock::time_point now = Clock::now();
+            for (;;) {
+                sockaddr_in from{};
+                socklen_t length = sizeof(from);
+                ssize_t received = recvfrom(fd_, buffer.data(), buffer.size(), 0, reinterpret_cast<sockaddr*>(&from),
+                                            &length);
+                if (received < 0) break;
+                stats_.messages_received++;
+                stats_.bytes_received += static_cast<uint64_t>(received);
+                receive(buffer.data(), static_cast<size_t>(received), from, now);
+            }
+            tick(now);
+        }
+        resolve_pending();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            changes.swap(changes_);
+        }
+        if (config_.on_change) {
+            for (const auto& member : changes) config_.on_change(member);
+        }
+        changes.clear();
+    }
+}
+
+void Membership::resolve_pending() {
+    std::vector<Member> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending.swap(unresolved_);
+    }
+    if (pending.empty()) return;
+    std::vector<std::pair<Member, sockaddr_in>> resolved;
+    for (const auto& member : pending) {
+        sockaddr_in address{};
+        if (resolve(member.id, address)) resolved.emplace_back(member, address);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& member : resolved) apply(member.first, Clock::now(), &member.second);
+}
+
+bool Membership::sync_allowed(Entry& entry, Clock::time_point now) {
+    if (now >= sync_period_ + config_.protocol_period) {
+        sync_period_ = now;
+        syncs_sent_ = 0;
+    }
+    if (syncs_sent_ >= kMaxSyncsPerPeriod || now < entry.last_sync + config_.protocol_period) return false;
+    syncs_sent_++;
+    entry.last_sync = now;
+    return true;
+}
+
+void Membership::tick(Clock::time_point now) {
+    // Ask the seeds for their member list until one sends it
+    if (!synced_ && !seeds_.empty() && now >= next_knock_) {
+        for (const auto& seed : seeds_) send(Type::sync_request, next_seq_++, std::string(), seed);
+        next_knock_ = now + config_.protocol_period;
+    }
+
+    if (probe_active_) {
+        if (!probe_acked_ && !probe_indirect_ && now >= probe_start_ + config_.ack_timeout) {
+            std::vector<const Entry*> helpers;
+            for (const auto& entry : members_) {
+                if (entry.first != probe_target_ && entry.second.member.state == State::alive) {
+                    helpers.push_back(&entry.second);
+                }
+            }
+            std::shuffle(helpers.begin(), helpers.end(), rng_);
+            helpers.resize(std::min<size_t>(helpers.size(), config_.indirect_probes));
+            for (const Entry* helper : helpers) send(Type::ping_req, probe_seq_, probe_target_, helper->address);
+            if (!helpers.empty()) stats_.indirect_probes++;
+            probe_indirect_ = true;
+        }
+        if (now >= probe_start_ + config_.protocol_period) {
+            auto it = members_.find(probe_target_);
+            if (!probe_acked_ && it != members_.end() && it->second.member.state == State::alive) {
+                stats_.suspicions++;
+                set_state(it->second, State::suspect, it->second.member.incarnation, now);
+                enqueue(it->second.member);
+            }
+            probe_active_ = false;
+        }
+    }
+    if (!probe_active_ && now >= next_probe_ && !members_.empty()) {
+        start_probe(now);
+    }
+
+    for (auto it = members_.begin(); it != members_.end();) {
+        Entry& entry = it->second;
+        if (entry.member.state == State::suspect && now >= entry.suspect_deadline) {
+            set_state(entry, State::dead, entry.member.incarnation, now);
+            enqueue(entry.member);
+        }
+        if (entry.member.state == State::dead && now - entry.dead_since >= config_.dead_retention) {
+            it = members_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = relays_.begin(); it != relays_.end();) {
+        it = now >= it->second.expires ? relays_.erase(it) : std::next(it);
+    }
+}
+
+void Membership::start_probe(Clock::time_point now) {
+    // Shuffled round-robin: every live member is probed once per round
+    const Entry* target = nullptr;
+    for (size_t attempts = 0; !target && attempts <= members_.size() + 1; ++attempts) {
+        if (probe_index_ >= probe_order_.size()) {
+            probe_order_.clear();
+            for (const auto& entry : members_) {
+                if (entry.second.member.state != State::dead) probe_order_.push_back(entry.first);
+            }
+            std::shuffle(probe_order_.begin(), probe_order_.end(), rng_);
+            probe_index_ = 0;
+            if (probe_order_.empty()) break;
+        }
+        auto it = members_.find(probe_order_[probe_index_++]);
+        if (it != members_.end() && it->second.member.state != State::dead) target = &it->second;
+    }
+    next_probe_ = now + config_.protocol_period;
+    if (!target) return;
+
+    probe_target_ = target->member.id;
+    probe_seq_ = next_seq_++;
+    probe_start_ = now;
+    probe_active_ = true;
+    probe_acked_ = false;
+    probe_indirect_ = false;
+    stats_.probes++;
+    send(Type::ping, probe_seq_, probe_target_, target->address);
+}
+
+void Membership::receive(const uint8_t* data, size_t size, const sockaddr_in& from, Clock::time_point now) {
+    if (size < sizeof(kMagic) || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) return;
+    Reader reader{data + sizeof(kMagic), data + size};
+    Type type = static_cast<Type>(reader.u8());
+    uint32_t seq = reader.u32();
+    Member sender;
+    sender.id = reader.str();
+    sender.incarnation = reader.u32();
+    sender.http_port = reader.u16();
+    std::string target;
+    if (type == Type::ping || type == Type::ping_req) target = reader.str();
+    std::vector<Member> updates(reader.u8());
+    for (auto& update : updates) {
+        update.state = static_cast<State>(reader.u8());
+        update.incarnation = reader.u32();
+        update.http_port = reader.u16();
+        update.id = reader.str();
+        if (update.state > State::dead) reader.ok = false;
+    }
+    if (!reader.ok || sender.id.empty() || sender.id == self_id_) return;
+
+    // Hearing from a node at all means it is alive at the incarnation it
+    // reports, and reachable where the datagram came from
+    apply(sender, now, &from);
+    for (const auto& update : updates) apply(update, now);
+
+    switch (type) {
+        case Type::ping:
+            if (target.empty() || target == self_id_) send(Type::ack, seq, std::string(), from);
+            break;
+        case Type::ack: {
+            if (probe_active_ && seq == probe_seq_) {
+                probe_acked_ = true;
+            }
+            auto relay = relays_.find(seq);
+            if (relay != relays_.end()) {
+                send(Type::ack, relay->second.requester_seq, std::string(), relay->second.requester);
+                relays_.erase(relay);
+            }
+            break;
+        }
+        case Type::ping_req: {
+            auto it = members_.find(target);
+            if (it == members_.end()) break;
+            uint32_t relay_seq = next_seq_++;
+            relays_[relay_seq] = Relay{from, seq, now + config_.protocol_period};
+            send(Type::ping, relay_seq, target, it->second.address);
+            break;
+        }
+        case Type::sync:
+            for (const auto& seed : seeds_) synced_ |= same_address(seed, from);
+            break;
+        case Type::sync_request: {
+            // Only to the member that asked, at the address it is known by
+            auto it = members_.find(sender.id);
+            if (it != members_.end() && same_address(it->second.address, from) && sync_allowed(it->second, now)) {
+                send_sync(from);
+            }
+            break;
+        }
+    }
+}
+
+bool Membership::apply(const Member& update, Clock::time_point now, const sockaddr_in* address) {
+    if (update.id == self_id_) {
+        // Refute: an incarnation above the rumour's beats it everywhere
+        if (update.state != State::alive && update.incarnation >= incarnation_) {
+            incarnation_ = update.incarnation + 1;
+            stats_.refutations++;
+            enqueue(self());
+        }
+        return false;
+    }
+
+    auto it = members_.find(update.id);
+    if (it == members_.end()) {
+        if (update.state == State::dead) return false;  // nothing to bury
+        Entry entry;
+        if (address) {
+            entry.address = *address;
+        } else if (!resolve(update.id, entry.address, false)) {
+            bool queued = std::any_of(unresolved_.begin(), unresolved_.end(),
+                                      [&update](const Member& member) { return member.id == update.id; });
+            if (!queued && unresolved_.size() < kMaxUnresolved) unresolved_.push_back(update);
+            return false;
+        }
+        entry.member = update;
+        entry.member.state = State::dead;  // so set_state reports the join
+        it = members_.emplace(update.id, entry).first;
+        set_state(it->second, update.state, update.incarnation, now);
+        enqueue(it->second.member);
+        return true;
+    }
+
+    const Member& current = it->second.member;
+    bool wins = false;
+    switch (update.state) {
+        case State::alive:
+            wins = update.incarnation > current.incarnation;
+            break;
+        case State::suspect:
+            wins = current.state == State::alive ? update.incarnation >= current.incarnation
+                                                 : update.incarnation > current.incarnation;
+            break;
+        case State::dead:
+            wins = current.state != State::dead && update.incarnation >= current.incarnation;
+            break;
+    }
+    if (!wins) return false;
+    it->second.member.http_port = update.http_port;
+    set_state(it->second, update.state, update.incarnation, now);
+    enqueue(it->second.member);
+    return true;
+}
+
+void Membership::set_state(Entry& entry, State state, uint32_t incarnation, Clock::time_point now) {
+    bool changed = entry.member.state != state;
+    entry.member.state = state;
+    entry.member.incarnation = incarnation;
+    if (state == State::suspect) {
+        entry.suspect_deadline = now + config_.protocol_period * config_.suspicion_periods;
+    } else if (state == State::dead) {
+        entry.dead_since = now;
+    }
+    if (changed) {
+        version_++;
+        changes_.push_back(entry.member);
+    }
+}
+
+void Membership::enqueue(const Member& member) {
+    for (auto& broadcast : broadcasts_) {
+        if (broadcast.member.id == member.id) {
+            broadcast.member = member;
+            broadcast.transmits = 0;
+            return;
+        }
+    }
+    broadcasts_.push_back(Broadcast{member, 0});
+}
+
+void Membership::send(Type type, uint32_t seq, const std::string& target, const sockaddr_in& to,
+                      const std::vector<Member>* full_list) {
+    std::string packet(kMagic, sizeof(kMagic));
+    packet.push_back(static_cast<char>(type));
+    put_u32(packet, seq);
+    put_string(packet, self_id_);
+    put_u32(packet, incarnation_);
+    put_u16(packet, config_.http_port);
+    if (type == Type::ping || type == Type::ping_req) put_string(packet, target);
+
+    size_t count_at = packet.size();
+    packet.push_back(0);
+    uint8_t count = 0;
+    if (full_list) {
+        for (const auto& member : *full_list) {
+            put_update(packet, member);
+            count++;
+        }
+    } else if (!broadcasts_.empty()) {
+        // Freshest news first, as much as fits
+        std::stable_sort(broadcasts_.begin(), broadcasts_.end(),
+                         [](const Broadcast& a, const Broadcast& b) { return a.transmits < b.transmits; });
+        for (auto& broadcast : broadcasts_) {
+            if (count == 255 || packet.size() + update_size(broadcast.member) > kMaxPacket) break;
+            put_update(packet, broadcast.member);
+            broadcast.transmits++;
+            count++;
+        }
+        unsigned limit = config_.retransmit_multiplier *
+            static_cast<unsigned>(std::ceil(std::log2(static_cast<double>(members_.size() + 2))));
+        broadcasts_.erase(std::remove_if(broadcasts_.begin(), broadcasts_.end(),
+                                         [limit](const Broadcast& b) { return b.transmits >= limit; }),
+                          broadcasts_.end());
+    }
+    packet[count_at] = static_cast<char>(count);
+
+    ssize_t sent = sendto(fd_, packet.data(), packet.size(), 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+    if (sent > 0) {
+        stats_.messages_sent++;
+        stats_.bytes_sent += static_cast<uint64_t>(sent);
+    }
+}
+
+void Membership::send_sync(const sockaddr_in& to) {
+    // The whole table, in as many packets as it takes
+    size_t header = sizeof(kMagic) + 1 + 4 + 2 + self_id_.size() + 4 + 2 + 1;
+    std::vector<Member> chunk;
+    size_t size = header;
+    for (const auto& entry : members_) {
+        size_t entry_size = update_size(entry.second.member);
+        if (!chunk.empty() && (size + entry_size > kMaxPacket || chunk.size() == 255)) {
+            send(Type::sync, 0, std::string(), to, &chunk);
+            chunk.clear();
+            size = header;
+        }
+        chunk.push_back(entry.second.member);
+        size += entry_size;
+    }
+    if (!chunk.empty()) send(Type::sync, 0, std::string(), to, &chunk);
+}
+
+} // namespace cpp_service
@@ -0,0 +1,59 @@
+#include "reading_validator.hpp"
+
+namespace cpp_service {
+
+const char* to_string(InvalidReadingPolicy policy) {
+    switch (policy) {
+        case InvalidReadingPolicy::reject: return "reject";
+        case InvalidReadingPolicy::drop: return "drop";
+        case InvalidReadingPolicy::clamp: return "clamp";
+    }
+    return "reject";
+}
+
+const char* to_string(InvalidReadingReason reason) {
+    switch (reason) {
+        case InvalidReadingReason::nan: return "nan";
+        case InvalidReadingReason::infinite: return "infinite";
+        case InvalidReadingReason::out_of_range: return "out_of_range";
+    }
+    return "nan";
+}
+
+bool parse_invalid_reading_policy(const std::string& name, InvalidReadingPolicy& policy) {
+    for (auto candidate : {InvalidReadingPolicy::reject, InvalidReadingPolicy::drop, InvalidReadingPolicy::clamp}) {
+        if (name == to_string(candidate)) {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReadingValidator::admit_invalid(double& value) {
+    size_t index = position_ - 1;
+    InvalidReadingReason reason = std::isnan(value) ? InvalidReadingReason::nan
+                                : std::isinf(value) ? InvalidReadingReason::infinite
+                                                    : InvalidReadingReason::out_of_range;
+    counts_[static_cast<size_t>(reason)]++;
+
+    if (limits_.policy == InvalidReadingPolicy::reject) {
+        if (error_.empty()) {
+            error_ = "Invalid reading at index " + std::to_string(index) + ": " + to_string(reason);
+        }
+        return false;
+    }
+
+    if (limits_.policy == InvalidReadingPolicy::clamp && reason != InvalidReadingReason::nan) {
+        double bound = value < limits_.min_value ? limits_.min_value : limits_.max_value;
+        if (std::isfinite(bound)) {
+            value = bound;
+            return true;
+        }
+    }
+
+    dropped_.push_back(index);
+    return false;
+}
+
+} // namespace cpp_service
@@ -0,0 +1,155 @@
+#include "reproducible_sum.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+namespace cpp_service {
+
+ReproducibleSum::ReproducibleSum() {
+    reset();
+}
+
+void ReproducibleSum::reset() {
+    std::fill(std::begin(limbs_), std::end(limbs_), 0);
+    pending_ = 0;
+    nan_ = false;
+    pos_inf_ = false;
+    neg_inf_ = false;
+}
+
+void ReproducibleSum::add(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    auto exponent_field = static_cast<int>((bits >> 52) & 0x7ff);
+    uint64_t mantissa = bits & ((1ULL << 52) - 1);
+    bool negative = (bits >> 63) != 0;
+
+    if (exponent_field == 0x7ff) {
+        if (mantissa != 0) nan_ = true;
+        else if (negative) neg_inf_ = true;
+        else pos_inf_ = true;
+        return;
+    }
+    if (exponent_field == 0 && mantissa == 0) return;  // +/-0
+
+    // value = mantissa * 2^exponent with an integer mantissa
+    int exponent = kMinExponent;
+    if (exponent_field != 0) {
+        mantissa |= 1ULL << 52;
+        exponent = exponent_field - 1075;
+    }
+
+    auto position = static_cast<unsigned>(exponent - kMinExponent);
+    unsigned index = position / kLimbBits;
+    unsigned shift = position % kLimbBits;
+
+    // Split mantissa << shift (up to 85 bits) into three 32-bit pieces
+    auto w0 = static_cast<int64_t>((mantissa << shift) & 0xffffffffULL);
+    uint64_t rest = mantissa >> (kLimbBits - shift);
+    if (shift == 0) rest = mantissa >> kLimbBits;
+    auto w1 = static_cast<int64_t>(rest & 0xffffffffULL);
+    auto w2 = static_cast<int64_t>(rest >> kLimbBits);
+
+    if (negative) {
+        limbs_[index] -= w0;
+        limbs_[index + 1] -= w1;
+        limbs_[index + 2] -= w2;
+    } else {
+        limbs_[index] += w0;
+        limbs_[index + 1] += w1;
+        limbs_[index + 2] += w2;
+    }
+
+    if (++pending_ >= kNormalizeInterval) {
+        normalize();
+    }
+}
+
+void ReproducibleSum::add(const double* values, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        add(values[i]);
+    }
+}
+
+void ReproducibleSum::merge(const ReproducibleSum& other) {
+    if (pending_ + other.pending_ >= kNormalizeInterval) {
+        normalize();
+        ReproducibleSum normalized = other;
+        normalized.normalize();
+        for (int i = 0; i < kLimbs; ++i) limbs_[i] += normalized.limbs_[i];
+        pending_ = 1;
+    } else {
+        for (int i = 0; i < kLimbs; ++i) limbs_[i] += other.limbs_[i];
+        pending_ += other.pending_;
+    }
+    nan_ = nan_ || other.nan_;
+    pos_inf_ = pos_inf_ || other.pos_inf_;
+    neg_inf_ = neg_inf_ || other.neg_inf_;
+}
+
+void ReproducibleSum::normalize() {
+    // Propagate carries so limbs 0..n-2 hold [0, 2^32); the top limb keeps the sign
+    for (int i = 0; i < kLimbs - 1; ++i) {
+        int64_t carry = limbs_[i] >> kLimbBits;  // floor division (arithmetic shift)
+        limbs_[i] &= 0xffffffffLL;
+        limbs_[i + 1] += carry;
+    }
+    pending_ = 0;
+}
+
+double ReproducibleSum::value() const {
+    if (nan_ || (pos_inf_ && neg_inf_)) return std::numeric_limits<double>::quiet_NaN();
+    if (pos_inf_) return std::numeric_limits<double>::infinity();
+    if (neg_inf_) return -std::numeric_limits<double>::infinity();
+
+    ReproducibleSum acc = *this;
+    acc.normalize();
+
+    bool negative = acc.limbs_[kLimbs - 1] < 0;
+    if (negative) {
+        for (auto& limb : acc.limbs_) limb = -limb;
+        acc.normalize();
+    }
+
+    int top = kLimbs - 1;
+    while (top >= 0 && acc.limbs_[top] == 0) --top;
+    if (top < 0) return 0.0;
+
+    // Highest set bit of the magnitude
+    auto top_limb = static_cast<uint64_t>(acc.limbs_[top]);
+    int top_bit = 63;
+    while (((top_limb >> top_bit) & 1) == 0) --top_bit;
+    int highest = top * kLimbBits + top_bit;
+
+    auto bit_at = [&acc](int position) -> uint64_t {
+        return (static_cast<uint64_t>(acc.limbs_[position / kLimbBits]) >> (position % kLimbBits)) & 1;
+    };
+
+    // Keep the bits a double holds at this magnitude: 53, or fewer once the
+    // result is subnormal (bit 0 is 2^-1074). Rounding them half to even on
+    // the guard and sticky bits is the only rounding; the scaling is exact
+    // (or overflows to infinity, which is the correctly rounded result)
+    int lowest = std::max(0, highest - 52);
+    uint64_t mantissa = 0;
+    for (int position = highest; position >= lowest; --position) {
+        mantissa = (mantissa << 1) | bit_at(position);
+    }
+    bool guard = lowest > 0 && bit_at(lowest - 1) != 0;
+    bool sticky = false;
+    for (int position = lowest - 2; position >= 0 && !sticky; --position) {
+        if (position % kLimbBits == kLimbBits - 1 && acc.limbs_[position / kLimbBits] == 0) {
+            position -= kLimbBits - 1;  // skip an all-zero limb
+            continue;
+        }
+        sticky = bit_at(position) != 0;
+    }
+    if (guard && (sticky || (mantissa & 1) != 0)) ++mantissa;
+
+    double result = std::ldexp(static_cast<double>(mantissa), lowest + kMinExponent);
+    return negative ? -result : result;
+}
+
+} // namespace cpp_service
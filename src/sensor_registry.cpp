@@ -0,0 +1,180 @@
+#include "sensor_registry.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace cpp_service {
+
+SensorRegistry::SensorRegistry(const Config& config) : config_(config) {
+    config_.tick_ms = std::max<int64_t>(1, config_.tick_ms);
+    config_.stale_after_ms = std::max<int64_t>(0, config_.stale_after_ms);
+    for (size_t i = 0; i < kShards; ++i) {
+        auto shard = std::make_unique<Shard>();
+        for (auto& level : shard->wheel) level.fill(kNone);
+        shards_.push_back(std::move(shard));
+    }
+}
+
+SensorRegistry::~SensorRegistry() = default;
+
+SensorRegistry::Shard& SensorRegistry::shard_for(const std::string& id) {
+    return *shards_[std::hash<std::string>()(id) % kShards];
+}
+
+bool SensorRegistry::touch(const std::string& id, int64_t now_ms) {
+    Shard& shard = shard_for(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    advance(shard, now_ms);
+
+    auto it = shard.index.find(id);
+    if (it == shard.index.end()) {
+        if (tracked_.fetch_add(1, std::memory_order_relaxed) >= config_.max_sensors) {
+            tracked_.fetch_sub(1, std::memory_order_relaxed);
+            untracked_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        uint32_t index = static_cast<uint32_t>(shard.entries.size());
+        shard.entries.emplace_back();
+        Entry& entry = shard.entries.back();
+        entry.sensor.id = id;
+        entry.sensor.last_seen_ms = now_ms;
+        entry.sensor.updates = 1;
+        shard.index.emplace(id, index);
+        arm(shard, index, now_ms + config_.stale_after_ms);
+        return true;
+    }
+
+    // The armed timer stays where it is; it re-checks last_seen when it fires
+    Entry& entry = shard.entries[it->second];
+    entry.sensor.last_seen_ms = std::max(entry.sensor.last_seen_ms, now_ms);
+    entry.sensor.updates++;
+    if (entry.sensor.stale) {
+        entry.sensor.stale = false;
+        shard.stale--;
+        arm(shard, it->second, entry.sensor.last_seen_ms + config_.stale_after_ms);
+    }
+    return true;
+}
+
+SensorRegistry::Counts SensorRegistry::counts(int64_t now_ms) {
+    Counts counts;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        advance(*shard, now_ms);
+        counts.tracked += shard->entries.size();
+        counts.stale += shard->stale;
+        counts.expirations += shard->expirations;
+    }
+    counts.untracked = untracked_.load(std::memory_order_relaxed);
+    return counts;
+}
+
+std::vector<SensorRegistry::Sensor> SensorRegistry::list(int64_t now_ms, bool stale_only, size_t limit) {
+    // Max-heap on last_seen holding the `limit` least recently seen so far,
+    // so only candidates are copied
+    auto newer = [](const Sensor& a, const Sensor& b) { return a.last_seen_ms < b.last_seen_ms; };
+    std::vector<Sensor> oldest;
+    if (limit == 0) return oldest;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        advance(*shard, now_ms);
+        for (const Entry& entry : shard->entries) {
+            if (stale_only && !entry.sensor.stale) continue;
+            if (oldest.size() < limit) {
+                oldest.push_back(entry.sensor);
+                std::push_heap(oldest.begin(), oldest.end(), newer);
+            } else if (entry.sensor.last_seen_ms < oldest.front().last_seen_ms) {
+                std::pop_heap(oldest.begin(), oldest.end(), newer);
+                oldest.back() = entry.sensor;
+                std::push_heap(oldest.begin(), oldest.end(), newer);
+            }
+        }
+    }
+    std::sort_heap(oldest.begin(), oldest.end(), newer);
+    return oldest;
+}
+
+void SensorRegistry::arm(Shard& shard, uint32_t index, int64_t deadline_ms) {
+    // First tick at or after the deadline, and never the current one
+    int64_t ticks = deadline_ms / config_.tick_ms + (deadline_ms % config_.tick_ms > 0 ? 1 : 0);
+    uint64_t expires = ticks > 0 ? static_cast<uint64_t>(ticks) : 0;
+    Entry& entry = shard.entries[index];
+    entry.expires = std::max(expires, shard.current_tick + 1);
+    entry.armed = true;
+    shard.armed++;
+    file(shard, index);
+}
+
+void SensorRegistry::file(Shard& shard, uint32_t index) {
+    Entry& entry = shard.entries[index];
+    uint64_t delta = entry.expires - shard.current_tick;
+    unsigned level = 0;
+    while (level + 1 < kLevels && delta >= (uint64_t(1) << (kBits * (level + 1)))) {
+        ++level;
+    }
+    if (delta >= (uint64_t(1) << (kBits * kLevels))) {
+        // Beyond the wheel: park in the top level and re-check when it fires
+        entry.expires = shard.current_tick + (uint64_t(1) << (kBits * kLevels)) - 1;
+    }
+    uint32_t slot = static_cast<uint32_t>(entry.expires >> (kBits * level)) & (kSlots - 1);
+    entry.next = shard.wheel[level][slot];
+    shard.wheel[level][slot] = index;
+}
+
+void SensorRegistry::advance(Shard& shard, int64_t now_ms) {
+    uint64_t target = now_ms > 0 ? static_cast<uint64_t>(now_ms / config_.tick_ms) : 0;
+    if (!shard.started) {
+        shard.started = true;
+        shard.current_tick = target;
+        return;
+    }
+    while (shard.current_tick < target) {
+        if (shard.armed == 0) {
+            // An empty wheel has nothing to cascade: jump
+            shard.current_tick = target;
+            break;
+        }
+        tick(shard);
+    }
+}
+
+void SensorRegistry::tick(Shard& shard) {
+    uint64_t now = ++shard.current_tick;
+    // Each time a level's index wraps, the next level's slot for this moment
+    // is re-filed into the levels below
+    for (unsigned level = 1; level < kLevels; ++level) {
+        if ((now & ((uint64_t(1) << (kBits * level)) - 1)) != 0) break;
+        uint32_t slot = static_cast<uint32_t>(now >> (kBits * level)) & (kSlots - 1);
+        uint32_t index = shard.wheel[level][slot];
+        shard.wheel[level][slot] = kNone;
+        while (index != kNone) {
+            uint32_t next = shard.entries[index].next;
+            file(shard, index);
+            index = next;
+        }
+    }
+    uint32_t slot = static_cast<uint32_t>(now) & (kSlots - 1);
+    uint32_t head = shard.wheel[0][slot];
+    shard.wheel[0][slot] = kNone;
+    fire(shard, head);
+}
+
+void SensorRegistry::fire(Shard& shard, uint32_t head) {
+    int64_t now_ms = static_cast<int64_t>(shard.current_tick) * config_.tick_ms;
+    while (head != kNone) {
+        Entry& entry = shard.entries[head];
+        uint32_t next = entry.next;
+        entry.armed = false;
+        shard.armed--;
+        int64_t deadline_ms = entry.sensor.last_seen_ms + config_.stale_after_ms;
+        if (deadline_ms > now_ms) {
+            arm(shard, head, deadline_ms);  // touched since the timer was set
+        } else {
+            entry.sensor.stale = true;
+            shard.stale++;
+            shard.expirations++;
+        }
+        head = next;
+    }
+}
+
+} // namespace cpp_service
@@ -0,0 +1,165 @@
+#include "series_compactor.hpp"
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cpp_service {
+
+SeriesCompactor::SeriesCompactor(SeriesStore& store, const Config& config)
+    : store_(store), config_(config), bucket_(config.bytes_per_second, config.burst_bytes),
+      backlog_(std::max(1u, config.threads)) {
+    config_.merge_points = std::max<size_t>(1, config_.merge_points);
+    for (auto& backlog : backlog_) backlog = 0;
+    for (unsigned i = 0; i < config_.threads; ++i) {
+        mergers_.push_back(std::make_unique<Merger>());
+        Merger& merger = *mergers_.back();
+        merger.thread = std::thread([this, &merger]() { merger_loop(merger); });
+    }
+    for (unsigned i = 0; i < config_.threads; ++i) {
+        workers_.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+SeriesCompactor::~SeriesCompactor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    for (auto& merger : mergers_) {
+        {
+            std::lock_guard<std::mutex> lock(merger->mutex);
+            merger->stopping = true;
+        }
+        merger->cv.notify_all();
+    }
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    for (auto& merger : mergers_) {
+        merger->thread.join();
+    }
+}
+
+void SeriesCompactor::compact_now() {
+    pass(0, 1, nullptr);
+}
+
+int64_t SeriesCompactor::retention_for(const std::string& sensor) const {
+    int64_t retention = config_.retention_ms;
+    size_t matched = 0;
+    for (const auto& rule : config_.retention_by_prefix) {
+        if (rule.first.size() >= matched && sensor.compare(0, rule.first.size(), rule.first) == 0) {
+            matched = rule.first.size();
+            retention = rule.second;
+        }
+    }
+    return retention;
+}
+
+SeriesCompactor::Stats SeriesCompactor::stats() const {
+    Stats stats;
+    stats.passes = passes_.load();
+    stats.merged_segments = merged_segments_.load();
+    stats.written_segments = written_segments_.load();
+    stats.bytes_read = bytes_read_.load();
+    stats.bytes_written = bytes_written_.load();
+    stats.expired_points = expired_points_.load();
+    stats.throttled_ms = throttled_ms_.load();
+    for (const auto& backlog : backlog_) stats.backlog_segments += backlog.load();
+    return stats;
+}
+
+void SeriesCompactor::worker_loop(unsigned index) {
+    for (;;) {
+        if (!pass(index, config_.threads, mergers_[index].get())) return;
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stop_cv_.wait_for(lock, config_.interval, [this] { return stopping_; })) return;
+    }
+}
+
+void SeriesCompactor::merger_loop(Merger& merger) {
+#ifdef __linux__
+    // Merging is the bulk of the CPU; it gets only what serving leaves idle
+    sched_param param{};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+    std::unique_lock<std::mutex> lock(merger.mutex);
+    for (;;) {
+        merger.cv.wait(lock, [&merger] { return merger.stopping || (merger.busy && !merger.merged); });
+        if (merger.stopping) return;
+        std::vector<SeriesStore::SegmentPtr> run = std::move(merger.run);
+        lock.unlock();
+        SeriesStore::SegmentPtr merged = SeriesStore::merge(run);
+        lock.lock();
+        merger.merged = std::move(merged);
+        merger.busy = false;
+        merger.cv.notify_all();
+    }
+}
+
+SeriesStore::SegmentPtr SeriesCompactor::merge_on(Merger& merger, const std::vector<SeriesStore::SegmentPtr>& run) {
+    std::unique_lock<std::mutex> lock(merger.mutex);
+    merger.run = run;
+    merger.merged = nullptr;
+    merger.busy = true;
+    merger.cv.notify_all();
+    merger.cv.wait(lock, [&merger] { return merger.stopping || !merger.busy; });
+    if (merger.busy) return nullptr;
+    return std::move(merger.merged);
+}
+
+bool SeriesCompactor::pass(unsigned index, unsigned stride, Merger* merger) {
+    std::vector<std::string> sensors = store_.sensors();
+    std::hash<std::string> hash;
+    sensors.erase(std::remove_if(sensors.begin(), sensors.end(),
+                                 [&](const std::string& sensor) { return hash(sensor) % stride != index; }),
+                  sensors.end());
+
+    // Retention first, so expiring data is never compacted
+    int64_t now = now_ms();
+    size_t backlog = 0;
+    for (const auto& sensor : sensors) {
+        if (int64_t retention = retention_for(sensor)) {
+            expired_points_.fetch_add(store_.expire(sensor, now - retention), std::memory_order_relaxed);
+        }
+        backlog += store_.compaction_backlog(sensor, config_.hot_segments);
+    }
+    backlog_[index] = backlog;
+
+    std::vector<SeriesStore::SegmentPtr> run;
+    for (const auto& sensor : sensors) {
+        while (store_.compaction_run(sensor, config_.hot_segments, config_.merge_points, run)) {
+            size_t read = 0;
+            size_t plain = 0;
+            for (const auto& segment : run) {
+                read += segment->bytes();
+                plain += segment->compacted() ? 0u : 1u;
+            }
+            if (!bucket_.pay(read, mutex_, stop_cv_, stopping_, throttled_ms_)) return false;
+            SeriesStore::SegmentPtr merged = merger ? merge_on(*merger, run) : SeriesStore::merge(run);
+            if (!merged) return false;
+            size_t written = merged->bytes();
+            if (!bucket_.pay(written, mutex_, stop_cv_, stopping_, throttled_ms_)) return false;
+            if (!store_.replace_run(sensor, run, std::move(merged))) break;  // retention got there first
+
+            merged_segments_.fetch_add(run.size(), std::memory_order_relaxed);
+            written_segments_.fetch_add(1, std::memory_order_relaxed);
+            bytes_read_.fetch_add(read, std::memory_order_relaxed);
+            bytes_written_.fetch_add(written, std::memory_order_relaxed);
+            backlog_[index] -= std::min(plain, backlog_[index].load());
+        }
+    }
+    passes_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+int64_t SeriesCompactor::now_ms() const {
+    if (config_.clock) return config_.clock();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace cpp_service
@@ -0,0 +1,209 @@
+#include "series_query.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace cpp_service {
+
+namespace {
+
+// Mergeable state for one (group, bucket)
+struct Partial {
+    uint64_t count = 0;
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    int64_t first = INT64_MAX;   // earliest timestamp
+    std::vector<double> values;  // quantiles only
+
+    void merge(Partial& other) {
+        count += other.count;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        first = std::min(first, other.first);
+        if (values.empty()) {
+            values = std::move(other.values);
+        } else {
+            values.insert(values.end(), other.values.begin(), other.values.end());
+        }
+    }
+};
+
+using Key = std::pair<size_t, int64_t>;  // group, bucket start (0 without buckets)
+using Partials = std::map<Key, Partial>;
+
+// A segment of one group that overlaps [from, to]
+struct Unit {
+    size_t group;
+    const SeriesStore::SegmentPtr* segment;
+};
+
+int64_t bucket_start(int64_t timestamp, int64_t step) {
+    int64_t quotient = timestamp / step;
+    if (timestamp % step < 0) --quotient;
+    return quotient * step;
+}
+
+// Folds the part of `segment` inside the query range into `partials`, one
+// map update per bucket: values of a bucket are contiguous, so each run is
+// reduced with plain loops over the column
+uint64_t scan(const SeriesStore::Segment& segment, size_t group, const SeriesQuery& query, Partials& partials) {
+    const auto& timestamps = segment.timestamps;
+    const double* values = segment.values.data();
+    size_t begin = static_cast<size_t>(std::lower_bound(timestamps.begin(), timestamps.end(), query.from) -
+                                       timestamps.begin());
+    size_t end = static_cast<size_t>(std::upper_bound(timestamps.begin(), timestamps.end(), query.to) -
+                                     timestamps.begin());
+    bool keep_values = query.aggregate == SeriesAggregate::quantile;
+
+    for (size_t i = begin; i < end;) {
+        int64_t start = 0;
+        size_t run_end = end;
+        if (query.step > 0) {
+            start = bucket_start(timestamps[i], query.step);
+            if (start <= INT64_MAX - query.step) {
+                run_end = static_cast<size_t>(std::lower_bound(timestamps.begin() + static_cast<std::ptrdiff_t>(i),
+                                                               timestamps.begin() + static_cast<std::ptrdiff_t>(end),
+                                                               start + query.step) - timestamps.begin());
+            }
+        }
+
+        double sum = 0.0;
+        double low = values[i];
+        double high = values[i];
+        for (size_t k = i; k < run_end; ++k) sum += values[k];
+        for (size_t k = i; k < run_end; ++k) low = values[k] < low ? values[k] : low;
+        for (size_t k = i; k < run_end; ++k) high = values[k] > high ? values[k] : high;
+
+        Partial& partial = partials[Key(group, start)];
+        partial.count += run_end - i;
+        partial.sum += sum;
+        partial.min = std::min(partial.min, low);
+        partial.max = std::max(partial.max, high);
+        partial.first = std::min(partial.first, timestamps[i]);
+        if (keep_values) partial.values.insert(partial.values.end(), values + i, values + run_end);
+        i = run_end;
+    }
+    return end - begin;
+}
+
+// Linear interpolation between the order statistics around q (n - 1)
+double quantile_of(std::vector<double>& values, double q) {
+    double position = q * static_cast<double>(values.size() - 1);
+    size_t low = static_cast<size_t>(std::floor(position));
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(low), values.end());
+    double value = values[low];
+    double fraction = position - static_cast<double>(low);
+    if (fraction > 0.0 && low + 1 < values.size()) {
+        double next = *std::min_element(values.begin() + static_cast<std::ptrdiff_t>(low + 1), values.end());
+        value += fraction * (next - value);
+    }
+    return value;
+}
+
+double finish(Partial& partial, const SeriesQuery& query) {
+    switch (query.aggregate) {
+        case SeriesAggregate::count: return static_cast<double>(partial.count);
+        case SeriesAggregate::sum: return partial.sum;
+        case SeriesAggregate::avg: return partial.sum / static_cast<double>(partial.count);
+        case SeriesAggregate::min: return partial.min;
+        case SeriesAggregate::max: return partial.max;
+        case SeriesAggregate::quantile: return quantile_of(partial.values, query.quantile);
+    }
+    return 0.0;
+}
+
+} // namespace
+
+const char* series_aggregate_name(SeriesAggregate aggregate) {
+    switch (aggregate) {
+        case SeriesAggregate::count: return "count";
+        case SeriesAggregate::sum: return "sum";
+        case SeriesAggregate::avg: return "avg";
+        case SeriesAggregate::min: return "min";
+        case SeriesAggregate::max: return "max";
+        case SeriesAggregate::quantile: return "quantile";
+    }
+    return "unknown";
+}
+
+bool parse_series_aggregate(const std::string& name, SeriesAggregate& aggregate) {
+    for (SeriesAggregate candidate : {SeriesAggregate::count, SeriesAggregate::sum, SeriesAggregate::avg,
+                                      SeriesAggregate::min, SeriesAggregate::max, SeriesAggregate::quantile}) {
+        if (name == series_aggregate_name(candidate)) {
+            aggregate = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+SeriesQueryResult run_series_query(const SeriesStore& store, const SeriesQuery& query, ThreadPool* pool) {
+    SeriesQueryResult result;
+
+    std::vector<std::string> sensors = store.sensors();
+    sensors.erase(std::remove_if(sensors.begin(), sensors.end(),
+                                 [&query](const std::string& sensor) {
+                                     return sensor.compare(0, query.prefix.size(), query.prefix) != 0;
+                                 }),
+                  sensors.end());
+
+    // Snapshots hold the segments alive for the scan; pushdown happens here
+    std::vector<SeriesStore::Snapshot> snapshots(sensors.size());
+    std::vector<Unit> units;
+    for (size_t i = 0; i < sensors.size(); ++i) {
+        store.snapshot(sensors[i], snapshots[i]);
+        for (const auto& segment : snapshots[i].segments) {
+            if (segment->size() == 0 || segment->last() < query.from || segment->first() > query.to) {
+                result.segments_skipped++;
+                continue;
+            }
+            units.push_back({query.by_sensor ? i : 0, &segment});
+        }
+    }
+    result.segments_scanned = units.size();
+
+    Partials merged;
+    std::mutex merge_mutex;
+    std::atomic<uint64_t> points{0};
+    auto scan_units = [&](size_t begin, size_t end) {
+        Partials partials;
+        uint64_t scanned = 0;
+        for (size_t u = begin; u < end; ++u) {
+            SeriesStore::SegmentPtr segment = SeriesStore::columns(*units[u].segment);
+            scanned += scan(*segment, units[u].group, query, partials);
+        }
+        points.fetch_add(scanned, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        for (auto& entry : partials) merged[entry.first].merge(entry.second);
+    };
+    if (pool) {
+        pool->parallel_for(units.size(), scan_units);
+    } else {
+        scan_units(0, units.size());
+    }
+    result.points_scanned = points.load();
+
+    // The map is ordered by group, then bucket
+    for (auto& entry : merged) {
+        size_t group = entry.first.first;
+        std::string sensor = query.by_sensor ? sensors[group] : std::string();
+        if (result.groups.empty() || result.groups.back().sensor != sensor) {
+            result.groups.push_back({sensor, {}});
+        }
+        SeriesQueryResult::Bucket bucket;
+        bucket.start = query.step > 0 ? entry.first.second : entry.second.first;
+        bucket.count = entry.second.count;
+        bucket.value = finish(entry.second, query);
+        result.groups.back().buckets.push_back(bucket);
+    }
+    return result;
+}
+
+} // namespace cpp_service
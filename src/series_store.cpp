@@ -0,0 +1,280 @@
+#include "series_store.hpp"
+#include "gorilla_codec.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace cpp_service {
+
+size_t SeriesStore::Snapshot::points() const {
+    size_t total = 0;
+    for (const auto& segment : segments) total += segment->size();
+    return total;
+}
+
+SeriesStore::SegmentPtr SeriesStore::columns(const SegmentPtr& segment) {
+    if (!segment->compacted()) return segment;
+    auto decoded = std::make_shared<Segment>();
+    decoded->timestamps.reserve(segment->encoded_count);
+    decoded->values.reserve(segment->encoded_count);
+    std::string error = decode_gorilla_batch(segment->encoded, decoded->values, decoded->timestamps);
+    if (!error.empty()) throw std::runtime_error("corrupt series segment: " + error);
+    return decoded;
+}
+
+SeriesStore::SegmentPtr SeriesStore::merge(const std::vector<SegmentPtr>& run) {
+    std::vector<int64_t> timestamps;
+    std::vector<double> values;
+    size_t total = 0;
+    for (const auto& segment : run) total += segment->size();
+    timestamps.reserve(total);
+    values.reserve(total);
+    for (const auto& segment : run) {
+        SegmentPtr plain = columns(segment);
+        timestamps.insert(timestamps.end(), plain->timestamps.begin(), plain->timestamps.end());
+        values.insert(values.end(), plain->values.begin(), plain->values.end());
+    }
+
+    auto merged = std::make_shared<Segment>();
+    GorillaEncoder encoder;
+    encoder.add_series("", timestamps, values);
+    merged->encoded = encoder.finish();
+    merged->encoded_count = total;
+    merged->encoded_first = timestamps.front();
+    merged->encoded_last = timestamps.back();
+    return merged;
+}
+
+SeriesStore::SeriesStore(const Config& config) : config_(config) {
+    config_.segment_points = std::max<size_t>(1, config_.segment_points);
+}
+
+SeriesStore::Series* SeriesStore::find(const std::string& sensor) const {
+    std::shared_lock<std::shared_mutex> lock(map_mutex_);
+    auto it = series_.find(sensor);
+    return it == series_.end() ? nullptr : it->second.get();
+}
+
+SeriesStore::Series& SeriesStore::find_or_create(const std::string& sensor) {
+    if (Series* series = find(sensor)) return *series;
+    std::unique_lock<std::shared_mutex> lock(map_mutex_);
+    auto& slot = series_[sensor];
+    if (!slot) slot = std::make_unique<Series>();
+    return *slot;
+}
+
+bool SeriesStore::append(const std::string& sensor, int64_t timestamp, double value) {
+    Series* series = &find_or_create(sensor);
+    std::lock_guard<std::mutex> lock(series->mutex);
+    if (!series->sealed.empty() && timestamp < series->sealed.back()->last()) {
+        late_points_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Segment& head = series->head;
+    if (head.timestamps.empty() || timestamp >= head.timestamps.back()) {
+        head.timestamps.push_back(timestamp);
+        head.values.push_back(value);
+    } else {
+        // Rare: keep the head sorted, after any equal timestamps
+        auto at = std::upper_bound(head.timestamps.begin(), head.timestamps.end(), timestamp);
+        size_t offset = static_cast<size_t>(at - head.timestamps.begin());
+        head.timestamps.insert(at, timestamp);
+        head.values.insert(head.values.begin() + static_cast<std::ptrdiff_t>(offset), value);
+    }
+    if (head.size() >= config_.segment_points) {
+        series->sealed.push_back(std::make_shared<const Segment>(std::move(head)));
+        head = Segment();
+        head.timestamps.reserve(config_.segment_points);
+        head.values.reserve(config_.segment_points);
+    }
+    return true;
+}
+
+bool SeriesStore::snapshot(const std::string& sensor, Snapshot& out) const {
+    out.segments.clear();
+    Series* series = find(sensor);
+    if (!series) return false;
+    std::lock_guard<std::mutex> lock(series->mutex);
+    out.segments = series->sealed;
+    if (series->head.size() > 0) {
+        out.segments.push_back(std::make_shared<const Segment>(series->head));
+    }
+    return !out.segments.empty();
+}
+
+size_t SeriesStore::points(const std::string& sensor) const {
+    Series* series = find(sensor);
+    if (!series) return 0;
+    std::lock_guard<std::mutex> lock(series->mutex);
+    size_t total = series->head.size();
+    for (const auto& segment : series->sealed) total += segment->size();
+    return total;
+}
+
+std::vector<std::string> SeriesStore::sensors() const {
+    std::shared_lock<std::shared_mutex> lock(map_mutex_);
+    std::vector<std::string> names;
+    names.reserve(series_.size());
+    for (const auto& entry : series_) names.push_back(entry.first);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+SeriesStore::Stats SeriesStore::stats() const {
+    Stats stats;
+    {
+        std::shared_lock<std::shared_mutex> lock(map_mutex_);
+        stats.sensors = series_.size();
+        for (const auto& entry : series_) {
+            std::lock_guard<std::mutex> series_lock(entry.second->mutex);
+            stats.segments += entry.second->sealed.size();
+            stats.points += entry.second->head.size();
+            stats.bytes += entry.second->head.bytes();
+            for (const auto& segment : entry.second->sealed) {
+                stats.points += segment->size();
+                stats.bytes += segment->bytes();
+                stats.compacted_segments += segment->compacted() ? 1u : 0u;
+            }
+        }
+    }
+    stats.late_points = late_points_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool SeriesStore::take(const std::string& sensor, Snapshot& out) {
+    out.segments.clear();
+    Series* series = find(sensor);
+    if (!series) return false;
+    // The map entry stays: other threads may hold the Series pointer
+    std::lock_guard<std::mutex> lock(series->mutex);
+    out.segments = std::move(series->sealed);
+    series->sealed.clear();
+    if (series->head.size() > 0) {
+        out.segments.push_back(std::make_shared<const Segment>(std::move(series->head)));
+    }
+    series->head = Segment();
+    return !out.segments.empty();
+}
+
+size_t SeriesStore::import(const std::string& sensor, const std::vector<int64_t>& timestamps,
+                           const std::vector<double>& values) {
+    if (timestamps.empty() || timestamps.size() != values.size()) return 0;
+    Series& series = find_or_create(sensor);
+    std::lock_guard<std::mutex> lock(series.mutex);
+    bool empty = series.sealed.empty() && series.head.size() == 0;
+    int64_t first = series.sealed.empty() ? (empty ? 0 : series.head.first()) : series.sealed.front()->first();
+    if (empty || timestamps.back() <= first) {
+        auto segment = std::make_shared<Segment>();
+        segment->timestamps = timestamps;
+        segment->values = values;
+        series.sealed.insert(series.sealed.begin(), std::move(segment));
+        return timestamps.size();
+    }
+
+    // Interleaved with what is stored: merge everything, then cut it into
+    // full sealed segments and a head
+    std::vector<int64_t> merged_timestamps(timestamps);
+    std::vector<double> merged_values(values);
+    auto absorb = [&](const Segment& segment) {
+        merged_timestamps.insert(merged_timestamps.end(), segment.timestamps.begin(), segment.timestamps.end());
+        merged_values.insert(merged_values.end(), segment.values.begin(), segment.values.end());
+    };
+    for (const auto& segment : series.sealed) absorb(*columns(segment));
+    absorb(series.head);
+    std::vector<size_t> order(merged_timestamps.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (merged_timestamps[a] != merged_timestamps[b]) return merged_timestamps[a] < merged_timestamps[b];
+        return merged_values[a] < merged_values[b];
+    });
+
+    series.sealed.clear();
+    series.head = Segment();
+    size_t previous = order.size();
+    size_t kept = 0;
+    for (size_t i : order) {
+        // Exact repeats are what a retried handoff sends; keep them once
+        if (previous != order.size() && merged_timestamps[previous] == merged_timestamps[i] &&
+            merged_values[previous] == merged_values[i]) {
+            continue;
+        }
+        previous = i;
+        ++kept;
+        series.head.timestamps.push_back(merged_timestamps[i]);
+        series.head.values.push_back(merged_values[i]);
+        if (series.head.size() >= config_.segment_points) {
+            series.sealed.push_back(std::make_shared<const Segment>(std::move(series.head)));
+            series.head = Segment();
+        }
+    }
+    size_t stored = merged_timestamps.size() - timestamps.size();
+    return kept > stored ? kept - stored : 0;
+}
+
+size_t SeriesStore::expire(const std::string& sensor, int64_t cutoff) {
+    Series* series = find(sensor);
+    if (!series) return 0;
+    std::lock_guard<std::mutex> lock(series->mutex);
+    size_t dropped = 0;
+    size_t keep = 0;
+    while (keep < series->sealed.size() && series->sealed[keep]->last() < cutoff) {
+        dropped += series->sealed[keep++]->size();
+    }
+    series->sealed.erase(series->sealed.begin(), series->sealed.begin() + static_cast<std::ptrdiff_t>(keep));
+    // A sensor that went quiet never fills its head, so it expires as well
+    if (series->sealed.empty() && series->head.size() > 0 && series->head.last() < cutoff) {
+        dropped += series->head.size();
+        series->head = Segment();
+    }
+    return dropped;
+}
+
+size_t SeriesStore::compaction_backlog(const std::string& sensor, size_t hot) const {
+    Series* series = find(sensor);
+    if (!series) return 0;
+    std::lock_guard<std::mutex> lock(series->mutex);
+    size_t eligible = series->sealed.size() > hot ? series->sealed.size() - hot : 0;
+    size_t backlog = 0;
+    for (size_t i = 0; i < eligible; ++i) backlog += series->sealed[i]->compacted() ? 0u : 1u;
+    return backlog;
+}
+
+bool SeriesStore::compaction_run(const std::string& sensor, size_t hot, size_t max_points,
+                                 std::vector<SegmentPtr>& run) const {
+    run.clear();
+    Series* series = find(sensor);
+    if (!series) return false;
+    std::lock_guard<std::mutex> lock(series->mutex);
+    size_t eligible = series->sealed.size() > hot ? series->sealed.size() - hot : 0;
+    for (size_t start = 0; start < eligible; ++start) {
+        size_t end = start;
+        size_t points = 0;
+        while (end < eligible && points + series->sealed[end]->size() <= max_points) {
+            points += series->sealed[end++]->size();
+        }
+        if (end - start >= 2 || (end - start == 1 && !series->sealed[start]->compacted())) {
+            run.assign(series->sealed.begin() + static_cast<std::ptrdiff_t>(start),
+                       series->sealed.begin() + static_cast<std::ptrdiff_t>(end));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SeriesStore::replace_run(const std::string& sensor, const std::vector<SegmentPtr>& run, SegmentPtr merged) {
+    Series* series = find(sensor);
+    if (!series || run.empty()) return false;
+    std::lock_guard<std::mutex> lock(series->mutex);
+    // Appends only add at the back, retention only removes from the front
+    // and migration swaps out whole segments, so the run is either intact
+    // or (partly) gone
+    auto& sealed = series->sealed;
+    auto at = std::find(sealed.begin(), sealed.end(), run.front());
+    if (static_cast<size_t>(sealed.end() - at) < run.size() || !std::equal(run.begin(), run.end(), at)) {
+        return false;
+    }
+    *at = std::move(merged);
+    sealed.erase(at + 1, at + static_cast<std::ptrdiff_t>(run.size()));
+    return true;
+}
+
+} // namespace cpp_service
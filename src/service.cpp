@@ -1,86 +1,630 @@
 #include "service.hpp"
+#include "json_scanner.hpp"
+#include "reproducible_sum.hpp"
+#include "thread_pool.hpp"
+#include "metrics.hpp"
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <limits>
 #include <numeric>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
 namespace cpp_service {
 
+namespace {
+
+// Sums term(i) over [0, n). In reproducible mode the sum is exact, so the
+// result does not depend on evaluation order, chunking or thread count.
+template <typename Term>
+double sum_terms(size_t n, bool reproducible, Term term) {
+    if (reproducible) {
+        ReproducibleSum sum;
+        for (size_t i = 0; i < n; ++i) {
+            sum.add(term(i));
+        }
+        return sum.value();
+    }
+    
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += term(i);
+    }
+    return sum;
+}
+
+constexpr Service::FusionAlgorithm kAlgorithms[] = {
+    Service::FusionAlgorithm::median, Service::FusionAlgorithm::trimmed_mean,
+    Service::FusionAlgorithm::winsorized_mean, Service::FusionAlgorithm::huber,
+    Service::FusionAlgorithm::weighted, Service::FusionAlgorithm::sketch,
+    Service::FusionAlgorithm::automatic,
+};
+
+// Partially orders `values` so that [k, n - k) holds the middle order
+// statistics with values[k] and values[n - 1 - k] at their sorted positions.
+// Two selections, O(n) on average, instead of a full sort.
+void select_tails(std::vector<double>& values, size_t k) {
+    if (k == 0) return;
+    auto low = values.begin() + k;
+    auto high = values.end() - 1 - k;
+    std::nth_element(values.begin(), low, values.end());
+    // Everything right of `low` is >= it, so selecting there leaves it in place
+    if (high > low) {
+        std::nth_element(low + 1, high, values.end());
+    }
+}
+
+using WeightedPoint = std::pair<double, double>;  // value, weight
+
+// Weighted median by quickselect: partitions around a median-of-three pivot,
+// keeps only the side holding the half-weight point and never sorts, so the
+// expected cost is linear. Weights must be positive. When the cumulative
+// weight splits exactly in half between two values their midpoint is
+// returned, which makes equal weights agree with the ordinary median.
+double weighted_quickselect(std::vector<WeightedPoint>& points, double total_weight) {
+    auto weight_of = [](auto first, auto last) {
+        double sum = 0.0;
+        for (; first != last; ++first) sum += first->second;
+        return sum;
+    };
+    
+    const double half = total_weight / 2.0;
+    auto first = points.begin();
+    auto last = points.end();
+    double below = 0.0;  // weight of everything left of [first, last)
+    
+    while (last - first > 1) {
+        double a = first->first;
+        double b = (first + (last - first) / 2)->first;
+        double c = (last - 1)->first;
+        double pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+        
+        auto equal_begin = std::partition(first, last, [pivot](const WeightedPoint& p) { return p.first < pivot; });
+        auto equal_end = std::partition(equal_begin, last, [pivot](const WeightedPoint& p) { return !(pivot < p.first); });
+        double less = weight_of(first, equal_begin);
+        double equal = weight_of(equal_begin, equal_end);
+        
+        if (below + less > half) {
+            last = equal_begin;
+            continue;
+        }
+        if (below + less == half && equal_begin != first) {
+            double lower = std::max_element(first, equal_begin)->first;
+            return (lower + pivot) / 2.0;
+        }
+        below += less;
+        if (below + equal > half || equal_end == last) {
+            return pivot;
+        }
+        if (below + equal == half) {
+            double upper = std::min_element(equal_end, last)->first;
+            return (pivot + upper) / 2.0;
+        }
+        below += equal;
+        first = equal_end;
+    }
+    return first->first;
+}
+
+double median_in_place(std::vector<double>& values) {
+    size_t n = values.size();
+    auto upper = values.begin() + n / 2;
+    std::nth_element(values.begin(), upper, values.end());
+    if (n % 2 == 0) {
+        // The lower middle is the largest value left of the upper one
+        double lower = *std::max_element(values.begin(), upper);
+        return (lower + *upper) / 2.0;
+    }
+    return *upper;
+}
+
+// Exact median for large inputs using the pool. A sorted sample brackets the
+// middle ranks with [low, high]; one parallel pass over fixed blocks counts
+// values below `low` and gathers those inside the bracket, and only that
+// small middle set is selected serially. Falls back to median_in_place() when
+// the bracket misses the middle ranks (unlucky sample, or NaN in the input).
+constexpr size_t kParallelMedianMin = size_t(1) << 18;
+constexpr size_t kMedianSample = 16384;
+constexpr size_t kMedianBlocks = 64;
+
+double parallel_median(std::vector<double>& values, ThreadPool& pool) {
+    size_t n = values.size();
+    if (n < kParallelMedianMin || pool.size() == 0) {
+        return median_in_place(values);
+    }
+
+    std::vector<double> sample(kMedianSample);
+    size_t stride = n / kMedianSample;
+    for (size_t i = 0; i < kMedianSample; ++i) {
+        sample[i] = values[i * stride];
+    }
+    std::sort(sample.begin(), sample.end());
+    // About three standard deviations of a sample rank either side
+    size_t margin = 3 * static_cast<size_t>(std::sqrt(static_cast<double>(kMedianSample)));
+    size_t lower_rank = (n - 1) / 2;
+    size_t upper_rank = n / 2;
+    size_t centre_low = lower_rank / stride;
+    size_t centre_high = upper_rank / stride;
+    double low = sample[centre_low > margin ? centre_low - margin : 0];
+    double high = sample[std::min(kMedianSample - 1, centre_high + margin)];
+
+    std::vector<size_t> below(kMedianBlocks, 0);
+    std::vector<std::vector<double>> inside(kMedianBlocks);
+    size_t block_size = (n + kMedianBlocks - 1) / kMedianBlocks;
+    pool.parallel_for(kMedianBlocks, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            size_t first = b * block_size;
+            size_t last = std::min(n, first + block_size);
+            size_t count = 0;
+            auto& kept = inside[b];
+            for (size_t i = first; i < last; ++i) {
+                double v = values[i];
+                count += v < low;
+                if (v >= low && v <= high) kept.push_back(v);
+            }
+            below[b] = count;
+        }
+    });
+
+    size_t total_below = std::accumulate(below.begin(), below.end(), size_t(0));
+    size_t middle_size = 0;
+    for (const auto& kept : inside) middle_size += kept.size();
+    if (total_below > lower_rank || total_below + middle_size <= upper_rank) {
+        return median_in_place(values);
+    }
+
+    std::vector<double> middle;
+    middle.reserve(middle_size);
+    for (const auto& kept : inside) middle.insert(middle.end(), kept.begin(), kept.end());
+    auto upper = middle.begin() + static_cast<std::ptrdiff_t>(upper_rank - total_below);
+    std::nth_element(middle.begin(), upper, middle.end());
+    if (lower_rank == upper_rank) {
+        return *upper;
+    }
+    // lower_rank >= total_below, so the lower middle is left of `upper` here too
+    double lower = *std::max_element(middle.begin(), upper);
+    return (lower + *upper) / 2.0;
+}
+
+// Approximate median from an equi-width histogram over the range of `values`,
+// refined once over the bins holding the middle rank(s). Three streaming
+// passes, no copy; `error_bound` receives the maximum distance from the exact
+// median, or infinity (with a NaN result) when a value is not finite.
+constexpr int kSketchBins = 256;
+// Each pass runs this many independent accumulators side by side: running
+// minima and maxima, and histograms, so a run of values landing in one bin
+// does not serialise on a single counter
+constexpr size_t kSketchLanes = 4;
+
+double sketch_median(const std::vector<double>& values, double& error_bound) {
+    size_t n = values.size();
+    double lows[kSketchLanes];
+    double highs[kSketchLanes];
+    std::fill(std::begin(lows), std::end(lows), values[0]);
+    std::fill(std::begin(highs), std::end(highs), values[0]);
+    bool finite = true;
+    size_t i = 0;
+    for (; i + kSketchLanes <= n; i += kSketchLanes) {
+        for (size_t lane = 0; lane < kSketchLanes; ++lane) {
+            double value = values[i + lane];
+            finite &= std::isfinite(value);
+            lows[lane] = std::min(lows[lane], value);
+            highs[lane] = std::max(highs[lane], value);
+        }
+    }
+    for (; i < n; ++i) {
+        finite &= std::isfinite(values[i]);
+        lows[0] = std::min(lows[0], values[i]);
+        highs[0] = std::max(highs[0], values[i]);
+    }
+    double low = *std::min_element(std::begin(lows), std::end(lows));
+    double high = *std::max_element(std::begin(highs), std::end(highs));
+    if (!finite) {
+        error_bound = std::numeric_limits<double>::infinity();
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (!(high > low)) {
+        error_bound = 0.0;
+        return low;
+    }
+    
+    size_t lower_rank = (n - 1) / 2;
+    size_t upper_rank = n / 2;
+    
+    // Finds the bins holding both middle ranks; `below` counts values left of bin 0
+    auto locate = [&](const uint32_t* counts, size_t below, int& lower_bin, int& upper_bin, size_t& below_lower) {
+        lower_bin = upper_bin = -1;
+        for (int b = 0; b < kSketchBins && upper_bin < 0; ++b) {
+            if (lower_bin < 0 && below + counts[b] > lower_rank) {
+                lower_bin = b;
+                below_lower = below;
+            }
+            if (below + counts[b] > upper_rank) {
+                upper_bin = b;
+            }
+            below += counts[b];
+        }
+    };
+    // Clamped in floating point, so the conversion is defined for any finite value
+    auto position_of = [](double value, double origin, double bin_scale) {
+        return std::min(std::max((value - origin) * bin_scale, 0.0), kSketchBins - 1.0);
+    };
+    auto bin_of = [&](double value, double origin, double bin_scale) {
+        return static_cast<size_t>(static_cast<int>(position_of(value, origin, bin_scale)));
+    };
+    // Counts each value `counted` into its bin, then folds the lanes into lanes[0]
+    uint32_t lanes[kSketchLanes][kSketchBins];
+    auto histogram = [&](double origin, double bin_scale, auto counted) {
+        std::memset(lanes, 0, sizeof(lanes));
+        i = 0;
+        for (; i + kSketchLanes <= n; i += kSketchLanes) {
+            for (size_t lane = 0; lane < kSketchLanes; ++lane) {
+                double value = values[i + lane];
+                if (counted(value)) lanes[lane][bin_of(value, origin, bin_scale)]++;
+            }
+        }
+        for (; i < n; ++i) {
+            if (counted(values[i])) lanes[0][bin_of(values[i], origin, bin_scale)]++;
+        }
+        for (size_t lane = 1; lane < kSketchLanes; ++lane) {
+            for (int b = 0; b < kSketchBins; ++b) lanes[0][b] += lanes[lane][b];
+        }
+    };
+    
+    double scale = kSketchBins / (high - low);
+    histogram(low, scale, [](double) { return true; });
+    int lower_bin = 0;
+    int upper_bin = 0;
+    size_t below = 0;
+    locate(lanes[0], 0, lower_bin, upper_bin, below);
+    
+    // Refine across the bins between the two ranks (usually a single bin)
+    double span_low = low + lower_bin / scale;
+    double span_width = (upper_bin - lower_bin + 1) / scale;
+    double sub_scale = kSketchBins / span_width;
+    // (a value's coarse bin is the truncated position, so comparing positions suffices)
+    double first = lower_bin;
+    double end = upper_bin + 1;
+    histogram(span_low, sub_scale, [&](double value) {
+        double position = position_of(value, low, scale);
+        return position >= first && position < end;
+    });
+    size_t unused = 0;
+    locate(lanes[0], below, lower_bin, upper_bin, unused);
+    
+    error_bound = 0.5 / sub_scale;
+    return span_low + (lower_bin + upper_bin + 1) / (2.0 * sub_scale);
+}
+
+// Resample counts are rounded down to these so index patterns get reused
+constexpr uint32_t kResampleSteps[] = {100, 200, 500, 1000, 2000, 5000, 10000};
+// Hard cap on resampled points per interval, whatever the deadline says
+constexpr double kMaxBootstrapPoints = 64.0 * 1024 * 1024;
+
+} // namespace
+
 Service::Service() : start_time_(std::chrono::steady_clock::now()) {
     // Service initialized
 }
 
+Service::~Service() = default;
+
+const char* Service::algorithm_name(FusionAlgorithm algorithm) {
+    switch (algorithm) {
+        case FusionAlgorithm::median: return "median";
+        case FusionAlgorithm::trimmed_mean: return "trimmed_mean";
+        case FusionAlgorithm::winsorized_mean: return "winsorized_mean";
+        case FusionAlgorithm::huber: return "huber";
+        case FusionAlgorithm::weighted: return "weighted";
+        case FusionAlgorithm::sketch: return "sketch";
+        case FusionAlgorithm::automatic: return "auto";
+    }
+    return "median";
+}
+
+bool Service::parse_algorithm(const std::string& name, FusionAlgorithm& algorithm) {
+    if (name == "trimmed") {
+        algorithm = FusionAlgorithm::trimmed_mean;
+        return true;
+    }
+    for (auto candidate : kAlgorithms) {
+        if (name == algorithm_name(candidate)) {
+            algorithm = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::map<Service::FusionAlgorithm, Service::CostModel> Service::default_cost_model() {
+    // Least-squares fits from fusion_bench --cost-model (x86-64, -O2, one core),
+    // which spans 16 to 16k readings. Selection slows once a request outgrows
+    // L2 and the sketch's streaming passes do not, which no single line fits,
+    // so the sketch's line is drawn to cross the median's where the measured
+    // costs cross (about 8k readings) and "auto" switches where it pays
+    return {
+        {FusionAlgorithm::median, {750.0, 7.3}},
+        {FusionAlgorithm::trimmed_mean, {1080.0, 6.95}},
+        {FusionAlgorithm::winsorized_mean, {630.0, 6.86}},
+        {FusionAlgorithm::huber, {505.0, 66.6}},
+        {FusionAlgorithm::weighted, {640.0, 7.6}},
+        {FusionAlgorithm::sketch, {7400.0, 6.4}},
+    };
+}
+
 std::string Service::health_check() const {
     return "ok";
 }
 
 double Service::fuse_readings(const std::vector<double>& readings) const {
+    return fuse_readings(readings, {});
+}
+
+double Service::fuse_readings(const std::vector<double>& readings, const std::vector<double>& weights) const {
+    return fuse(readings, weights, FusionOptions()).value;
+}
+
+Service::FusionResult Service::fuse(const std::vector<double>& readings, const std::vector<double>& weights,
+                                    const FusionOptions& options) const {
+    return fuse(readings, weights, options, config_snapshot());
+}
+
+Service::FusionResult Service::fuse(const std::vector<double>& readings, const std::vector<double>& weights,
+                                    const FusionOptions& options, const Config& config) const {
+    FusionResult result;
     if (readings.empty()) {
-        return 0.0;
+        return result;
+    }
+    if (!weights.empty()) {
+        std::string error = validate_weights(readings, weights);
+        if (!error.empty()) {
+            throw std::invalid_argument(error);
+        }
+    }
+    if (options.interval && !(options.interval_level > 0.0 && options.interval_level < 1.0)) {
+        throw std::invalid_argument("interval level must be between 0 and 1");
+    }
+    if (!weights.empty() && options.algorithm && *options.algorithm != FusionAlgorithm::weighted &&
+        *options.algorithm != FusionAlgorithm::automatic) {
+        throw std::invalid_argument(std::string("weights are not supported by the ") +
+                                    algorithm_name(*options.algorithm) + " algorithm");
+    }
+    if (!(options.tolerance >= 0.0)) {
+        throw std::invalid_argument("tolerance must be non-negative");
     }
     
-    total_requests_.fetch_add(1, std::memory_order_relaxed);
+    if (options.record) {
+        total_requests_.fetch_add(1, std::memory_order_relaxed);
+    }
     
     try {
-        std::vector<double> processed_readings = readings;
-        
-        // Apply outlier detection if enabled
-        if (config_.enable_outlier_detection && readings.size() > 2) {
-            auto outliers = detect_outliers(readings);
-            if (!outliers.empty()) {
-                // Remove outliers
-                processed_readings.erase(
-                    std::remove_if(processed_readings.begin(), processed_readings.end(),
-                        [&outliers](double value) {
-                            return std::find(outliers.begin(), outliers.end(), value) != outliers.end();
-                        }),
-                    processed_readings.end()
-                );
-            }
+        // Apply outlier detection if enabled; the gate copies the kept readings
+        // in one pass, and that copy is what the estimators reorder
+        std::vector<double> processed_readings;
+        std::vector<double> processed_weights;
+        if (config.enable_outlier_detection && readings.size() > 2) {
+            processed_readings = filter_outliers(readings, weights, config, processed_weights);
         }
         
         if (processed_readings.empty()) {
             processed_readings = readings;
+            processed_weights = weights;
         }
         
         // Calculate confidence
-        double confidence = calculate_confidence(readings, processed_readings);
+        result.confidence = calculate_confidence(readings, processed_readings, config);
+        
+        auto start = std::chrono::steady_clock::now();
+        FusionAlgorithm algorithm = processed_weights.empty()
+            ? resolve_algorithm(options.algorithm.value_or(config.algorithm), processed_readings,
+                                options.tolerance, config)
+            : FusionAlgorithm::weighted;
         
-        // Apply fusion algorithm (weighted average with median filter backup)
-        double fused_value;
-        if (processed_readings.size() >= 3) {
-            // Use median filter for robustness
-            fused_value = median_filter(processed_readings);
-        } else {
-            // Use weighted average for small datasets
-            fused_value = weighted_average(processed_readings);
+        // The interval resamples the gated readings through the same estimator
+        if (options.interval) {
+            bootstrap_interval(processed_readings, processed_weights, config, algorithm, options, result);
         }
         
+        double fused_value = estimate(processed_readings, processed_weights, config, algorithm, options.tolerance,
+                                     options.parallel);
+        result.value = fused_value;
+        result.algorithm = algorithm;
+        if (!options.record) {
+            return result;
+        }
+        
+        std::string label = std::string("algorithm=\"") + algorithm_name(algorithm) + "\"";
+        get_metrics().increment_counter("fusion_algorithm_total", label);
+        get_metrics().observe_histogram("fusion_duration_us",
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count(), label);
+        
         // Update statistics
         sum_fused_values_.fetch_add(static_cast<uint64_t>(fused_value * 1000), std::memory_order_relaxed);
         fused_count_.fetch_add(1, std::memory_order_relaxed);
         successful_requests_.fetch_add(1, std::memory_order_relaxed);
         
-        return fused_value;
+        return result;
         
     } catch (const std::exception& e) {
-        failed_requests_.fetch_add(1, std::memory_order_relaxed);
+        if (options.record) {
+            failed_requests_.fetch_add(1, std::memory_order_relaxed);
+        }
         throw;
     }
 }
 
+std::vector<double> Service::fuse_batch(const std::vector<std::vector<double>>& batches,
+                                        const std::vector<std::vector<double>>& weights) const {
+    return fuse_batch(batches, weights, FusionOptions());
+}
+
+std::vector<double> Service::fuse_batch(const std::vector<std::vector<double>>& batches,
+                                        const std::vector<std::vector<double>>& weights,
+                                        const FusionOptions& options) const {
+    if (!weights.empty() && weights.size() != batches.size()) {
+        throw std::invalid_argument("weights must have one entry per batch");
+    }
+    
+    std::vector<double> results;
+    results.reserve(batches.size());
+    for (size_t i = 0; i < batches.size(); ++i) {
+        results.push_back(fuse(batches[i], weights.empty() ? std::vector<double>() : weights[i], options).value);
+    }
+    return results;
+}
+
+std::string Service::validate_weights(const std::vector<double>& readings, const std::vector<double>& weights) {
+    if (weights.size() != readings.size()) {
+        return "'weights' must have one entry per reading";
+    }
+    double total = 0.0;
+    for (double weight : weights) {
+        if (!std::isfinite(weight) || weight < 0.0) {
+            return "'weights' must be finite and non-negative";
+        }
+        total += weight;
+    }
+    if (!(total > 0.0) || !std::isfinite(total)) {
+        return "'weights' must have a positive, finite sum";
+    }
+    return "";
+}
+
+Service::Config Service::config_snapshot() const {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return config_;
+}
+
+ReadingLimits Service::reading_limits() const {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return config_.reading_limits;
+}
+
 void Service::set_config(const std::string& config_json) {
-    // Simple JSON parsing - in production you'd use a proper JSON library
-    // For demo purposes, we'll just set some defaults
-    // This could be enhanced with actual JSON parsing
+    Config updated = config_snapshot();
+    
+    JsonScanner scanner(config_json);
+    std::string key;
+    if (scanner.begin_object()) {
+        while (scanner.next_member(key)) {
+            bool ok;
+            if (key == "outlier_threshold") {
+                ok = scanner.read_number(updated.outlier_threshold);
+            } else if (key == "min_confidence") {
+                ok = scanner.read_number(updated.min_confidence);
+            } else if (key == "enable_outlier_detection") {
+                ok = scanner.read_bool(updated.enable_outlier_detection);
+            } else if (key == "reproducible_summation") {
+                ok = scanner.read_bool(updated.reproducible_summation);
+            } else if (key == "fusion_algorithm") {
+                std::string name;
+                ok = scanner.read_string(name);
+                if (ok && !parse_algorithm(name, updated.algorithm)) {
+                    throw std::invalid_argument("Unknown fusion_algorithm: " + name);
+                }
+            } else if (key == "trim_fraction") {
+                ok = scanner.read_number(updated.trim_fraction);
+            } else if (key == "invalid_readings") {
+                std::string name;
+                ok = scanner.read_string(name);
+                if (ok && !parse_invalid_reading_policy(name, updated.reading_limits.policy)) {
+                    throw std::invalid_argument("Unknown invalid_readings policy: " + name);
+                }
+            } else if (key == "min_reading" || key == "max_reading") {
+                // null removes the bound
+                double& bound = key == "min_reading" ? updated.reading_limits.min_value
+                                                     : updated.reading_limits.max_value;
+                if (scanner.at_null()) {
+                    bound = (key == "min_reading" ? -1.0 : 1.0) * std::numeric_limits<double>::infinity();
+                    ok = scanner.skip_value();
+                } else {
+                    ok = scanner.read_number(bound);
+                }
+            } else if (key == "cost_model") {
+                // {"median": {"fixed_ns": 120, "per_item_ns": 9}, ...}; listed entries replace the current ones
+                ok = scanner.begin_object();
+                while (ok && scanner.next_member(key)) {
+                    FusionAlgorithm algorithm;
+                    if (!parse_algorithm(key, algorithm)) {
+                        throw std::invalid_argument("Unknown algorithm in cost_model: " + key);
+                    }
+                    CostModel model;
+                    std::string field;
+                    ok = scanner.begin_object();
+                    while (ok && scanner.next_member(field)) {
+                        if (field == "fixed_ns") {
+                            ok = scanner.read_number(model.fixed_ns);
+                        } else if (field == "per_item_ns") {
+                            ok = scanner.read_number(model.per_item_ns);
+                        } else {
+                            ok = scanner.skip_value();
+                        }
+                    }
+                    ok = ok && !scanner.failed();
+                    if (!(model.fixed_ns >= 0.0 && model.per_item_ns >= 0.0)) {
+                        throw std::invalid_argument("cost_model entries must be non-negative");
+                    }
+                    updated.cost_model[algorithm] = model;
+                }
+                ok = ok && !scanner.failed();
+            } else {
+                ok = scanner.skip_value();
+            }
+            if (!ok) break;
+        }
+    }
+    
+    if (!scanner.finish()) {
+        throw std::invalid_argument("Invalid configuration: " + scanner.error());
+    }
+    if (!(updated.outlier_threshold > 0.0)) {
+        throw std::invalid_argument("outlier_threshold must be positive");
+    }
+    if (!(updated.min_confidence >= 0.0 && updated.min_confidence <= 1.0)) {
+        throw std::invalid_argument("min_confidence must be between 0 and 1");
+    }
+    if (!(updated.trim_fraction >= 0.0 && updated.trim_fraction < 0.5)) {
+        throw std::invalid_argument("trim_fraction must be in [0, 0.5)");
+    }
+    if (!(updated.reading_limits.min_value < updated.reading_limits.max_value)) {
+        throw std::invalid_argument("min_reading must be below max_reading");
+    }
+    
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    config_ = updated;
 }
 
 std::string Service::get_config() const {
+    const Config config = config_snapshot();
     std::ostringstream oss;
     oss << "{\n";
-    oss << "  \"outlier_threshold\": " << config_.outlier_threshold << ",\n";
-    oss << "  \"min_confidence\": " << config_.min_confidence << ",\n";
-    oss << "  \"enable_outlier_detection\": " << (config_.enable_outlier_detection ? "true" : "false") << "\n";
+    oss << "  \"outlier_threshold\": " << config.outlier_threshold << ",\n";
+    oss << "  \"min_confidence\": " << config.min_confidence << ",\n";
+    oss << "  \"enable_outlier_detection\": " << (config.enable_outlier_detection ? "true" : "false") << ",\n";
+    oss << "  \"reproducible_summation\": " << (config.reproducible_summation ? "true" : "false") << ",\n";
+    oss << "  \"fusion_algorithm\": \"" << algorithm_name(config.algorithm) << "\",\n";
+    oss << "  \"trim_fraction\": " << config.trim_fraction << ",\n";
+    oss << "  \"invalid_readings\": \"" << to_string(config.reading_limits.policy) << "\",\n";
+    auto print_bound = [&oss](double bound) {
+        if (std::isfinite(bound)) oss << bound;
+        else oss << "null";
+    };
+    oss << "  \"min_reading\": ";
+    print_bound(config.reading_limits.min_value);
+    oss << ",\n  \"max_reading\": ";
+    print_bound(config.reading_limits.max_value);
+    oss << ",\n";
+    oss << "  \"cost_model\": {";
+    bool first = true;
+    for (const auto& [algorithm, model] : config.cost_model) {
+        oss << (first ? "\n" : ",\n") << "    \"" << algorithm_name(algorithm) << "\": {\"fixed_ns\": "
+            << model.fixed_ns << ", \"per_item_ns\": " << model.per_item_ns << "}";
+        first = false;
+    }
+    oss << "\n  }\n";
     oss << "}";
     return oss.str();
 }
@@ -108,21 +652,15 @@ void Service::reset_stats() {
     fused_count_.store(0);
 }
 
-double Service::weighted_average(const std::vector<double>& readings) const {
+double Service::weighted_average(const std::vector<double>& readings, const Config& config) const {
     if (readings.empty()) return 0.0;
     if (readings.size() == 1) return readings[0];
     
-    // Calculate weights based on inverse variance
+    // Weight each reading by its closeness to the mean
     std::vector<double> weights;
-    double mean = calculate_mean(readings);
-    double variance = 0.0;
-    
-    for (double reading : readings) {
-        variance += (reading - mean) * (reading - mean);
-    }
-    variance /= readings.size();
+    weights.reserve(readings.size());
+    double mean = calculate_mean(readings, config);
     
-    // Use inverse variance as weight (higher variance = lower weight)
     for (double reading : readings) {
         double diff = reading - mean;
         double weight = 1.0 / (1.0 + diff * diff);  // Avoid division by zero
@@ -130,53 +668,264 @@ double Service::weighted_average(const std::vector<double>& readings) const {
     }
     
     // Normalize weights
-    double total_weight = std::accumulate(weights.begin(), weights.end(), 0.0);
+    double total_weight = sum_terms(weights.size(), config.reproducible_summation,
+                                    [&weights](size_t i) { return weights[i]; });
     if (total_weight == 0.0) {
         return mean;  // Fallback to simple average
     }
     
-    double weighted_sum = 0.0;
-    for (size_t i = 0; i < readings.size(); ++i) {
-        weighted_sum += readings[i] * weights[i];
-    }
+    double weighted_sum = sum_terms(readings.size(), config.reproducible_summation,
+                                    [&](size_t i) { return readings[i] * weights[i]; });
     
     return weighted_sum / total_weight;
 }
 
+ThreadPool& Service::pool() const {
+    std::call_once(pool_once_, [this] {
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        pool_ = std::make_unique<ThreadPool>(threads - 1);  // the caller is the last worker
+    });
+    return *pool_;
+}
+
+Service::FusionAlgorithm Service::resolve_algorithm(FusionAlgorithm algorithm, const std::vector<double>& values,
+                                                    double tolerance, const Config& config) const {
+    if (algorithm != FusionAlgorithm::automatic) {
+        return algorithm;
+    }
+    if (values.size() < 3 || tolerance <= 0.0) {
+        return FusionAlgorithm::median;
+    }
+    
+    // The sketch qualifies when its bound, assuming both middle ranks share a
+    // bin, fits the tolerance; estimate() still checks the actual bound
+    auto [low, high] = std::minmax_element(values.begin(), values.end());
+    double predicted_error = (*high - *low) / (2.0 * kSketchBins * kSketchBins);
+    if (predicted_error > tolerance) {
+        return FusionAlgorithm::median;
+    }
+    
+    auto cost = [&](FusionAlgorithm candidate) {
+        auto it = config.cost_model.find(candidate);
+        if (it == config.cost_model.end()) return std::numeric_limits<double>::infinity();
+        return it->second.fixed_ns + it->second.per_item_ns * values.size();
+    };
+    return cost(FusionAlgorithm::sketch) < cost(FusionAlgorithm::median) ? FusionAlgorithm::sketch
+                                                                           : FusionAlgorithm::median;
+}
+
+double Service::estimate(std::vector<double>& values, const std::vector<double>& weights, const Config& config,
+                         FusionAlgorithm& algorithm, double tolerance, bool parallel) const {
+    auto exact_median = [&]() { return parallel ? parallel_median(values, pool()) : median_in_place(values); };
+    
+    if (!weights.empty()) {
+        return weighted_median(values, weights);
+    }
+    
+    switch (algorithm) {
+        case FusionAlgorithm::trimmed_mean:
+            return trimmed_mean(values, config);
+        case FusionAlgorithm::winsorized_mean:
+            return winsorized_mean(values, config);
+        case FusionAlgorithm::huber:
+            return huber_estimate(values, config);
+        case FusionAlgorithm::weighted:
+            return weighted_average(values, config);
+        case FusionAlgorithm::sketch: {
+            double error_bound = 0.0;
+            double value = sketch_median(values, error_bound);
+            if (std::isfinite(error_bound) && (tolerance <= 0.0 || error_bound <= tolerance)) {
+                return value;
+            }
+            algorithm = FusionAlgorithm::median;  // Middle ranks were spread out, or a value was not finite
+            return exact_median();
+        }
+        default:
+            break;
+    }
+    
+    if (values.size() >= 3) {
+        // Use median filter for robustness
+        return exact_median();
+    } else {
+        // Use weighted average for small datasets
+        return weighted_average(values, config);
+    }
+}
+
+void Service::bootstrap_interval(const std::vector<double>& values, const std::vector<double>& weights,
+                                 const Config& config, FusionAlgorithm algorithm, const FusionOptions& options,
+                                 FusionResult& result) const {
+    ThreadPool& workers = pool();
+    const auto count = static_cast<double>(values.size());
+    
+    // Spend about deadline_ms across the pool, per the measured cost per resampled point
+    double budget = options.deadline_ms * 1e6 * static_cast<double>(workers.size() + 1) /
+                    (bootstrap_ns_per_point_.load(std::memory_order_relaxed) * count);
+    budget = std::min(budget, kMaxBootstrapPoints / count);
+    if (budget < kResampleSteps[0]) {
+        // Fewer resamples than the smallest step would not be an interval worth reporting
+        throw std::invalid_argument("interval needs " + std::to_string(kResampleSteps[0]) + " resamples of " +
+                                    std::to_string(values.size()) + " readings, more than deadline_ms allows");
+    }
+    auto n = static_cast<uint32_t>(values.size());
+    uint32_t resamples = kResampleSteps[0];
+    for (uint32_t step : kResampleSteps) {
+        if (step <= budget && step <= options.max_resamples) resamples = step;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    // Large shapes are not cached; each worker then generates its own rows
+    BootstrapIndexCache::Pattern pattern = bootstrap_cache_.get(n, resamples);
+    
+    std::vector<double> estimates(resamples);
+    workers.parallel_for(resamples, [&](size_t begin, size_t end) {
+        std::vector<double> sample(n);
+        std::vector<double> sample_weights(weights.empty() ? 0 : n);
+        std::vector<uint32_t> generated(pattern ? 0 : n);
+        for (size_t r = begin; r < end; ++r) {
+            const uint32_t* row = generated.data();
+            if (pattern) {
+                row = pattern->data() + r * n;
+            } else {
+                BootstrapIndexCache::fill_row(n, resamples, static_cast<uint32_t>(r), generated.data());
+            }
+            for (uint32_t i = 0; i < n; ++i) {
+                sample[i] = values[row[i]];
+            }
+            for (uint32_t i = 0; i < sample_weights.size(); ++i) {
+                sample_weights[i] = weights[row[i]];
+            }
+            FusionAlgorithm resample_algorithm = algorithm;
+            estimates[r] = estimate(sample, sample_weights, config, resample_algorithm, options.tolerance, false);
+        }
+    });
+    
+    double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    size_t threads_used = std::min<size_t>(resamples, workers.size() + 1);
+    double measured = elapsed_ns * threads_used / (static_cast<double>(resamples) * n);
+    double model = bootstrap_ns_per_point_.load(std::memory_order_relaxed);
+    bootstrap_ns_per_point_.store(0.8 * model + 0.2 * measured, std::memory_order_relaxed);
+    
+    percentile_interval(estimates, options.interval_level, result.interval_low, result.interval_high);
+    result.has_interval = true;
+    result.resamples = resamples;
+}
+
 double Service::median_filter(const std::vector<double>& readings) const {
     if (readings.empty()) return 0.0;
     
-    std::vector<double> sorted_readings = readings;
-    sort_vector(sorted_readings);
+    std::vector<double> values = readings;
+    return median_in_place(values);
+}
+
+double Service::trimmed_mean(std::vector<double>& values, const Config& config) const {
+    if (values.empty()) return 0.0;
     
-    size_t n = sorted_readings.size();
-    if (n % 2 == 0) {
-        return (sorted_readings[n/2 - 1] + sorted_readings[n/2]) / 2.0;
-    } else {
-        return sorted_readings[n/2];
+    size_t n = values.size();
+    auto k = static_cast<size_t>(config.trim_fraction * n);
+    select_tails(values, k);
+    
+    const double* middle = values.data() + k;
+    return sum_terms(n - 2 * k, config.reproducible_summation,
+                     [middle](size_t i) { return middle[i]; }) / (n - 2 * k);
+}
+
+double Service::winsorized_mean(std::vector<double>& values, const Config& config) const {
+    if (values.empty()) return 0.0;
+    
+    size_t n = values.size();
+    auto k = static_cast<size_t>(config.trim_fraction * n);
+    if (k == 0) return calculate_mean(values, config);
+    select_tails(values, k);
+    
+    // Each tail value is replaced by the nearest kept order statistic
+    double low = values[k];
+    double high = values[n - 1 - k];
+    return sum_terms(n, config.reproducible_summation, [&](size_t i) {
+        return std::min(std::max(values[i], low), high);
+    }) / n;
+}
+
+double Service::weighted_median(const std::vector<double>& values, const std::vector<double>& weights) const {
+    // Zero-weight readings cannot move the median; leave them out of the selection
+    std::vector<WeightedPoint> points;
+    points.reserve(values.size());
+    double total_weight = 0.0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (weights[i] > 0.0) {
+            points.emplace_back(values[i], weights[i]);
+            total_weight += weights[i];
+        }
     }
+    
+    if (points.empty()) {
+        return median_filter(values);  // The outlier gate kept only zero-weight readings
+    }
+    return weighted_quickselect(points, total_weight);
 }
 
-std::vector<double> Service::detect_outliers(const std::vector<double>& readings) const {
-    if (readings.size() <= 2) return {};
+double Service::huber_estimate(std::vector<double>& values, const Config& config) const {
+    if (values.size() < 3) return calculate_mean(values, config);
     
-    double mean = calculate_mean(readings);
-    double std_dev = calculate_std_dev(readings, mean);
+    // Start at the median with the MAD (scaled to sigma for normal data) as the scale
+    double center = median_in_place(values);
+    std::vector<double> deviations(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        deviations[i] = std::abs(values[i] - center);
+    }
+    double scale = 1.4826 * median_in_place(deviations);
+    if (scale == 0.0) return center;
     
-    if (std_dev == 0.0) return {};  // All values are the same
+    // Iteratively reweighted mean: residuals past k * scale get weight k * scale / |r|
+    const double cutoff = 1.345 * scale;
+    auto weight = [&](double value, double at) {
+        double residual = std::abs(value - at);
+        return residual <= cutoff ? 1.0 : cutoff / residual;
+    };
+    for (int iteration = 0; iteration < 50; ++iteration) {
+        double numerator = sum_terms(values.size(), config.reproducible_summation,
+                                     [&](size_t i) { return weight(values[i], center) * values[i]; });
+        double denominator = sum_terms(values.size(), config.reproducible_summation,
+                                       [&](size_t i) { return weight(values[i], center); });
+        double next = numerator / denominator;
+        bool converged = std::abs(next - center) <= 1e-9 * scale;
+        center = next;
+        if (converged) break;
+    }
+    return center;
+}
+
+std::vector<double> Service::filter_outliers(const std::vector<double>& readings, const std::vector<double>& weights,
+                                             const Config& config, std::vector<double>& kept_weights) const {
+    double mean = calculate_mean(readings, config);
+    double std_dev = calculate_std_dev(readings, mean, config);
     
-    std::vector<double> outliers;
-    for (double reading : readings) {
-        double z_score = std::abs((reading - mean) / std_dev);
-        if (z_score > config_.outlier_threshold) {
-            outliers.push_back(reading);
+    if (std_dev == 0.0) {  // All values are the same
+        kept_weights = weights;
+        return readings;
+    }
+    
+    std::vector<double> kept;
+    kept.reserve(readings.size());
+    kept_weights.clear();
+    for (size_t i = 0; i < readings.size(); ++i) {
+        // A deviation that overflows scores NaN (inf / inf); it cannot be
+        // shown to be within the threshold, so it goes with the outliers
+        double z_score = std::abs((readings[i] - mean) / std_dev);
+        if (std::isfinite(z_score) && z_score <= config.outlier_threshold) {
+            kept.push_back(readings[i]);
+            if (!weights.empty()) {
+                kept_weights.push_back(weights[i]);
+            }
         }
     }
     
-    return outliers;
+    return kept;
 }
 
-double Service::calculate_confidence(const std::vector<double>& readings, const std::vector<double>& filtered) const {
+double Service::calculate_confidence(const std::vector<double>& readings, const std::vector<double>& filtered,
+                                     const Config& config) const {
     if (readings.empty()) return 0.0;
     
     // Confidence based on how many readings were kept vs filtered
@@ -184,8 +933,8 @@ double Service::calculate_confidence(const std::vector<double>& readings, const
     
     // Additional confidence based on consistency of filtered readings
     if (filtered.size() > 1) {
-        double mean = calculate_mean(filtered);
-        double std_dev = calculate_std_dev(filtered, mean);
+        double mean = calculate_mean(filtered, config);
+        double std_dev = calculate_std_dev(filtered, mean, config);
         double coefficient_of_variation = std_dev / std::abs(mean);
         
         // Lower CV = higher confidence
@@ -196,25 +945,21 @@ double Service::calculate_confidence(const std::vector<double>& readings, const
     return retention_rate;
 }
 
-double Service::calculate_mean(const std::vector<double>& values) const {
+double Service::calculate_mean(const std::vector<double>& values, const Config& config) const {
     if (values.empty()) return 0.0;
-    return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    return sum_terms(values.size(), config.reproducible_summation,
+                     [&values](size_t i) { return values[i]; }) / values.size();
 }
 
-double Service::calculate_std_dev(const std::vector<double>& values, double mean) const {
+double Service::calculate_std_dev(const std::vector<double>& values, double mean, const Config& config) const {
     if (values.size() <= 1) return 0.0;
     
-    double variance = 0.0;
-    for (double value : values) {
-        variance += (value - mean) * (value - mean);
-    }
+    double variance = sum_terms(values.size(), config.reproducible_summation, [&](size_t i) {
+        return (values[i] - mean) * (values[i] - mean);
+    });
     variance /= values.size();
     
     return std::sqrt(variance);
 }
 
-void Service::sort_vector(std::vector<double>& values) const {
-    std::sort(values.begin(), values.end());
-}
-
 } // namespace cpp_service
\ No newline at end of file
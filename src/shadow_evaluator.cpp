@@ -0,0 +1,208 @@
+#include "shadow_evaluator.hpp"
+#include "metrics.hpp"
+#include "../third_party/simple_http.hpp"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <time.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cpp_service {
+
+namespace {
+
+// CPU time consumed by the calling thread, so a shadow job that gets
+// preempted by serving threads is not charged for the time it sat runnable
+double thread_cpu_us() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) * 1e6 + static_cast<double>(ts.tv_nsec) / 1e3;
+}
+
+} // namespace
+
+ShadowEvaluator::ShadowEvaluator(const Service& service, const Config& config)
+    : service_(service), config_(config),
+      algorithm_label_(std::string("algorithm=\"") + Service::algorithm_name(config.algorithm) + "\"") {
+    for (unsigned i = 0; i < std::max(1u, config_.threads); ++i) {
+        workers_.emplace_back([this]() { worker_loop(); });
+    }
+    publisher_ = std::thread([this]() { publisher_loop(); });
+}
+
+ShadowEvaluator::~ShadowEvaluator() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    work_cv_.notify_all();
+    publish_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    publisher_.join();
+}
+
+bool ShadowEvaluator::offer(std::vector<double>& readings, const std::vector<double>& weights,
+                            const Service::FusionOptions& options, const Service::FusionResult& served) {
+    if (!weights.empty() || readings.empty()) {
+        return false;
+    }
+    if (!simple_http::keep_sampled(offered_.fetch_add(1, std::memory_order_relaxed), config_.sample_rate)) {
+        return false;
+    }
+    sampled_.fetch_add(1, std::memory_order_relaxed);
+
+    // Captured here, at the serving thread's priority, so the worker never
+    // takes the service's configuration lock
+    Job job;
+    job.options = options;
+    job.config = service_.config_snapshot();
+    job.served_value = served.value;
+    {
+        // A worker holding the queue may be preempted for as long as the CPU
+        // stays busy; shed rather than wait for it
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        if (!lock.owns_lock() || queue_.size() >= config_.max_queue) {
+            if (lock.owns_lock()) lock.unlock();
+            shed_queue_full_.fetch_add(1, std::memory_order_relaxed);
+            get_metrics().increment_counter("shadow_requests_total", "outcome=\"queue_full\"");
+            return false;
+        }
+        job.readings = std::move(readings);
+        job.queued = std::chrono::steady_clock::now();
+        queue_.push_back(std::move(job));
+    }
+    readings.clear();
+    work_cv_.notify_one();
+    return true;
+}
+
+ShadowEvaluator::Stats ShadowEvaluator::stats() const {
+    Stats stats;
+    stats.sampled = sampled_.load();
+    stats.evaluated = evaluated_.load();
+    stats.shed_queue_full = shed_queue_full_.load();
+    stats.shed_stale = shed_stale_.load();
+    stats.failed = failed_.load();
+    return stats;
+}
+
+void ShadowEvaluator::wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] {
+        return queue_.empty() && running_jobs_ == 0 && outcomes_.empty() && !publishing_;
+    });
+}
+
+void ShadowEvaluator::worker_loop() {
+#ifdef __linux__
+    // Shadow jobs run only on CPU the serving threads leave idle
+    sched_param param{};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        work_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        if (stopping_) return;
+        Job job = std::move(queue_.front());
+        queue_.pop_front();
+        running_jobs_++;
+        lock.unlock();
+
+        Outcome outcome;
+        if (std::chrono::steady_clock::now() - job.queued >= config_.max_delay) {
+            // The workers are starved, so the server is busy: drop, don't catch up
+            shed_stale_.fetch_add(1, std::memory_order_relaxed);
+            outcome.kind = Outcome::Kind::stale;
+        } else {
+            outcome = evaluate(job);
+        }
+
+        lock.lock();
+        running_jobs_--;
+        outcomes_.push_back(outcome);
+        publish_cv_.notify_one();
+    }
+}
+
+void ShadowEvaluator::publisher_loop() {
+    std::vector<Outcome> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        publish_cv_.wait(lock, [this] { return stopping_ || !outcomes_.empty(); });
+        if (stopping_) return;
+        batch.swap(outcomes_);
+        publishing_ = true;
+        lock.unlock();
+
+        for (const Outcome& outcome : batch) {
+            publish(outcome);
+        }
+        batch.clear();
+
+        lock.lock();
+        publishing_ = false;
+        if (queue_.empty() && running_jobs_ == 0 && outcomes_.empty()) {
+            idle_cv_.notify_all();
+        }
+    }
+}
+
+ShadowEvaluator::Outcome ShadowEvaluator::evaluate(const Job& job) {
+    // Both sides run here, under the same conditions, so their costs compare.
+    // Neither records, bootstraps nor uses the pool, so neither takes a lock.
+    Service::FusionOptions served_options = job.options;
+    served_options.interval = false;
+    served_options.parallel = false;
+    served_options.record = false;
+    Service::FusionOptions shadow_options;
+    shadow_options.algorithm = config_.algorithm;
+    shadow_options.tolerance = config_.tolerance;
+    shadow_options.record = false;
+
+    Outcome outcome;
+    try {
+        double start = thread_cpu_us();
+        Service::FusionResult served = service_.fuse(job.readings, {}, served_options, job.config);
+        double middle = thread_cpu_us();
+        Service::FusionResult shadow = service_.fuse(job.readings, {}, shadow_options, job.config);
+        double end = thread_cpu_us();
+
+        double scale = std::max(std::abs(job.served_value), std::numeric_limits<double>::min());
+        outcome.served_algorithm = served.algorithm;
+        outcome.served_cpu_us = middle - start;
+        outcome.shadow_cpu_us = end - middle;
+        outcome.diff_ppm = std::abs(shadow.value - job.served_value) / scale * 1e6;
+        evaluated_.fetch_add(1, std::memory_order_relaxed);
+    } catch (const std::exception&) {
+        outcome.kind = Outcome::Kind::failed;
+        failed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return outcome;
+}
+
+void ShadowEvaluator::publish(const Outcome& outcome) {
+    switch (outcome.kind) {
+    case Outcome::Kind::stale:
+        get_metrics().increment_counter("shadow_requests_total", "outcome=\"stale\"");
+        return;
+    case Outcome::Kind::failed:
+        get_metrics().increment_counter("shadow_requests_total", "outcome=\"failed\"");
+        return;
+    case Outcome::Kind::evaluated:
+        break;
+    }
+    get_metrics().observe_histogram("shadow_cpu_us", outcome.served_cpu_us,
+        std::string("pipeline=\"served\",algorithm=\"") + Service::algorithm_name(outcome.served_algorithm) + "\"");
+    get_metrics().observe_histogram("shadow_cpu_us", outcome.shadow_cpu_us, "pipeline=\"shadow\"," + algorithm_label_);
+    get_metrics().observe_histogram("shadow_diff_ppm", outcome.diff_ppm, algorithm_label_);
+    get_metrics().increment_counter("shadow_requests_total", "outcome=\"evaluated\"");
+}
+
+} // namespace cpp_service
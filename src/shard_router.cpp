@@ -0,0 +1,446 @@
+#include "shard_router.hpp"
+#include "gorilla_codec.hpp"
+#include "../third_party/simple_http.hpp"
+#include <algorithm>
+
+namespace cpp_service {
+
+namespace {
+
+uint64_t fnv1a(uint64_t hash, const std::string& bytes) {
+    for (char c : bytes) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// FNV-1a over both IDs, finished with splitmix64's mixer: FNV alone scores
+// IDs differing only in their last bytes too alike
+uint64_t rendezvous_score(const std::string& member, const std::string& sensor) {
+    uint64_t hash = fnv1a(1469598103934665603ULL, member);
+    hash = fnv1a(hash ^ 0xff, sensor);
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+std::string host_of(const std::string& id) {
+    size_t colon = id.rfind(':');
+    return colon == std::string::npos ? id : id.substr(0, colon);
+}
+
+} // namespace
+
+std::string ShardRouter::owner(const std::vector<Membership::Member>& ring, const std::string& sensor) {
+    const Membership::Member* best = nullptr;
+    uint64_t best_score = 0;
+    for (const auto& member : ring) {
+        uint64_t score = rendezvous_score(member.id, sensor);
+        if (!best || score > best_score || (score == best_score && member.id < best->id)) {
+            best = &member;
+            best_score = score;
+        }
+    }
+    return best ? best->id : std::string();
+}
+
+ShardRouter::ShardRouter(Membership& membership, SeriesStore* series, const Config& config)
+    : membership_(membership), series_(series), config_(config),
+      bucket_(config.bytes_per_second, config.burst_bytes) {
+    config_.chunk_points = std::max<size_t>(1, config_.chunk_points);
+    rebuild();
+    thread_ = std::thread([this]() { loop(); });
+}
+
+ShardRouter::~ShardRouter() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stopping_ = true;
+    }
+    stop_cv_.notify_all();
+    thread_.join();
+}
+
+ShardRouter::Route ShardRouter::route(const std::string& sensor, unsigned hops) const {
+    Route here;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (ring_.size() < 2 || hops >= config_.max_hops) return here;
+    std::string target = owner(ring_, sensor);
+    if (target == membership_.id()) {
+        // Gained in the last change: the previous owner serves it until its
+        // handoff is done, since the history here may be partial. Only a
+        // request that came here first goes back, so none ping-pongs.
+        if (hops > 0 || handoffs_.empty()) return here;
+        std::string previous = owner(previous_ring_, sensor);
+        auto pending = handoffs_.find(previous);
+        if (pending == handoffs_.end() || Clock::now() >= pending->second) return here;
+        target = previous;
+    } else if (queued_.count(sensor)) {
+        return here;
+    }
+    const Membership::Member* destination = member(target);
+    if (!destination) return here;
+    Route route;
+    route.local = false;
+    route.host = host_of(destination->id);
+    route.port = destination->http_port;
+    return route;
+}
+
+bool ShardRouter::accepts_from(const std::string& id, const std::string& address) const {
+    if (id.empty() || address.empty() || id == membership_.id()) return false;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto* ring : {&ring_, &previous_ring_}) {
+        for (const auto& member : *ring) {
+            if (member.id == id) return member.address == address;
+        }
+    }
+    return false;
+}
+
+bool ShardRouter::receive(const std::string& body, std::string& error, size_t max_decoded_bytes) {
+    std::vector<double> values;
+    std::vector<int64_t> timestamps;
+    std::vector<GorillaSeriesView> views;
+    error = decode_gorilla_batch(body, values, timestamps, &views, max_decoded_bytes);
+    if (!error.empty()) return false;
+    if (!series_) {
+        error = "series storage is disabled";
+        return false;
+    }
+    for (const auto& view : views) {
+        auto first = static_cast<std::ptrdiff_t>(view.first);
+        auto last = static_cast<std::ptrdiff_t>(view.first + view.count);
+        points_received_.fetch_add(series_->import(view.sensor,
+                                                   std::vector<int64_t>(timestamps.begin() + first, timestamps.begin() + last),
+                                                   std::vector<double>(values.begin() + first, values.begin() + last)),
+                                   std::memory_order_relaxed);
+        if (config_.on_import) config_.on_import(view.sensor);
+    }
+    chunks_received_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ShardRouter::handoff_done(const std::string& from, uint64_t ring) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    done_[from] = ring;
+    if (ring == fingerprint_) handoffs_.erase(from);
+}
+
+uint64_t ShardRouter::ring_fingerprint() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return fingerprint_;
+}
+
+ShardRouter::Stats ShardRouter::stats() const {
+    Stats stats;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        stats.ring_members = ring_.size();
+        stats.queued_sensors = queue_.size();
+        auto now = Clock::now();
+        for (const auto& handoff : handoffs_) stats.pending_handoffs += now < handoff.second ? 1u : 0u;
+    }
+    stats.ring_changes = ring_changes_.load();
+    stats.sensors_sent = sensors_sent_.load();
+    stats.points_sent = points_sent_.load();
+    stats.bytes_sent = bytes_sent_.load();
+    stats.chunks_sent = chunks_sent_.load();
+    stats.chunks_failed = chunks_failed_.load();
+    stats.points_received = points_received_.load();
+    stats.chunks_received = chunks_received_.load();
+    stats.throttled_ms = throttled_ms_.load();
+    return stats;
+}
+
+void ShardRouter::loop() {
+    uint64_t seen = membership_.version();
+    auto next_sweep = Clock::now();
+    for (;;) {
+        if (membership_.version() != seen) {
+            seen = membership_.version();
+            rebuild();
+        }
+        auto now = Clock::now();
+        bool sweep;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            sweep = now < sweep_until_;
+        }
+        if (series_ && sweep && now >= next_sweep) {
+            // Points from requests routed here just before a handoff land
+            // after the series was taken; send those stragglers on as well
+            queue_moved();
+            next_sweep = now + std::chrono::seconds(1);
+        }
+        if (!series_ || drain()) announce_done();
+
+        std::unique_lock<std::mutex> lock(stop_mutex_);
+        if (stop_cv_.wait_for(lock, config_.poll_interval, [this] { return stopping_; })) return;
+    }
+}
+
+void ShardRouter::rebuild() {
+    std::vector<Membership::Member> ring;
+    for (const auto& member : membership_.members()) {
+        if (member.state != Membership::State::dead) ring.push_back(member);
+    }
+    std::sort(ring.begin(), ring.end(),
+              [](const Membership::Member& a, const Membership::Member& b) { return a.id < b.id; });
+    uint64_t fingerprint = 1469598103934665603ULL;
+    for (const auto& member : ring) fingerprint = fnv1a(fingerprint, member.id + '\n');
+    // Asked before locking: the store has locks of its own
+    bool stored_nothing = !series_ || series_->stats().points == 0;
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (fingerprint == fingerprint_ && !ring_.empty()) {
+            ring_ = std::move(ring);  // a suspicion or refutation: same owners
+            return;
+        }
+        const std::string& self = membership_.id();
+        bool joining = ring_.size() <= 1 && stored_nothing;
+        if (joining) {
+            // A node with nothing stored that finds others has joined them:
+            // they are what owned its sensors before
+            previous_ring_.clear();
+            for (const auto& member : ring) {
+                if (member.id != self) previous_ring_.push_back(member);
+            }
+        } else {
+            previous_ring_ = std::move(ring_);
+        }
+        ring_ = std::move(ring);
+        fingerprint_ = fingerprint;
+
+        // Every other member hands over after each change, if only to say
+        // it had nothing; one that already did for this ring is not waited for
+        auto deadline = Clock::now() + config_.handoff_timeout;
+        handoffs_.clear();
+        for (const auto& member : ring_) {
+            auto done = done_.find(member.id);
+            if (member.id != self && (done == done_.end() || done->second != fingerprint_)) {
+                handoffs_[member.id] = deadline;
+            }
+        }
+        announce_ = true;
+        sweep_until_ = deadline;
+    }
+    ring_changes_.fetch_add(1, std::memory_order_relaxed);
+    if (series_) queue_moved();
+}
+
+void ShardRouter::queue_moved() {
+    std::vector<Membership::Member> ring;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        ring = ring_;
+    }
+    if (ring.size() < 2) return;
+    for (const auto& sensor : series_->sensors()) {
+        if (owner(ring, sensor) == membership_.id() || series_->points(sensor) == 0) continue;
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (queued_.insert(sensor).second) queue_.push_back(sensor);
+    }
+}
+
+void ShardRouter::requeue(const std::string& sensor) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    queued_.insert(sensor);
+    queue_.push_back(sensor);
+}
+
+bool ShardRouter::drain() {
+    std::vector<Piece> batch;
+    std::vector<Piece> complete;  // sensors whose points are all in `batch`
+    std::string batch_target;
+    size_t batch_points = 0;
+    auto send = [&]() {
+        batch_points = 0;
+        return flush(batch_target, batch, complete);
+    };
+    for (;;) {
+        std::string sensor;
+        std::string target;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            if (queue_.empty()) break;
+            sensor = std::move(queue_.front());
+            queue_.pop_front();
+            target = owner(ring_, sensor);
+            if (target.empty() || target == membership_.id()) {
+                queued_.erase(sensor);  // came back in a later change
+                continue;
+            }
+        }
+        // Still served here while it streams; writes meanwhile follow in hand_over()
+        Piece series{sensor, {}, {}};
+        SeriesStore::Snapshot snapshot;
+        series_->snapshot(sensor, snapshot);
+        for (const auto& segment : snapshot.segments) {
+            SeriesStore::SegmentPtr plain = SeriesStore::columns(segment);
+            series.timestamps.insert(series.timestamps.end(), plain->timestamps.begin(), plain->timestamps.end());
+            series.values.insert(series.values.end(), plain->values.begin(), plain->values.end());
+        }
+        if (series.timestamps.empty()) {
+            hand_over(target, series);  // emptied since it was queued, but for stragglers
+            continue;
+        }
+        if (!batch.empty() && target != batch_target && !send()) {
+            requeue(sensor);
+            return false;
+        }
+        batch_target = target;
+
+        // Newest points first: should the handoff be cut short, the new
+        // owner holds the part most queries ask for
+        size_t end = series.timestamps.size();
+        while (end > 0) {
+            size_t room = config_.chunk_points - batch_points;
+            size_t start = end > room ? end - room : 0;
+            batch.push_back(Piece{sensor,
+                                  std::vector<int64_t>(series.timestamps.begin() + static_cast<std::ptrdiff_t>(start),
+                                                       series.timestamps.begin() + static_cast<std::ptrdiff_t>(end)),
+                                  std::vector<double>(series.values.begin() + static_cast<std::ptrdiff_t>(start),
+                                                      series.values.begin() + static_cast<std::ptrdiff_t>(end))});
+            batch_points += end - start;
+            end = start;
+            if (end == 0) complete.push_back(std::move(series));
+            if (batch_points >= config_.chunk_points && !send()) {
+                if (end > 0) requeue(sensor);
+                return false;
+            }
+        }
+    }
+    return (batch.empty() && complete.empty()) || send();
+}
+
+bool ShardRouter::flush(const std::string& target, std::vector<Piece>& pieces, std::vector<Piece>& complete) {
+    bool sent = pieces.empty() || send_pieces(target, pieces);
+    pieces.clear();
+    if (!sent) {
+        // Nothing was taken from the store, so a retry starts over; the
+        // owner keeps any points it gets twice once
+        for (const auto& series : complete) requeue(series.sensor);
+        complete.clear();
+        return false;
+    }
+    for (auto& series : complete) {
+        if (!hand_over(target, series)) sent = false;
+    }
+    complete.clear();
+    return sent;
+}
+
+bool ShardRouter::hand_over(const std::string& target, const Piece& sent) {
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        // From here on requests for the sensor go to its owner
+        queued_.erase(sent.sensor);
+    }
+    SeriesStore::Snapshot snapshot;
+    if (!series_->take(sent.sensor, snapshot)) return true;
+
+    // Send on whatever was written since the snapshot that was streamed
+    Piece rest{sent.sensor, {}, {}};
+    size_t next = 0;
+    for (const auto& segment : snapshot.segments) {
+        SeriesStore::SegmentPtr plain = SeriesStore::columns(segment);
+        for (size_t i = 0; i < plain->size(); ++i) {
+            int64_t timestamp = plain->timestamps[i];
+            while (next < sent.timestamps.size() && sent.timestamps[next] < timestamp) ++next;
+            if (next < sent.timestamps.size() && sent.timestamps[next] == timestamp &&
+                sent.values[next] == plain->values[i]) {
+                ++next;
+                continue;
+            }
+            rest.timestamps.push_back(timestamp);
+            rest.values.push_back(plain->values[i]);
+        }
+    }
+    sensors_sent_.fetch_add(1, std::memory_order_relaxed);
+    if (rest.timestamps.empty()) return true;
+    std::vector<Piece> pieces{rest};
+    if (send_pieces(target, pieces)) return true;
+    // Served from here again, from these points alone, until a retry gets through
+    series_->import(rest.sensor, rest.timestamps, rest.values);
+    requeue(rest.sensor);
+    return false;
+}
+
+bool ShardRouter::send_pieces(const std::string& target, const std::vector<Piece>& pieces) {
+    GorillaEncoder encoder;
+    size_t points = 0;
+    for (const auto& piece : pieces) {
+        encoder.add_series(piece.sensor, piece.timestamps, piece.values);
+        points += piece.timestamps.size();
+    }
+    std::string body = encoder.finish();
+    if (!bucket_.pay(body.size(), stop_mutex_, stop_cv_, stopping_, throttled_ms_) || !post(target, body)) {
+        chunks_failed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    chunks_sent_.fetch_add(1, std::memory_order_relaxed);
+    points_sent_.fetch_add(points, std::memory_order_relaxed);
+    bytes_sent_.fetch_add(body.size(), std::memory_order_relaxed);
+    return true;
+}
+
+void ShardRouter::announce_done() {
+    std::vector<std::string> targets;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (!announce_ || !queue_.empty()) return;
+        announce_ = false;
+        for (const auto& member : ring_) {
+            if (member.id != membership_.id()) targets.push_back(member.id);
+        }
+    }
+    // A member that misses the notice gives up waiting at its deadline
+    for (const auto& target : targets) post(target, std::string());
+}
+
+bool ShardRouter::post(const std::string& target, const std::string& body) {
+    std::string host;
+    uint16_t port = 0;
+    uint64_t fingerprint = 0;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        const Membership::Member* destination = member(target);
+        if (!destination) return false;
+        host = host_of(destination->id);
+        port = destination->http_port;
+        fingerprint = fingerprint_;
+    }
+    std::string key = host + ":" + std::to_string(port);
+    auto& client = clients_[key];
+    if (!client) client = std::make_unique<simple_http::Client>(host, port);
+
+    std::unordered_map<std::string, std::string> headers = {
+        {"Content-Type", kGorillaContentType},
+        {"X-Fuser-Member", membership_.id()},
+    };
+    if (body.empty()) {
+        headers["X-Fuser-Handoff"] = "done";
+        headers["X-Fuser-Ring"] = std::to_string(fingerprint);
+    }
+    simple_http::Response response;
+    if (!client->request("POST", "/cluster/migrate", body, response, headers) || response.status_code != 200) {
+        client->disconnect();
+        return false;
+    }
+    return true;
+}
+
+const Membership::Member* ShardRouter::member(const std::string& id) const {
+    for (const auto& candidate : ring_) {
+        if (candidate.id == id) return &candidate;
+    }
+    return nullptr;
+}
+
+} // namespace cpp_service
@@ -0,0 +1,251 @@
+#include "telemetry_fuser.h"
+#include "service.hpp"
+#include "reading_validator.hpp"
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using cpp_service::ReadingValidator;
+using cpp_service::Service;
+
+struct tf_service {
+    Service service;
+};
+
+// Reused across calls, so inputs are copied into capacity already held
+struct tf_workspace {
+    std::vector<double> readings;
+    std::vector<double> weights;
+    std::vector<double> no_weights;  // stays empty
+};
+
+namespace {
+
+thread_local std::string last_error;
+
+tf_status fail(tf_status status, const char* message) {
+    last_error = message;
+    return status;
+}
+
+// Runs `body`, turning exceptions into a status for the C side
+template <typename Body>
+tf_status guarded(Body body) {
+    try {
+        last_error.clear();
+        return body();
+    } catch (const std::invalid_argument& e) {
+        return fail(TF_INVALID_ARGUMENT, e.what());
+    } catch (const std::bad_alloc&) {
+        return fail(TF_OUT_OF_MEMORY, "out of memory");
+    } catch (const std::exception& e) {
+        return fail(TF_INTERNAL_ERROR, e.what());
+    } catch (...) {
+        return fail(TF_INTERNAL_ERROR, "unknown error");
+    }
+}
+
+const Service::FusionAlgorithm kAlgorithms[] = {
+    Service::FusionAlgorithm::median,
+    Service::FusionAlgorithm::trimmed_mean,
+    Service::FusionAlgorithm::winsorized_mean,
+    Service::FusionAlgorithm::huber,
+    Service::FusionAlgorithm::weighted,
+    Service::FusionAlgorithm::sketch,
+    Service::FusionAlgorithm::automatic,
+};
+constexpr int32_t kAlgorithmCount = static_cast<int32_t>(sizeof(kAlgorithms) / sizeof(kAlgorithms[0]));
+
+int32_t algorithm_code(Service::FusionAlgorithm algorithm) {
+    for (int32_t i = 0; i < kAlgorithmCount; ++i) {
+        if (kAlgorithms[i] == algorithm) return i;
+    }
+    return TF_ALGORITHM_DEFAULT;
+}
+
+// The layout of ABI version 1; later fields are read only when the caller's
+// struct_size covers them
+constexpr size_t kOptionsV1Size = offsetof(tf_options, parallel) + sizeof(int32_t);
+
+bool convert_options(const tf_options* options, Service::FusionOptions& out) {
+    if (!options) return true;
+    if (options->struct_size < kOptionsV1Size) return false;
+    if (options->algorithm != TF_ALGORITHM_DEFAULT) {
+        if (options->algorithm < 0 || options->algorithm >= kAlgorithmCount) return false;
+        out.algorithm = kAlgorithms[options->algorithm];
+    }
+    out.tolerance = options->tolerance;
+    out.interval = options->interval != 0;
+    out.interval_level = options->interval_level;
+    out.deadline_ms = options->deadline_ms;
+    out.max_resamples = options->max_resamples;
+    out.parallel = options->parallel != 0;
+    return true;
+}
+
+tf_workspace& workspace_or_default(tf_workspace* workspace) {
+    thread_local tf_workspace per_thread;
+    return workspace ? *workspace : per_thread;
+}
+
+// Copies one series into the workspace through the service's reading
+// policy, as the HTTP decoders do; an empty string on success
+std::string load(tf_workspace& scratch, const double* readings, const double* weights, size_t count,
+                 ReadingValidator& validator) {
+    validator.begin_series();
+    scratch.readings.clear();
+    for (size_t i = 0; i < count; ++i) {
+        double value = readings[i];
+        if (validator.admit(value)) scratch.readings.push_back(value);
+    }
+    if (validator.rejected()) return validator.error();
+    if (weights) {
+        scratch.weights.assign(weights, weights + count);
+        cpp_service::erase_dropped(validator, scratch.weights);
+    }
+    if (scratch.readings.empty()) return "readings array cannot be empty";
+    return std::string();
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t tf_abi_version(void) {
+    return TF_ABI_VERSION;
+}
+
+const char* tf_last_error(void) {
+    return last_error.c_str();
+}
+
+const char* tf_algorithm_name(int32_t algorithm) {
+    if (algorithm < 0 || algorithm >= kAlgorithmCount) return nullptr;
+    return Service::algorithm_name(kAlgorithms[algorithm]);
+}
+
+void tf_options_init(tf_options* options) {
+    if (!options) return;
+    Service::FusionOptions defaults;
+    std::memset(options, 0, sizeof(*options));
+    options->struct_size = sizeof(tf_options);
+    options->algorithm = TF_ALGORITHM_DEFAULT;
+    options->tolerance = defaults.tolerance;
+    options->interval_level = defaults.interval_level;
+    options->deadline_ms = defaults.deadline_ms;
+    options->max_resamples = defaults.max_resamples;
+}
+
+tf_service* tf_service_create(void) {
+    tf_service* service = nullptr;
+    guarded([&]() {
+        service = new tf_service();
+        return TF_OK;
+    });
+    return service;
+}
+
+void tf_service_destroy(tf_service* service) {
+    delete service;
+}
+
+tf_status tf_service_configure(tf_service* service, const char* config_json) {
+    if (!service || !config_json) return fail(TF_INVALID_ARGUMENT, "service and configuration are required");
+    return guarded([&]() {
+        service->service.set_config(config_json);
+        return TF_OK;
+    });
+}
+
+tf_status tf_service_config(const tf_service* service, char* buffer, size_t capacity, size_t* required) {
+    if (!service) return fail(TF_INVALID_ARGUMENT, "service is required");
+    return guarded([&]() {
+        std::string config = service->service.get_config();
+        if (required) *required = config.size() + 1;
+        if (!buffer || capacity < config.size() + 1) return fail(TF_BUFFER_TOO_SMALL, "buffer too small");
+        std::memcpy(buffer, config.c_str(), config.size() + 1);
+        return TF_OK;
+    });
+}
+
+tf_workspace* tf_workspace_create(void) {
+    tf_workspace* workspace = nullptr;
+    guarded([&]() {
+        workspace = new tf_workspace();
+        return TF_OK;
+    });
+    return workspace;
+}
+
+void tf_workspace_destroy(tf_workspace* workspace) {
+    delete workspace;
+}
+
+tf_status tf_fuse(tf_service* service, tf_workspace* workspace,
+                  const double* readings, size_t count, const double* weights,
+                  const tf_options* options, tf_result* result) {
+    if (!service || !result) return fail(TF_INVALID_ARGUMENT, "service and result are required");
+    if (!readings || count == 0) return fail(TF_INVALID_ARGUMENT, "readings array cannot be empty");
+    Service::FusionOptions fusion_options;
+    if (!convert_options(options, fusion_options)) return fail(TF_INVALID_ARGUMENT, "invalid options");
+
+    return guarded([&]() {
+        tf_workspace& scratch = workspace_or_default(workspace);
+        ReadingValidator validator(service->service.reading_limits());
+        std::string error = load(scratch, readings, weights, count, validator);
+        if (!error.empty()) throw std::invalid_argument(error);
+        Service::FusionResult fused = service->service.fuse(scratch.readings,
+                                                            weights ? scratch.weights : scratch.no_weights,
+                                                            fusion_options);
+        result->value = fused.value;
+        result->confidence = fused.confidence;
+        result->algorithm = algorithm_code(fused.algorithm);
+        result->has_interval = fused.has_interval ? 1 : 0;
+        result->interval_low = fused.interval_low;
+        result->interval_high = fused.interval_high;
+        result->resamples = fused.resamples;
+        return TF_OK;
+    });
+}
+
+tf_status tf_fuse_batch(tf_service* service, tf_workspace* workspace,
+                        const double* readings, const size_t* offsets, size_t batch_count,
+                        const double* weights, const tf_options* options,
+                        double* values, size_t values_capacity) {
+    if (!service || !readings || !offsets) return fail(TF_INVALID_ARGUMENT, "service, readings and offsets are required");
+    if (batch_count == 0) return fail(TF_INVALID_ARGUMENT, "batches array cannot be empty");
+    if (!values || values_capacity < batch_count) return fail(TF_BUFFER_TOO_SMALL, "values buffer too small");
+    Service::FusionOptions fusion_options;
+    if (!convert_options(options, fusion_options)) return fail(TF_INVALID_ARGUMENT, "invalid options");
+    // Checked up front, like /fuse/batch: a bad batch fuses nothing
+    for (size_t i = 0; i < batch_count; ++i) {
+        if (offsets[i + 1] <= offsets[i]) {
+            last_error = "batch " + std::to_string(i) + " has no readings";
+            return TF_INVALID_ARGUMENT;
+        }
+    }
+
+    return guarded([&]() {
+        tf_workspace& scratch = workspace_or_default(workspace);
+        ReadingValidator validator(service->service.reading_limits());
+        for (size_t i = 0; i < batch_count; ++i) {
+            const size_t first = offsets[i];
+            std::string error = load(scratch, readings + first, weights ? weights + first : nullptr,
+                                     offsets[i + 1] - first, validator);
+            try {
+                if (!error.empty()) throw std::invalid_argument(error);
+                values[i] = service->service.fuse(scratch.readings, weights ? scratch.weights : scratch.no_weights,
+                                                  fusion_options).value;
+            } catch (const std::invalid_argument& e) {
+                last_error = "batch " + std::to_string(i) + ": " + e.what();
+                return TF_INVALID_ARGUMENT;
+            }
+        }
+        return TF_OK;
+    });
+}
+
+} // extern "C"
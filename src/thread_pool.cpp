@@ -0,0 +1,81 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace cpp_service {
+
+ThreadPool::ThreadPool(size_t threads) {
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this] { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task) {
+    std::packaged_task<void()> packaged(std::move(task));
+    std::future<void> future = packaged.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(packaged));
+    }
+    cv_.notify_one();
+    return future;
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0) return;
+
+    size_t chunks = std::min(count, workers_.size() + 1);
+    size_t chunk_size = (count + chunks - 1) / chunks;
+
+    std::vector<std::future<void>> pending;
+    pending.reserve(chunks);
+    for (size_t begin = chunk_size; begin < count; begin += chunk_size) {
+        size_t end = std::min(count, begin + chunk_size);
+        pending.push_back(submit([&fn, begin, end] { fn(begin, end); }));
+    }
+
+    // The caller takes the first chunk instead of idling
+    std::exception_ptr error;
+    try {
+        fn(0, std::min(count, chunk_size));
+    } catch (...) {
+        error = std::current_exception();
+    }
+    for (auto& future : pending) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::worker_loop() {
+    for (;;) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) return;  // stopping and drained
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace cpp_service
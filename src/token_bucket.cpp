@@ -0,0 +1,38 @@
+#include "token_bucket.hpp"
+#include <algorithm>
+
+namespace cpp_service {
+
+TokenBucket::TokenBucket(double bytes_per_second, double burst_bytes)
+    : rate_(bytes_per_second), burst_(std::max(1.0, burst_bytes)), tokens_(burst_),
+      refilled_(std::chrono::steady_clock::now()) {
+}
+
+std::chrono::nanoseconds TokenBucket::take(size_t bytes) {
+    if (rate_ <= 0.0) return std::chrono::nanoseconds(0);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - refilled_).count();
+    tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+    refilled_ = now;
+    tokens_ -= static_cast<double>(bytes);
+    if (tokens_ >= 0.0) return std::chrono::nanoseconds(0);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(-tokens_ / rate_));
+}
+
+bool TokenBucket::pay(size_t bytes, std::mutex& stop_mutex, std::condition_variable& stop_cv, const bool& stopping,
+                      std::atomic<uint64_t>& throttled_ms) {
+    std::chrono::nanoseconds debt = take(bytes);
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    if (stopping) return false;
+    if (debt.count() <= 0) return true;
+
+    auto start = std::chrono::steady_clock::now();
+    bool stopped = stop_cv.wait_for(lock, debt, [&stopping] { return stopping; });
+    throttled_ms.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::steady_clock::now() - start).count()),
+                           std::memory_order_relaxed);
+    return !stopped;
+}
+
+} // namespace cpp_service
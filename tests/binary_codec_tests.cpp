@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include "binary_codec.hpp"
+#include "reading_validator.hpp"
+#include <cmath>
+#include <limits>
+
+using cpp_service::BinaryFormat;
+using cpp_service::BinaryWriter;
+using cpp_service::decode_binary_batches;
+using cpp_service::decode_binary_readings;
+
+class BinaryCodecTest : public ::testing::TestWithParam<BinaryFormat> {};
+
+TEST_P(BinaryCodecTest, ReadingsWithUnrelatedFields) {
+    BinaryWriter writer(GetParam());
+    writer.begin_map(3);
+    writer.string("gateway").begin_map(2).string("id").string("gw-7").string("tags").begin_array(2)
+        .string("roof").integer(3);
+    writer.string("readings").begin_array(4).number(12.1).number(11.9).integer(12).number(-0.5);
+    writer.string("sent_at").integer(1700000000000ULL);
+
+    std::vector<double> readings;
+    ASSERT_EQ(decode_binary_readings(GetParam(), writer.data(), readings), "");
+    EXPECT_EQ(readings, (std::vector<double>{12.1, 11.9, 12.0, -0.5}));
+}
+
+TEST_P(BinaryCodecTest, BareArrayAndBatches) {
+    BinaryWriter readings_writer(GetParam());
+    readings_writer.begin_array(2).number(1.0).number(2.0);
+
+    std::vector<double> readings;
+    ASSERT_EQ(decode_binary_readings(GetParam(), readings_writer.data(), readings), "");
+    EXPECT_EQ(readings, (std::vector<double>{1.0, 2.0}));
+
+    BinaryWriter batch_writer(GetParam());
+    batch_writer.begin_map(1).string("batches").begin_array(2);
+    batch_writer.begin_array(3).number(1.0).number(2.0).number(3.0);
+    batch_writer.begin_array(1).integer(300);
+
+    std::vector<std::vector<double>> batches;
+    ASSERT_EQ(decode_binary_batches(GetParam(), batch_writer.data(), batches), "");
+    ASSERT_EQ(batches.size(), 2u);
+    EXPECT_EQ(batches[0], (std::vector<double>{1.0, 2.0, 3.0}));
+    EXPECT_EQ(batches[1], (std::vector<double>{300.0}));
+}
+
+TEST_P(BinaryCodecTest, RejectsMalformedBodies) {
+    std::vector<double> readings;
+
+    BinaryWriter no_readings(GetParam());
+    no_readings.begin_map(1).string("values").begin_array(1).number(1.0);
+    EXPECT_EQ(decode_binary_readings(GetParam(), no_readings.data(), readings), "Missing 'readings' field");
+
+    BinaryWriter strings(GetParam());
+    strings.begin_map(1).string("readings").begin_array(1).string("12.0");
+    EXPECT_NE(decode_binary_readings(GetParam(), strings.data(), readings), "");
+
+    BinaryWriter valid(GetParam());
+    valid.begin_map(1).string("readings").begin_array(2).number(1.0).number(2.0);
+    std::string truncated = valid.data().substr(0, valid.data().size() - 1);
+    EXPECT_NE(decode_binary_readings(GetParam(), truncated, readings), "");
+    EXPECT_NE(decode_binary_readings(GetParam(), valid.data() + "x", readings), "");
+    EXPECT_NE(decode_binary_readings(GetParam(), "", readings), "");
+}
+
+TEST_P(BinaryCodecTest, ValidatesFloatsAsTheyAreDecoded) {
+    // Unlike JSON, both formats can carry NaN and infinities
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inf = std::numeric_limits<double>::infinity();
+    BinaryWriter writer(GetParam());
+    writer.begin_map(1).string("readings").begin_array(4).number(1.0).number(nan).number(-inf).number(2.0);
+
+    std::vector<double> readings;
+    cpp_service::ReadingValidator rejecting;
+    EXPECT_EQ(decode_binary_readings(GetParam(), writer.data(), readings, &rejecting),
+              "Invalid reading at index 1: nan");
+
+    cpp_service::ReadingLimits limits;
+    limits.policy = cpp_service::InvalidReadingPolicy::drop;
+    cpp_service::ReadingValidator dropping(limits);
+    ASSERT_EQ(decode_binary_readings(GetParam(), writer.data(), readings, &dropping), "");
+    EXPECT_EQ(readings, (std::vector<double>{1.0, 2.0}));
+    EXPECT_EQ(dropping.count(cpp_service::InvalidReadingReason::nan), 1u);
+    EXPECT_EQ(dropping.count(cpp_service::InvalidReadingReason::infinite), 1u);
+
+    BinaryWriter batch_writer(GetParam());
+    batch_writer.begin_array(2);
+    batch_writer.begin_array(2).number(inf).number(3.0);
+    batch_writer.begin_array(1).number(4.0);
+    std::vector<std::vector<double>> batches;
+    cpp_service::ReadingValidator batch_validator(limits);
+    ASSERT_EQ(decode_binary_batches(GetParam(), batch_writer.data(), batches, &batch_validator), "");
+    ASSERT_EQ(batches.size(), 2u);
+    EXPECT_EQ(batches[0], (std::vector<double>{3.0}));
+    EXPECT_EQ(batches[1], (std::vector<double>{4.0}));
+}
+
+INSTANTIATE_TEST_SUITE_P(Formats, BinaryCodecTest,
+                         ::testing::Values(BinaryFormat::msgpack, BinaryFormat::cbor));
+
+TEST(BinaryCodecWireTest, MessagePackCompactIntegerAndFloatForms) {
+    // {"readings": [5, -3, uint16 1000, int8 -100, float32 1.5]}
+    const unsigned char body[] = {
+        0x81, 0xa8, 'r', 'e', 'a', 'd', 'i', 'n', 'g', 's',
+        0x95, 0x05, 0xfd, 0xcd, 0x03, 0xe8, 0xd0, 0x9c, 0xca, 0x3f, 0xc0, 0x00, 0x00,
+    };
+    std::vector<double> readings;
+    ASSERT_EQ(decode_binary_readings(BinaryFormat::msgpack,
+                                     std::string(reinterpret_cast<const char*>(body), sizeof(body)), readings), "");
+    EXPECT_EQ(readings, (std::vector<double>{5.0, -3.0, 1000.0, -100.0, 1.5}));
+}
+
+TEST(BinaryCodecWireTest, CborIndefiniteArrayAndHalfFloats) {
+    // {"readings": [_ 1.5 (half), -10, 0.5 (single)]}
+    const unsigned char body[] = {
+        0xa1, 0x68, 'r', 'e', 'a', 'd', 'i', 'n', 'g', 's',
+        0x9f, 0xf9, 0x3e, 0x00, 0x29, 0xfa, 0x3f, 0x00, 0x00, 0x00, 0xff,
+    };
+    std::vector<double> readings;
+    ASSERT_EQ(decode_binary_readings(BinaryFormat::cbor,
+                                     std::string(reinterpret_cast<const char*>(body), sizeof(body)), readings), "");
+    EXPECT_EQ(readings, (std::vector<double>{1.5, -10.0, 0.5}));
+}
+
+TEST(BinaryCodecWireTest, CborTagsAreBoundedNotRecursive) {
+    // {"readings": [1(2.625), <tags> 7]}: one tag is fine, a flood of them is
+    // rejected without recursing once per tag
+    auto body_with_tags = [](size_t tags) {
+        std::string body = "\xa1\x68readings\x82\xc1\xf9\x41\x40";
+        body.append(tags, '\xc6');
+        body += '\x07';
+        return body;
+    };
+    std::vector<double> readings;
+    ASSERT_EQ(decode_binary_readings(BinaryFormat::cbor, body_with_tags(3), readings), "");
+    EXPECT_EQ(readings, (std::vector<double>{2.625, 7.0}));
+    readings.clear();
+    EXPECT_NE(decode_binary_readings(BinaryFormat::cbor, body_with_tags(8 * 1024 * 1024), readings), "");
+}
+
+TEST(BinaryCodecWireTest, MediaTypes) {
+    BinaryFormat format;
+    EXPECT_TRUE(cpp_service::binary_format_for_media_type("application/msgpack", format));
+    EXPECT_EQ(format, BinaryFormat::msgpack);
+    EXPECT_TRUE(cpp_service::binary_format_for_media_type("Application/X-MsgPack; charset=binary", format));
+    EXPECT_EQ(format, BinaryFormat::msgpack);
+    EXPECT_TRUE(cpp_service::binary_format_for_media_type(" application/cbor", format));
+    EXPECT_EQ(format, BinaryFormat::cbor);
+    EXPECT_FALSE(cpp_service::binary_format_for_media_type("application/json", format));
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include "../third_party/simple_http.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string capture_path(const std::string& name) {
+    return ::testing::TempDir() + name + ".shcap";
+}
+
+std::vector<simple_http::CapturedRequest> read_all(const std::string& path) {
+    std::vector<simple_http::CapturedRequest> records;
+    simple_http::CaptureReader reader;
+    EXPECT_TRUE(reader.open(path));
+    simple_http::CapturedRequest record;
+    while (reader.next(record)) records.push_back(record);
+    return records;
+}
+
+} // namespace
+
+TEST(CaptureTest, RoundTripsRequests) {
+    simple_http::CaptureOptions options;
+    options.path = capture_path("round_trip");
+    std::string binary("a\0b\xff\x80 c", 7);
+    auto start = std::chrono::steady_clock::now();
+    {
+        simple_http::CaptureWriter writer(options);
+        for (int i = 0; i < 3; ++i) {
+            simple_http::Request request;
+            request.method = i == 1 ? "GET" : "POST";
+            request.path = "/fuse";
+            request.query = "i=" + std::to_string(i);
+            request.headers["Content-Type"] = "application/json";
+            request.headers["X-Index"] = std::to_string(i);
+            request.body = i == 2 ? binary : std::string(300, static_cast<char>('a' + i));
+            writer.record(request, start + std::chrono::milliseconds(10 * (i + 1)));
+        }
+        EXPECT_EQ(writer.stats().captured, 3u);
+    }
+
+    auto records = read_all(options.path);
+    ASSERT_EQ(records.size(), 3u);
+    for (int i = 0; i < 3; ++i) {
+        const simple_http::Request& request = records[i].request;
+        EXPECT_EQ(request.method, i == 1 ? "GET" : "POST");
+        EXPECT_EQ(request.path, "/fuse");
+        EXPECT_EQ(request.query, "i=" + std::to_string(i));
+        EXPECT_EQ(request.headers.at("X-Index"), std::to_string(i));
+        EXPECT_EQ(request.headers.at("Content-Type"), "application/json");
+        EXPECT_EQ(request.headers.size(), 2u);
+    }
+    EXPECT_EQ(records[2].request.body, binary);
+    // Gaps between arrivals survive exactly
+    EXPECT_EQ(records[1].arrival_ns - records[0].arrival_ns, 10000000u);
+    EXPECT_EQ(records[2].arrival_ns - records[1].arrival_ns, 10000000u);
+    std::remove(options.path.c_str());
+}
+
+TEST(CaptureTest, SamplesEvenly) {
+    for (double rate : {0.25, 0.0}) {
+        simple_http::CaptureOptions options;
+        options.path = capture_path("sampled");
+        options.sample_rate = rate;
+        {
+            simple_http::CaptureWriter writer(options);
+            simple_http::Request request;
+            request.method = "GET";
+            for (int i = 0; i < 1000; ++i) {
+                request.path = "/" + std::to_string(i);
+                writer.record(request, std::chrono::steady_clock::now());
+            }
+            EXPECT_EQ(writer.stats().seen, 1000u);
+            EXPECT_EQ(writer.stats().captured, static_cast<uint64_t>(1000 * rate));
+        }
+        auto records = read_all(options.path);
+        ASSERT_EQ(records.size(), static_cast<size_t>(1000 * rate));
+        // Every fourth request, not the first quarter
+        for (size_t i = 0; i < records.size(); ++i) {
+            EXPECT_EQ(records[i].request.path, "/" + std::to_string(4 * i + 3));
+        }
+        std::remove(options.path.c_str());
+    }
+}
+
+TEST(CaptureTest, DropsOverBufferLimit) {
+    simple_http::CaptureOptions options;
+    options.path = capture_path("dropped");
+    options.max_buffered_bytes = 1024;
+    options.flush_interval = std::chrono::hours(1);
+    {
+        simple_http::CaptureWriter writer(options);
+        simple_http::Request request;
+        request.method = "POST";
+        request.path = "/fuse";
+        request.body = std::string(400, 'x');
+        for (int i = 0; i < 5; ++i) writer.record(request, std::chrono::steady_clock::now());
+        EXPECT_EQ(writer.stats().captured, 2u);
+        EXPECT_EQ(writer.stats().dropped, 3u);
+    }
+    EXPECT_EQ(read_all(options.path).size(), 2u);
+    std::remove(options.path.c_str());
+}
+
+TEST(CaptureTest, ServerRecordsWhatItServes) {
+    simple_http::CaptureOptions options;
+    options.path = capture_path("server");
+    {
+        simple_http::Server server(0);
+        server.post("/echo", [](const simple_http::Request& req, simple_http::Response& res) {
+            res.text(req.body);
+        });
+        server.set_capture(options);
+        simple_http::BusyPollOptions busy;
+        busy.threads = 1;
+        busy.max_spin = std::chrono::microseconds(200);
+        server.set_busy_poll(busy);
+        std::thread thread([&server]() { server.run(); });
+        while (server.port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        simple_http::Client client("127.0.0.1", server.port());
+        simple_http::Response response;
+        for (int i = 0; i < 20; ++i) {
+            ASSERT_TRUE(client.request("POST", "/echo", "body " + std::to_string(i), response));
+            EXPECT_EQ(response.body, "body " + std::to_string(i));
+        }
+        EXPECT_EQ(server.capture_stats().captured, 20u);
+        server.stop();
+        thread.join();
+    }
+
+    auto records = read_all(options.path);
+    ASSERT_EQ(records.size(), 20u);
+    for (size_t i = 0; i < records.size(); ++i) {
+        EXPECT_EQ(records[i].request.method, "POST");
+        EXPECT_EQ(records[i].request.path, "/echo");
+        EXPECT_EQ(records[i].request.body, "body " + std::to_string(i));
+        if (i > 0) EXPECT_GE(records[i].arrival_ns, records[i - 1].arrival_ns);
+    }
+    std::remove(options.path.c_str());
+}
+
+TEST(CaptureTest, ReaderRejectsOtherFiles) {
+    std::string path = capture_path("not_a_capture");
+    FILE* file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    std::fputs("GET / HTTP/1.1\r\n\r\n", file);
+    std::fclose(file);
+    simple_http::CaptureReader reader;
+    EXPECT_FALSE(reader.open(path));
+    std::remove(path.c_str());
+
+    simple_http::CaptureReader missing;
+    EXPECT_FALSE(missing.open(capture_path("missing")));
+    simple_http::CaptureOptions options;
+    options.path = "/nonexistent/dir/capture.shcap";
+    EXPECT_THROW(simple_http::CaptureWriter writer(options), std::runtime_error);
+}
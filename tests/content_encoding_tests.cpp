@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "content_encoding.hpp"
+#include "config.h"
+
+#ifdef CPP_SERVICE_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef CPP_SERVICE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using cpp_service::ContentDecodeError;
+using cpp_service::decode_content;
+
+namespace {
+
+#ifdef CPP_SERVICE_HAVE_ZLIB
+std::string gzip_compress(const std::string& input) {
+    z_stream stream{};
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+    std::string output(deflateBound(&stream, static_cast<uLong>(input.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&output[0]);
+    stream.avail_out = static_cast<uInt>(output.size());
+    deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return output;
+}
+#endif
+
+} // namespace
+
+TEST(ContentEncodingTest, IdentityPassesThrough) {
+    std::string decoded;
+    std::string body = "{\"readings\":[1.0,2.0]}";
+
+    EXPECT_EQ(decode_content("identity", body, decoded, 1024), ContentDecodeError::none);
+    EXPECT_EQ(decoded, body);
+    EXPECT_EQ(decode_content("", body, decoded, 1024), ContentDecodeError::none);
+    EXPECT_EQ(decoded, body);
+}
+
+TEST(ContentEncodingTest, UnsupportedEncodingRejected) {
+    std::string decoded;
+    EXPECT_EQ(decode_content("br", "abc", decoded, 1024), ContentDecodeError::unsupported_encoding);
+    EXPECT_FALSE(cpp_service::is_content_encoding_supported("br"));
+    EXPECT_TRUE(cpp_service::is_content_encoding_supported("identity"));
+}
+
+#ifdef CPP_SERVICE_HAVE_ZLIB
+TEST(ContentEncodingTest, GzipRoundTrip) {
+    std::string body = "{\"readings\":[";
+    for (int i = 0; i < 1000; ++i) {
+        body += (i ? ",12." : "12.") + std::to_string(i % 10);
+    }
+    body += "]}";
+
+    std::string compressed = gzip_compress(body);
+    EXPECT_LT(compressed.size(), body.size() / 5);
+
+    std::string decoded;
+    EXPECT_EQ(decode_content("GZIP", compressed, decoded, 1 << 20), ContentDecodeError::none);
+    EXPECT_EQ(decoded, body);
+}
+
+TEST(ContentEncodingTest, GzipBombStopsAtLimit) {
+    std::string zeros(8 * 1024 * 1024, '0');
+    std::string compressed = gzip_compress(zeros);
+
+    std::string decoded;
+    EXPECT_EQ(decode_content("gzip", compressed, decoded, 1024 * 1024), ContentDecodeError::too_large);
+    EXPECT_LE(decoded.size(), 1024u * 1024u);
+}
+
+TEST(ContentEncodingTest, TruncatedGzipIsMalformed) {
+    std::string compressed = gzip_compress(std::string(4096, 'x'));
+    compressed.resize(compressed.size() / 2);
+
+    std::string decoded;
+    EXPECT_EQ(decode_content("gzip", compressed, decoded, 1 << 20), ContentDecodeError::malformed);
+    EXPECT_EQ(decode_content("gzip", "not gzip at all", decoded, 1 << 20), ContentDecodeError::malformed);
+}
+#endif
+
+#ifdef CPP_SERVICE_HAVE_ZSTD
+TEST(ContentEncodingTest, ZstdRoundTrip) {
+    std::string body(10000, 'a');
+    std::string compressed(ZSTD_compressBound(body.size()), '\0');
+    compressed.resize(ZSTD_compress(&compressed[0], compressed.size(), body.data(), body.size(), 3));
+
+    std::string decoded;
+    EXPECT_EQ(decode_content("zstd", compressed, decoded, 1 << 20), ContentDecodeError::none);
+    EXPECT_EQ(decoded, body);
+    EXPECT_EQ(decode_content("zstd", compressed, decoded, 100), ContentDecodeError::too_large);
+}
+#endif
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "downsample.hpp"
+#include "test_helpers.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using cpp_service::DownsampleMode;
+using cpp_service::SeriesStore;
+using test_helpers::segments_of;
+
+namespace {
+
+// A sine wave with one spike, one point per 10 ms, over small segments
+SeriesStore::Snapshot wave(SeriesStore& store, int64_t count, int64_t spike_at) {
+    for (int64_t i = 0; i < count; ++i) {
+        double value = i == spike_at ? 100.0 : std::sin(static_cast<double>(i) / 50.0);
+        store.append("s", 10 * i, value);
+    }
+    SeriesStore::Snapshot snapshot;
+    store.snapshot("s", snapshot);
+    return snapshot;
+}
+
+bool contains(const std::vector<SeriesStore::Point>& points, int64_t timestamp) {
+    return std::any_of(points.begin(), points.end(),
+                       [timestamp](const SeriesStore::Point& p) { return p.timestamp == timestamp; });
+}
+
+bool time_ordered(const std::vector<SeriesStore::Point>& points) {
+    return std::is_sorted(points.begin(), points.end(),
+                          [](const SeriesStore::Point& a, const SeriesStore::Point& b) {
+                              return a.timestamp < b.timestamp;
+                          });
+}
+
+} // namespace
+
+TEST(DownsampleTest, LttbKeepsEndpointsAndSpikes) {
+    SeriesStore store(segments_of(97));
+    SeriesStore::Snapshot snapshot = wave(store, 10000, 4321);
+    auto result = cpp_service::downsample(snapshot, INT64_MIN, INT64_MAX, 100, DownsampleMode::lttb);
+    EXPECT_EQ(result.in_range, 10000u);
+    ASSERT_EQ(result.points.size(), 100u);
+    EXPECT_EQ(result.points.front().timestamp, 0);
+    EXPECT_EQ(result.points.back().timestamp, 99990);
+    EXPECT_TRUE(contains(result.points, 43210));
+    EXPECT_TRUE(time_ordered(result.points));
+}
+
+TEST(DownsampleTest, MinMaxKeepsEveryBucketExtreme) {
+    SeriesStore store(segments_of(97));
+    SeriesStore::Snapshot snapshot = wave(store, 10000, 4321);
+    auto result = cpp_service::downsample(snapshot, INT64_MIN, INT64_MAX, 100, DownsampleMode::minmax);
+    EXPECT_LE(result.points.size(), 100u);
+    EXPECT_GE(result.points.size(), 98u);
+    EXPECT_TRUE(contains(result.points, 43210));
+    EXPECT_TRUE(time_ordered(result.points));
+
+    double low = 1e9;
+    for (const auto& p : result.points) low = std::min(low, p.value);
+    EXPECT_NEAR(low, -1.0, 1e-4);
+}
+
+TEST(DownsampleTest, RangeLimitsTheScanAcrossSegments) {
+    SeriesStore store(segments_of(64));
+    SeriesStore::Snapshot snapshot = wave(store, 1000, -1);
+    for (DownsampleMode mode : {DownsampleMode::lttb, DownsampleMode::minmax}) {
+        auto result = cpp_service::downsample(snapshot, 2995, 7005, 20, mode);
+        EXPECT_EQ(result.in_range, 401u);
+        ASSERT_FALSE(result.points.empty());
+        EXPECT_EQ(result.points.front().timestamp, 3000);
+        EXPECT_EQ(result.points.back().timestamp, 7000);
+        EXPECT_LE(result.points.size(), 20u);
+    }
+
+    auto empty = cpp_service::downsample(snapshot, 20000, 30000, 20, DownsampleMode::lttb);
+    EXPECT_EQ(empty.in_range, 0u);
+    EXPECT_TRUE(empty.points.empty());
+}
+
+TEST(DownsampleTest, ReturnsSmallRangesUnchanged) {
+    SeriesStore store(segments_of(3));
+    SeriesStore::Snapshot snapshot = wave(store, 10, -1);
+    auto result = cpp_service::downsample(snapshot, INT64_MIN, INT64_MAX, 10, DownsampleMode::lttb);
+    ASSERT_EQ(result.points.size(), 10u);
+    for (int64_t i = 0; i < 10; ++i) EXPECT_EQ(result.points[i].timestamp, 10 * i);
+
+    // Tiny budgets are raised to what each mode needs
+    EXPECT_EQ(cpp_service::downsample(snapshot, INT64_MIN, INT64_MAX, 1, DownsampleMode::lttb).points.size(), 3u);
+    EXPECT_EQ(cpp_service::downsample(snapshot, INT64_MIN, INT64_MAX, 1, DownsampleMode::minmax).points.size(), 2u);
+}
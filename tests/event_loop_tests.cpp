@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include "../third_party/simple_http.hpp"
+#include <chrono>
+#include <thread>
+
+namespace {
+
+// Runs a server on an ephemeral port for the lifetime of the fixture
+class EventLoopTest : public ::testing::TestWithParam<bool> {
+protected:
+    void SetUp() override {
+        server_.post("/echo", [](const simple_http::Request& req, simple_http::Response& res) {
+            res.text(req.body);
+        });
+        server_.get("/params", [](const simple_http::Request& req, simple_http::Response& res) {
+            res.text(req.query_param("a", "-") + "," + req.query_param("b", "-") + "," + req.query_param("c", "-"));
+        });
+        server_.set_max_body_size(1024);
+        if (GetParam()) {
+            simple_http::BusyPollOptions options;
+            options.threads = 2;
+            options.max_spin = std::chrono::microseconds(200);
+            server_.set_busy_poll(options);
+        }
+        thread_ = std::thread([this]() { server_.run(); });
+        while (server_.port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    void TearDown() override {
+        server_.stop();
+        thread_.join();
+    }
+
+    simple_http::Server server_{0};
+    std::thread thread_;
+};
+
+} // namespace
+
+TEST_P(EventLoopTest, RoundTripsOverOneClient) {
+    simple_http::Client client("127.0.0.1", server_.port());
+    simple_http::Response response;
+    for (int i = 0; i < 50; ++i) {
+        std::string body = "reading " + std::to_string(i);
+        ASSERT_TRUE(client.request("POST", "/echo", body, response));
+        EXPECT_EQ(response.status_code, 200);
+        EXPECT_EQ(response.body, body);
+        // Busy-poll loops keep the connection; the blocking server closes it
+        EXPECT_EQ(response.headers["Connection"], GetParam() ? "keep-alive" : "close");
+    }
+
+    ASSERT_TRUE(client.request("POST", "/missing", "", response));
+    EXPECT_EQ(response.status_code, 404);
+    ASSERT_TRUE(client.request("POST", "/echo", std::string(2048, 'x'), response));
+    EXPECT_EQ(response.status_code, 413);
+    EXPECT_EQ(response.headers["Connection"], "close");
+
+    // The client reconnects after the server closed the connection
+    ASSERT_TRUE(client.request("POST", "/echo", "again", response));
+    EXPECT_EQ(response.body, "again");
+}
+
+TEST_P(EventLoopTest, RoutesOnPathWithoutQuery) {
+    simple_http::Client client("127.0.0.1", server_.port());
+    simple_http::Response response;
+    ASSERT_TRUE(client.request("GET", "/params?a=1&bb=2&b&c=x%20y", "", response));
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_EQ(response.body, "1,,x%20y");
+    ASSERT_TRUE(client.request("GET", "/params", "", response));
+    EXPECT_EQ(response.body, "-,-,-");
+    ASSERT_TRUE(client.request("GET", "/params?", "", response));
+    EXPECT_EQ(response.body, "-,-,-");
+}
+
+TEST_P(EventLoopTest, ConcurrentClients) {
+    std::vector<std::thread> clients;
+    std::atomic<int> ok{0};
+    for (int c = 0; c < 4; ++c) {
+        clients.emplace_back([&, c]() {
+            simple_http::Client client("127.0.0.1", server_.port());
+            simple_http::Response response;
+            for (int i = 0; i < 25; ++i) {
+                std::string body = std::to_string(c) + ":" + std::to_string(i);
+                if (client.request("POST", "/echo", body, response) && response.body == body) ++ok;
+            }
+        });
+    }
+    for (auto& client : clients) client.join();
+    EXPECT_EQ(ok.load(), 100);
+}
+
+TEST(EventLoopWireTest, BusyPollHonoursHttp10AndPipelining) {
+    simple_http::Server server(0);
+    server.get("/ping", [](const simple_http::Request&, simple_http::Response& res) { res.text("pong"); });
+    simple_http::BusyPollOptions options;
+    options.max_spin = std::chrono::microseconds(200);
+    server.set_busy_poll(options);
+    std::thread thread([&server]() { server.run(); });
+    while (server.port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(server.port()));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    // Two pipelined requests; the HTTP/1.0 one ends the connection
+    std::string requests = "GET /ping HTTP/1.1\r\nHost: x\r\n\r\nGET /ping HTTP/1.0\r\n\r\n";
+    ASSERT_EQ(send(fd, requests.data(), requests.size(), 0), static_cast<ssize_t>(requests.size()));
+    std::string received;
+    char buffer[1024];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) received.append(buffer, static_cast<size_t>(n));
+    close(fd);
+
+    size_t first = received.find("pong");
+    ASSERT_NE(first, std::string::npos);
+    EXPECT_NE(received.find("pong", first + 4), std::string::npos);
+    EXPECT_NE(received.find("Connection: keep-alive"), std::string::npos);
+    EXPECT_NE(received.find("Connection: close"), std::string::npos);
+
+    server.stop();
+    thread.join();
+}
+
+TEST(EventLoopWireTest, DeferredResponsesKeepRequestOrder) {
+    // Deferred /slow requests complete from the loop hook after a later
+    // immediate /fast request; the client must still see request order
+    simple_http::Server server(0);
+    std::vector<std::pair<simple_http::Ticket, std::string>> waiting;
+    int hook_calls = 0;
+    server.post("/fast", [](const simple_http::Request& req, simple_http::Response& res) { res.text(req.body); });
+    server.post_deferred("/slow", [&](simple_http::Request& req, simple_http::Response&,
+                                      const simple_http::Ticket& ticket) {
+        waiting.emplace_back(ticket, req.body);
+        return true;
+    });
+    server.set_loop_hook([&](unsigned) {
+        if (waiting.size() < 2 || ++hook_calls < 100) return false;
+        for (auto& entry : waiting) {
+            simple_http::Response res;
+            res.text(entry.second);
+            server.complete(entry.first, res);
+        }
+        waiting.clear();
+        hook_calls = 0;
+        return true;
+    });
+    simple_http::BusyPollOptions options;
+    options.max_spin = std::chrono::microseconds(200);
+    server.set_busy_poll(options);
+    std::thread thread([&server]() { server.run(); });
+    while (server.port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(server.port()));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    std::string requests =
+        "POST /slow HTTP/1.1\r\nContent-Length: 1\r\n\r\nA"
+        "POST /fast HTTP/1.1\r\nContent-Length: 1\r\n\r\nB"
+        "POST /slow HTTP/1.1\r\nContent-Length: 1\r\nConnection: close\r\n\r\nC";
+    ASSERT_EQ(send(fd, requests.data(), requests.size(), 0), static_cast<ssize_t>(requests.size()));
+    std::string received;
+    char buffer[1024];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) received.append(buffer, static_cast<size_t>(n));
+    close(fd);
+
+    size_t a = received.find("\r\n\r\nA");
+    size_t b = received.find("\r\n\r\nB");
+    size_t c = received.find("\r\n\r\nC");
+    ASSERT_NE(a, std::string::npos);
+    ASSERT_NE(b, std::string::npos);
+    ASSERT_NE(c, std::string::npos);
+    EXPECT_LT(a, b);
+    EXPECT_LT(b, c);
+
+    server.stop();
+    thread.join();
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, EventLoopTest, ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return info.param ? "BusyPoll" : "Blocking";
+                         });
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include "fusion_pipeline.hpp"
+#include "spsc_ring.hpp"
+#include <chrono>
+#include <thread>
+
+using cpp_service::FusionPipeline;
+using cpp_service::Service;
+using cpp_service::SpscRing;
+
+TEST(SpscRingTest, FifoUntilFull) {
+    SpscRing<int> ring(3);  // rounded up to 4
+    EXPECT_EQ(ring.capacity(), 4u);
+    for (int i = 0; i < 4; ++i) {
+        int value = i;
+        EXPECT_TRUE(ring.try_push(std::move(value)));
+    }
+    int extra = 99;
+    EXPECT_FALSE(ring.try_push(std::move(extra)));
+    EXPECT_EQ(extra, 99);
+
+    int value = -1;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.try_pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(ring.try_pop(value));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingTest, TransfersAcrossThreadsInOrder) {
+    SpscRing<std::vector<int>> ring(8);
+    const int count = 20000;
+    std::thread producer([&]() {
+        for (int i = 0; i < count; ++i) {
+            std::vector<int> item{i, -i};
+            while (!ring.try_push(std::move(item))) std::this_thread::yield();
+        }
+    });
+    std::vector<int> item;
+    for (int expected = 0; expected < count; ++expected) {
+        while (!ring.try_pop(item)) std::this_thread::yield();
+        ASSERT_EQ(item, (std::vector<int>{expected, -expected}));
+    }
+    producer.join();
+}
+
+namespace {
+
+std::vector<FusionPipeline::Job> collect_all(FusionPipeline& pipeline, unsigned lane, size_t count) {
+    std::vector<FusionPipeline::Job> done;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (done.size() < count && std::chrono::steady_clock::now() < deadline) {
+        if (pipeline.collect(lane, done) == 0) std::this_thread::yield();
+    }
+    return done;
+}
+
+} // namespace
+
+TEST(FusionPipelineTest, MatchesRunToCompletion) {
+    Service service;
+    FusionPipeline pipeline(service, 2, 2, -1, 16);
+    EXPECT_EQ(pipeline.compute_threads(), 2u);
+
+    // More jobs than one ring holds, spread over both lanes
+    const size_t per_lane = 40;
+    size_t submitted[2] = {0, 0};
+    std::vector<FusionPipeline::Job> done[2];
+    for (size_t i = 0; i < per_lane; ++i) {
+        for (unsigned lane = 0; lane < 2; ++lane) {
+            FusionPipeline::Job job;
+            job.tag = lane * 1000 + i;
+            job.readings = {10.0 + i, 11.0 + i, 12.0 + i, 100.0 + i};
+            while (!pipeline.submit(lane, job)) pipeline.collect(lane, done[lane]);
+            submitted[lane]++;
+        }
+    }
+    for (unsigned lane = 0; lane < 2; ++lane) {
+        auto rest = collect_all(pipeline, lane, submitted[lane] - done[lane].size());
+        for (auto& job : rest) done[lane].push_back(std::move(job));
+        ASSERT_EQ(done[lane].size(), per_lane);
+
+        std::vector<bool> seen(per_lane, false);
+        for (const auto& job : done[lane]) {
+            size_t i = job.tag - lane * 1000;
+            ASSERT_LT(i, per_lane);
+            seen[i] = true;
+            EXPECT_TRUE(job.error.empty());
+            std::vector<double> readings = {10.0 + i, 11.0 + i, 12.0 + i, 100.0 + i};
+            EXPECT_DOUBLE_EQ(job.result.value, service.fuse(readings, {}, Service::FusionOptions()).value);
+        }
+        EXPECT_EQ(std::count(seen.begin(), seen.end(), true), static_cast<long>(per_lane));
+    }
+}
+
+TEST(FusionPipelineTest, ReportsErrorsInsteadOfThrowing) {
+    Service service;
+    FusionPipeline pipeline(service, 1, 1);
+    FusionPipeline::Job job;
+    job.tag = 7;
+    job.readings = {1.0, 2.0};
+    job.weights = {1.0};  // one weight short
+    ASSERT_TRUE(pipeline.submit(0, job));
+    auto done = collect_all(pipeline, 0, 1);
+    ASSERT_EQ(done.size(), 1u);
+    EXPECT_EQ(done[0].tag, 7u);
+    EXPECT_FALSE(done[0].error.empty());
+    EXPECT_TRUE(done[0].bad_request);
+}
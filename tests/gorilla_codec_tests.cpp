@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include "gorilla_codec.hpp"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+using cpp_service::decode_gorilla_batch;
+using cpp_service::GorillaEncoder;
+using cpp_service::GorillaSeriesView;
+
+namespace {
+
+bool same_bits(double a, double b) {
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+} // namespace
+
+TEST(GorillaCodecTest, RoundTripSmoothSeries) {
+    std::vector<int64_t> timestamps;
+    std::vector<double> values;
+    for (int i = 0; i < 1000; ++i) {
+        timestamps.push_back(1700000000000 + i * 1000);
+        values.push_back(12.0 + 0.25 * std::sin(i / 50.0));
+    }
+
+    GorillaEncoder encoder;
+    encoder.add_series("temp-1", timestamps, values);
+    std::string payload = encoder.finish();
+
+    std::vector<double> decoded;
+    std::vector<int64_t> decoded_ts;
+    std::vector<GorillaSeriesView> series;
+    ASSERT_EQ(decode_gorilla_batch(payload, decoded, decoded_ts, &series), "");
+
+    ASSERT_EQ(decoded.size(), values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_TRUE(same_bits(decoded[i], values[i])) << "index " << i;
+        EXPECT_EQ(decoded_ts[i], timestamps[i]);
+    }
+    ASSERT_EQ(series.size(), 1u);
+    EXPECT_EQ(series[0].sensor, "temp-1");
+    EXPECT_EQ(series[0].count, values.size());
+
+    // Regular timestamps cost one bit each; far below 16 bytes per point
+    EXPECT_LT(payload.size(), values.size() * 16 / 2);
+}
+
+TEST(GorillaCodecTest, RoundTripIrregularAndSpecialValues) {
+    std::mt19937_64 rng(42);
+    std::vector<int64_t> timestamps = {0};
+    std::vector<double> values = {0.0};
+    for (int i = 1; i < 500; ++i) {
+        int64_t jitter = static_cast<int64_t>(rng() % 5000) - 2500;
+        if (i % 97 == 0) jitter = 1LL << 40;  // large jump hits the 64-bit bucket
+        timestamps.push_back(timestamps.back() + 1000 + jitter);
+        values.push_back(static_cast<double>(rng() % 100000) / 7.0);
+    }
+    values[10] = -0.0;
+    values[11] = std::numeric_limits<double>::infinity();
+    values[12] = std::numeric_limits<double>::denorm_min();
+    values[13] = values[12];
+
+    GorillaEncoder encoder;
+    encoder.add_series("a", {5}, {1.5});
+    encoder.add_series("b", timestamps, values);
+    encoder.add_series("empty", {}, {});
+    std::string payload = encoder.finish();
+
+    std::vector<double> decoded;
+    std::vector<int64_t> decoded_ts;
+    std::vector<GorillaSeriesView> series;
+    ASSERT_EQ(decode_gorilla_batch(payload, decoded, decoded_ts, &series), "");
+
+    ASSERT_EQ(decoded.size(), values.size() + 1);
+    EXPECT_EQ(decoded[0], 1.5);
+    for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_TRUE(same_bits(decoded[i + 1], values[i])) << "index " << i;
+        EXPECT_EQ(decoded_ts[i + 1], timestamps[i]);
+    }
+    ASSERT_EQ(series.size(), 2u);
+    EXPECT_EQ(series[1].sensor, "b");
+    EXPECT_EQ(series[1].first, 1u);
+}
+
+TEST(GorillaCodecTest, RejectsMalformedPayloads) {
+    std::vector<double> values;
+    std::vector<int64_t> timestamps;
+
+    EXPECT_NE(decode_gorilla_batch("", values, timestamps), "");
+    EXPECT_NE(decode_gorilla_batch("{\"readings\":[1]}", values, timestamps), "");
+
+    GorillaEncoder encoder;
+    encoder.add_series("s", {1, 2, 3, 4}, {1.0, 2.0, 3.0, 4.0});
+    std::string payload = encoder.finish();
+
+    EXPECT_NE(decode_gorilla_batch(payload.substr(0, payload.size() - 3), values, timestamps), "");
+    EXPECT_NE(decode_gorilla_batch(payload + "x", values, timestamps), "");
+}
+
+TEST(GorillaCodecTest, RefusesBatchesThatDecodeBeyondTheLimit) {
+    std::vector<int64_t> timestamps;
+    std::vector<double> values;
+    for (int i = 0; i < 1000; ++i) {
+        timestamps.push_back(i * 1000);
+        values.push_back(7.0);
+    }
+    GorillaEncoder encoder;
+    encoder.add_series("a", timestamps, values);
+    encoder.add_series("b", timestamps, values);
+    std::string payload = encoder.finish();
+
+    // Constant series encode in a couple of bits per point; the limit is on
+    // what they decode to, counted across series
+    std::vector<double> decoded;
+    std::vector<int64_t> decoded_ts;
+    EXPECT_EQ(decode_gorilla_batch(payload, decoded, decoded_ts, nullptr, 2000 * 16), "");
+    decoded.clear();
+    decoded_ts.clear();
+    EXPECT_NE(decode_gorilla_batch(payload, decoded, decoded_ts, nullptr, 2000 * 16 - 1), "");
+    EXPECT_LE(decoded.size(), 1000u);
+    EXPECT_LT(payload.size(), 1000u);
+}
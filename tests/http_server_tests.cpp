@@ -0,0 +1,380 @@
+#include <gtest/gtest.h>
+#include "http_server.hpp"
+#include "metrics.hpp"
+#include "../third_party/simple_http.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::string readings_body(int count) {
+    std::string body = "{\"readings\": [";
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) body += ", ";
+        body += std::to_string(i);
+    }
+    return body + "]}";
+}
+
+// Runs an HttpServer with a small-threshold bulk lane, blocking or busy-poll
+class BulkLaneTest : public ::testing::TestWithParam<bool> {
+protected:
+    void SetUp() override {
+        cpp_service::get_metrics().reset();
+        cpp_service::HttpServer::BulkLaneConfig bulk;
+        bulk.threads = 1;
+        bulk.min_body_bytes = 4096;
+        bulk.min_readings = 200;
+        server_.set_bulk_lane(bulk);
+        if (GetParam()) {
+            cpp_service::HttpServer::BusyPollConfig busy_poll;
+            busy_poll.threads = 1;
+            busy_poll.max_spin_us = 200;
+            server_.set_busy_poll(busy_poll);
+        }
+        thread_ = std::thread([this]() { server_.run(); });
+        while (server_.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        port_ = server_.bound_port();
+    }
+
+    void TearDown() override {
+        server_.stop();
+        thread_.join();
+    }
+
+    static uint64_t lane_count(const std::string& lane) {
+        std::string metrics = cpp_service::get_metrics().get_prometheus_metrics();
+        std::string key = "fuse_lane_duration_ms_count{lane=\"" + lane + "\"} ";
+        size_t at = metrics.find(key);
+        return at == std::string::npos ? 0 : std::stoull(metrics.substr(at + key.size()));
+    }
+
+    cpp_service::Service service_;
+    cpp_service::HttpServer server_{0, &service_};
+    std::thread thread_;
+    int port_ = 0;
+};
+
+} // namespace
+
+TEST_P(BulkLaneTest, RoutesBySizeAndKeepsResults) {
+    simple_http::Client client("127.0.0.1", port_);
+    simple_http::Response response;
+
+    ASSERT_TRUE(client.request("POST", "/fuse", "{\"readings\": [1.0, 2.0, 3.0]}", response));
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_NE(response.body.find("\"fused_value\": \"2.000000\""), std::string::npos) << response.body;
+
+    // Under the byte threshold, over the reading threshold
+    std::string by_readings = readings_body(300);
+    ASSERT_LT(by_readings.size(), 4096u);
+    ASSERT_TRUE(client.request("POST", "/fuse", by_readings, response));
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_NE(response.body.find("\"fused_value\": \"149.500000\""), std::string::npos) << response.body;
+
+    // Over the byte threshold: decoded on the bulk lane too
+    ASSERT_TRUE(client.request("POST", "/fuse", readings_body(2001), response));
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_NE(response.body.find("\"fused_value\": \"1000.000000\""), std::string::npos) << response.body;
+
+    // Errors from a bulk body still come back as client errors
+    ASSERT_TRUE(client.request("POST", "/fuse", "{\"readings\": [" + std::string(5000, ' ') + "]}", response));
+    EXPECT_EQ(response.status_code, 400);
+
+    // A small request after the bulk ones still answers in order
+    ASSERT_TRUE(client.request("POST", "/fuse", "{\"readings\": [4.0]}", response));
+    EXPECT_NE(response.body.find("\"fused_value\": \"4.000000\""), std::string::npos) << response.body;
+
+    EXPECT_EQ(lane_count("small"), 2u);
+    EXPECT_EQ(lane_count("bulk"), 3u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, BulkLaneTest, ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return info.param ? "BusyPoll" : "Blocking";
+                         });
+
+// Every served /fuse request reaches the shadow evaluator, whether it was
+// fused in the handler or came back from the compute pipeline
+class ShadowTest : public ::testing::TestWithParam<bool> {};
+
+TEST_P(ShadowTest, ShadowsServedRequests) {
+    cpp_service::get_metrics().reset();
+    cpp_service::Service service;
+    cpp_service::HttpServer server(0, &service);
+    cpp_service::ShadowEvaluator::Config shadow;
+    shadow.algorithm = cpp_service::Service::FusionAlgorithm::trimmed_mean;
+    shadow.sample_rate = 1.0;
+    server.set_shadow(shadow);
+    if (GetParam()) {
+        cpp_service::HttpServer::BusyPollConfig busy_poll;
+        busy_poll.threads = 1;
+        busy_poll.max_spin_us = 200;
+        busy_poll.pipeline_threads = 1;
+        server.set_busy_poll(busy_poll);
+    }
+    std::thread thread([&server]() { server.run(); });
+    while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    int port = server.bound_port();
+
+    simple_http::Response response;
+    {
+        // Closed before the server stops, so no handler outlives it
+        simple_http::Client client("127.0.0.1", port);
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(client.request("POST", "/fuse", "{\"readings\": [8.0, 8.0, 8.0, 12.0]}", response));
+            EXPECT_NE(response.body.find("\"fused_value\": \"8.000000\""), std::string::npos) << response.body;
+        }
+        // Weighted and rejected requests are not shadowed
+        ASSERT_TRUE(client.request("POST", "/fuse", "{\"readings\": [1.0, 2.0], \"weights\": [1.0, 2.0]}",
+                                   response));
+        ASSERT_TRUE(client.request("POST", "/fuse", "{\"readings\": []}", response));
+        EXPECT_EQ(response.status_code, 400);
+    }
+
+    // A request that finds a shadow worker holding the queue is shed, not waited for
+    std::string metrics;
+    auto value = [&metrics](const std::string& series) {
+        size_t at = metrics.find(series + " ");
+        return at == std::string::npos ? 0.0 : std::stod(metrics.substr(at + series.size() + 1));
+    };
+    const std::string evaluated = "shadow_requests_total{outcome=\"evaluated\"}";
+    const std::string shed = "shadow_requests_total{outcome=\"queue_full\"}";
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        metrics = cpp_service::get_metrics().get_prometheus_metrics();
+        if (value(evaluated) + value(shed) == 4.0) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(value(evaluated) + value(shed), 4.0) << metrics;
+    EXPECT_GT(value(evaluated), 0.0);
+    EXPECT_EQ(value("shadow_diff_ppm_count{algorithm=\"trimmed_mean\"}"), value(evaluated));
+
+    server.stop();
+    thread.join();
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, ShadowTest, ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return info.param ? "BusyPollPipeline" : "Blocking";
+                         });
+
+// A request the fusion itself refuses (here a bootstrap interval its deadline
+// cannot pay for) is the client's error on every path it can take
+class FuseRejectionTest : public ::testing::TestWithParam<bool> {};
+
+TEST_P(FuseRejectionTest, AnswersUnaffordableIntervalsWith400) {
+    cpp_service::get_metrics().reset();
+    cpp_service::Service service;
+    cpp_service::HttpServer server(0, &service);
+    cpp_service::HttpServer::BulkLaneConfig bulk;
+    bulk.threads = 1;
+    bulk.min_body_bytes = 4096;
+    bulk.min_readings = 200;
+    server.set_bulk_lane(bulk);
+    if (GetParam()) {
+        cpp_service::HttpServer::BusyPollConfig busy_poll;
+        busy_poll.threads = 1;
+        busy_poll.max_spin_us = 200;
+        busy_poll.pipeline_threads = 1;
+        server.set_busy_poll(busy_poll);
+    }
+    std::thread thread([&server]() { server.run(); });
+    while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    {
+        simple_http::Client client("127.0.0.1", server.bound_port());
+        simple_http::Response response;
+        const std::string interval = ", \"interval\": {\"deadline_ms\": 0.000001}}";
+        std::string small = "{\"readings\": [1.0, 2.0, 3.0]" + interval;
+        std::string by_readings = readings_body(300);
+        by_readings.replace(by_readings.size() - 1, 1, interval);
+        std::string by_bytes = readings_body(2001);
+        by_bytes.replace(by_bytes.size() - 1, 1, interval);
+        for (const std::string& body : {small, by_readings, by_bytes}) {
+            ASSERT_TRUE(client.request("POST", "/fuse", body, response));
+            EXPECT_EQ(response.status_code, 400) << response.body;
+            EXPECT_NE(response.body.find("more than deadline_ms allows"), std::string::npos) << response.body;
+        }
+
+        ASSERT_TRUE(client.request("POST", "/fuse", "{\"readings\": [1.0], \"interval\": {\"level\": 1.0}}",
+                                   response));
+        EXPECT_EQ(response.status_code, 400) << response.body;
+    }
+
+    std::string metrics = cpp_service::get_metrics().get_prometheus_metrics();
+    EXPECT_NE(metrics.find("errors_total{endpoint=\"/fuse\",error=\"bad_request\"} 4"), std::string::npos)
+        << metrics;
+    EXPECT_EQ(metrics.find("error=\"internal_error\""), std::string::npos) << metrics;
+
+    server.stop();
+    thread.join();
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, FuseRejectionTest, ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return info.param ? "BusyPollPipeline" : "Blocking";
+                         });
+
+TEST(SensorsEndpointTest, ListsSilentSensors) {
+    cpp_service::get_metrics().reset();
+    cpp_service::Service service;
+    cpp_service::HttpServer server(0, &service);
+    cpp_service::SensorRegistry::Config sensors;
+    sensors.stale_after_ms = 200;
+    sensors.tick_ms = 10;
+    server.set_sensor_tracking(sensors);
+    std::thread thread([&server]() { server.run(); });
+    while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    int port = server.bound_port();
+
+    simple_http::Response response;
+    {
+        simple_http::Client client("127.0.0.1", port);
+        ASSERT_TRUE(client.request("POST", "/fuse", "{\"sensor\": \"quiet\", \"readings\": [1.0]}", response));
+        EXPECT_EQ(response.status_code, 200);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        ASSERT_TRUE(client.request("POST", "/fuse", "{\"sensor\": \"busy\", \"readings\": [2.0]}", response));
+
+        ASSERT_TRUE(client.request("GET", "/sensors?stale=true", "", response));
+        EXPECT_EQ(response.status_code, 200);
+        EXPECT_NE(response.body.find("\"tracked\": 2"), std::string::npos) << response.body;
+        EXPECT_NE(response.body.find("\"stale\": 1"), std::string::npos) << response.body;
+        EXPECT_NE(response.body.find("{\"id\": \"quiet\""), std::string::npos) << response.body;
+        EXPECT_EQ(response.body.find("\"busy\""), std::string::npos) << response.body;
+
+        ASSERT_TRUE(client.request("GET", "/sensors?limit=1", "", response));
+        EXPECT_NE(response.body.find("\"quiet\""), std::string::npos) << response.body;
+        EXPECT_EQ(response.body.find("\"busy\""), std::string::npos) << response.body;
+        ASSERT_TRUE(client.request("GET", "/sensors?limit=lots", "", response));
+        EXPECT_EQ(response.status_code, 400);
+
+        ASSERT_TRUE(client.request("GET", "/metrics", "", response));
+        EXPECT_NE(response.body.find("sensors_stale 1.0"), std::string::npos);
+        EXPECT_NE(response.body.find("sensors_tracked 2.0"), std::string::npos);
+    }
+
+    server.stop();
+    thread.join();
+}
+
+TEST(SeriesEndpointTest, ServesDownsampledSeries) {
+    cpp_service::get_metrics().reset();
+    cpp_service::Service service;
+    cpp_service::HttpServer server(0, &service);
+    cpp_service::SeriesStore::Config series;
+    series.segment_points = 16;
+    server.set_series_store(series);
+    std::thread thread([&server]() { server.run(); });
+    while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    int port = server.bound_port();
+
+    simple_http::Response response;
+    {
+        simple_http::Client client("127.0.0.1", port);
+        for (int i = 0; i < 100; ++i) {
+            std::string body = "{\"sensor\": \"pump 1\", \"readings\": [" + std::to_string(i) +
+                               "], \"timestamps\": [" + std::to_string(1000 + i) + "]}";
+            ASSERT_TRUE(client.request("POST", "/fuse", body, response));
+            ASSERT_EQ(response.status_code, 200);
+        }
+
+        ASSERT_TRUE(client.request("GET", "/series?sensor=pump%201&points=10", "", response));
+        EXPECT_EQ(response.status_code, 200);
+        EXPECT_NE(response.body.find("\"mode\": \"lttb\""), std::string::npos) << response.body;
+        EXPECT_NE(response.body.find("\"in_range\": 100"), std::string::npos) << response.body;
+        EXPECT_NE(response.body.find("\"returned\": 10"), std::string::npos) << response.body;
+        EXPECT_NE(response.body.find("[[1000,0],"), std::string::npos) << response.body;
+        EXPECT_NE(response.body.find(",[1099,99]]"), std::string::npos) << response.body;
+
+        ASSERT_TRUE(client.request("GET", "/series?sensor=pump+1&from=1010&to=1013&mode=minmax", "", response));
+        EXPECT_NE(response.body.find("[[1010,10],[1011,11],[1012,12],[1013,13]]"), std::string::npos)
+            << response.body;
+
+        ASSERT_TRUE(client.request("GET", "/series?sensor=pump%201&mode=spline", "", response));
+        EXPECT_EQ(response.status_code, 400);
+        ASSERT_TRUE(client.request("GET", "/series?sensor=pump%201&points=0", "", response));
+        EXPECT_EQ(response.status_code, 400);
+        ASSERT_TRUE(client.request("GET", "/series?sensor=nobody", "", response));
+        EXPECT_EQ(response.status_code, 404);
+        ASSERT_TRUE(client.request("GET", "/series?sensor=no%22body", "", response));
+        EXPECT_EQ(response.status_code, 404);
+        EXPECT_NE(response.body.find("\"message\": \"no series for sensor: no\\\"body\""), std::string::npos)
+            << response.body;
+
+        ASSERT_TRUE(client.request("GET", "/metrics", "", response));
+        EXPECT_NE(response.body.find("series_points 100.0"), std::string::npos);
+    }
+
+    server.stop();
+    thread.join();
+}
+
+TEST(SeriesEndpointTest, AggregatesWithQuery) {
+    cpp_service::get_metrics().reset();
+    cpp_service::Service service;
+    cpp_service::HttpServer server(0, &service);
+    server.set_series_store(cpp_service::SeriesStore::Config());
+    server.set_query_threads(2);
+    std::thread thread([&server]() { server.run(); });
+    while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    int port = server.bound_port();
+
+    simple_http::Response response;
+    {
+        simple_http::Client client("127.0.0.1", port);
+        for (int i = 0; i < 20; ++i) {
+            for (const char* sensor : {"a", "b"}) {
+                std::string body = std::string("{\"sensor\": \"") + sensor + "\", \"readings\": [" +
+                                   std::to_string(i) + "], \"timestamps\": [" + std::to_string(100 * i) + "]}";
+                ASSERT_TRUE(client.request("POST", "/fuse", body, response));
+                ASSERT_EQ(response.status_code, 200);
+            }
+        }
+
+        ASSERT_TRUE(client.request("GET", "/query?agg=max&step=1000&prefix=a", "", response));
+        EXPECT_EQ(response.status_code, 200);
+        EXPECT_NE(response.body.find("{\"sensor\": \"a\", \"buckets\": [[0,9,10],[1000,19,10]]}"),
+                  std::string::npos) << response.body;
+        EXPECT_EQ(response.body.find("\"b\""), std::string::npos) << response.body;
+
+        ASSERT_TRUE(client.request("GET", "/query?agg=quantile&q=0.5&group=all&from=0&to=900", "", response));
+        EXPECT_NE(response.body.find("{\"sensor\": null, \"buckets\": [[0,4.5,20]]}"), std::string::npos)
+            << response.body;
+
+        ASSERT_TRUE(client.request("GET", "/query?agg=median", "", response));
+        EXPECT_EQ(response.status_code, 400);
+        ASSERT_TRUE(client.request("GET", "/query?agg=quantile&q=2", "", response));
+        EXPECT_EQ(response.status_code, 400);
+        ASSERT_TRUE(client.request("GET", "/query?step=-5", "", response));
+        EXPECT_EQ(response.status_code, 400);
+    }
+
+    server.stop();
+    thread.join();
+}
+
+TEST(FuseErrorsTest, EscapeClientInputInMessages) {
+    cpp_service::get_metrics().reset();
+    cpp_service::Service service;
+    cpp_service::HttpServer server(0, &service);
+    std::thread thread([&server]() { server.run(); });
+    while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    {
+        simple_http::Client client("127.0.0.1", server.bound_port());
+        simple_http::Response response;
+        ASSERT_TRUE(client.request("POST", "/fuse", "{\"readings\": [1], \"algorithm\": \"x\\\"}, \\\"y\\\\\"}",
+                                   response));
+        EXPECT_EQ(response.status_code, 400);
+        EXPECT_NE(response.body.find("\"message\": \"Unknown algorithm: x\\\"}, \\\"y\\\\\""), std::string::npos)
+            << response.body;
+
+        ASSERT_TRUE(client.request("POST", "/fuse", "{\"a\\nb\" 1}", response));
+        EXPECT_EQ(response.status_code, 400);
+        EXPECT_NE(response.body.find("key 'a\\nb'"), std::string::npos) << response.body;
+    }
+
+    server.stop();
+    thread.join();
+}
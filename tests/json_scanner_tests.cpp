@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "json_scanner.hpp"
+
+using cpp_service::JsonScanner;
+
+namespace {
+
+// Extracts the top-level "readings" array the way /fuse does
+std::string extract_readings(const std::string& json, std::vector<double>& readings) {
+    JsonScanner scanner(json);
+    std::string key;
+    bool found = false;
+    if (scanner.begin_object()) {
+        while (scanner.next_member(key)) {
+            bool ok = (key == "readings") ? (found = true, scanner.read_number_array(readings)) : scanner.skip_value();
+            if (!ok) break;
+        }
+    }
+    if (!scanner.finish()) return scanner.error();
+    return found ? "" : "missing";
+}
+
+} // namespace
+
+TEST(JsonScannerTest, ReadsTopLevelReadings) {
+    std::vector<double> readings;
+    ASSERT_EQ(extract_readings("{\"readings\": [12.1, -11.9e0, 0, 1E2]}", readings), "");
+    EXPECT_EQ(readings, (std::vector<double>{12.1, -11.9, 0.0, 100.0}));
+}
+
+TEST(JsonScannerTest, IgnoresKeyInsideStringsAndNestedObjects) {
+    std::string json =
+        "{\"note\": \"\\\"readings\\\": [999]\","
+        " \"meta\": {\"readings\": [888], \"tags\": [\"a]\", {\"b\": \"}\"}]},"
+        " \"readings\": [1, 2, 3]}";
+
+    std::vector<double> readings;
+    ASSERT_EQ(extract_readings(json, readings), "");
+    EXPECT_EQ(readings, (std::vector<double>{1.0, 2.0, 3.0}));
+
+    readings.clear();
+    EXPECT_EQ(extract_readings("{\"meta\": {\"readings\": [1]}}", readings), "missing");
+}
+
+TEST(JsonScannerTest, SkipsLargeUnrelatedFields) {
+    std::string blob(10000, 'x');
+    std::string json = "{\"gateway\": {\"firmware\": \"" + blob + "\", \"history\": [";
+    for (int i = 0; i < 1000; ++i) {
+        json += (i ? ",{\"v\":[" : "{\"v\":[") + std::to_string(i) + "]}";
+    }
+    json += "]}, \"readings\": [5.5]}";
+
+    std::vector<double> readings;
+    ASSERT_EQ(extract_readings(json, readings), "");
+    EXPECT_EQ(readings, (std::vector<double>{5.5}));
+}
+
+TEST(JsonScannerTest, DecodesStringEscapes) {
+    std::string json = "{\"sensor\": \"rack\\t7 \\u00e9\\ud83d\\ude00\\\"\"}";
+    JsonScanner scanner(json);
+    std::string key;
+    std::string sensor;
+    ASSERT_TRUE(scanner.begin_object());
+    ASSERT_TRUE(scanner.next_member(key));
+    EXPECT_EQ(key, "sensor");
+    ASSERT_TRUE(scanner.read_string(sensor));
+    EXPECT_EQ(sensor, "rack\t7 \xc3\xa9\xf0\x9f\x98\x80\"");
+    EXPECT_FALSE(scanner.next_member(key));
+    EXPECT_TRUE(scanner.finish());
+}
+
+TEST(JsonScannerTest, IntegerArrays) {
+    std::string json = "[1700000000000, -5]";
+    JsonScanner scanner(json);
+    std::vector<int64_t> values;
+    ASSERT_TRUE(scanner.read_integer_array(values));
+    EXPECT_EQ(values, (std::vector<int64_t>{1700000000000, -5}));
+
+    std::string fractional_json = "[1.5]";
+    JsonScanner fractional(fractional_json);
+    EXPECT_FALSE(fractional.read_integer_array(values));
+    EXPECT_TRUE(fractional.failed());
+}
+
+TEST(JsonScannerTest, RejectsNonJsonNumbersAndMalformedDocuments) {
+    std::vector<double> readings;
+    EXPECT_NE(extract_readings("{\"readings\": [nan]}", readings), "");
+    EXPECT_NE(extract_readings("{\"readings\": [0x1p3]}", readings), "");
+    EXPECT_NE(extract_readings("{\"readings\": [+1]}", readings), "");
+    EXPECT_NE(extract_readings("{\"readings\": [1,]}", readings), "");
+    EXPECT_NE(extract_readings("{\"readings\": [1, 2]", readings), "");
+    EXPECT_NE(extract_readings("{\"meta\": {\"a\": [}, \"readings\": [1]}", readings), "");
+    EXPECT_NE(extract_readings("{\"readings\": [1]} trailing", readings), "");
+    EXPECT_NE(extract_readings("[1, 2]", readings), "");
+    // A skipped string cut off right after a backslash
+    EXPECT_EQ(extract_readings("{\"note\": \"abc\\", readings), "Unterminated JSON string");
+}
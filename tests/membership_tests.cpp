@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include "membership.hpp"
+#include "test_helpers.hpp"
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using cpp_service::Membership;
+using test_helpers::eventually;
+
+namespace {
+
+Membership::Config fast(std::vector<std::string> seeds = {}) {
+    Membership::Config config;
+    config.bind_host = "127.0.0.1";
+    config.protocol_period = std::chrono::milliseconds(50);
+    config.ack_timeout = std::chrono::milliseconds(20);
+    config.suspicion_periods = 4;
+    config.seeds = std::move(seeds);
+    return config;
+}
+
+size_t count_in_state(const Membership& node, Membership::State state) {
+    size_t count = 0;
+    for (const auto& member : node.members()) count += member.state == state ? 1 : 0;
+    return count;
+}
+
+bool is_dead(const Membership& node, const std::string& id) {
+    for (const auto& member : node.members()) {
+        if (member.id == id) return member.state == Membership::State::dead;
+    }
+    return false;
+}
+
+} // namespace
+
+TEST(MembershipTest, JoinsThroughOneSeedAndDetectsASilentFailure) {
+    std::vector<std::unique_ptr<Membership>> nodes;
+    nodes.push_back(std::make_unique<Membership>(fast()));
+    std::string seed = nodes[0]->id();
+
+    std::mutex mutex;
+    std::vector<Membership::Member> observed;
+    for (int i = 0; i < 4; ++i) {
+        Membership::Config config = fast({seed});
+        if (i == 0) {
+            config.on_change = [&](const Membership::Member& member) {
+                std::lock_guard<std::mutex> lock(mutex);
+                observed.push_back(member);
+            };
+        }
+        nodes.push_back(std::make_unique<Membership>(config));
+    }
+    ASSERT_TRUE(eventually([&] {
+        for (const auto& node : nodes) {
+            if (count_in_state(*node, Membership::State::alive) != 5) return false;
+        }
+        return true;
+    })) << "cluster did not converge";
+    EXPECT_EQ(nodes[1]->members().front().id, nodes[1]->id());
+
+    // Killed without a word: the others must notice on their own
+    std::string victim = nodes.back()->id();
+    nodes.pop_back();
+    auto killed = std::chrono::steady_clock::now();
+    ASSERT_TRUE(eventually([&] {
+        for (const auto& node : nodes) {
+            if (!is_dead(*node, victim)) return false;
+        }
+        return true;
+    })) << "failure not detected";
+    // Probed within two periods, suspected for four more, then spread
+    EXPECT_LT(std::chrono::steady_clock::now() - killed, std::chrono::milliseconds(1500));
+    for (const auto& node : nodes) {
+        EXPECT_EQ(count_in_state(*node, Membership::State::alive), 4u);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    bool saw_death = false;
+    for (const auto& member : observed) saw_death |= member.id == victim && member.state == Membership::State::dead;
+    EXPECT_TRUE(saw_death);
+}
+
+TEST(MembershipTest, GossipStaysCheapAtSteadyState) {
+    std::vector<std::unique_ptr<Membership>> nodes;
+    nodes.push_back(std::make_unique<Membership>(fast()));
+    for (int i = 0; i < 5; ++i) nodes.push_back(std::make_unique<Membership>(fast({nodes[0]->id()})));
+    ASSERT_TRUE(eventually([&] { return count_in_state(*nodes[5], Membership::State::alive) == 6; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));  // let join news die down
+
+    Membership::Stats before = nodes[3]->stats();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    Membership::Stats after = nodes[3]->stats();
+    // One ping a period plus the acks for the others' pings: about 40 here
+    EXPECT_LE(after.messages_sent - before.messages_sent, 60u);
+    EXPECT_GE(after.probes - before.probes, 15u);
+    EXPECT_EQ(after.suspicions, 0u);
+    EXPECT_LT(after.bytes_sent - before.bytes_sent, 60u * 64);
+}
+
+// A sync request (type 5) with no updates, in the wire layout of membership.cpp
+std::string sync_request(const std::string& sender) {
+    std::string packet = "SWM1";
+    packet.push_back(5);
+    packet.append(4, '\0');  // seq
+    packet.push_back(static_cast<char>(sender.size()));
+    packet.push_back('\0');
+    packet += sender;
+    packet.append(4, '\0');  // incarnation
+    packet.append(2, '\0');  // http port
+    packet.push_back('\0');  // no updates
+    return packet;
+}
+
+TEST(MembershipTest, AnswersFewSyncRequestsAndOnlyToTheirSource) {
+    std::vector<std::unique_ptr<Membership>> nodes;
+    nodes.push_back(std::make_unique<Membership>(fast()));
+    for (int i = 0; i < 3; ++i) nodes.push_back(std::make_unique<Membership>(fast({nodes[0]->id()})));
+    ASSERT_TRUE(eventually([&] { return count_in_state(*nodes[0], Membership::State::alive) == 4; }));
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_NE(fd, -1);
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &local.sin_addr);
+    socklen_t length = sizeof(local);
+    ASSERT_EQ(bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)), 0);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length);
+    sockaddr_in target = local;
+    target.sin_port = htons(nodes[0]->port());
+
+    // Thirty strangers ask at once, one of them claiming to be another node:
+    // the lists go to this socket, and only a few of them
+    std::string self = "127.0.0.1:" + std::to_string(ntohs(local.sin_port));
+    for (int i = 0; i < 30; ++i) {
+        std::string packet = sync_request(i == 0 ? nodes[1]->id() : i == 1 ? self : "10.9.9." + std::to_string(i) + ":7");
+        sendto(fd, packet.data(), packet.size(), 0, reinterpret_cast<sockaddr*>(&target), sizeof(target));
+    }
+    int replies = 0;
+    char buffer[2048];
+    pollfd poll_fd{fd, POLLIN, 0};
+    while (poll(&poll_fd, 1, 30) > 0 && recv(fd, buffer, sizeof(buffer), 0) > 0) replies++;
+    close(fd);
+    EXPECT_GE(replies, 1);
+    EXPECT_LE(replies, 8);
+    // The impostor did not take over the real member's address
+    for (const auto& member : nodes[0]->members()) {
+        if (member.id == nodes[1]->id()) EXPECT_EQ(member.state, Membership::State::alive);
+    }
+}
+
+TEST(MembershipTest, SeparateProcessesSurviveAKilledPeer) {
+    // Forked while this process runs no other thread
+    constexpr int kChildren = 3;
+    constexpr uint16_t kBasePort = 47810;
+    std::vector<pid_t> children;
+    for (int i = 0; i < kChildren; ++i) {
+        pid_t pid = fork();
+        ASSERT_NE(pid, -1);
+        if (pid == 0) {
+            Membership::Config config = fast({"127.0.0.1:" + std::to_string(kBasePort)});
+            config.port = static_cast<uint16_t>(kBasePort + 1 + i);
+            Membership node(config);
+            for (;;) pause();
+        }
+        children.push_back(pid);
+    }
+
+    Membership::Config config = fast();
+    config.port = kBasePort;
+    Membership observer(config);
+    bool converged = eventually([&] { return count_in_state(observer, Membership::State::alive) == kChildren + 1; });
+
+    kill(children[1], SIGKILL);
+    std::string victim = "127.0.0.1:" + std::to_string(kBasePort + 2);
+    bool detected = converged && eventually([&] { return is_dead(observer, victim); });
+    size_t alive = count_in_state(observer, Membership::State::alive);
+
+    for (pid_t pid : children) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+    EXPECT_TRUE(converged);
+    EXPECT_TRUE(detected);
+    EXPECT_EQ(alive, static_cast<size_t>(kChildren));
+}
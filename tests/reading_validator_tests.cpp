@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "reading_validator.hpp"
+#include "json_scanner.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+using cpp_service::InvalidReadingPolicy;
+using cpp_service::InvalidReadingReason;
+using cpp_service::JsonScanner;
+using cpp_service::ReadingLimits;
+using cpp_service::ReadingValidator;
+
+namespace {
+
+const double kNan = std::numeric_limits<double>::quiet_NaN();
+const double kInf = std::numeric_limits<double>::infinity();
+
+ReadingLimits limits(InvalidReadingPolicy policy, double min_value = -kInf, double max_value = kInf) {
+    ReadingLimits result;
+    result.policy = policy;
+    result.min_value = min_value;
+    result.max_value = max_value;
+    return result;
+}
+
+std::vector<double> admit_all(ReadingValidator& validator, std::vector<double> values) {
+    std::vector<double> kept;
+    for (double value : values) {
+        if (validator.admit(value)) kept.push_back(value);
+    }
+    return kept;
+}
+
+} // namespace
+
+TEST(ReadingValidatorTest, RejectReportsTheFirstInvalidIndex) {
+    ReadingValidator validator;
+    EXPECT_EQ(admit_all(validator, {1.0, 2.0, kInf, kNan}), (std::vector<double>{1.0, 2.0}));
+    EXPECT_TRUE(validator.rejected());
+    EXPECT_EQ(validator.error(), "Invalid reading at index 2: infinite");
+    EXPECT_EQ(validator.count(InvalidReadingReason::infinite), 1u);
+    EXPECT_EQ(validator.count(InvalidReadingReason::nan), 1u);
+}
+
+TEST(ReadingValidatorTest, DropRemovesParallelEntries) {
+    ReadingValidator validator(limits(InvalidReadingPolicy::drop, 0.0, 100.0));
+    EXPECT_EQ(admit_all(validator, {10.0, kNan, 20.0, 150.0, -kInf, 30.0}), (std::vector<double>{10.0, 20.0, 30.0}));
+    EXPECT_FALSE(validator.rejected());
+    EXPECT_EQ(validator.dropped(), (std::vector<size_t>{1, 3, 4}));
+    EXPECT_EQ(validator.count(InvalidReadingReason::out_of_range), 1u);
+
+    std::vector<int64_t> timestamps = {1, 2, 3, 4, 5, 6};
+    cpp_service::erase_dropped(validator, timestamps);
+    EXPECT_EQ(timestamps, (std::vector<int64_t>{1, 3, 6}));
+
+    // A mismatched container is left for the caller's length check
+    std::vector<double> weights = {1.0, 1.0};
+    cpp_service::erase_dropped(validator, weights);
+    EXPECT_EQ(weights.size(), 2u);
+
+    validator.begin_series();
+    EXPECT_EQ(validator.seen(), 0u);
+    EXPECT_TRUE(validator.dropped().empty());
+    EXPECT_EQ(validator.count(InvalidReadingReason::nan), 1u);  // counts accumulate
+}
+
+TEST(ReadingValidatorTest, ClampPullsOntoFiniteBounds) {
+    ReadingValidator bounded(limits(InvalidReadingPolicy::clamp, -40.0, 125.0));
+    EXPECT_EQ(admit_all(bounded, {-50.0, 20.0, 200.0, kInf, -kInf, kNan}),
+              (std::vector<double>{-40.0, 20.0, 125.0, 125.0, -40.0}));
+    EXPECT_EQ(bounded.dropped(), (std::vector<size_t>{5}));
+
+    // Without a finite bound there is nothing to clamp an infinity onto
+    ReadingValidator open(limits(InvalidReadingPolicy::clamp, 0.0));
+    EXPECT_EQ(admit_all(open, {-1.0, kInf, 5.0}), (std::vector<double>{0.0, 5.0}));
+    EXPECT_EQ(open.dropped(), (std::vector<size_t>{1}));
+}
+
+TEST(ReadingValidatorTest, PolicyNames) {
+    InvalidReadingPolicy policy = InvalidReadingPolicy::reject;
+    EXPECT_TRUE(cpp_service::parse_invalid_reading_policy("clamp", policy));
+    EXPECT_EQ(policy, InvalidReadingPolicy::clamp);
+    EXPECT_STREQ(cpp_service::to_string(InvalidReadingPolicy::drop), "drop");
+    EXPECT_FALSE(cpp_service::parse_invalid_reading_policy("ignore", policy));
+}
+
+TEST(ReadingValidatorTest, JsonOverflowIsJudgedInsteadOfStored) {
+    // 1e999 is valid JSON but not a finite double
+    std::string json = "[1.5, 1e999, -1e999, 2.5]";
+    std::vector<double> values;
+
+    JsonScanner rejecting_scanner(json);
+    ReadingValidator rejecting;
+    EXPECT_FALSE(rejecting_scanner.read_number_array(values, rejecting));
+    EXPECT_EQ(rejecting_scanner.error(), "Invalid reading at index 1: infinite");
+
+    values.clear();
+    JsonScanner clamping_scanner(json);
+    ReadingValidator clamping(limits(InvalidReadingPolicy::clamp, -100.0, 100.0));
+    ASSERT_TRUE(clamping_scanner.read_number_array(values, clamping));
+    EXPECT_TRUE(clamping_scanner.finish());
+    EXPECT_EQ(values, (std::vector<double>{1.5, 100.0, -100.0, 2.5}));
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "reproducible_sum.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using cpp_service::ReproducibleSum;
+
+namespace {
+
+std::vector<double> mixed_magnitudes(size_t count) {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> mantissa(-1.0, 1.0);
+    std::uniform_int_distribution<int> exponent(-40, 40);
+    std::vector<double> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        values.push_back(std::ldexp(mantissa(rng), exponent(rng)));
+    }
+    return values;
+}
+
+double sum_of(const std::vector<double>& values) {
+    ReproducibleSum sum;
+    sum.add(values.data(), values.size());
+    return sum.value();
+}
+
+} // namespace
+
+TEST(ReproducibleSumTest, ExactWhereNaiveSummationLosesBits) {
+    EXPECT_EQ(sum_of({1e16, 1.0, -1e16}), 1.0);
+    // The doubles nearest 0.1, 0.2 and 0.3 differ by exactly 2^-55
+    EXPECT_EQ(sum_of({0.1, 0.2, -0.3}), std::ldexp(1.0, -55));
+    EXPECT_EQ(sum_of({std::numeric_limits<double>::denorm_min(), 1.0, -1.0}),
+              std::numeric_limits<double>::denorm_min());
+    EXPECT_EQ(sum_of({std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                      -std::numeric_limits<double>::max()}),
+              std::numeric_limits<double>::max());
+    EXPECT_EQ(sum_of({}), 0.0);
+}
+
+TEST(ReproducibleSumTest, RoundsToNearestEven) {
+    // 2^53 + 1 is a tie between 2^53 and 2^53 + 2; ties go to the even mantissa
+    double two53 = std::ldexp(1.0, 53);
+    EXPECT_EQ(sum_of({two53, 1.0}), two53);
+    EXPECT_EQ(sum_of({two53, 3.0}), two53 + 4.0);
+    // Anything past the halfway point rounds up
+    EXPECT_EQ(sum_of({two53, 1.0, std::ldexp(1.0, -60)}), two53 + 2.0);
+    EXPECT_EQ(sum_of({-two53, -1.0, -std::ldexp(1.0, -60)}), -(two53 + 2.0));
+
+    // Across the subnormal boundary the result keeps fewer bits and is
+    // exact; just above it, it rounds once at the normal precision
+    double tiny = std::numeric_limits<double>::denorm_min();
+    double smallest_normal = std::numeric_limits<double>::min();
+    EXPECT_EQ(sum_of({smallest_normal, -tiny}), std::nextafter(smallest_normal, 0.0));
+    EXPECT_EQ(sum_of({smallest_normal, smallest_normal, tiny}), 2.0 * smallest_normal);
+    EXPECT_EQ(sum_of({smallest_normal, smallest_normal, 3.0 * tiny}), 2.0 * smallest_normal + 4.0 * tiny);
+    // Rounding up past the largest double overflows rather than saturating
+    double max = std::numeric_limits<double>::max();
+    EXPECT_EQ(sum_of({max, std::ldexp(1.0, 970)}), std::numeric_limits<double>::infinity());
+    EXPECT_EQ(sum_of({max, std::ldexp(1.0, 969)}), max);
+}
+
+TEST(ReproducibleSumTest, IndependentOfOrderAndChunking) {
+    std::vector<double> values = mixed_magnitudes(10000);
+    double expected = sum_of(values);
+
+    std::mt19937_64 rng(7);
+    for (int round = 0; round < 5; ++round) {
+        std::shuffle(values.begin(), values.end(), rng);
+        EXPECT_EQ(sum_of(values), expected);
+
+        // Partial sums over uneven chunks, merged in reverse order
+        std::vector<ReproducibleSum> partials;
+        for (size_t start = 0; start < values.size(); start += 97 + round * 13) {
+            size_t count = std::min<size_t>(97 + round * 13, values.size() - start);
+            partials.emplace_back();
+            partials.back().add(values.data() + start, count);
+        }
+        ReproducibleSum merged;
+        for (auto it = partials.rbegin(); it != partials.rend(); ++it) {
+            merged.merge(*it);
+        }
+        EXPECT_EQ(merged.value(), expected);
+    }
+}
+
+TEST(ReproducibleSumTest, PropagatesNonFiniteValues) {
+    double inf = std::numeric_limits<double>::infinity();
+    EXPECT_EQ(sum_of({1.0, inf}), inf);
+    EXPECT_EQ(sum_of({-inf, 1.0}), -inf);
+    EXPECT_TRUE(std::isnan(sum_of({inf, -inf})));
+    EXPECT_TRUE(std::isnan(sum_of({1.0, std::numeric_limits<double>::quiet_NaN()})));
+
+    ReproducibleSum sum;
+    sum.add(std::numeric_limits<double>::quiet_NaN());
+    sum.reset();
+    sum.add(2.5);
+    EXPECT_EQ(sum.value(), 2.5);
+}
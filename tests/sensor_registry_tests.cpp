@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include "sensor_registry.hpp"
+#include <map>
+#include <random>
+#include <string>
+
+using cpp_service::SensorRegistry;
+
+namespace {
+
+SensorRegistry::Config window(int64_t stale_after_ms, int64_t tick_ms = 100) {
+    SensorRegistry::Config config;
+    config.stale_after_ms = stale_after_ms;
+    config.tick_ms = tick_ms;
+    return config;
+}
+
+// Arbitrary clock origin, as a steady clock would give
+constexpr int64_t kStart = 987654300;
+
+} // namespace
+
+TEST(SensorRegistryTest, ExpiresSilentSensorsAndRevivesThem) {
+    SensorRegistry registry(window(1000));
+    EXPECT_TRUE(registry.touch("a", kStart));
+    EXPECT_TRUE(registry.touch("b", kStart + 500));
+    EXPECT_EQ(registry.counts(kStart + 999).stale, 0u);
+    EXPECT_EQ(registry.counts(kStart + 1000).stale, 1u);
+    EXPECT_EQ(registry.counts(kStart + 1500).stale, 2u);
+
+    registry.touch("a", kStart + 1600);
+    SensorRegistry::Counts counts = registry.counts(kStart + 1600);
+    EXPECT_EQ(counts.tracked, 2u);
+    EXPECT_EQ(counts.stale, 1u);
+    EXPECT_EQ(counts.expirations, 2u);
+
+    auto stale = registry.list(kStart + 1600, true, 10);
+    ASSERT_EQ(stale.size(), 1u);
+    EXPECT_EQ(stale[0].id, "b");
+    EXPECT_TRUE(stale[0].stale);
+
+    // Revived sensors expire again a full window after their last touch
+    EXPECT_EQ(registry.counts(kStart + 2599).stale, 1u);
+    EXPECT_EQ(registry.counts(kStart + 2600).stale, 2u);
+    EXPECT_EQ(registry.counts(kStart + 2600).expirations, 3u);
+}
+
+TEST(SensorRegistryTest, TouchesDeferExpiry) {
+    SensorRegistry registry(window(1000));
+    for (int64_t t = 0; t <= 1800; t += 900) registry.touch("a", kStart + t);
+    EXPECT_EQ(registry.counts(kStart + 2799).stale, 0u);
+    SensorRegistry::Counts counts = registry.counts(kStart + 2800);
+    EXPECT_EQ(counts.stale, 1u);
+    EXPECT_EQ(counts.expirations, 1u);
+    EXPECT_EQ(registry.list(kStart + 2800, false, 1)[0].updates, 3u);
+}
+
+TEST(SensorRegistryTest, LongWindowsCascadeThroughEveryLevel) {
+    // 3 days and 30 days at 100 ms ticks: the top level, and beyond the wheel
+    for (int64_t days : {3, 30}) {
+        int64_t stale_after = days * 24 * 3600 * 1000;
+        SensorRegistry registry(window(stale_after));
+        registry.touch("a", kStart);
+        registry.touch("b", kStart + stale_after / 2);
+        EXPECT_EQ(registry.counts(kStart + stale_after - 100).stale, 0u) << days;
+        EXPECT_EQ(registry.counts(kStart + stale_after).stale, 1u) << days;
+        EXPECT_EQ(registry.counts(kStart + stale_after + stale_after / 2 - 100).stale, 1u) << days;
+        EXPECT_EQ(registry.counts(kStart + stale_after + stale_after / 2).stale, 2u) << days;
+    }
+}
+
+TEST(SensorRegistryTest, MatchesFullScanUnderRandomTraffic) {
+    std::mt19937_64 rng(117);
+    // Windows that land on wheel levels 0-1, 1 and 2
+    for (auto [stale_after, tick] : {std::pair<int64_t, int64_t>{250, 10}, {5000, 10}, {400000, 100}}) {
+        SensorRegistry registry(window(stale_after, tick));
+        std::map<std::string, int64_t> last_seen;
+        int64_t now = kStart;
+        for (int step = 0; step < 20000; ++step) {
+            now += static_cast<int64_t>(rng() % (stale_after / 20 + 2));
+            if (rng() % 500 == 0) now += stale_after * static_cast<int64_t>(rng() % 3);  // idle gaps
+            std::string id = "s" + std::to_string(rng() % 300);
+            registry.touch(id, now);
+            last_seen[id] = now;
+            if (step % 97 == 0) {
+                // Stale once the window has passed by the last whole tick
+                int64_t tick_time = now / tick * tick;
+                size_t expected = 0;
+                for (const auto& [name, seen] : last_seen) expected += seen + stale_after <= tick_time;
+                ASSERT_EQ(registry.counts(now).stale, expected) << "step " << step << " window " << stale_after;
+            }
+        }
+        EXPECT_EQ(registry.counts(now).tracked, last_seen.size());
+    }
+}
+
+TEST(SensorRegistryTest, ListsOldestFirstAndCapsTracking) {
+    SensorRegistry::Config config = window(1000);
+    config.max_sensors = 3;
+    SensorRegistry registry(config);
+    EXPECT_TRUE(registry.touch("c", kStart + 30));
+    EXPECT_TRUE(registry.touch("a", kStart + 10));
+    EXPECT_TRUE(registry.touch("b", kStart + 20));
+    EXPECT_FALSE(registry.touch("d", kStart + 40));
+    EXPECT_TRUE(registry.touch("a", kStart + 50));  // known sensors still update
+
+    auto all = registry.list(kStart + 60, false, 10);
+    ASSERT_EQ(all.size(), 3u);
+    EXPECT_EQ(all[0].id, "b");
+    EXPECT_EQ(all[1].id, "c");
+    EXPECT_EQ(all[2].id, "a");
+    auto two = registry.list(kStart + 60, false, 2);
+    ASSERT_EQ(two.size(), 2u);
+    EXPECT_EQ(two[1].id, "c");
+    EXPECT_TRUE(registry.list(kStart + 60, true, 10).empty());
+
+    SensorRegistry::Counts counts = registry.counts(kStart + 60);
+    EXPECT_EQ(counts.tracked, 3u);
+    EXPECT_EQ(counts.untracked, 1u);
+}
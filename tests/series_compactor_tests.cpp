@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+#include "series_compactor.hpp"
+#include "downsample.hpp"
+#include "test_helpers.hpp"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using cpp_service::SeriesCompactor;
+using cpp_service::SeriesStore;
+using test_helpers::segments_of;
+
+namespace {
+
+SeriesCompactor::Config manual() {
+    SeriesCompactor::Config config;
+    config.threads = 0;
+    config.bytes_per_second = 0.0;  // unthrottled
+    return config;
+}
+
+void fill(SeriesStore& store, const std::string& sensor, int64_t from, int64_t count) {
+    for (int64_t t = from; t < from + count; ++t) {
+        store.append(sensor, 1000 * t, std::round(std::sin(static_cast<double>(t) / 20.0) * 8.0) / 4.0);
+    }
+}
+
+std::vector<SeriesStore::Point> points_of(const SeriesStore& store, const std::string& sensor) {
+    SeriesStore::Snapshot snapshot;
+    store.snapshot(sensor, snapshot);
+    std::vector<SeriesStore::Point> points;
+    for (const auto& stored : snapshot.segments) {
+        auto segment = SeriesStore::columns(stored);
+        for (size_t i = 0; i < segment->size(); ++i) points.push_back({segment->timestamps[i], segment->values[i]});
+    }
+    return points;
+}
+
+} // namespace
+
+TEST(SeriesCompactorTest, MergesOldSegmentsAndKeepsTheData) {
+    SeriesStore store(segments_of(100));
+    fill(store, "s", 0, 2050);
+    auto before = points_of(store, "s");
+
+    SeriesCompactor::Config config = manual();
+    config.merge_points = 1000;
+    config.hot_segments = 2;
+    SeriesCompactor compactor(store, config);
+    compactor.compact_now();
+
+    // 20 sealed: the oldest 18 become 1000 + 800, the newest 2 stay plain
+    SeriesStore::Snapshot snapshot;
+    ASSERT_TRUE(store.snapshot("s", snapshot));
+    ASSERT_EQ(snapshot.segments.size(), 5u);  // 2 compacted, 2 hot, the head
+    EXPECT_TRUE(snapshot.segments[0]->compacted());
+    EXPECT_EQ(snapshot.segments[0]->size(), 1000u);
+    EXPECT_EQ(snapshot.segments[1]->size(), 800u);
+    EXPECT_FALSE(snapshot.segments[2]->compacted());
+
+    auto after = points_of(store, "s");
+    ASSERT_EQ(after.size(), before.size());
+    for (size_t i = 0; i < before.size(); ++i) {
+        ASSERT_EQ(after[i].timestamp, before[i].timestamp);
+        ASSERT_EQ(after[i].value, before[i].value);
+    }
+
+    SeriesStore::Stats stats = store.stats();
+    EXPECT_EQ(stats.compacted_segments, 2u);
+    EXPECT_LT(snapshot.segments[0]->bytes(), 1000u * 16 / 4);
+    EXPECT_LT(stats.bytes, 2050u * 16 / 2);
+    SeriesCompactor::Stats progress = compactor.stats();
+    EXPECT_EQ(progress.merged_segments, 18u);
+    EXPECT_EQ(progress.written_segments, 2u);
+    EXPECT_GT(progress.bytes_read, progress.bytes_written);
+    EXPECT_EQ(progress.backlog_segments, 0u);
+
+    // Segments sealed later are folded into the partial one
+    fill(store, "s", 2050, 200);
+    compactor.compact_now();
+    ASSERT_TRUE(store.snapshot("s", snapshot));
+    EXPECT_EQ(snapshot.segments[1]->size(), 1000u);
+    EXPECT_EQ(points_of(store, "s").size(), 2250u);
+
+    auto lttb = cpp_service::downsample(snapshot, 500000, 1500000, 50, cpp_service::DownsampleMode::lttb);
+    EXPECT_EQ(lttb.in_range, 1001u);
+    EXPECT_EQ(lttb.points.front().timestamp, 500000);
+    EXPECT_EQ(lttb.points.back().timestamp, 1500000);
+}
+
+TEST(SeriesCompactorTest, AppliesRetentionByLongestPrefix) {
+    SeriesStore store(segments_of(10));
+    fill(store, "lab/a", 0, 100);       // 0 .. 99 s
+    fill(store, "lab/keep/b", 0, 100);
+    fill(store, "plant/c", 0, 100);
+    fill(store, "quiet", 0, 5);         // never seals
+
+    SeriesCompactor::Config config = manual();
+    config.merge_points = 1;  // retention only
+    config.retention_ms = 30000;
+    config.retention_by_prefix = {{"lab/", 60000}, {"lab/keep/", 0}};
+    config.clock = []() { return int64_t{100000}; };
+    SeriesCompactor compactor(store, config);
+    EXPECT_EQ(compactor.retention_for("lab/keep/b"), 0);
+    compactor.compact_now();
+
+    EXPECT_EQ(points_of(store, "lab/a").front().timestamp, 40000);
+    EXPECT_EQ(points_of(store, "lab/keep/b").size(), 100u);
+    EXPECT_EQ(points_of(store, "plant/c").front().timestamp, 70000);
+    EXPECT_TRUE(points_of(store, "quiet").empty());
+    EXPECT_EQ(compactor.stats().expired_points, 40u + 70u + 5u);
+
+    // Late points into an expired range are not resurrected
+    EXPECT_FALSE(store.append("plant/c", 1000, 1.0));
+}
+
+TEST(SeriesCompactorTest, TokenBucketPacesTheWork) {
+    SeriesStore store(segments_of(1000));
+    fill(store, "s", 0, 20000);  // ~320 KB of plain columns to read
+
+    SeriesCompactor::Config config = manual();
+    config.bytes_per_second = 2.0 * 1024 * 1024;
+    config.burst_bytes = 16 * 1024;
+    config.hot_segments = 0;
+    SeriesCompactor compactor(store, config);
+    auto start = std::chrono::steady_clock::now();
+    compactor.compact_now();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    SeriesCompactor::Stats stats = compactor.stats();
+    double paid = static_cast<double>(stats.bytes_read + stats.bytes_written);
+    EXPECT_GE(seconds, (paid - config.burst_bytes) / config.bytes_per_second * 0.9);
+    EXPECT_GT(stats.throttled_ms, 0u);
+}
+
+TEST(SeriesCompactorTest, BackgroundWorkersRaceIngestSafely) {
+    SeriesStore store(segments_of(64));
+    SeriesCompactor::Config config;
+    config.threads = 2;
+    config.interval = std::chrono::milliseconds(1);
+    config.merge_points = 512;
+    config.hot_segments = 1;
+    config.bytes_per_second = 0.0;
+    SeriesCompactor compactor(store, config);
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; ++w) {
+        writers.emplace_back([&store, w]() {
+            for (int64_t t = 0; t < 20000; ++t) store.append("s" + std::to_string(w), t, static_cast<double>(t));
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    // Passes may all have run before anything was sealed, so wait for one that merged
+    ASSERT_TRUE(test_helpers::eventually([&store] { return store.stats().compacted_segments > 0; }));
+
+    for (const char* sensor : {"s0", "s1"}) {
+        auto points = points_of(store, sensor);
+        ASSERT_EQ(points.size(), 20000u);
+        for (size_t i = 0; i < points.size(); ++i) {
+            ASSERT_EQ(points[i].timestamp, static_cast<int64_t>(i));
+            ASSERT_EQ(points[i].value, static_cast<double>(i));
+        }
+    }
+}
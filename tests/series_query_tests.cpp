@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include "series_query.hpp"
+#include "series_compactor.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+using cpp_service::SeriesAggregate;
+using cpp_service::SeriesQuery;
+using cpp_service::SeriesQueryResult;
+using cpp_service::SeriesStore;
+
+namespace {
+
+struct Sample {
+    std::string sensor;
+    int64_t timestamp;
+    double value;
+};
+
+// Random series over small segments, the older half compacted
+std::vector<Sample> populate(SeriesStore& store) {
+    std::mt19937_64 rng(7);
+    std::vector<Sample> samples;
+    for (const char* sensor : {"lab/a", "lab/b", "plant/c"}) {
+        int64_t t = -5000;
+        for (int i = 0; i < 3000; ++i) {
+            t += 1 + static_cast<int64_t>(rng() % 20);
+            double value = std::round(std::normal_distribution<double>(20.0, 5.0)(rng) * 100.0) / 100.0;
+            store.append(sensor, t, value);
+            samples.push_back({sensor, t, value});
+        }
+    }
+    cpp_service::SeriesCompactor::Config config;
+    config.threads = 0;
+    config.bytes_per_second = 0.0;
+    config.merge_points = 500;
+    config.hot_segments = 10;
+    cpp_service::SeriesCompactor(store, config).compact_now();
+    return samples;
+}
+
+// The same query, answered by sorting the raw samples into groups
+SeriesQueryResult brute_force(const std::vector<Sample>& samples, const SeriesQuery& query) {
+    std::map<std::pair<std::string, int64_t>, std::vector<Sample>> groups;
+    for (const auto& sample : samples) {
+        if (sample.sensor.compare(0, query.prefix.size(), query.prefix) != 0) continue;
+        if (sample.timestamp < query.from || sample.timestamp > query.to) continue;
+        int64_t bucket = query.step > 0
+            ? static_cast<int64_t>(std::floor(static_cast<double>(sample.timestamp) / query.step)) * query.step : 0;
+        groups[{query.by_sensor ? sample.sensor : "", bucket}].push_back(sample);
+    }
+    SeriesQueryResult result;
+    for (auto& entry : groups) {
+        if (result.groups.empty() || result.groups.back().sensor != entry.first.first) {
+            result.groups.push_back({entry.first.first, {}});
+        }
+        std::vector<double> values;
+        int64_t first = INT64_MAX;
+        for (const auto& sample : entry.second) {
+            values.push_back(sample.value);
+            first = std::min(first, sample.timestamp);
+        }
+        std::sort(values.begin(), values.end());
+        SeriesQueryResult::Bucket bucket;
+        bucket.start = query.step > 0 ? entry.first.second : first;
+        bucket.count = values.size();
+        double sum = 0.0;
+        for (double v : values) sum += v;
+        double position = query.quantile * static_cast<double>(values.size() - 1);
+        size_t low = static_cast<size_t>(position);
+        double quantile = values[low] +
+            (low + 1 < values.size() ? (position - static_cast<double>(low)) * (values[low + 1] - values[low]) : 0.0);
+        switch (query.aggregate) {
+            case SeriesAggregate::count: bucket.value = static_cast<double>(values.size()); break;
+            case SeriesAggregate::sum: bucket.value = sum; break;
+            case SeriesAggregate::avg: bucket.value = sum / static_cast<double>(values.size()); break;
+            case SeriesAggregate::min: bucket.value = values.front(); break;
+            case SeriesAggregate::max: bucket.value = values.back(); break;
+            case SeriesAggregate::quantile: bucket.value = quantile; break;
+        }
+        result.groups.back().buckets.push_back(bucket);
+    }
+    return result;
+}
+
+void expect_same(const SeriesQueryResult& expected, const SeriesQueryResult& actual) {
+    ASSERT_EQ(expected.groups.size(), actual.groups.size());
+    for (size_t g = 0; g < expected.groups.size(); ++g) {
+        EXPECT_EQ(expected.groups[g].sensor, actual.groups[g].sensor);
+        ASSERT_EQ(expected.groups[g].buckets.size(), actual.groups[g].buckets.size());
+        for (size_t b = 0; b < expected.groups[g].buckets.size(); ++b) {
+            const auto& want = expected.groups[g].buckets[b];
+            const auto& got = actual.groups[g].buckets[b];
+            EXPECT_EQ(want.start, got.start);
+            EXPECT_EQ(want.count, got.count);
+            EXPECT_NEAR(want.value, got.value, 1e-9 * std::max(1.0, std::abs(want.value)));
+        }
+    }
+}
+
+} // namespace
+
+TEST(SeriesQueryTest, MatchesBruteForceForEveryAggregate) {
+    SeriesStore::Config config;
+    config.segment_points = 100;
+    SeriesStore store(config);
+    std::vector<Sample> samples = populate(store);
+    ASSERT_GT(store.stats().compacted_segments, 0u);
+    cpp_service::ThreadPool pool(3);
+
+    for (SeriesAggregate aggregate : {SeriesAggregate::count, SeriesAggregate::sum, SeriesAggregate::avg,
+                                      SeriesAggregate::min, SeriesAggregate::max, SeriesAggregate::quantile}) {
+        for (int64_t step : {int64_t{0}, int64_t{1000}, int64_t{7777}}) {
+            for (bool by_sensor : {true, false}) {
+                SeriesQuery query;
+                query.aggregate = aggregate;
+                query.step = step;
+                query.by_sensor = by_sensor;
+                query.from = -2000;
+                query.to = 20000;
+                query.quantile = 0.9;
+                SCOPED_TRACE(std::string(cpp_service::series_aggregate_name(aggregate)) + " step " +
+                             std::to_string(step) + (by_sensor ? " by sensor" : " overall"));
+                SeriesQueryResult expected = brute_force(samples, query);
+                expect_same(expected, cpp_service::run_series_query(store, query, &pool));
+                expect_same(expected, cpp_service::run_series_query(store, query, nullptr));
+            }
+        }
+    }
+}
+
+TEST(SeriesQueryTest, PushesTheRangeAndPrefixDown) {
+    SeriesStore::Config config;
+    config.segment_points = 100;
+    SeriesStore store(config);
+    std::vector<Sample> samples = populate(store);
+
+    SeriesQuery query;
+    query.prefix = "lab/";
+    query.from = 1000;
+    query.to = 3000;
+    query.aggregate = SeriesAggregate::count;
+    SeriesQueryResult result = cpp_service::run_series_query(store, query, nullptr);
+    expect_same(brute_force(samples, query), result);
+    ASSERT_EQ(result.groups.size(), 2u);
+    EXPECT_EQ(result.groups[1].sensor, "lab/b");
+
+    // Only segments overlapping the two-second window are read
+    EXPECT_GT(result.segments_skipped, 5 * result.segments_scanned);
+    EXPECT_EQ(result.points_scanned, result.groups[0].buckets[0].count + result.groups[1].buckets[0].count);
+
+    query.from = 1000000;
+    query.to = 2000000;
+    result = cpp_service::run_series_query(store, query, nullptr);
+    EXPECT_TRUE(result.groups.empty());
+    EXPECT_EQ(result.segments_scanned, 0u);
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include "series_store.hpp"
+#include "test_helpers.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+using cpp_service::SeriesStore;
+using test_helpers::segments_of;
+
+namespace {
+
+std::vector<int64_t> timestamps_of(const SeriesStore::Snapshot& snapshot) {
+    std::vector<int64_t> timestamps;
+    for (const auto& segment : snapshot.segments) {
+        timestamps.insert(timestamps.end(), segment->timestamps.begin(), segment->timestamps.end());
+    }
+    return timestamps;
+}
+
+} // namespace
+
+TEST(SeriesStoreTest, SealsSegmentsAndSnapshotsTheHead) {
+    SeriesStore store(segments_of(4));
+    for (int64_t t = 0; t < 10; ++t) {
+        EXPECT_TRUE(store.append("s", 1000 + t, static_cast<double>(t)));
+    }
+    SeriesStore::Snapshot snapshot;
+    ASSERT_TRUE(store.snapshot("s", snapshot));
+    ASSERT_EQ(snapshot.segments.size(), 3u);
+    EXPECT_EQ(snapshot.segments[0]->size(), 4u);
+    EXPECT_EQ(snapshot.segments[2]->size(), 2u);
+    EXPECT_EQ(snapshot.points(), 10u);
+    EXPECT_EQ(snapshot.segments[2]->values.back(), 9.0);
+
+    SeriesStore::Stats stats = store.stats();
+    EXPECT_EQ(stats.sensors, 1u);
+    EXPECT_EQ(stats.points, 10u);
+    EXPECT_EQ(stats.segments, 2u);
+
+    // A snapshot is unaffected by later appends
+    store.append("s", 2000, 1.0);
+    EXPECT_EQ(snapshot.points(), 10u);
+    EXPECT_FALSE(store.snapshot("missing", snapshot));
+    EXPECT_TRUE(snapshot.segments.empty());
+}
+
+TEST(SeriesStoreTest, SortsLatePointsIntoTheHeadAndDropsOlderOnes) {
+    SeriesStore store(segments_of(4));
+    for (int64_t t : {10, 20, 30, 40}) store.append("s", t, 0.0);  // sealed
+    EXPECT_TRUE(store.append("s", 60, 0.0));
+    EXPECT_TRUE(store.append("s", 50, 0.0));
+    EXPECT_TRUE(store.append("s", 40, 0.0));  // ties the sealed segment's last point
+    EXPECT_FALSE(store.append("s", 35, 0.0));
+
+    SeriesStore::Snapshot snapshot;
+    ASSERT_TRUE(store.snapshot("s", snapshot));
+    EXPECT_EQ(timestamps_of(snapshot), (std::vector<int64_t>{10, 20, 30, 40, 40, 50, 60}));
+    EXPECT_EQ(store.stats().late_points, 1u);
+}
+
+TEST(SeriesStoreTest, TakesASeriesAndImportsHistoryInFront) {
+    SeriesStore store(segments_of(4));
+    for (int64_t t : {100, 110, 120, 130, 140}) store.append("s", t, 1.0);
+    SeriesStore::Snapshot taken;
+    ASSERT_TRUE(store.take("s", taken));
+    EXPECT_EQ(timestamps_of(taken), (std::vector<int64_t>{100, 110, 120, 130, 140}));
+    EXPECT_EQ(store.points("s"), 0u);
+    EXPECT_FALSE(store.take("s", taken));
+
+    // Handed over newest first: each older chunk lands in front
+    store.append("s", 150, 1.0);
+    EXPECT_EQ(store.import("s", {120, 130, 140}, {1.0, 1.0, 1.0}), 3u);
+    EXPECT_EQ(store.import("s", {100, 110}, {1.0, 1.0}), 2u);
+    SeriesStore::Snapshot snapshot;
+    ASSERT_TRUE(store.snapshot("s", snapshot));
+    EXPECT_EQ(timestamps_of(snapshot), (std::vector<int64_t>{100, 110, 120, 130, 140, 150}));
+    // Late appends are still judged against the newest sealed segment
+    EXPECT_FALSE(store.append("s", 125, 1.0));
+
+    // Overlapping history is merged in order
+    EXPECT_EQ(store.import("s", {105, 145, 160}, {2.0, 2.0, 2.0}), 3u);
+    ASSERT_TRUE(store.snapshot("s", snapshot));
+    EXPECT_EQ(timestamps_of(snapshot), (std::vector<int64_t>{100, 105, 110, 120, 130, 140, 145, 150, 160}));
+    EXPECT_EQ(store.points("s"), 9u);
+}
+
+TEST(SeriesStoreTest, ConcurrentWritersAndReaders) {
+    SeriesStore store(segments_of(64));
+    std::vector<std::thread> threads;
+    for (int w = 0; w < 4; ++w) {
+        threads.emplace_back([&store, w]() {
+            for (int64_t t = 0; t < 5000; ++t) store.append("sensor-" + std::to_string(w % 2), t, 1.0);
+        });
+    }
+    threads.emplace_back([&store]() {
+        SeriesStore::Snapshot snapshot;
+        for (int i = 0; i < 200; ++i) {
+            if (store.snapshot("sensor-0", snapshot)) {
+                auto timestamps = timestamps_of(snapshot);
+                ASSERT_TRUE(std::is_sorted(timestamps.begin(), timestamps.end()));
+            }
+        }
+    });
+    for (auto& thread : threads) thread.join();
+
+    SeriesStore::Stats stats = store.stats();
+    EXPECT_EQ(stats.sensors, 2u);
+    EXPECT_EQ(stats.points + stats.late_points, 20000u);
+    EXPECT_EQ(store.sensors(), (std::vector<std::string>{"sensor-0", "sensor-1"}));
+}
@@ -1,5 +1,10 @@
 #include <gtest/gtest.h>
 #include "service.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
 
 class ServiceTest : public ::testing::Test {
 protected:
@@ -34,6 +39,14 @@ TEST_F(ServiceTest, FuseReadingsWithOutliers) {
     EXPECT_LT(result, 50.0);  // Should not be influenced by the outlier
 }
 
+TEST_F(ServiceTest, OutlierGateDropsUnscorableReadings) {
+    // The first reading's deviation overflows, and so does the variance: its
+    // z-score is inf / inf, the others' finite / inf
+    double big = 1.7e308;
+    std::vector<double> readings = {big, -big, -big, 0.0};
+    EXPECT_EQ(service->fuse_readings(readings), -big);
+}
+
 TEST_F(ServiceTest, FuseReadingsEmpty) {
     std::vector<double> readings;
     double result = service->fuse_readings(readings);
@@ -56,6 +69,19 @@ TEST_F(ServiceTest, FuseReadingsTwoValues) {
     EXPECT_LT(result, 20.0);
 }
 
+TEST_F(ServiceTest, FuseBatch) {
+    std::vector<std::vector<double>> batches = {
+        {10.0, 11.0, 12.0, 13.0, 100.0},
+        {42.5},
+    };
+    auto results = service->fuse_batch(batches);
+    
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0], service->fuse_readings(batches[0]));
+    EXPECT_EQ(results[1], 42.5);
+    EXPECT_EQ(service->get_stats().total_requests, 3);
+}
+
 TEST_F(ServiceTest, ConfigurationManagement) {
     // Test default configuration
     std::string default_config = service->get_config();
@@ -140,4 +166,338 @@ TEST_F(ServiceTest, UptimeTracking) {
     // Should be less than a minute for this test
     auto uptime_seconds = std::chrono::duration_cast<std::chrono::seconds>(uptime);
     EXPECT_LT(uptime_seconds.count(), 60);
-}
\ No newline at end of file
+}
+
+TEST_F(ServiceTest, SetConfigUpdatesAndValidates) {
+    service->set_config("{\"outlier_threshold\": 3.0, \"reproducible_summation\": true, \"unknown\": [1]}");
+    std::string config = service->get_config();
+    EXPECT_NE(config.find("\"outlier_threshold\": 3"), std::string::npos);
+    EXPECT_NE(config.find("\"reproducible_summation\": true"), std::string::npos);
+    
+    EXPECT_THROW(service->set_config("{\"outlier_threshold\": -1}"), std::invalid_argument);
+    EXPECT_THROW(service->set_config("{\"min_confidence\": \"high\"}"), std::invalid_argument);
+    EXPECT_THROW(service->set_config("not json"), std::invalid_argument);
+    // A rejected update leaves the previous configuration in place
+    EXPECT_EQ(service->get_config(), config);
+}
+
+TEST_F(ServiceTest, ReadingLimitsConfig) {
+    EXPECT_EQ(service->reading_limits().policy, cpp_service::InvalidReadingPolicy::reject);
+    EXPECT_TRUE(std::isinf(service->reading_limits().max_value));
+
+    service->set_config("{\"invalid_readings\": \"clamp\", \"min_reading\": -40, \"max_reading\": 125}");
+    auto limits = service->reading_limits();
+    EXPECT_EQ(limits.policy, cpp_service::InvalidReadingPolicy::clamp);
+    EXPECT_EQ(limits.min_value, -40.0);
+    EXPECT_EQ(limits.max_value, 125.0);
+    EXPECT_NE(service->get_config().find("\"invalid_readings\": \"clamp\""), std::string::npos);
+
+    service->set_config("{\"max_reading\": null}");
+    EXPECT_TRUE(std::isinf(service->reading_limits().max_value));
+    EXPECT_NE(service->get_config().find("\"max_reading\": null"), std::string::npos);
+
+    EXPECT_THROW(service->set_config("{\"invalid_readings\": \"ignore\"}"), std::invalid_argument);
+    EXPECT_THROW(service->set_config("{\"max_reading\": -50}"), std::invalid_argument);
+}
+
+TEST_F(ServiceTest, ReproducibleSummationMatchesOnWellConditionedInput) {
+    std::vector<double> readings = {21.5, 22.25};
+    double plain = service->fuse_readings(readings);
+    
+    service->set_config("{\"reproducible_summation\": true}");
+    EXPECT_DOUBLE_EQ(service->fuse_readings(readings), plain);
+    std::reverse(readings.begin(), readings.end());
+    EXPECT_DOUBLE_EQ(service->fuse_readings(readings), plain);
+}
+
+TEST_F(ServiceTest, TrimmedAndWinsorizedMeans) {
+    std::vector<double> readings = {7.0, 100.0, 2.0, 1.0, 3.0};
+    service->set_config("{\"enable_outlier_detection\": false, \"trim_fraction\": 0.2, "
+                        "\"fusion_algorithm\": \"trimmed_mean\"}");
+    EXPECT_DOUBLE_EQ(service->fuse_readings(readings), 4.0);  // mean of {2, 3, 7}
+    
+    service->set_config("{\"fusion_algorithm\": \"winsorized_mean\"}");
+    EXPECT_DOUBLE_EQ(service->fuse_readings(readings), 4.2);  // mean of {2, 2, 3, 7, 7}
+    
+    // No trimming is the plain mean
+    service->set_config("{\"trim_fraction\": 0}");
+    EXPECT_DOUBLE_EQ(service->fuse_readings(readings), 22.6);
+    
+    EXPECT_THROW(service->set_config("{\"trim_fraction\": 0.5}"), std::invalid_argument);
+    EXPECT_THROW(service->set_config("{\"fusion_algorithm\": \"mode\"}"), std::invalid_argument);
+}
+
+TEST_F(ServiceTest, SelectionMatchesSortedReference) {
+    service->set_config("{\"enable_outlier_detection\": false, \"reproducible_summation\": true, "
+                        "\"trim_fraction\": 0.15}");
+    std::vector<double> readings;
+    for (int i = 0; i < 101; ++i) {
+        readings.push_back(std::fmod(i * 37.0, 101.0) + (i % 3) * 0.25);
+    }
+    std::vector<double> sorted = readings;
+    std::sort(sorted.begin(), sorted.end());
+    size_t k = static_cast<size_t>(0.15 * sorted.size());
+    
+    EXPECT_DOUBLE_EQ(service->fuse_readings(readings), sorted[sorted.size() / 2]);
+    
+    double trimmed = 0.0;
+    double winsorized = 0.0;
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (i >= k && i < sorted.size() - k) trimmed += sorted[i];
+        winsorized += std::min(std::max(sorted[i], sorted[k]), sorted[sorted.size() - 1 - k]);
+    }
+    service->set_config("{\"fusion_algorithm\": \"trimmed_mean\"}");
+    EXPECT_DOUBLE_EQ(service->fuse_readings(readings), trimmed / (sorted.size() - 2 * k));
+    service->set_config("{\"fusion_algorithm\": \"winsorized_mean\"}");
+    EXPECT_DOUBLE_EQ(service->fuse_readings(readings), winsorized / sorted.size());
+    
+    // Even count: the median averages the two middle values
+    readings.pop_back();
+    sorted = readings;
+    std::sort(sorted.begin(), sorted.end());
+    service->set_config("{\"fusion_algorithm\": \"median\"}");
+    EXPECT_DOUBLE_EQ(service->fuse_readings(readings), (sorted[49] + sorted[50]) / 2.0);
+}
+
+TEST_F(ServiceTest, ParallelMedianMatchesSerial) {
+    service->set_config("{\"enable_outlier_detection\": false, \"fusion_algorithm\": \"median\"}");
+    std::mt19937 rng(11);
+    std::normal_distribution<double> noise(20.0, 3.0);
+    cpp_service::Service::FusionOptions parallel;
+    parallel.parallel = true;
+    
+    // Above the parallel threshold, odd and even counts, distinct and heavily repeated values
+    for (size_t n : {size_t(300001), size_t(300000)}) {
+        for (int repeated = 0; repeated < 2; ++repeated) {
+            std::vector<double> readings(n);
+            for (size_t i = 0; i < n; ++i) {
+                readings[i] = repeated ? static_cast<double>(i % 7) : noise(rng);
+            }
+            std::vector<double> sorted = readings;
+            std::sort(sorted.begin(), sorted.end());
+            double expected = (sorted[(n - 1) / 2] + sorted[n / 2]) / 2.0;
+            
+            EXPECT_DOUBLE_EQ(service->fuse(readings, {}, parallel).value, expected);
+            EXPECT_DOUBLE_EQ(service->fuse(readings, {}, cpp_service::Service::FusionOptions()).value, expected);
+        }
+    }
+}
+
+TEST_F(ServiceTest, WeightedMedian) {
+    service->set_config("{\"enable_outlier_detection\": false}");
+    
+    // The heavy reading carries more than half the weight
+    EXPECT_DOUBLE_EQ(service->fuse_readings({10.0, 20.0, 30.0}, {1.0, 1.0, 5.0}), 30.0);
+    // Zero weights are ignored
+    EXPECT_DOUBLE_EQ(service->fuse_readings({10.0, 20.0, 30.0, 99.0}, {1.0, 1.0, 1.0, 0.0}), 20.0);
+    // Equal weights agree with the ordinary median, including even counts
+    EXPECT_DOUBLE_EQ(service->fuse_readings({4.0, 1.0, 3.0, 2.0}, {2.0, 2.0, 2.0, 2.0}), 2.5);
+    EXPECT_DOUBLE_EQ(service->fuse_readings({4.0, 1.0, 3.0, 2.0}), 2.5);
+    // No weights keeps the unweighted path
+    EXPECT_DOUBLE_EQ(service->fuse_readings({10.0, 20.0, 30.0}, {}), 20.0);
+    
+    EXPECT_THROW(service->fuse_readings({1.0, 2.0}, {1.0}), std::invalid_argument);
+    EXPECT_THROW(service->fuse_readings({1.0, 2.0}, {1.0, -1.0}), std::invalid_argument);
+    EXPECT_THROW(service->fuse_readings({1.0, 2.0}, {0.0, 0.0}), std::invalid_argument);
+}
+
+TEST_F(ServiceTest, WeightedMedianMatchesSortAndScan) {
+    service->set_config("{\"enable_outlier_detection\": false}");
+    
+    std::vector<double> readings;
+    std::vector<double> weights;
+    for (int i = 0; i < 257; ++i) {
+        readings.push_back(std::fmod(i * 7919.0, 263.0) / 4.0);  // includes duplicates
+        weights.push_back(1.0 + (i * 31) % 17);
+    }
+    
+    std::vector<std::pair<double, double>> sorted;
+    double total = 0.0;
+    for (size_t i = 0; i < readings.size(); ++i) {
+        sorted.emplace_back(readings[i], weights[i]);
+        total += weights[i];
+    }
+    std::sort(sorted.begin(), sorted.end());
+    double cumulative = 0.0;
+    double expected = 0.0;
+    for (const auto& [value, weight] : sorted) {
+        cumulative += weight;
+        if (cumulative >= total / 2.0) {
+            expected = value;
+            break;
+        }
+    }
+    
+    EXPECT_DOUBLE_EQ(service->fuse_readings(readings, weights), expected);
+    
+    auto batch = service->fuse_batch({readings, {1.0, 2.0}}, {weights, {}});
+    ASSERT_EQ(batch.size(), 2u);
+    EXPECT_DOUBLE_EQ(batch[0], expected);
+    EXPECT_DOUBLE_EQ(batch[1], 1.5);
+}
+
+TEST_F(ServiceTest, BootstrapInterval) {
+    std::vector<double> readings;
+    for (int i = 0; i < 200; ++i) {
+        readings.push_back(20.0 + std::sin(i * 1.7));
+    }
+    
+    cpp_service::Service::FusionOptions options;
+    options.interval = true;
+    options.max_resamples = 500;
+    options.deadline_ms = 1000.0;
+    auto result = service->fuse(readings, {}, options);
+    
+    ASSERT_TRUE(result.has_interval);
+    EXPECT_EQ(result.resamples, 500u);
+    EXPECT_LE(result.interval_low, result.value);
+    EXPECT_GE(result.interval_high, result.value);
+    EXPECT_LT(result.interval_high - result.interval_low, 1.0);
+    EXPECT_GT(result.confidence, 0.0);
+    EXPECT_LE(result.confidence, 1.0);
+    
+    // Cached index patterns make the interval repeatable
+    auto again = service->fuse(readings, {}, options);
+    EXPECT_EQ(again.interval_low, result.interval_low);
+    EXPECT_EQ(again.interval_high, result.interval_high);
+    
+    // A wider level never gives a narrower interval
+    options.interval_level = 0.5;
+    auto narrow = service->fuse(readings, {}, options);
+    EXPECT_GE(narrow.interval_low, result.interval_low);
+    EXPECT_LE(narrow.interval_high, result.interval_high);
+    
+    // Weighted requests resample weights alongside readings
+    std::vector<double> weights(readings.size(), 1.0);
+    auto weighted = service->fuse(readings, weights, options);
+    EXPECT_TRUE(weighted.has_interval);
+    
+    EXPECT_FALSE(service->fuse(readings, {}, {}).has_interval);
+    options.interval_level = 1.0;
+    EXPECT_THROW(service->fuse(readings, {}, options), std::invalid_argument);
+}
+
+TEST_F(ServiceTest, BootstrapIntervalStaysWithinItsBudget) {
+    cpp_service::Service::FusionOptions options;
+    options.interval = true;
+    options.max_resamples = 100;
+    
+    // Even the smallest resample count would blow the deadline: an error, not
+    // an interval that ignores it
+    std::vector<double> large(1 << 20, 5.0);
+    options.deadline_ms = 0.01;
+    EXPECT_THROW(service->fuse(large, {}, options), std::invalid_argument);
+    
+    // Too large for a cached pattern: rows are generated per chunk, still repeatably
+    std::vector<double> readings;
+    for (int i = 0; i < 50000; ++i) {
+        readings.push_back(20.0 + std::sin(i * 0.37));
+    }
+    options.deadline_ms = 60000.0;
+    auto result = service->fuse(readings, {}, options);
+    ASSERT_TRUE(result.has_interval);
+    EXPECT_EQ(result.resamples, 100u);
+    EXPECT_LE(result.interval_low, result.value);
+    EXPECT_GE(result.interval_high, result.value);
+    auto again = service->fuse(readings, {}, options);
+    EXPECT_EQ(again.interval_low, result.interval_low);
+    EXPECT_EQ(again.interval_high, result.interval_high);
+}
+
+TEST_F(ServiceTest, PerRequestAlgorithms) {
+    service->set_config("{\"enable_outlier_detection\": false}");
+    std::vector<double> readings = {7.0, 100.0, 2.0, 1.0, 3.0};
+    cpp_service::Service::FusionOptions options;
+    
+    options.algorithm = cpp_service::Service::FusionAlgorithm::median;
+    auto result = service->fuse(readings, {}, options);
+    EXPECT_DOUBLE_EQ(result.value, 3.0);
+    EXPECT_EQ(result.algorithm, cpp_service::Service::FusionAlgorithm::median);
+    
+    // Huber sits between the median and the mean and is barely moved by 100
+    options.algorithm = cpp_service::Service::FusionAlgorithm::huber;
+    result = service->fuse(readings, {}, options);
+    EXPECT_GT(result.value, 3.0);
+    EXPECT_LT(result.value, 6.0);
+    
+    options.algorithm = cpp_service::Service::FusionAlgorithm::weighted;
+    EXPECT_DOUBLE_EQ(service->fuse(readings, {1, 1, 1, 1, 10}, options).value, 3.0);
+    
+    // Explicit non-weighted algorithms refuse weights
+    options.algorithm = cpp_service::Service::FusionAlgorithm::trimmed_mean;
+    EXPECT_THROW(service->fuse(readings, {1, 1, 1, 1, 1}, options), std::invalid_argument);
+    
+    // The configured algorithm is untouched
+    EXPECT_NE(service->get_config().find("\"fusion_algorithm\": \"median\""), std::string::npos);
+    
+    cpp_service::Service::FusionAlgorithm parsed;
+    EXPECT_TRUE(cpp_service::Service::parse_algorithm("auto", parsed));
+    EXPECT_EQ(parsed, cpp_service::Service::FusionAlgorithm::automatic);
+    EXPECT_TRUE(cpp_service::Service::parse_algorithm("trimmed", parsed));
+    EXPECT_EQ(parsed, cpp_service::Service::FusionAlgorithm::trimmed_mean);
+    EXPECT_FALSE(cpp_service::Service::parse_algorithm("mode", parsed));
+}
+
+TEST_F(ServiceTest, SketchStaysWithinItsBound) {
+    service->set_config("{\"enable_outlier_detection\": false}");
+    std::vector<double> readings;
+    for (int i = 0; i < 5001; ++i) {
+        readings.push_back(20.0 + 5.0 * std::sin(i * 0.37) + (i % 11) * 0.01);
+    }
+    double exact = service->fuse_readings(readings);
+    
+    cpp_service::Service::FusionOptions options;
+    options.algorithm = cpp_service::Service::FusionAlgorithm::sketch;
+    auto result = service->fuse(readings, {}, options);
+    EXPECT_EQ(result.algorithm, cpp_service::Service::FusionAlgorithm::sketch);
+    double range = 10.0 + 0.1;
+    EXPECT_NEAR(result.value, exact, range / (256.0 * 256.0));
+    
+    // A tolerance the sketch cannot meet falls back to the exact median
+    options.tolerance = 1e-12;
+    result = service->fuse(readings, {}, options);
+    EXPECT_EQ(result.algorithm, cpp_service::Service::FusionAlgorithm::median);
+    EXPECT_DOUBLE_EQ(result.value, exact);
+    
+    // So does a value the histogram cannot place, whatever the tolerance
+    options.tolerance = 0.0;
+    for (double bad : {std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()}) {
+        result = service->fuse({1.0, 2.0, 3.0, bad, 4.0}, {}, options);
+        EXPECT_EQ(result.algorithm, cpp_service::Service::FusionAlgorithm::median);
+        EXPECT_DOUBLE_EQ(result.value, bad > 0 ? 3.0 : 2.0);
+    }
+}
+
+TEST_F(ServiceTest, AutoFollowsCostModel) {
+    service->set_config("{\"enable_outlier_detection\": false}");
+    std::vector<double> readings(2000);
+    for (size_t i = 0; i < readings.size(); ++i) {
+        readings[i] = static_cast<double>(i % 100);
+    }
+    cpp_service::Service::FusionOptions options;
+    options.algorithm = cpp_service::Service::FusionAlgorithm::automatic;
+    
+    // Exact answers required: always the median
+    EXPECT_EQ(service->fuse(readings, {}, options).algorithm, cpp_service::Service::FusionAlgorithm::median);
+    
+    // The default model keeps the median for small requests and takes the
+    // sketch for large ones
+    options.tolerance = 0.01;
+    EXPECT_EQ(service->fuse(readings, {}, options).algorithm, cpp_service::Service::FusionAlgorithm::median);
+    std::vector<double> large(64 * 1024);
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<double>(i % 100);
+    }
+    EXPECT_EQ(service->fuse(large, {}, options).algorithm, cpp_service::Service::FusionAlgorithm::sketch);
+    
+
+    service->set_config("{\"cost_model\": {\"sketch\": {\"fixed_ns\": 0, \"per_item_ns\": 1}, "
+                        "\"median\": {\"fixed_ns\": 0, \"per_item_ns\": 10}}}");
+    EXPECT_EQ(service->fuse(readings, {}, options).algorithm, cpp_service::Service::FusionAlgorithm::sketch);
+    
+    service->set_config("{\"cost_model\": {\"sketch\": {\"fixed_ns\": 0, \"per_item_ns\": 20}}}");
+    EXPECT_EQ(service->fuse(readings, {}, options).algorithm, cpp_service::Service::FusionAlgorithm::median);
+    
+    EXPECT_THROW(service->set_config("{\"cost_model\": {\"mode\": {}}}"), std::invalid_argument);
+    EXPECT_THROW(service->set_config("{\"cost_model\": {\"median\": {\"fixed_ns\": -1}}}"), std::invalid_argument);
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "shadow_evaluator.hpp"
+#include "metrics.hpp"
+#include <string>
+#include <vector>
+
+using cpp_service::Service;
+using cpp_service::ShadowEvaluator;
+
+namespace {
+
+// Value of one exported series, or -1 when it is missing
+double metric_value(const std::string& series) {
+    std::string metrics = cpp_service::get_metrics().get_prometheus_metrics();
+    size_t at = metrics.find(series + " ");
+    return at == std::string::npos ? -1.0 : std::stod(metrics.substr(at + series.size() + 1));
+}
+
+ShadowEvaluator::Config trimmed_mean_shadow(double sample_rate) {
+    ShadowEvaluator::Config config;
+    config.algorithm = Service::FusionAlgorithm::trimmed_mean;
+    config.sample_rate = sample_rate;
+    return config;
+}
+
+} // namespace
+
+TEST(ShadowEvaluatorTest, ComparesSampledRequestsOffThePath) {
+    cpp_service::get_metrics().reset();
+    Service service;
+    Service::FusionOptions options;
+    {
+        ShadowEvaluator shadow(service, trimmed_mean_shadow(0.5));
+        for (int i = 0; i < 10; ++i) {
+            // Median 8, mean 9: the shadow is off by 1/8 of the served value
+            std::vector<double> readings = {8.0, 8.0, 8.0, 12.0};
+            Service::FusionResult served = service.fuse(readings, {}, options);
+            ASSERT_DOUBLE_EQ(served.value, 8.0);
+            bool taken = shadow.offer(readings, {}, options, served);
+            EXPECT_EQ(taken, i % 2 == 1);
+            EXPECT_EQ(readings.empty(), taken);
+            // offer() sheds rather than wait for a worker holding the queue
+            shadow.wait_idle();
+        }
+        ShadowEvaluator::Stats stats = shadow.stats();
+        EXPECT_EQ(stats.sampled, 5u);
+        EXPECT_EQ(stats.evaluated, 5u);
+        EXPECT_EQ(stats.shed_queue_full + stats.shed_stale + stats.failed, 0u);
+    }
+
+    EXPECT_EQ(metric_value("shadow_requests_total{outcome=\"evaluated\"}"), 5.0);
+    EXPECT_EQ(metric_value("shadow_diff_ppm_count{algorithm=\"trimmed_mean\"}"), 5.0);
+    EXPECT_EQ(metric_value("shadow_diff_ppm_sum{algorithm=\"trimmed_mean\"}"), 5 * 125000.0);
+    EXPECT_EQ(metric_value("shadow_cpu_us_count{pipeline=\"served\",algorithm=\"median\"}"), 5.0);
+    EXPECT_EQ(metric_value("shadow_cpu_us_count{pipeline=\"shadow\",algorithm=\"trimmed_mean\"}"), 5.0);
+    // Only the ten served requests count as traffic
+    EXPECT_EQ(service.get_stats().total_requests, 10u);
+    EXPECT_EQ(metric_value("fusion_algorithm_total{algorithm=\"trimmed_mean\"}"), -1.0);
+}
+
+TEST(ShadowEvaluatorTest, ShedsInsteadOfQueueing) {
+    cpp_service::get_metrics().reset();
+    Service service;
+    Service::FusionOptions options;
+    Service::FusionResult served;
+    served.value = 1.0;
+
+    ShadowEvaluator::Config no_room = trimmed_mean_shadow(1.0);
+    no_room.max_queue = 0;
+    ShadowEvaluator full(service, no_room);
+    std::vector<double> readings = {1.0, 2.0, 3.0};
+    EXPECT_FALSE(full.offer(readings, {}, options, served));
+    EXPECT_EQ(readings.size(), 3u);
+    EXPECT_EQ(full.stats().shed_queue_full, 1u);
+
+    // Everything has waited too long by the time a worker picks it up
+    ShadowEvaluator::Config no_delay = trimmed_mean_shadow(1.0);
+    no_delay.max_delay = std::chrono::milliseconds(0);
+    ShadowEvaluator stale(service, no_delay);
+    for (int i = 0; i < 3; ++i) {
+        std::vector<double> copy = readings;
+        EXPECT_TRUE(stale.offer(copy, {}, options, served));
+    }
+    stale.wait_idle();
+    EXPECT_EQ(stale.stats().shed_stale, 3u);
+    EXPECT_EQ(stale.stats().evaluated, 0u);
+    EXPECT_EQ(metric_value("shadow_requests_total{outcome=\"queue_full\"}"), 1.0);
+    EXPECT_EQ(metric_value("shadow_requests_total{outcome=\"stale\"}"), 3.0);
+}
+
+TEST(ShadowEvaluatorTest, SkipsWeightedAndUnsampledRequests) {
+    Service service;
+    Service::FusionOptions options;
+    Service::FusionResult served;
+    ShadowEvaluator never(service, trimmed_mean_shadow(0.0));
+    ShadowEvaluator always(service, trimmed_mean_shadow(1.0));
+
+    std::vector<double> readings = {1.0, 2.0, 3.0};
+    EXPECT_FALSE(never.offer(readings, {}, options, served));
+    EXPECT_FALSE(always.offer(readings, {1.0, 1.0, 1.0}, options, served));
+    EXPECT_EQ(readings.size(), 3u);
+    EXPECT_EQ(never.stats().sampled, 0u);
+    EXPECT_EQ(always.stats().sampled, 0u);
+}
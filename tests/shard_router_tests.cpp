@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include "shard_router.hpp"
+#include "http_server.hpp"
+#include "metrics.hpp"
+#include "test_helpers.hpp"
+#include "../third_party/simple_http.hpp"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using cpp_service::HttpServer;
+using cpp_service::Membership;
+using cpp_service::ShardRouter;
+using test_helpers::eventually;
+
+namespace {
+
+std::vector<Membership::Member> ring_of(const std::vector<std::string>& ids) {
+    std::vector<Membership::Member> ring;
+    for (const auto& id : ids) {
+        Membership::Member member;
+        member.id = id;
+        ring.push_back(member);
+    }
+    return ring;
+}
+
+// A port the kernel just handed out, free for TCP and in practice for UDP
+uint16_t free_port() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    close(fd);
+    return ntohs(address.sin_port);
+}
+
+// One sharded node: HTTP on `http_port`, gossip on `gossip_port`
+struct Node {
+    Node(uint16_t http_port, uint16_t gossip_port, std::vector<std::string> seeds)
+        : port(http_port), server(http_port, &service) {
+        cpp_service::SeriesStore::Config series;
+        series.segment_points = 16;
+        server.set_series_store(series);
+        Membership::Config membership;
+        membership.bind_host = "127.0.0.1";
+        membership.port = gossip_port;
+        membership.seeds = std::move(seeds);
+        membership.protocol_period = std::chrono::milliseconds(50);
+        membership.ack_timeout = std::chrono::milliseconds(20);
+        server.set_membership(membership);
+        ShardRouter::Config sharding;
+        sharding.chunk_points = 100;
+        sharding.bytes_per_second = 256 * 1024;
+        sharding.burst_bytes = 4096;
+        sharding.poll_interval = std::chrono::milliseconds(10);
+        server.set_sharding(sharding);
+        thread = std::thread([this]() { server.run(); });
+        while (server.bound_port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ~Node() {
+        server.stop();
+        thread.join();
+    }
+
+    // GET `path`, served here whoever owns the sensor when `local`
+    simple_http::Response get(const std::string& path, bool local = false) {
+        simple_http::Response response;
+        simple_http::Client client("127.0.0.1", port);
+        std::unordered_map<std::string, std::string> headers;
+        if (local) headers["X-Fuser-Hops"] = "9";
+        EXPECT_TRUE(client.request("GET", path, "", response, headers)) << path;
+        return response;
+    }
+
+    uint16_t port;
+    cpp_service::Service service;
+    HttpServer server;
+    std::thread thread;
+};
+
+bool has(const simple_http::Response& response, const std::string& text) {
+    return response.body.find(text) != std::string::npos;
+}
+
+} // namespace
+
+TEST(ShardRouterTest, RendezvousMovesOnlyWhatTheNewMemberWins) {
+    auto three = ring_of({"10.0.0.1:7000", "10.0.0.2:7000", "10.0.0.3:7000"});
+    auto four = ring_of({"10.0.0.1:7000", "10.0.0.2:7000", "10.0.0.3:7000", "10.0.0.4:7000"});
+    std::map<std::string, int> owned;
+    int moved = 0;
+    const int sensors = 4000;
+    for (int i = 0; i < sensors; ++i) {
+        std::string sensor = "sensor-" + std::to_string(i);
+        std::string before = ShardRouter::owner(three, sensor);
+        std::string after = ShardRouter::owner(four, sensor);
+        owned[before]++;
+        if (before != after) {
+            EXPECT_EQ(after, "10.0.0.4:7000") << sensor;
+            moved++;
+        }
+        // The order members are listed in does not matter
+        EXPECT_EQ(ShardRouter::owner(ring_of({"10.0.0.3:7000", "10.0.0.1:7000", "10.0.0.2:7000"}), sensor), before);
+    }
+    EXPECT_NEAR(moved, sensors / 4, sensors / 20);
+    for (const auto& entry : owned) EXPECT_NEAR(entry.second, sensors / 3, sensors / 15) << entry.first;
+    EXPECT_EQ(ShardRouter::owner({}, "x"), "");
+}
+
+TEST(ShardRouterTest, HandsSeriesToAJoiningMemberAndForwardsToIt) {
+    cpp_service::get_metrics().reset();
+    uint16_t gossip_a = free_port();
+    std::string id_a = "127.0.0.1:" + std::to_string(gossip_a);
+    Node a(free_port(), gossip_a, {});
+
+    const int sensors = 30;
+    const int points = 50;
+    {
+        simple_http::Client client("127.0.0.1", a.port);
+        simple_http::Response response;
+        for (int s = 0; s < sensors; ++s) {
+            for (int i = 0; i < points; ++i) {
+                std::string body = "{\"sensor\": \"s" + std::to_string(s) + "\", \"readings\": [" +
+                                   std::to_string(i) + "], \"timestamps\": [" + std::to_string(1000 + i) + "]}";
+                ASSERT_TRUE(client.request("POST", "/fuse", body, response));
+                ASSERT_EQ(response.status_code, 200) << response.body;
+            }
+        }
+    }
+
+    uint16_t gossip_b = free_port();
+    std::string id_b = "127.0.0.1:" + std::to_string(gossip_b);
+    Node b(free_port(), gossip_b, {id_a});
+    auto ring = ring_of({id_a, id_b});
+
+    // Every series stays whole whichever node is asked, mid-handoff or after
+    auto all_whole = [&](Node& node) {
+        for (int s = 0; s < sensors; ++s) {
+            if (!has(node.get("/series?sensor=s" + std::to_string(s)), "\"in_range\": 50")) return false;
+        }
+        return true;
+    };
+    ASSERT_TRUE(eventually([&] { return has(a.get("/metrics"), "shard_ring_members 2"); }));
+    EXPECT_TRUE(all_whole(a));
+
+    // Once the handoff is done each series lives only with its owner
+    int moved = 0;
+    ASSERT_TRUE(eventually([&] {
+        moved = 0;
+        for (int s = 0; s < sensors; ++s) {
+            std::string sensor = "s" + std::to_string(s);
+            bool at_b = ShardRouter::owner(ring, sensor) == id_b;
+            moved += at_b ? 1 : 0;
+            Node& owner = at_b ? b : a;
+            Node& other = at_b ? a : b;
+            if (!has(owner.get("/series?sensor=" + sensor, true), "\"in_range\": 50")) return false;
+            if (other.get("/series?sensor=" + sensor, true).status_code != 404) return false;
+        }
+        return true;
+    })) << a.get("/metrics").body;
+    EXPECT_GT(moved, 0);
+    EXPECT_LT(moved, sensors);
+    EXPECT_TRUE(all_whole(a));
+    EXPECT_TRUE(all_whole(b));
+
+    simple_http::Response metrics = a.get("/metrics");
+    EXPECT_TRUE(has(metrics, "shard_migration_sensors_sent " + std::to_string(moved))) << metrics.body;
+    EXPECT_TRUE(has(metrics, "shard_migration_points{direction=\"sent\"} " + std::to_string(moved * points)))
+        << metrics.body;
+    EXPECT_TRUE(has(metrics, "shard_migration_queued_sensors 0")) << metrics.body;
+
+    // New readings for a moved sensor sent to the old owner reach the new one
+    std::string sensor;
+    for (int s = 0; sensor.empty(); ++s) {
+        if (ShardRouter::owner(ring, "s" + std::to_string(s)) == id_b) sensor = "s" + std::to_string(s);
+    }
+    simple_http::Client client("127.0.0.1", a.port);
+    simple_http::Response response;
+    ASSERT_TRUE(client.request("POST", "/fuse",
+                               "{\"sensor\": \"" + sensor + "\", \"readings\": [7], \"timestamps\": [2000]}",
+                               response));
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_TRUE(has(response, "\"sensor\": \"" + sensor + "\"")) << response.body;
+    EXPECT_TRUE(has(b.get("/series?sensor=" + sensor, true), "\"in_range\": 51"));
+    EXPECT_TRUE(has(a.get("/metrics"), "forwarded_requests_total{endpoint=\"/fuse\"}"));
+
+    // Migration traffic is taken only from members, at their gossip address.
+    // Metrics are process-wide and a handoff racing b's ring may already have
+    // been refused (and retried), so count from here
+    auto forbidden = [&a]() {
+        const std::string label = "errors_total{endpoint=\"/cluster/migrate\",error=\"forbidden\"} ";
+        std::string body = a.get("/metrics").body;
+        size_t at = body.find(label);
+        return at == std::string::npos ? 0L : std::stol(body.substr(at + label.size()));
+    };
+    const long refused = forbidden();
+    for (const std::string& member : {std::string(), std::string("10.1.2.3:7946"), id_a}) {
+        std::unordered_map<std::string, std::string> headers = {{"X-Fuser-Handoff", "done"}};
+        if (!member.empty()) headers["X-Fuser-Member"] = member;
+        ASSERT_TRUE(client.request("POST", "/cluster/migrate", "", response, headers));
+        EXPECT_EQ(response.status_code, 403) << member;
+    }
+    EXPECT_EQ(forbidden(), refused + 3);
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include "telemetry_fuser.h"
+#include "service.hpp"
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using cpp_service::Service;
+
+namespace {
+
+struct ServiceDeleter {
+    void operator()(tf_service* service) const { tf_service_destroy(service); }
+};
+struct WorkspaceDeleter {
+    void operator()(tf_workspace* workspace) const { tf_workspace_destroy(workspace); }
+};
+using ServicePtr = std::unique_ptr<tf_service, ServiceDeleter>;
+using WorkspacePtr = std::unique_ptr<tf_workspace, WorkspaceDeleter>;
+
+} // namespace
+
+TEST(TelemetryFuserTest, MatchesTheServiceForEveryAlgorithm) {
+    EXPECT_EQ(tf_abi_version(), static_cast<uint32_t>(TF_ABI_VERSION));
+    ServicePtr service(tf_service_create());
+    WorkspacePtr workspace(tf_workspace_create());
+    ASSERT_TRUE(service && workspace);
+    Service reference;
+
+    const std::vector<double> readings = {10.0, 10.4, 9.8, 10.1, 55.0, 10.2, 9.9};
+    const std::vector<double> weights = {1, 2, 1, 1, 0.1, 3, 1};
+    for (int32_t algorithm = TF_ALGORITHM_MEDIAN; algorithm <= TF_ALGORITHM_AUTO; ++algorithm) {
+        tf_options options;
+        tf_options_init(&options);
+        options.algorithm = algorithm;
+        tf_result result;
+        ASSERT_EQ(tf_fuse(service.get(), workspace.get(), readings.data(), readings.size(), nullptr, &options,
+                          &result), TF_OK) << tf_last_error();
+
+        Service::FusionAlgorithm parsed;
+        ASSERT_TRUE(Service::parse_algorithm(tf_algorithm_name(algorithm), parsed));
+        Service::FusionOptions expected_options;
+        expected_options.algorithm = parsed;
+        Service::FusionResult expected = reference.fuse(readings, {}, expected_options);
+        EXPECT_DOUBLE_EQ(result.value, expected.value) << tf_algorithm_name(algorithm);
+        EXPECT_DOUBLE_EQ(result.confidence, expected.confidence);
+        EXPECT_STREQ(tf_algorithm_name(result.algorithm), Service::algorithm_name(expected.algorithm));
+        EXPECT_STREQ(tf_last_error(), "");
+    }
+
+    // Weights, defaults (no options) and the per-thread workspace
+    tf_result weighted;
+    ASSERT_EQ(tf_fuse(service.get(), nullptr, readings.data(), readings.size(), weights.data(), nullptr, &weighted),
+              TF_OK);
+    EXPECT_DOUBLE_EQ(weighted.value, reference.fuse_readings(readings, weights));
+    EXPECT_EQ(tf_algorithm_name(99), nullptr);
+}
+
+TEST(TelemetryFuserTest, ReportsIntervalsAndConfiguration) {
+    ServicePtr service(tf_service_create());
+    ASSERT_EQ(tf_service_configure(service.get(), "{\"fusion_algorithm\": \"huber\"}"), TF_OK) << tf_last_error();
+
+    size_t required = 0;
+    char small[4];
+    EXPECT_EQ(tf_service_config(service.get(), small, sizeof(small), &required), TF_BUFFER_TOO_SMALL);
+    ASSERT_GT(required, sizeof(small));
+    std::string config(required, '\0');
+    ASSERT_EQ(tf_service_config(service.get(), &config[0], config.size(), nullptr), TF_OK);
+    EXPECT_NE(config.find("\"fusion_algorithm\": \"huber\""), std::string::npos) << config;
+
+    EXPECT_EQ(tf_service_configure(service.get(), "{\"fusion_algorithm\": \"nope\"}"), TF_INVALID_ARGUMENT);
+    EXPECT_NE(std::string(tf_last_error()).find("nope"), std::string::npos) << tf_last_error();
+
+    std::vector<double> readings;
+    for (int i = 0; i < 200; ++i) readings.push_back(20.0 + 0.01 * (i % 17));
+    tf_options options;
+    tf_options_init(&options);
+    options.interval = 1;
+    options.max_resamples = 300;
+    tf_result result;
+    ASSERT_EQ(tf_fuse(service.get(), nullptr, readings.data(), readings.size(), nullptr, &options, &result), TF_OK);
+    EXPECT_EQ(result.algorithm, TF_ALGORITHM_HUBER);
+    EXPECT_EQ(result.has_interval, 1);
+    EXPECT_LE(result.interval_low, result.value);
+    EXPECT_GE(result.interval_high, result.value);
+    EXPECT_GT(result.resamples, 0u);
+}
+
+TEST(TelemetryFuserTest, FusesBatchesLaidOutByOffsets) {
+    ServicePtr service(tf_service_create());
+    WorkspacePtr workspace(tf_workspace_create());
+    Service reference;
+
+    const std::vector<double> readings = {1, 2, 3, 10, 20, 5, 6, 7, 8};
+    const std::vector<size_t> offsets = {0, 3, 5, 9};
+    std::vector<double> values(3);
+    ASSERT_EQ(tf_fuse_batch(service.get(), workspace.get(), readings.data(), offsets.data(), 3, nullptr, nullptr,
+                            values.data(), values.size()), TF_OK) << tf_last_error();
+    EXPECT_EQ(values, reference.fuse_batch({{1, 2, 3}, {10, 20}, {5, 6, 7, 8}}));
+
+    EXPECT_EQ(tf_fuse_batch(service.get(), workspace.get(), readings.data(), offsets.data(), 3, nullptr, nullptr,
+                            values.data(), 2), TF_BUFFER_TOO_SMALL);
+    const std::vector<size_t> with_empty = {0, 3, 3, 9};
+    EXPECT_EQ(tf_fuse_batch(service.get(), workspace.get(), readings.data(), with_empty.data(), 3, nullptr, nullptr,
+                            values.data(), values.size()), TF_INVALID_ARGUMENT);
+    EXPECT_STREQ(tf_last_error(), "batch 1 has no readings");
+
+    const std::vector<double> bad_weights = {1, 1, 1, 1, -1, 1, 1, 1, 1};
+    EXPECT_EQ(tf_fuse_batch(service.get(), workspace.get(), readings.data(), offsets.data(), 3, bad_weights.data(),
+                            nullptr, values.data(), values.size()), TF_INVALID_ARGUMENT);
+    EXPECT_EQ(std::string(tf_last_error()).rfind("batch 1: ", 0), 0u) << tf_last_error();
+}
+
+TEST(TelemetryFuserTest, AppliesTheReadingPolicyAndRejectsBadArguments) {
+    ServicePtr service(tf_service_create());
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const std::vector<double> readings = {1.0, nan, 3.0, 500.0};
+    tf_result result;
+
+    EXPECT_EQ(tf_fuse(service.get(), nullptr, readings.data(), readings.size(), nullptr, nullptr, &result),
+              TF_INVALID_ARGUMENT);
+    EXPECT_STRNE(tf_last_error(), "");
+
+    ASSERT_EQ(tf_service_configure(service.get(), "{\"invalid_readings\": \"drop\", \"max_reading\": 100}"), TF_OK);
+    const std::vector<double> weights = {1.0, 1.0, 3.0, 1.0};
+    ASSERT_EQ(tf_fuse(service.get(), nullptr, readings.data(), readings.size(), weights.data(), nullptr, &result),
+              TF_OK) << tf_last_error();
+    EXPECT_DOUBLE_EQ(result.value, Service().fuse_readings({1.0, 3.0}, {1.0, 3.0}));
+
+    ASSERT_EQ(tf_service_configure(service.get(), "{\"invalid_readings\": \"clamp\"}"), TF_OK);
+    ASSERT_EQ(tf_fuse(service.get(), nullptr, readings.data(), readings.size(), nullptr, nullptr, &result), TF_OK);
+    EXPECT_DOUBLE_EQ(result.value, Service().fuse_readings({1.0, 3.0, 100.0}));
+
+    const double only_nan[] = {nan};
+    EXPECT_EQ(tf_fuse(service.get(), nullptr, only_nan, 1, nullptr, nullptr, &result), TF_INVALID_ARGUMENT);
+    EXPECT_STREQ(tf_last_error(), "readings array cannot be empty");
+
+    EXPECT_EQ(tf_fuse(service.get(), nullptr, readings.data(), 0, nullptr, nullptr, &result), TF_INVALID_ARGUMENT);
+    EXPECT_EQ(tf_fuse(nullptr, nullptr, readings.data(), 1, nullptr, nullptr, &result), TF_INVALID_ARGUMENT);
+    tf_options options;
+    tf_options_init(&options);
+    options.algorithm = 42;
+    EXPECT_EQ(tf_fuse(service.get(), nullptr, readings.data(), 1, nullptr, &options, &result), TF_INVALID_ARGUMENT);
+    options.algorithm = TF_ALGORITHM_DEFAULT;
+    options.struct_size = 4;  // older than any released layout
+    EXPECT_EQ(tf_fuse(service.get(), nullptr, readings.data(), 1, nullptr, &options, &result), TF_INVALID_ARGUMENT);
+}
+
+TEST(TelemetryFuserTest, ThreadsShareAServiceWithTheirOwnWorkspaces) {
+    ServicePtr service(tf_service_create());
+    const double expected = Service().fuse_readings({4, 5, 6, 7, 100});
+
+    std::vector<std::thread> threads;
+    std::vector<int> failures(4, 0);
+    for (size_t t = 0; t < failures.size(); ++t) {
+        threads.emplace_back([&, t]() {
+            WorkspacePtr workspace(tf_workspace_create());
+            const double readings[] = {4, 5, 6, 7, 100};
+            const double bad[] = {std::numeric_limits<double>::infinity()};
+            tf_result result;
+            for (int i = 0; i < 2000; ++i) {
+                if (i % 100 == 0) {
+                    // Errors stay with the thread that caused them
+                    if (tf_fuse(service.get(), workspace.get(), bad, 1, nullptr, nullptr, &result) == TF_OK) {
+                        failures[t]++;
+                    }
+                }
+                if (tf_fuse(service.get(), workspace.get(), readings, 5, nullptr, nullptr, &result) != TF_OK ||
+                    result.value != expected || tf_last_error()[0] != '\0') {
+                    failures[t]++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (int count : failures) EXPECT_EQ(count, 0);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "series_store.hpp"
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+// Fixtures shared by more than one test binary
+namespace test_helpers {
+
+// A store configuration that seals a segment every `points` points
+inline cpp_service::SeriesStore::Config segments_of(size_t points) {
+    cpp_service::SeriesStore::Config config;
+    config.segment_points = points;
+    return config;
+}
+
+// Polls `condition` until it holds or `limit` passes
+template <typename Condition>
+bool eventually(Condition condition, std::chrono::milliseconds limit = std::chrono::milliseconds(10000)) {
+    auto deadline = std::chrono::steady_clock::now() + limit;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (condition()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return condition();
+}
+
+} // namespace test_helpers
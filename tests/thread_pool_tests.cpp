@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include "thread_pool.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using cpp_service::ThreadPool;
+
+TEST(ThreadPoolTest, ParallelForCoversEveryIndexOnce) {
+    ThreadPool pool(3);
+    for (size_t count : {0u, 1u, 3u, 4u, 1000u}) {
+        std::vector<std::atomic<int>> hits(count);
+        pool.parallel_for(count, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) hits[i]++;
+        });
+        for (size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(hits[i].load(), 1) << "count " << count << " index " << i;
+        }
+    }
+}
+
+TEST(ThreadPoolTest, WorksWithoutWorkers) {
+    ThreadPool pool(0);
+    int sum = 0;
+    pool.parallel_for(10, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) sum += static_cast<int>(i);
+    });
+    EXPECT_EQ(sum, 45);
+}
+
+TEST(ThreadPoolTest, SubmitAndExceptions) {
+    ThreadPool pool(2);
+    std::atomic<int> ran{0};
+    auto future = pool.submit([&] { ran++; });
+    future.get();
+    EXPECT_EQ(ran.load(), 1);
+
+    EXPECT_THROW(pool.parallel_for(100, [](size_t begin, size_t) {
+        if (begin > 0) throw std::runtime_error("chunk failed");
+    }), std::runtime_error);
+
+    // The pool stays usable after a failed batch
+    std::atomic<size_t> total{0};
+    pool.parallel_for(100, [&](size_t begin, size_t end) { total += end - begin; });
+    EXPECT_EQ(total.load(), 100u);
+}
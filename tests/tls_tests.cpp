@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "../third_party/simple_http.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+
+#ifdef SIMPLE_HTTP_OPENSSL
+
+namespace {
+
+// HTTPS echo server on an ephemeral port with a fresh self-signed certificate,
+// blocking or busy-poll
+class TlsTest : public ::testing::TestWithParam<bool> {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(simple_http::make_self_signed_certificate("localhost", certificate_, key_));
+        server_.post("/echo", [](const simple_http::Request& req, simple_http::Response& res) {
+            res.text(req.body);
+        });
+        simple_http::TlsOptions tls;
+        tls.certificate_pem = certificate_;
+        tls.private_key_pem = key_;
+        server_.set_tls(tls);
+        if (GetParam()) {
+            simple_http::BusyPollOptions options;
+            options.threads = 1;
+            options.max_spin = std::chrono::microseconds(200);
+            server_.set_busy_poll(options);
+        }
+        thread_ = std::thread([this]() { server_.run(); });
+        while (server_.port() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    void TearDown() override {
+        server_.stop();
+        thread_.join();
+    }
+
+    simple_http::ClientTlsOptions client_options() const {
+        simple_http::ClientTlsOptions options;
+        options.ca_pem = certificate_;
+        options.server_name = "localhost";
+        return options;
+    }
+
+    std::string certificate_;
+    std::string key_;
+    simple_http::Server server_{0};
+    std::thread thread_;
+};
+
+} // namespace
+
+TEST_P(TlsTest, RoundTripsAndResumesSessions) {
+    simple_http::Client client("127.0.0.1", server_.port(), client_options());
+    simple_http::Response response;
+    ASSERT_TRUE(client.request("POST", "/echo", "over tls", response));
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_EQ(response.body, "over tls");
+    EXPECT_FALSE(client.session_resumed());
+
+    // A large body crosses many records and, in busy-poll mode, partial writes
+    std::string large(1 << 20, 'x');
+    for (size_t i = 0; i < large.size(); i += 4096) large[i] = static_cast<char>('a' + i / 4096 % 26);
+    ASSERT_TRUE(client.request("POST", "/echo", large, response));
+    EXPECT_EQ(response.body, large);
+
+    // A new connection presents the ticket from the first one
+    client.disconnect();
+    ASSERT_TRUE(client.request("POST", "/echo", "again", response));
+    EXPECT_EQ(response.body, "again");
+    EXPECT_TRUE(client.session_resumed());
+
+    simple_http::TlsStats stats = server_.tls_stats();
+    EXPECT_GE(stats.handshakes, 2u);
+    EXPECT_GE(stats.resumed, 1u);
+    EXPECT_EQ(stats.failures, 0u);
+    EXPECT_LE(stats.ktls_send, stats.handshakes);
+}
+
+TEST_P(TlsTest, RejectsPlainTextAndUntrustedPeers) {
+    simple_http::Response response;
+    simple_http::Client plain("127.0.0.1", server_.port());
+    EXPECT_FALSE(plain.request("POST", "/echo", "plain", response) && response.status_code == 200);
+
+    // Verification against a different self-signed CA fails the handshake
+    std::string other_certificate;
+    std::string other_key;
+    ASSERT_TRUE(simple_http::make_self_signed_certificate("localhost", other_certificate, other_key));
+    simple_http::ClientTlsOptions untrusted = client_options();
+    untrusted.ca_pem = other_certificate;
+    simple_http::Client client("127.0.0.1", server_.port(), untrusted);
+    EXPECT_FALSE(client.request("POST", "/echo", "hello", response));
+
+    // So does a name the certificate does not cover
+    simple_http::ClientTlsOptions wrong_name = client_options();
+    wrong_name.server_name = "example.com";
+    simple_http::Client misnamed("127.0.0.1", server_.port(), wrong_name);
+    EXPECT_FALSE(misnamed.request("POST", "/echo", "hello", response));
+
+    // The server keeps serving trusted clients
+    simple_http::Client trusted("127.0.0.1", server_.port(), client_options());
+    ASSERT_TRUE(trusted.request("POST", "/echo", "still here", response));
+    EXPECT_EQ(response.body, "still here");
+    EXPECT_GE(server_.tls_stats().failures, 2u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, TlsTest, ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return info.param ? "BusyPoll" : "Blocking";
+                         });
+
+TEST(TlsConfigTest, RejectsMismatchedKey) {
+    std::string certificate;
+    std::string key;
+    std::string other_certificate;
+    std::string other_key;
+    ASSERT_TRUE(simple_http::make_self_signed_certificate("localhost", certificate, key));
+    ASSERT_TRUE(simple_http::make_self_signed_certificate("localhost", other_certificate, other_key));
+
+    simple_http::Server server(0);
+    simple_http::TlsOptions tls;
+    tls.certificate_pem = certificate;
+    tls.private_key_pem = other_key;
+    EXPECT_THROW(server.set_tls(tls), std::runtime_error);
+    tls.certificate_pem.clear();
+    tls.certificate_file = "/nonexistent/cert.pem";
+    tls.private_key_file = "/nonexistent/key.pem";
+    EXPECT_THROW(server.set_tls(tls), std::runtime_error);
+}
+
+#else
+
+TEST(TlsConfigTest, ReportsMissingSupport) {
+    simple_http::Server server(0);
+    EXPECT_THROW(server.set_tls(simple_http::TlsOptions()), std::runtime_error);
+}
+
+#endif
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <functional>
 #include <thread>
 #include <atomic>
@@ -9,6 +16,12 @@
 #include <iostream>
 #include <memory>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -18,21 +31,68 @@
 #else
     #include <sys/socket.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <poll.h>
     #include <unistd.h>
 #endif
+#ifdef __linux__
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+#ifdef SIMPLE_HTTP_OPENSSL
+    #include <openssl/err.h>
+    #include <openssl/evp.h>
+    #include <openssl/pem.h>
+    #include <openssl/ssl.h>
+    #include <openssl/x509.h>
+    #include <openssl/x509v3.h>
+#endif
 
 namespace simple_http {
 
 struct Request {
     std::string method;
-    std::string path;
+    std::string path;     // without the query string
+    std::string query;    // after '?', e.g. "stale=true&limit=10"
+    std::string version;  // e.g. "HTTP/1.1"
     std::unordered_map<std::string, std::string> headers;
     std::string body;
+    std::string remote_address;  // peer's IPv4 address, as the server saw it
+    
+    // Value of `name` in the query string ("" for a bare key), not
+    // percent-decoded; `fallback` when the key is absent
+    std::string query_param(const std::string& name, const std::string& fallback = "") const {
+        size_t start = 0;
+        while (start <= query.size()) {
+            size_t end = query.find('&', start);
+            if (end == std::string::npos) end = query.size();
+            size_t equals = query.find('=', start);
+            size_t key_end = equals < end ? equals : end;
+            if (query.compare(start, key_end - start, name) == 0 && key_end - start == name.size()) {
+                return equals < end ? query.substr(equals + 1, end - equals - 1) : "";
+            }
+            start = end + 1;
+        }
+        return fallback;
+    }
     
     std::string get_header(const std::string& name) const {
         auto it = headers.find(name);
-        return (it != headers.end()) ? it->second : "";
+        if (it != headers.end()) return it->second;
+        
+        // Header names are case-insensitive on the wire
+        for (const auto& header : headers) {
+            if (header.first.size() == name.size() &&
+                std::equal(name.begin(), name.end(), header.first.begin(), [](char a, char b) {
+                    return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+                })) {
+                return header.second;
+            }
+        }
+        return "";
     }
 };
 
@@ -61,10 +121,525 @@ struct Response {
 
 using Handler = std::function<void(const Request&, Response&)>;
 
+// Request capture for offline, timing-faithful replay (benchmarks/http_replay).
+// Sampled requests are encoded on the serving thread into a memory buffer that
+// a background thread appends to the file, so serving never waits on disk;
+// once `max_buffered_bytes` are pending, further records are dropped and
+// counted instead.
+//
+// File layout: the magic "SHCAP\0\0\1", then one record per request with
+// every integer a LEB128 varint and every string its length then its bytes:
+//   arrival delta in ns (from the previous record; the first from capture start)
+//   method, path (with any query string), header count, name/value pairs, body
+struct CaptureOptions {
+    std::string path;
+    double sample_rate = 1.0;  // fraction of requests kept, evenly spaced
+    size_t max_buffered_bytes = 64 * 1024 * 1024;
+    std::chrono::milliseconds flush_interval{100};
+};
+
+struct CaptureStats {
+    uint64_t seen = 0;
+    uint64_t captured = 0;
+    uint64_t dropped = 0;  // sampled but over the buffer limit
+    uint64_t bytes_written = 0;
+};
+
+struct CapturedRequest {
+    uint64_t arrival_ns = 0;  // since capture start
+    Request request;
+};
+
+// Evenly spaced sampling of a stream: item n (counting from 0) is kept when
+// floor((n + 1) p) steps past floor(n p), so any run of items keeps its share
+// to within one
+inline bool keep_sampled(uint64_t n, double rate) {
+    return rate >= 1.0 || std::floor(static_cast<double>(n + 1) * rate) != std::floor(static_cast<double>(n) * rate);
+}
+
+// Pins the calling thread to `cpu` (wrapped to CPU_SETSIZE); a negative `cpu`,
+// or a platform without thread affinity, leaves placement to the kernel
+inline void pin_thread_to_cpu(int cpu) {
+#ifdef __linux__
+    if (cpu < 0) return;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(static_cast<size_t>(cpu) % CPU_SETSIZE, &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+    (void)cpu;
+#endif
+}
+
+namespace capture_detail {
+
+constexpr char kMagic[8] = {'S', 'H', 'C', 'A', 'P', '\0', '\0', '\1'};
+
+inline void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline void put_string(std::string& out, const std::string& value) {
+    put_varint(out, value.size());
+    out += value;
+}
+
+} // namespace capture_detail
+
+class CaptureWriter {
+public:
+    // Throws when the file can't be created
+    explicit CaptureWriter(const CaptureOptions& options)
+        : options_(options), last_arrival_(std::chrono::steady_clock::now()) {
+        file_ = std::fopen(options.path.c_str(), "wb");
+        if (!file_) throw std::runtime_error("Cannot open capture file " + options.path);
+        std::fwrite(capture_detail::kMagic, 1, sizeof(capture_detail::kMagic), file_);
+        written_ = sizeof(capture_detail::kMagic);
+        thread_ = std::thread([this]() { writer_loop(); });
+    }
+    
+    // Writes out everything still buffered
+    ~CaptureWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+        std::fclose(file_);
+    }
+    
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+    
+    // Safe from any thread; `arrival` is when the request was complete
+    void record(const Request& request, std::chrono::steady_clock::time_point arrival) {
+        if (!keep_sampled(seen_.fetch_add(1, std::memory_order_relaxed), options_.sample_rate)) {
+            return;
+        }
+        
+        thread_local std::string encoded;
+        encoded.clear();
+        capture_detail::put_string(encoded, request.method);
+        capture_detail::put_string(encoded, request.query.empty() ? request.path : request.path + "?" + request.query);
+        capture_detail::put_varint(encoded, request.headers.size());
+        for (const auto& header : request.headers) {
+            capture_detail::put_string(encoded, header.first);
+            capture_detail::put_string(encoded, header.second);
+        }
+        capture_detail::put_string(encoded, request.body);
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (buffer_.size() + encoded.size() > options_.max_buffered_bytes) {
+            dropped_++;
+            return;
+        }
+        // Arrivals stamped on different threads may land slightly out of order
+        auto delta = std::max(arrival, last_arrival_) - last_arrival_;
+        last_arrival_ = std::max(arrival, last_arrival_);
+        capture_detail::put_varint(buffer_,
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(delta).count()));
+        buffer_ += encoded;
+        captured_++;
+    }
+    
+    CaptureStats stats() const {
+        CaptureStats stats;
+        stats.seen = seen_.load();
+        stats.captured = captured_.load();
+        stats.dropped = dropped_.load();
+        stats.bytes_written = written_.load();
+        return stats;
+    }
+    
+private:
+    void writer_loop() {
+        std::string pending;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait_for(lock, options_.flush_interval, [this] { return stopping_; });
+            pending.swap(buffer_);
+            bool stopping = stopping_;
+            lock.unlock();
+            if (!pending.empty()) {
+                written_ += std::fwrite(pending.data(), 1, pending.size(), file_);
+                std::fflush(file_);
+                pending.clear();
+            }
+            if (stopping) return;
+            lock.lock();
+        }
+    }
+    
+    CaptureOptions options_;
+    FILE* file_ = nullptr;
+    std::chrono::steady_clock::time_point last_arrival_;  // capture start at first; guarded by mutex_
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::string buffer_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> seen_{0};
+    std::atomic<uint64_t> captured_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> written_{0};
+    std::thread thread_;
+};
+
+// Streams records back out of a capture file
+class CaptureReader {
+public:
+    CaptureReader() = default;
+    ~CaptureReader() {
+        if (file_) std::fclose(file_);
+    }
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+    
+    // False if the file is missing or not a capture
+    bool open(const std::string& path) {
+        file_ = std::fopen(path.c_str(), "rb");
+        char magic[sizeof(capture_detail::kMagic)];
+        return file_ && std::fread(magic, 1, sizeof(magic), file_) == sizeof(magic) &&
+               std::equal(magic, magic + sizeof(magic), capture_detail::kMagic);
+    }
+    
+    // False at the end of the file or on a truncated record (a capture cut
+    // short by a crash still yields every complete record before the cut)
+    bool next(CapturedRequest& captured) {
+        uint64_t delta = 0;
+        uint64_t header_count = 0;
+        captured.request = Request();
+        if (!file_ || !read_varint(delta) || !read_string(captured.request.method) ||
+            !read_string(captured.request.path) || !read_varint(header_count)) {
+            return false;
+        }
+        size_t question = captured.request.path.find('?');
+        if (question != std::string::npos) {
+            captured.request.query = captured.request.path.substr(question + 1);
+            captured.request.path.resize(question);
+        }
+        for (uint64_t i = 0; i < header_count; ++i) {
+            std::string name;
+            std::string value;
+            if (!read_string(name) || !read_string(value)) return false;
+            captured.request.headers[name] = std::move(value);
+        }
+        if (!read_string(captured.request.body)) return false;
+        arrival_ns_ += delta;
+        captured.arrival_ns = arrival_ns_;
+        return true;
+    }
+    
+private:
+    bool read_varint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = std::fgetc(file_);
+            if (byte == EOF) return false;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+    
+    bool read_string(std::string& value) {
+        uint64_t size = 0;
+        if (!read_varint(size) || size > (uint64_t(1) << 32)) return false;
+        value.resize(static_cast<size_t>(size));
+        return size == 0 || std::fread(&value[0], 1, value.size(), file_) == value.size();
+    }
+    
+    FILE* file_ = nullptr;
+    uint64_t arrival_ns_ = 0;
+};
+
+// Identifies a request whose response is produced later (busy-poll mode only)
+struct Ticket {
+    unsigned loop;        // event loop that owns the connection
+    uint64_t connection;  // loop-local connection id
+    uint64_t sequence;    // position in the connection's response order
+};
+
+// Either fills in `response` and returns false, like a Handler, or keeps the
+// ticket and returns true; the response is then delivered with
+// Server::complete() from that loop's hook. The request is the handler's to
+// move from (a large body need not be copied to outlive the call).
+using DeferredHandler = std::function<bool(Request&, Response&, const Ticket&)>;
+
+// Runs on every iteration of event loop `loop`; returns true if it did work
+using LoopHook = std::function<bool(unsigned loop)>;
+
+// Opt-in alternative to the blocking thread-per-connection accept loop:
+// `threads` event loops, optionally pinned to dedicated cores, spin over
+// non-blocking sockets and only park in poll() after a stretch without work.
+// Spinning removes the scheduler wakeup from the request path at the cost of
+// a busy core per loop. Connections are kept alive between requests.
+struct BusyPollOptions {
+    unsigned threads = 1;
+    int first_cpu = -1;            // pin loop i to CPU first_cpu + i; -1 leaves placement to the kernel
+    int socket_busy_poll_us = 50;  // SO_BUSY_POLL on accepted sockets (0 = off); the kernel may cap it
+    // Idle time before a loop parks; adapted between the bounds: doubled when
+    // work arrives right after parking, halved after long parks
+    std::chrono::microseconds min_spin{50};
+    std::chrono::microseconds max_spin{5000};
+};
+
+// TLS termination; needs a build against OpenSSL (SIMPLE_HTTP_OPENSSL).
+// Certificate chain and key come from PEM files, or from memory when the
+// *_pem fields are set.
+struct TlsOptions {
+    std::string certificate_file;
+    std::string private_key_file;
+    std::string certificate_pem;
+    std::string private_key_pem;
+    // Ask OpenSSL to hand the record layer to the kernel (kTLS) once the
+    // handshake is done; sends then go to the socket as plain send() calls.
+    // Stays in user space when the kernel, OpenSSL build or cipher can't.
+    bool ktls = true;
+    bool session_resumption = true;  // server session cache and TLS 1.3 tickets
+};
+
+// Client side of the same; verification uses the system trust store unless a
+// CA is given
+struct ClientTlsOptions {
+    bool verify_peer = true;
+    std::string ca_file;
+    std::string ca_pem;
+    std::string server_name;  // SNI and hostname check; defaults to the host
+    bool resume_sessions = true;
+};
+
+// Counters since the server was configured
+struct TlsStats {
+    uint64_t handshakes = 0;
+    uint64_t resumed = 0;    // of which abbreviated (session resumption)
+    uint64_t failures = 0;
+    uint64_t ktls_send = 0;  // connections whose sends the kernel encrypts
+    uint64_t ktls_recv = 0;  // connections whose receives the kernel decrypts
+};
+
+#ifdef SIMPLE_HTTP_OPENSSL
+inline constexpr bool tls_supported = true;
+
+namespace tls_detail {
+
+struct SslDeleter {
+    void operator()(SSL* ssl) const { SSL_free(ssl); }
+};
+struct ContextDeleter {
+    void operator()(SSL_CTX* context) const { SSL_CTX_free(context); }
+};
+using SslPtr = std::unique_ptr<SSL, SslDeleter>;
+using ContextPtr = std::unique_ptr<SSL_CTX, ContextDeleter>;
+
+inline std::string last_error() {
+    unsigned long code = ERR_get_error();
+    ERR_clear_error();
+    if (code == 0) return "unknown error";
+    char text[256];
+    ERR_error_string_n(code, text, sizeof(text));
+    return text;
+}
+
+// OpenSSL's socket BIO writes with write(), which raises SIGPIPE on a reset
+// connection where the plain path passes MSG_NOSIGNAL
+inline void ignore_sigpipe() {
+#ifdef SIGPIPE
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+}
+
+inline X509* read_certificate(const std::string& pem) {
+    BIO* bio = BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size()));
+    X509* certificate = bio ? PEM_read_bio_X509(bio, nullptr, nullptr, nullptr) : nullptr;
+    BIO_free(bio);
+    return certificate;
+}
+
+// Maps an SSL_read/SSL_write result onto the recv()/send() convention: bytes
+// moved, 0 once the peer has closed, or -1 with errno (EAGAIN while a
+// non-blocking session waits for the socket)
+inline long io_result(SSL* ssl, int result, bool& want_write) {
+    if (result > 0) return result;
+    int error = SSL_get_error(ssl, result);
+    if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+        want_write = error == SSL_ERROR_WANT_WRITE;
+        errno = EAGAIN;
+        return -1;
+    }
+    ERR_clear_error();
+    if (error == SSL_ERROR_ZERO_RETURN) return 0;
+    if (error == SSL_ERROR_SYSCALL && errno == 0) return 0;  // EOF without close_notify
+    if (error != SSL_ERROR_SYSCALL) errno = ECONNRESET;
+    return -1;
+}
+
+} // namespace tls_detail
+
+// Self-signed P-256 certificate for `common_name` (also its DNS subject
+// alternative name), valid for a year; for tests and local benchmarks
+inline bool make_self_signed_certificate(const std::string& common_name, std::string& certificate_pem,
+                                         std::string& private_key_pem) {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* key_context = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    bool ok = key_context && EVP_PKEY_keygen_init(key_context) > 0 &&
+              EVP_PKEY_CTX_set_ec_paramgen_curve_nid(key_context, NID_X9_62_prime256v1) > 0 &&
+              EVP_PKEY_keygen(key_context, &key) > 0;
+    EVP_PKEY_CTX_free(key_context);
+    X509* certificate = ok ? X509_new() : nullptr;
+    if (certificate) {
+        X509_set_version(certificate, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+        X509_gmtime_adj(X509_getm_notBefore(certificate), -3600);
+        X509_gmtime_adj(X509_getm_notAfter(certificate), 365L * 24 * 3600);
+        X509_set_pubkey(certificate, key);
+        X509_NAME* name = X509_get_subject_name(certificate);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                   reinterpret_cast<const unsigned char*>(common_name.c_str()), -1, -1, 0);
+        X509_set_issuer_name(certificate, name);
+        X509V3_CTX extension_context;
+        X509V3_set_ctx_nodb(&extension_context);
+        X509V3_set_ctx(&extension_context, certificate, certificate, nullptr, nullptr, 0);
+        std::string alt_name = "DNS:" + common_name;
+        X509_EXTENSION* extension = X509V3_EXT_conf_nid(nullptr, &extension_context, NID_subject_alt_name,
+                                                        alt_name.c_str());
+        ok = extension && X509_add_ext(certificate, extension, -1) == 1 &&
+             X509_sign(certificate, key, EVP_sha256()) > 0;
+        X509_EXTENSION_free(extension);
+    }
+    
+    auto to_pem = [](auto write) {
+        std::string pem;
+        BIO* bio = BIO_new(BIO_s_mem());
+        if (bio && write(bio)) {
+            char* data = nullptr;
+            long size = BIO_get_mem_data(bio, &data);
+            pem.assign(data, static_cast<size_t>(size));
+        }
+        BIO_free(bio);
+        return pem;
+    };
+    if (ok) {
+        certificate_pem = to_pem([&](BIO* bio) { return PEM_write_bio_X509(bio, certificate) == 1; });
+        private_key_pem = to_pem([&](BIO* bio) {
+            return PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+        });
+        ok = !certificate_pem.empty() && !private_key_pem.empty();
+    }
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+    ERR_clear_error();
+    return ok;
+}
+#else
+inline constexpr bool tls_supported = false;
+#endif
+
+namespace detail {
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// Dotted IPv4 address of a connected socket's peer; empty for other families
+inline std::string peer_address(int fd) {
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    char text[INET_ADDRSTRLEN] = {};
+    if (getpeername(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0 || address.sin_family != AF_INET ||
+        !inet_ntop(AF_INET, &address.sin_addr, text, sizeof(text))) {
+        return std::string();
+    }
+    return text;
+}
+
+// A connected socket, optionally carrying a TLS session. read() and write()
+// follow the recv()/send() conventions whether or not the socket blocks.
+struct Stream {
+    int fd = -1;
+    std::string peer;          // peer_address(fd)
+#ifdef SIMPLE_HTTP_OPENSSL
+    tls_detail::SslPtr tls;    // null for plain connections
+    bool kernel_send = false;  // kTLS owns sends: write() bypasses SSL_write
+#endif
+    bool want_write = false;   // TLS is waiting for the socket to drain
+    
+    long read(char* buffer, size_t size) {
+#ifdef SIMPLE_HTTP_OPENSSL
+        if (tls) {
+            ERR_clear_error();
+            return tls_detail::io_result(tls.get(), SSL_read(tls.get(), buffer, static_cast<int>(size)), want_write);
+        }
+#endif
+        return recv(fd, buffer, size, 0);
+    }
+    
+    long write(const char* data, size_t size) {
+#ifdef SIMPLE_HTTP_OPENSSL
+        if (tls && !kernel_send) {
+            ERR_clear_error();
+            return tls_detail::io_result(tls.get(), SSL_write(tls.get(), data, static_cast<int>(size)), want_write);
+        }
+#endif
+        return send(fd, data, size, kSendFlags);
+    }
+    
+    // Decrypted or buffered bytes a socket readiness check would not see
+    bool pending() const {
+#ifdef SIMPLE_HTTP_OPENSSL
+        return tls && SSL_has_pending(tls.get());
+#else
+        return false;
+#endif
+    }
+    
+    // For blocking sockets
+    bool write_all(const char* data, size_t size) {
+        size_t offset = 0;
+        while (offset < size) {
+            long sent = write(data + offset, size - offset);
+            if (sent <= 0) {
+                if (sent == -1 && errno == EINTR) continue;
+                return false;
+            }
+            offset += static_cast<size_t>(sent);
+        }
+        return true;
+    }
+    
+    // Sends close_notify when a session is established, then closes
+    void close_socket(bool established = true) {
+        if (fd == -1) return;
+#ifdef SIMPLE_HTTP_OPENSSL
+        if (tls && established) {
+            ERR_clear_error();
+            SSL_shutdown(tls.get());
+            ERR_clear_error();
+        }
+        tls.reset();
+#endif
+        close(fd);
+        fd = -1;
+    }
+};
+
+} // namespace detail
+
 class Server {
 public:
     Server(int port = 8080) : port_(port), running_(false) {}
     
+    // Upper bound on the (still encoded) request body; larger bodies get 413
+    void set_max_body_size(size_t bytes) {
+        max_body_size_ = bytes;
+    }
+    
     void get(const std::string& path, Handler handler) {
         routes_["GET"][path] = handler;
     }
@@ -73,34 +648,136 @@ public:
         routes_["POST"][path] = handler;
     }
     
-    void run() {
-        running_ = true;
+    // Switches run() to busy-polling event loops (call before run())
+    void set_busy_poll(const BusyPollOptions& options) {
+        busy_poll_ = options;
+        busy_poll_enabled_ = true;
+    }
+    
+    // Routes that may answer asynchronously; they need busy-poll mode, the
+    // blocking server answers them with 500
+    void post_deferred(const std::string& path, DeferredHandler handler) {
+        deferred_routes_["POST"][path] = handler;
+    }
+    
+    void set_loop_hook(LoopHook hook) {
+        loop_hook_ = std::move(hook);
+    }
+    
+    // Serves HTTPS instead of HTTP (call before run()); throws when the
+    // certificate or key can't be loaded or TLS support is not compiled in
+    void set_tls(const TlsOptions& options) {
+#ifdef SIMPLE_HTTP_OPENSSL
+        tls_detail::ContextPtr context(SSL_CTX_new(TLS_server_method()));
+        if (!context) throw std::runtime_error("TLS: " + tls_detail::last_error());
+        SSL_CTX_set_min_proto_version(context.get(), TLS1_2_VERSION);
+        // Non-blocking writes may be partial and retried from a grown buffer
+        SSL_CTX_set_mode(context.get(), SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
         
-        // Simple socket server implementation
-        int server_fd = socket(AF_INET, SOCK_STREAM, 0);
-        if (server_fd == -1) {
-            throw std::runtime_error("Failed to create socket");
+        bool loaded;
+        if (!options.certificate_pem.empty()) {
+            X509* certificate = tls_detail::read_certificate(options.certificate_pem);
+            BIO* bio = BIO_new_mem_buf(options.private_key_pem.data(), static_cast<int>(options.private_key_pem.size()));
+            EVP_PKEY* key = bio ? PEM_read_bio_PrivateKey(bio, nullptr, nullptr, nullptr) : nullptr;
+            loaded = certificate && key && SSL_CTX_use_certificate(context.get(), certificate) == 1 &&
+                     SSL_CTX_use_PrivateKey(context.get(), key) == 1;
+            EVP_PKEY_free(key);
+            BIO_free(bio);
+            X509_free(certificate);
+        } else {
+            loaded = SSL_CTX_use_certificate_chain_file(context.get(), options.certificate_file.c_str()) == 1 &&
+                     SSL_CTX_use_PrivateKey_file(context.get(), options.private_key_file.c_str(),
+                                                 SSL_FILETYPE_PEM) == 1;
         }
-        
-        int opt = 1;
-        if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1) {
-            throw std::runtime_error("Failed to set socket options");
+        if (!loaded || SSL_CTX_check_private_key(context.get()) != 1) {
+            throw std::runtime_error("TLS: cannot load certificate and key: " + tls_detail::last_error());
         }
         
-        sockaddr_in address;
-        address.sin_family = AF_INET;
-        address.sin_addr.s_addr = INADDR_ANY;
-        address.sin_port = htons(port_);
+        if (options.session_resumption) {
+            static const unsigned char session_context[] = "simple_http";
+            SSL_CTX_set_session_id_context(context.get(), session_context, sizeof(session_context) - 1);
+            SSL_CTX_set_session_cache_mode(context.get(), SSL_SESS_CACHE_SERVER);
+        } else {
+            SSL_CTX_set_session_cache_mode(context.get(), SSL_SESS_CACHE_OFF);
+            SSL_CTX_set_options(context.get(), SSL_OP_NO_TICKET);
+            SSL_CTX_set_num_tickets(context.get(), 0);
+        }
+#ifdef SSL_OP_ENABLE_KTLS
+        if (options.ktls) {
+            SSL_CTX_set_options(context.get(), SSL_OP_ENABLE_KTLS);
+        }
+#endif
+        tls_detail::ignore_sigpipe();
+        tls_context_ = std::move(context);
+#else
+        (void)options;
+        throw std::runtime_error("TLS support is not compiled in (build with OpenSSL)");
+#endif
+    }
+    
+    // Records sampled requests for replay (call before run()); the file is
+    // complete once the server is destroyed. Throws if it can't be created.
+    void set_capture(const CaptureOptions& options) {
+        capture_ = std::make_unique<CaptureWriter>(options);
+    }
+    
+    CaptureStats capture_stats() const {
+        return capture_ ? capture_->stats() : CaptureStats();
+    }
+    
+    TlsStats tls_stats() const {
+        TlsStats stats;
+        stats.handshakes = tls_handshakes_.load();
+        stats.resumed = tls_resumed_.load();
+        stats.failures = tls_failures_.load();
+        stats.ktls_send = tls_ktls_send_.load();
+        stats.ktls_recv = tls_ktls_recv_.load();
+        return stats;
+    }
+    
+#ifndef _WIN32
+    // Delivers the response for a deferred request. Must be called on the
+    // ticket's own loop thread (i.e. from the loop hook), once per ticket;
+    // responses for connections that have since closed are discarded.
+    void complete(const Ticket& ticket, const Response& response) {
+        Loop& loop = *loops_[ticket.loop];
+        loop.deferred--;
+        auto it = loop.connections.find(ticket.connection);
+        if (it == loop.connections.end()) return;
+        for (auto& slot : it->second.slots) {
+            if (slot.sequence == ticket.sequence) {
+                slot.data = serialize_response(response, slot.keep_alive);
+                slot.ready = true;
+                break;
+            }
+        }
+        release_ready(it->second);
+    }
+#endif
+    
+    // The bound port once run() is listening (useful with port 0), else 0
+    int port() const {
+        return bound_port_;
+    }
+    
+    void run() {
+        running_ = true;
         
-        if (bind(server_fd, (sockaddr*)&address, sizeof(address)) == -1) {
-            throw std::runtime_error("Failed to bind socket");
+#ifndef _WIN32
+        if (busy_poll_enabled_) {
+            run_busy_poll();
+            return;
         }
+#endif
         
-        if (listen(server_fd, 10) == -1) {
-            throw std::runtime_error("Failed to listen on socket");
+        // Simple socket server implementation
+        int server_fd = open_listener(false);
+        {
+            std::lock_guard<std::mutex> lock(listener_mutex_);
+            listener_fd_ = server_fd;
         }
         
-        std::cout << "Server listening on port " << port_ << std::endl;
+        std::cout << "Server listening on port " << bound_port_.load() << std::endl;
         
         while (running_) {
             sockaddr_in client_address;
@@ -113,6 +790,11 @@ public:
                 }
                 continue;
             }
+            if (!running_) {
+                // Accepted as stop() ran; this Server may be gone before a handler would
+                close(client_fd);
+                break;
+            }
             
             // Handle request in thread
             std::thread([this, client_fd]() {
@@ -121,26 +803,161 @@ public:
             }).detach();
         }
         
+        {
+            std::lock_guard<std::mutex> lock(listener_mutex_);
+            listener_fd_ = -1;
+        }
         close(server_fd);
     }
     
+    // Makes run() return; a blocking accept() is woken by shutting the
+    // listener down, so no further connection is needed
     void stop() {
         running_ = false;
+        std::lock_guard<std::mutex> lock(listener_mutex_);
+        if (listener_fd_ != -1) {
+            shutdown(listener_fd_, SHUT_RDWR);
+        }
     }
     
 private:
-    void handle_client(int client_fd) {
-        char buffer[4096] = {0};
-        int bytes_read = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
+    int open_listener(bool reuse_port) {
+        int server_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (server_fd == -1) {
+            throw std::runtime_error("Failed to create socket");
+        }
+        
+        int opt = 1;
+        if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1) {
+            throw std::runtime_error("Failed to set socket options");
+        }
+#ifdef SO_REUSEPORT
+        // One listener per event loop; the kernel spreads connections across them
+        if (reuse_port && setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1) {
+            throw std::runtime_error("Failed to set socket options");
+        }
+#endif
+        
+        sockaddr_in address;
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(static_cast<uint16_t>(bound_port_ ? bound_port_.load() : port_));
         
-        if (bytes_read <= 0) return;
+        if (bind(server_fd, (sockaddr*)&address, sizeof(address)) == -1) {
+            throw std::runtime_error("Failed to bind socket");
+        }
         
-        buffer[bytes_read] = '\0';
-        std::string request_str(buffer);
+        if (listen(server_fd, reuse_port ? 1024 : 10) == -1) {
+            throw std::runtime_error("Failed to listen on socket");
+        }
         
-        auto request = parse_request(request_str);
+        socklen_t address_len = sizeof(address);
+        if (getsockname(server_fd, (sockaddr*)&address, &address_len) == 0) {
+            bound_port_ = ntohs(address.sin_port);
+        }
+        return server_fd;
+    }
+    
+    void handle_client(int client_fd) {
+        detail::Stream stream;
+        stream.fd = client_fd;
+        stream.peer = detail::peer_address(client_fd);
+#ifdef SIMPLE_HTTP_OPENSSL
+        if (tls_context_) {
+            if (!start_tls(stream)) return;
+            ERR_clear_error();
+            if (SSL_accept(stream.tls.get()) != 1) {
+                tls_failures_++;
+                ERR_clear_error();
+                return;
+            }
+            finish_handshake(stream);
+        }
+#endif
+        char buffer[4096];
+        std::string raw;
+        size_t header_end = std::string::npos;
+        
+        // Read until the end of the header block
+        while (header_end == std::string::npos) {
+            auto bytes_read = stream.read(buffer, sizeof(buffer));
+            if (bytes_read <= 0) return;
+            raw.append(buffer, static_cast<size_t>(bytes_read));
+            header_end = raw.find("\r\n\r\n");
+            if (header_end == std::string::npos && raw.size() > max_header_size_) return;
+        }
+        
+        auto request = parse_request(raw.substr(0, header_end + 2));
+        request.remote_address = stream.peer;
         Response response;
         
+        // Read exactly Content-Length body bytes; bodies may be binary
+        size_t content_length = content_length_of(request);
+        
+        if (content_length > max_body_size_) {
+            response.status_code = 413;
+            response.text("Payload Too Large");
+            send_response(stream, response);
+            return;
+        }
+        
+        request.body = raw.substr(header_end + 4);
+        while (request.body.size() < content_length) {
+            auto bytes_read = stream.read(buffer, sizeof(buffer));
+            if (bytes_read <= 0) return;
+            request.body.append(buffer, static_cast<size_t>(bytes_read));
+        }
+        request.body.resize(content_length);
+        if (capture_) capture_->record(request, std::chrono::steady_clock::now());
+        
+        dispatch(request, response);
+        send_response(stream, response);
+#ifdef SIMPLE_HTTP_OPENSSL
+        if (stream.tls) {
+            ERR_clear_error();
+            SSL_shutdown(stream.tls.get());  // the caller closes the socket
+            ERR_clear_error();
+        }
+#endif
+    }
+    
+#ifdef SIMPLE_HTTP_OPENSSL
+    // Attaches a server-side session to an accepted socket
+    bool start_tls(detail::Stream& stream) {
+        stream.tls.reset(SSL_new(tls_context_.get()));
+        if (!stream.tls || SSL_set_fd(stream.tls.get(), stream.fd) != 1) {
+            tls_failures_++;
+            ERR_clear_error();
+            return false;
+        }
+        SSL_set_accept_state(stream.tls.get());
+        return true;
+    }
+    
+    void finish_handshake(detail::Stream& stream) {
+        SSL* ssl = stream.tls.get();
+        tls_handshakes_++;
+        if (SSL_session_reused(ssl)) tls_resumed_++;
+#if defined(BIO_get_ktls_send) && defined(BIO_get_ktls_recv)
+        stream.kernel_send = BIO_get_ktls_send(SSL_get_wbio(ssl));
+        if (stream.kernel_send) tls_ktls_send_++;
+        if (BIO_get_ktls_recv(SSL_get_rbio(ssl))) tls_ktls_recv_++;
+#endif
+    }
+#endif
+    
+    static size_t content_length_of(const Request& request) {
+        std::string content_length_str = request.get_header("Content-Length");
+        if (content_length_str.empty()) return 0;
+        return static_cast<size_t>(std::strtoull(content_length_str.c_str(), nullptr, 10));
+    }
+    
+    bool has_deferred_route(const Request& request) const {
+        auto method_it = deferred_routes_.find(request.method);
+        return method_it != deferred_routes_.end() && method_it->second.count(request.path) != 0;
+    }
+    
+    void dispatch(const Request& request, Response& response) {
         auto method_it = routes_.find(request.method);
         if (method_it != routes_.end()) {
             auto path_it = method_it->second.find(request.path);
@@ -151,6 +968,9 @@ private:
                     response.status_code = 500;
                     response.text("Internal Server Error: " + std::string(e.what()));
                 }
+            } else if (has_deferred_route(request)) {
+                response.status_code = 500;
+                response.text("Internal Server Error: route requires busy-poll mode");
             } else {
                 response.status_code = 404;
                 response.text("Not Found");
@@ -159,8 +979,6 @@ private:
             response.status_code = 405;
             response.text("Method Not Allowed");
         }
-        
-        send_response(client_fd, response);
     }
     
     Request parse_request(const std::string& request_str) {
@@ -171,7 +989,12 @@ private:
         // Parse request line
         if (std::getline(stream, line)) {
             std::istringstream line_stream(line);
-            line_stream >> request.method >> request.path;
+            line_stream >> request.method >> request.path >> request.version;
+            size_t question = request.path.find('?');
+            if (question != std::string::npos) {
+                request.query = request.path.substr(question + 1);
+                request.path.resize(question);
+            }
         }
         
         // Parse headers
@@ -189,18 +1012,10 @@ private:
             }
         }
         
-        // Parse body
-        std::ostringstream body_stream;
-        while (std::getline(stream, line)) {
-            body_stream << line;
-            if (!stream.eof()) body_stream << "\n";
-        }
-        request.body = body_stream.str();
-        
         return request;
     }
     
-    void send_response(int client_fd, const Response& response) {
+    static std::string serialize_response(const Response& response, bool keep_alive) {
         std::ostringstream response_stream;
         response_stream << "HTTP/1.1 " << response.status_code << " OK\r\n";
         
@@ -209,16 +1024,531 @@ private:
         }
         
         response_stream << "Content-Length: " << response.body.length() << "\r\n";
-        response_stream << "Connection: close\r\n\r\n";
+        response_stream << (keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
         response_stream << response.body;
+        return response_stream.str();
+    }
+    
+    void send_response(detail::Stream& stream, const Response& response) {
+        std::string response_str = serialize_response(response, false);
+        stream.write_all(response_str.data(), response_str.size());
+    }
+    
+#ifndef _WIN32
+    // A response in request order; deferred ones are filled in by complete()
+    struct ResponseSlot {
+        uint64_t sequence;
+        bool ready;
+        bool keep_alive;
+        std::string data;
+    };
+    
+    struct Connection {
+        detail::Stream stream;
+        bool handshaking = false;  // TLS handshake still in progress
+        std::string in;
+        std::string out;
+        size_t out_offset = 0;
+        bool close_after_write = false;
+        uint64_t next_sequence = 0;
+        std::deque<ResponseSlot> slots;  // responses not yet moved to `out`
+    };
+    
+    // Loop-local state; only its own loop thread touches it
+    struct Loop {
+        std::unordered_map<uint64_t, Connection> connections;
+        uint64_t next_connection = 0;
+        size_t deferred = 0;  // handed out tickets not yet completed
+    };
+    
+    void run_busy_poll() {
+        unsigned threads = std::max(1u, busy_poll_.threads);
+        std::vector<int> listeners;
+        for (unsigned i = 0; i < threads; ++i) {
+            listeners.push_back(open_listener(true));
+            fcntl(listeners.back(), F_SETFL, fcntl(listeners.back(), F_GETFL, 0) | O_NONBLOCK);
+        }
+        loops_.clear();
+        for (unsigned i = 0; i < threads; ++i) {
+            loops_.push_back(std::make_unique<Loop>());
+        }
+        
+        std::cout << "Server listening on port " << bound_port_.load() << " (busy-poll, " << threads
+                  << (threads == 1 ? " loop)" : " loops)") << std::endl;
+        
+        // The calling thread runs loop 0
+        std::vector<std::thread> loops;
+        for (unsigned i = 1; i < threads; ++i) {
+            loops.emplace_back([this, &listeners, i]() { busy_poll_loop(listeners[i], i); });
+        }
+        busy_poll_loop(listeners[0], 0);
+        for (auto& loop : loops) {
+            loop.join();
+        }
+        for (int listener : listeners) {
+            close(listener);
+        }
+    }
+    
+    void busy_poll_loop(int listener, unsigned index) {
+        pin_thread_to_cpu(busy_poll_.first_cpu >= 0 ? busy_poll_.first_cpu + static_cast<int>(index) : -1);
+        using Clock = std::chrono::steady_clock;
+        Loop& loop = *loops_[index];
+        std::vector<pollfd> poll_fds;
+        auto spin = busy_poll_.min_spin;
+        auto last_work = Clock::now();
         
-        std::string response_str = response_stream.str();
-        send(client_fd, response_str.c_str(), response_str.length(), 0);
+        while (running_) {
+            bool worked = false;
+            
+            int client_fd;
+            while ((client_fd = accept(listener, nullptr, nullptr)) != -1) {
+                fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL, 0) | O_NONBLOCK);
+                int one = 1;
+                setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_BUSY_POLL
+                if (busy_poll_.socket_busy_poll_us > 0) {
+                    // Best effort: raising it past net.core.busy_read needs CAP_NET_ADMIN
+                    setsockopt(client_fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_.socket_busy_poll_us,
+                               sizeof(busy_poll_.socket_busy_poll_us));
+                }
+#endif
+                Connection connection;
+                connection.stream.fd = client_fd;
+                connection.stream.peer = detail::peer_address(client_fd);
+#ifdef SIMPLE_HTTP_OPENSSL
+                if (tls_context_) {
+                    if (!start_tls(connection.stream)) {
+                        close(client_fd);
+                        continue;
+                    }
+                    connection.handshaking = true;
+                }
+#endif
+                loop.connections.emplace(loop.next_connection++, std::move(connection));
+                worked = true;
+            }
+            
+            for (auto it = loop.connections.begin(); it != loop.connections.end();) {
+                if (service_connection(index, it->first, it->second, worked)) {
+                    ++it;
+                } else {
+                    it->second.stream.close_socket(!it->second.handshaking);
+                    it = loop.connections.erase(it);
+                }
+            }
+            
+            if (loop_hook_ && loop_hook_(index)) {
+                worked = true;
+            }
+            
+            auto now = Clock::now();
+            if (worked) {
+                last_work = now;
+                continue;
+            }
+            // Deferred responses arrive through the hook, not a socket, so
+            // never park while any are outstanding. Yielding costs next to
+            // nothing on a dedicated core and keeps an oversubscribed one usable.
+            if (now - last_work < spin || loop.deferred > 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            
+            // Idle past the spin budget: park until a socket is ready
+            poll_fds.clear();
+            poll_fds.push_back(pollfd{listener, POLLIN, 0});
+            for (const auto& entry : loop.connections) {
+                const Connection& connection = entry.second;
+                bool writing = connection.out_offset < connection.out.size() || connection.stream.want_write;
+                poll_fds.push_back(pollfd{connection.stream.fd, static_cast<short>(writing ? POLLOUT : POLLIN), 0});
+            }
+            poll(poll_fds.data(), poll_fds.size(), 100);  // bounded so stop() is noticed
+            auto parked = Clock::now() - now;
+            if (parked < spin) {
+                spin = std::min(spin * 2, busy_poll_.max_spin);
+            } else if (parked > spin * 16) {
+                spin = std::max(spin / 2, busy_poll_.min_spin);
+            }
+            last_work = Clock::now();
+        }
+        
+        for (auto& entry : loop.connections) {
+            entry.second.stream.close_socket(!entry.second.handshaking);
+        }
+        loop.connections.clear();
     }
     
+    // Reads, handles and writes whatever is ready without blocking; false
+    // when the connection should be closed
+    bool service_connection(unsigned loop_index, uint64_t id, Connection& connection, bool& worked) {
+#ifdef SIMPLE_HTTP_OPENSSL
+        if (connection.handshaking) {
+            ERR_clear_error();
+            int result = SSL_do_handshake(connection.stream.tls.get());
+            if (result != 1) {
+                int error = SSL_get_error(connection.stream.tls.get(), result);
+                if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) {
+                    connection.stream.want_write = error == SSL_ERROR_WANT_WRITE;
+                    return true;
+                }
+                tls_failures_++;
+                ERR_clear_error();
+                return false;
+            }
+            connection.handshaking = false;
+            connection.stream.want_write = false;
+            finish_handshake(connection.stream);
+            worked = true;
+        }
+#endif
+        if (!flush(connection, worked)) return false;
+        if (connection.close_after_write) {
+            return connection.out_offset < connection.out.size() || !connection.slots.empty();
+        }
+        
+        char buffer[16384];
+        for (;;) {
+            auto bytes_read = connection.stream.read(buffer, sizeof(buffer));
+            if (bytes_read > 0) {
+                connection.in.append(buffer, static_cast<size_t>(bytes_read));
+                worked = true;
+                // A TLS record never fills the buffer, but more may be decrypted already
+                if (static_cast<size_t>(bytes_read) < sizeof(buffer) && !connection.stream.pending()) break;
+                continue;
+            }
+            if (bytes_read == 0) return false;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno != EINTR) return false;
+        }
+        
+        // Handle every complete request in the buffer (clients may pipeline)
+        while (!connection.close_after_write) {
+            size_t header_end = connection.in.find("\r\n\r\n");
+            if (header_end == std::string::npos) {
+                if (connection.in.size() > max_header_size_) return false;
+                break;
+            }
+            
+            auto request = parse_request(connection.in.substr(0, header_end + 2));
+            request.remote_address = connection.stream.peer;
+            Response response;
+            size_t content_length = content_length_of(request);
+            if (content_length > max_body_size_) {
+                response.status_code = 413;
+                response.text("Payload Too Large");
+                queue_response(connection, connection.next_sequence++, serialize_response(response, false));
+                connection.close_after_write = true;
+                break;
+            }
+            if (connection.in.size() - (header_end + 4) < content_length) {
+                break;
+            }
+            
+            request.body = connection.in.substr(header_end + 4, content_length);
+            connection.in.erase(0, header_end + 4 + content_length);
+            if (capture_) capture_->record(request, std::chrono::steady_clock::now());
+            
+            std::string connection_header = request.get_header("Connection");
+            bool keep_alive = request.version == "HTTP/1.0" ? connection_header == "keep-alive"
+                                                            : connection_header != "close";
+            Ticket ticket{loop_index, id, connection.next_sequence++};
+            if (dispatch_deferred(request, response, ticket)) {
+                connection.slots.push_back(ResponseSlot{ticket.sequence, false, keep_alive, std::string()});
+                loops_[loop_index]->deferred++;
+            } else {
+                queue_response(connection, ticket.sequence, serialize_response(response, keep_alive));
+            }
+            connection.close_after_write = !keep_alive;
+            worked = true;
+        }
+        
+        if (!flush(connection, worked)) return false;
+        return !connection.close_after_write || connection.out_offset < connection.out.size() ||
+               !connection.slots.empty();
+    }
+    
+    // Runs a deferred route if one matches; false if the request was not deferred
+    bool dispatch_deferred(Request& request, Response& response, const Ticket& ticket) {
+        auto method_it = deferred_routes_.find(request.method);
+        if (method_it == deferred_routes_.end()) {
+            dispatch(request, response);
+            return false;
+        }
+        auto path_it = method_it->second.find(request.path);
+        if (path_it == method_it->second.end()) {
+            dispatch(request, response);
+            return false;
+        }
+        try {
+            return path_it->second(request, response, ticket);
+        } catch (const std::exception& e) {
+            response = Response();
+            response.status_code = 500;
+            response.text("Internal Server Error: " + std::string(e.what()));
+            return false;
+        }
+    }
+    
+    // Appends a response, keeping request order behind any deferred ones
+    static void queue_response(Connection& connection, uint64_t sequence, std::string data) {
+        if (connection.slots.empty()) {
+            connection.out += data;
+        } else {
+            connection.slots.push_back(ResponseSlot{sequence, true, true, std::move(data)});
+        }
+    }
+    
+    static void release_ready(Connection& connection) {
+        while (!connection.slots.empty() && connection.slots.front().ready) {
+            connection.out += connection.slots.front().data;
+            connection.slots.pop_front();
+        }
+    }
+    
+    bool flush(Connection& connection, bool& worked) {
+        release_ready(connection);
+        while (connection.out_offset < connection.out.size()) {
+            auto sent = connection.stream.write(connection.out.data() + connection.out_offset,
+                                                connection.out.size() - connection.out_offset);
+            if (sent > 0) {
+                connection.out_offset += static_cast<size_t>(sent);
+                worked = true;
+                continue;
+            }
+            if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+            if (sent == -1 && errno == EINTR) continue;
+            return false;
+        }
+        connection.out.clear();
+        connection.out_offset = 0;
+        return true;
+    }
+#endif
+    
     int port_;
     std::atomic<bool> running_;
+    std::atomic<int> bound_port_{0};
+    std::mutex listener_mutex_;  // keeps stop() off a listener run() is closing
+    int listener_fd_ = -1;       // the blocking accept loop's listener
+    bool busy_poll_enabled_ = false;
+    BusyPollOptions busy_poll_;
+    size_t max_header_size_ = 64 * 1024;
+    size_t max_body_size_ = 16 * 1024 * 1024;
     std::unordered_map<std::string, std::unordered_map<std::string, Handler>> routes_;
+    std::unordered_map<std::string, std::unordered_map<std::string, DeferredHandler>> deferred_routes_;
+    LoopHook loop_hook_;
+#ifndef _WIN32
+    std::vector<std::unique_ptr<Loop>> loops_;
+#endif
+#ifdef SIMPLE_HTTP_OPENSSL
+    tls_detail::ContextPtr tls_context_;
+#endif
+    std::unique_ptr<CaptureWriter> capture_;
+    std::atomic<uint64_t> tls_handshakes_{0};
+    std::atomic<uint64_t> tls_resumed_{0};
+    std::atomic<uint64_t> tls_failures_{0};
+    std::atomic<uint64_t> tls_ktls_send_{0};
+    std::atomic<uint64_t> tls_ktls_recv_{0};
+};
+
+#ifndef _WIN32
+// Minimal blocking HTTP/1.1 client over one keep-alive connection, for load
+// generators and tests. Reconnects when the server closes the connection,
+// resuming the previous TLS session when it can.
+class Client {
+public:
+    Client(std::string host, int port) : host_(std::move(host)), port_(port) {}
+    
+    // HTTPS; throws when TLS support is not compiled in or the CA can't be loaded
+    Client(std::string host, int port, const ClientTlsOptions& tls) : Client(std::move(host), port) {
+#ifdef SIMPLE_HTTP_OPENSSL
+        tls_ = tls;
+        context_.reset(SSL_CTX_new(TLS_client_method()));
+        if (!context_) throw std::runtime_error("TLS: " + tls_detail::last_error());
+        SSL_CTX_set_min_proto_version(context_.get(), TLS1_2_VERSION);
+        if (tls.verify_peer) {
+            SSL_CTX_set_verify(context_.get(), SSL_VERIFY_PEER, nullptr);
+            bool loaded;
+            if (!tls.ca_pem.empty()) {
+                X509* ca = tls_detail::read_certificate(tls.ca_pem);
+                loaded = ca && X509_STORE_add_cert(SSL_CTX_get_cert_store(context_.get()), ca) == 1;
+                X509_free(ca);
+            } else if (!tls.ca_file.empty()) {
+                loaded = SSL_CTX_load_verify_locations(context_.get(), tls.ca_file.c_str(), nullptr) == 1;
+            } else {
+                loaded = SSL_CTX_set_default_verify_paths(context_.get()) == 1;
+            }
+            if (!loaded) throw std::runtime_error("TLS: cannot load CA: " + tls_detail::last_error());
+        }
+        if (tls.resume_sessions) {
+            // TLS 1.3 tickets arrive after the handshake; keep the newest
+            SSL_CTX_set_session_cache_mode(context_.get(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(context_.get(), [](SSL* ssl, SSL_SESSION* session) {
+                auto* client = static_cast<Client*>(SSL_get_app_data(ssl));
+                client->session_.reset(session);
+                return 1;  // keep the reference
+            });
+        }
+        tls_detail::ignore_sigpipe();
+#else
+        (void)tls;
+        throw std::runtime_error("TLS support is not compiled in (build with OpenSSL)");
+#endif
+    }
+    
+    ~Client() { disconnect(); }
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+    
+    // Sends one request and waits for the whole response; false on a
+    // connection or protocol error
+    bool request(const std::string& method, const std::string& path, const std::string& body, Response& response,
+                 const std::unordered_map<std::string, std::string>& headers = {}) {
+        std::ostringstream request_stream;
+        request_stream << method << " " << path << " HTTP/1.1\r\n";
+        request_stream << "Host: " << host_ << "\r\n";
+        for (const auto& header : headers) {
+            request_stream << header.first << ": " << header.second << "\r\n";
+        }
+        request_stream << "Content-Length: " << body.size() << "\r\n\r\n";
+        request_stream << body;
+        std::string wire = request_stream.str();
+        
+        // A kept-alive connection may have been closed by the server since the
+        // last request; retry once on a fresh one
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            bool fresh = stream_.fd == -1;
+            if (fresh && !connect_socket()) return false;
+            if (stream_.write_all(wire.data(), wire.size()) && read_response(response)) return true;
+            disconnect();
+            if (fresh) return false;
+        }
+        return false;
+    }
+    
+    void disconnect() {
+        stream_.close_socket();
+        buffer_.clear();
+    }
+    
+    // Whether the current (or last) TLS connection resumed an earlier session
+    bool session_resumed() const { return resumed_; }
+    
+private:
+    bool connect_socket() {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(host_.c_str(), std::to_string(port_).c_str(), &hints, &result) != 0) return false;
+        int fd = -1;
+        for (addrinfo* candidate = result; candidate && fd == -1; candidate = candidate->ai_next) {
+            fd = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+            if (fd == -1) continue;
+            if (connect(fd, candidate->ai_addr, candidate->ai_addrlen) == -1) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(result);
+        if (fd == -1) return false;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        stream_.fd = fd;
+        return start_tls();
+    }
+    
+    bool start_tls() {
+#ifdef SIMPLE_HTTP_OPENSSL
+        if (!context_) return true;
+        stream_.tls.reset(SSL_new(context_.get()));
+        SSL* ssl = stream_.tls.get();
+        const std::string& server_name = tls_.server_name.empty() ? host_ : tls_.server_name;
+        bool ok = ssl && SSL_set_fd(ssl, stream_.fd) == 1 && SSL_set_tlsext_host_name(ssl, server_name.c_str()) == 1;
+        if (ok && tls_.verify_peer) ok = SSL_set1_host(ssl, server_name.c_str()) == 1;
+        if (ok) {
+            SSL_set_app_data(ssl, this);
+            if (session_) SSL_set_session(ssl, session_.get());
+            ERR_clear_error();
+            ok = SSL_connect(ssl) == 1;
+        }
+        if (!ok) {
+            ERR_clear_error();
+            stream_.close_socket(false);
+            return false;
+        }
+        resumed_ = SSL_session_reused(ssl);
+#endif
+        return true;
+    }
+    
+    bool read_response(Response& response) {
+        response = Response();
+        size_t header_end;
+        while ((header_end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+            if (!receive_more()) return false;
+        }
+        
+        std::istringstream stream(buffer_.substr(0, header_end + 2));
+        std::string line;
+        std::string version;
+        if (!std::getline(stream, line)) return false;
+        std::istringstream status_line(line);
+        if (!(status_line >> version >> response.status_code)) return false;
+        while (std::getline(stream, line) && line != "\r" && !line.empty()) {
+            size_t colon_pos = line.find(':');
+            if (colon_pos == std::string::npos) continue;
+            std::string name = line.substr(0, colon_pos);
+            std::string value = line.substr(colon_pos + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            value.erase(value.find_last_not_of(" \t\r") + 1);
+            response.headers[name] = value;
+        }
+        
+        auto content_length_it = response.headers.find("Content-Length");
+        size_t content_length = content_length_it == response.headers.end()
+            ? 0 : static_cast<size_t>(std::strtoull(content_length_it->second.c_str(), nullptr, 10));
+        while (buffer_.size() - (header_end + 4) < content_length) {
+            if (!receive_more()) return false;
+        }
+        response.body = buffer_.substr(header_end + 4, content_length);
+        buffer_.erase(0, header_end + 4 + content_length);
+        
+        auto connection_it = response.headers.find("Connection");
+        if (connection_it != response.headers.end() && connection_it->second == "close") {
+            disconnect();
+        }
+        return true;
+    }
+    
+    bool receive_more() {
+        char chunk[16384];
+        for (;;) {
+            auto bytes_read = stream_.read(chunk, sizeof(chunk));
+            if (bytes_read > 0) {
+                buffer_.append(chunk, static_cast<size_t>(bytes_read));
+                return true;
+            }
+            if (bytes_read == -1 && errno == EINTR) continue;
+            return false;
+        }
+    }
+    
+    std::string host_;
+    int port_;
+    detail::Stream stream_;
+    std::string buffer_;
+    bool resumed_ = false;
+#ifdef SIMPLE_HTTP_OPENSSL
+    struct SessionDeleter {
+        void operator()(SSL_SESSION* session) const { SSL_SESSION_free(session); }
+    };
+    ClientTlsOptions tls_;
+    tls_detail::ContextPtr context_;
+    std::unique_ptr<SSL_SESSION, SessionDeleter> session_;
+#endif
 };
+#endif
 
 } // namespace simple_http
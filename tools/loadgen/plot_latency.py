@@ -3,10 +3,15 @@
 """
 Simple latency plotting script for load test results.
 Usage: python3 plot_latency.py <hey_output_file> [output_image]
+       python3 plot_latency.py --scaling <sweep.csv>... [-o output_image]
+
+--scaling plots CSVs written by scaling_sweep.py, one line per run, so runs
+before and after a change can be compared.
 """
 
 import sys
 import re
+import csv
 import matplotlib.pyplot as plt
 import numpy as np
 from datetime import datetime
@@ -107,10 +112,78 @@ def create_latency_plot(stats, output_file='latency_plot.png'):
     plt.savefig(output_file, dpi=300, bbox_inches='tight')
     print(f"Latency plot saved to: {output_file}")
 
+def parse_scaling_csv(filename):
+    """Read a scaling_sweep.py CSV into (label, rows sorted by core count)."""
+    with open(filename, newline='') as f:
+        rows = [{key: (value if key in ('label', 'mode', 'mix') else float(value)) for key, value in row.items()}
+                for row in csv.DictReader(f)]
+    if not rows:
+        raise ValueError(f"{filename}: no rows")
+    rows.sort(key=lambda row: row['cores'])
+    return rows[0]['label'], rows
+
+def create_scaling_plot(runs, output_file='scaling_plot.png'):
+    """Throughput, efficiency and latency against cores, one line per run."""
+    fig, ((ax1, ax2), (ax3, ax4)) = plt.subplots(2, 2, figsize=(12, 8))
+    max_cores = 1
+
+    for label, rows in runs:
+        cores = np.array([row['cores'] for row in rows])
+        max_cores = max(max_cores, cores.max())
+        line, = ax1.plot(cores, [row['rps'] for row in rows], 'o-', linewidth=2, label=label)
+        # Linear scaling from this run's single-core throughput
+        ax1.plot(cores, rows[0]['rps'] * cores / rows[0]['cores'], '--', color=line.get_color(), alpha=0.4)
+        ax2.plot(cores, [100 * row['efficiency'] for row in rows], 'o-', linewidth=2, label=label)
+        ax3.plot(cores, [row['p50_us'] for row in rows], 'o-', color=line.get_color(), label=f'{label} p50')
+        ax3.plot(cores, [row['p99_us'] for row in rows], 's--', color=line.get_color(), label=f'{label} p99')
+        ax4.plot(cores, [row['cpu_us_per_request'] for row in rows], 'o-', linewidth=2, label=label)
+
+    for ax, ylabel, title in ((ax1, 'Requests/sec', 'Throughput (dashed: linear)'),
+                              (ax2, 'Efficiency (%)', 'Scaling efficiency'),
+                              (ax3, 'Latency (us)', 'Latency at saturation'),
+                              (ax4, 'CPU us / request', 'Server CPU per request')):
+        ax.set_xlabel('Cores')
+        ax.set_ylabel(ylabel)
+        ax.set_title(title)
+        ax.set_xscale('log', base=2)
+        ax.set_xticks(sorted({c for c in [1, 2, 4, 8, 16, 32, 64, 128] if c <= max_cores} | {max_cores}))
+        ax.get_xaxis().set_major_formatter(plt.ScalarFormatter())
+        ax.grid(True, alpha=0.3)
+        ax.legend(fontsize=8)
+    ax2.set_ylim(0, 110)
+    ax3.set_yscale('log')
+
+    plt.tight_layout()
+    plt.savefig(output_file, dpi=150, bbox_inches='tight')
+    print(f"Scaling plot saved to: {output_file}")
+
+def scaling_main(args):
+    output_file = 'scaling_plot.png'
+    if '-o' in args:
+        i = args.index('-o')
+        if i + 1 >= len(args):
+            print("Error: -o needs a file name")
+            sys.exit(1)
+        output_file = args[i + 1]
+        args = args[:i] + args[i + 2:]
+    if not args:
+        print("Usage: python3 plot_latency.py --scaling <sweep.csv>... [-o output_image]")
+        sys.exit(1)
+    try:
+        create_scaling_plot([parse_scaling_csv(f) for f in args], output_file)
+    except Exception as e:
+        print(f"Error: {e}")
+        sys.exit(1)
+
 def main():
     if len(sys.argv) < 2:
         print("Usage: python3 plot_latency.py <hey_output_file> [output_image]")
+        print("       python3 plot_latency.py --scaling <sweep.csv>... [-o output_image]")
         sys.exit(1)
+
+    if sys.argv[1] == '--scaling':
+        scaling_main(sys.argv[2:])
+        return
     
     input_file = sys.argv[1]
     output_file = sys.argv[2] if len(sys.argv) > 2 else 'latency_plot.png'
@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+
+"""
+Multi-core scaling sweep for POST /fuse.
+
+Starts build/cpp-service once per core count (1, 2, 4 ... N, plus N itself),
+confined to that many cores with taskset and running that many busy-poll
+loops (or the blocking server, --mode blocking). Each run drives it to
+saturation with benchmarks/http_loadgen over a fixed payload mix. The load
+generator gets the cores the server was not given, when there are any.
+
+For each count it records throughput, p50/p99, server CPU utilisation (of
+the cores it was given) and CPU time per request. It prints a
+scaling-efficiency table and writes it as CSV, then plots it with
+plot_latency.py --scaling. Pass several CSVs to that to compare runs, e.g.
+before and after a concurrency change to simple_http or Metrics:
+
+    python3 tools/loadgen/scaling_sweep.py --label before
+    (change, rebuild)
+    python3 tools/loadgen/scaling_sweep.py --label after
+    python3 tools/loadgen/plot_latency.py --scaling scaling_before.csv scaling_after.csv
+
+Efficiency is throughput / (cores x single-core throughput). A busy-poll loop
+spins on its core while idle, so under --mode busy-poll utilisation reads near
+100% whatever the load; CPU per request is the figure to compare there.
+
+Usage: python3 scaling_sweep.py [--build DIR] [--max-cores N] [--mode busy-poll|blocking]
+                                [--requests N] [--connections N] [--mix 8:70,64:25,1024:5]
+                                [--label NAME] [--out-dir DIR] [--no-plot]
+"""
+
+import argparse
+import csv
+import os
+import re
+import shutil
+import socket
+import subprocess
+import sys
+import time
+import urllib.request
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.normpath(os.path.join(HERE, '..', '..'))
+CLOCK_TICKS = os.sysconf('SC_CLK_TCK')
+
+FIELDS = ['label', 'mode', 'cores', 'connections', 'mix', 'requests', 'rps', 'p50_us', 'p99_us', 'p999_us',
+          'cpu_utilization', 'cpu_us_per_request', 'speedup', 'efficiency']
+
+
+def core_counts(maximum):
+    counts = []
+    count = 1
+    while count < maximum:
+        counts.append(count)
+        count *= 2
+    counts.append(maximum)
+    return counts
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(('127.0.0.1', 0))
+        return s.getsockname()[1]
+
+
+def cpu_seconds(pid):
+    """User plus system time of a process and all its threads."""
+    with open('/proc/%d/stat' % pid) as f:
+        fields = f.read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / CLOCK_TICKS
+
+
+def wait_healthy(port, process, timeout=10.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if process.poll() is not None:
+            raise RuntimeError('cpp-service exited with status %d' % process.returncode)
+        try:
+            with urllib.request.urlopen('http://127.0.0.1:%d/health' % port, timeout=1) as response:
+                if response.status == 200:
+                    return
+        except OSError:
+            time.sleep(0.05)
+    raise RuntimeError('cpp-service did not become healthy on port %d' % port)
+
+
+def pinned(command, cores):
+    """`command` confined to `cores` when taskset is available."""
+    if not cores or not shutil.which('taskset'):
+        return command
+    return ['taskset', '-c', ','.join(str(c) for c in cores)] + command
+
+
+def run_one(args, cores, available):
+    server_cores = available[:cores]
+    client_cores = available[cores:]
+    port = free_port()
+    command = [os.path.join(args.build, 'cpp-service'), '--port', str(port)]
+    if args.mode == 'busy-poll':
+        command += ['--busy-poll', str(cores)]
+    server = subprocess.Popen(pinned(command, server_cores), stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        wait_healthy(port, server)
+        loadgen = [os.path.join(args.build, 'benchmarks', 'http_loadgen'), '--target', '127.0.0.1:%d' % port,
+                   str(args.requests), str(args.connections), args.mix]
+        cpu_before = cpu_seconds(server.pid)
+        started = time.time()
+        output = subprocess.run(pinned(loadgen, client_cores), check=True, capture_output=True, text=True).stdout
+        wall = time.time() - started
+        cpu = cpu_seconds(server.pid) - cpu_before
+    finally:
+        server.terminate()
+        try:
+            server.wait(timeout=5)
+        except subprocess.TimeoutExpired:
+            server.kill()
+            server.wait()
+
+    summary = re.search(r'^summary (.*)$', output, re.MULTILINE)
+    if not summary:
+        raise RuntimeError('no summary line from http_loadgen:\n' + output)
+    result = {key: float(value) for key, value in (item.split('=') for item in summary.group(1).split())}
+    return {
+        'label': args.label,
+        'mode': args.mode,
+        'cores': cores,
+        'connections': args.connections,
+        'mix': args.mix,
+        'requests': int(result['requests']),
+        'rps': result['rps'],
+        'p50_us': result['p50_us'],
+        'p99_us': result['p99_us'],
+        'p999_us': result['p999_us'],
+        # Over the whole load generator run, warm-up included
+        'cpu_utilization': cpu / (wall * cores),
+        'cpu_us_per_request': cpu * 1e6 / result['requests'],
+    }
+
+
+def git_label():
+    try:
+        return subprocess.run(['git', '-C', ROOT, 'describe', '--always', '--dirty'], check=True,
+                              capture_output=True, text=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return 'run'
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Multi-core scaling sweep for POST /fuse')
+    parser.add_argument('--build', default=os.path.join(ROOT, 'build'), help='CMake build directory')
+    parser.add_argument('--max-cores', type=int, default=len(os.sched_getaffinity(0)))
+    parser.add_argument('--mode', choices=['busy-poll', 'blocking'], default='busy-poll')
+    parser.add_argument('--requests', type=int, default=50000, help='per core count')
+    parser.add_argument('--connections', type=int, default=64, help='enough to keep every core busy')
+    parser.add_argument('--mix', default='8:70,64:25,1024:5', help='readings:weight,... per request')
+    parser.add_argument('--label', default=None, help='names the run in the CSV and plot (default: git describe)')
+    parser.add_argument('--out-dir', default='.')
+    parser.add_argument('--no-plot', action='store_true')
+    args = parser.parse_args()
+    args.label = args.label or git_label()
+
+    available = sorted(os.sched_getaffinity(0))
+    if args.max_cores > len(available):
+        print('only %d cores available; sweeping up to %d' % (len(available), len(available)), file=sys.stderr)
+        args.max_cores = len(available)
+    if args.max_cores == len(available) and len(available) > 1:
+        print('note: at %d cores the load generator shares the server\'s cores' % args.max_cores, file=sys.stderr)
+
+    rows = []
+    for cores in core_counts(args.max_cores):
+        print('%d core(s)...' % cores, file=sys.stderr)
+        row = run_one(args, cores, available)
+        baseline = rows[0]['rps'] if rows else row['rps']
+        row['speedup'] = row['rps'] / baseline
+        row['efficiency'] = row['speedup'] / cores
+        rows.append(row)
+
+    print('\n/fuse scaling, %s, %s, %d connections, mix %s' % (args.label, args.mode, args.connections, args.mix))
+    print('  %5s %12s %8s %10s %10s %8s %12s %10s' % ('cores', 'req/s', 'speedup', 'efficiency', 'p50 us',
+                                                     'p99 us', 'CPU util', 'CPU us/req'))
+    for row in rows:
+        print('  %5d %12.0f %7.2fx %9.0f%% %10.1f %8.1f %11.0f%% %10.1f' % (
+            row['cores'], row['rps'], row['speedup'], 100 * row['efficiency'], row['p50_us'], row['p99_us'],
+            100 * row['cpu_utilization'], row['cpu_us_per_request']))
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    csv_path = os.path.join(args.out_dir, 'scaling_%s.csv' % re.sub(r'[^A-Za-z0-9_.-]', '_', args.label))
+    with open(csv_path, 'w', newline='') as f:
+        writer = csv.DictWriter(f, fieldnames=FIELDS)
+        writer.writeheader()
+        for row in rows:
+            writer.writerow({key: (round(value, 4) if isinstance(value, float) else value)
+                             for key, value in row.items()})
+    print('\nCSV written to: %s' % csv_path)
+
+    if not args.no_plot:
+        plot = [sys.executable, os.path.join(HERE, 'plot_latency.py'), '--scaling', csv_path,
+                '-o', csv_path[:-len('.csv')] + '.png']
+        if subprocess.run(plot).returncode != 0:
+            print('plotting failed (is matplotlib installed?); the CSV is complete', file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
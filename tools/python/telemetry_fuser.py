@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+
+"""
+ctypes binding for libtelemetry_fuser.so, the C ABI in include/telemetry_fuser.h.
+
+Fuses readings in-process, without the HTTP round trip:
+
+    from telemetry_fuser import Fuser
+    fuser = Fuser()                      # finds the library, see find_library()
+    fuser.fuse([12.1, 11.9, 12.0, 55.0]) # -> {'value': 12.05, ...}
+    fuser.fuse_batch([[1, 2, 3], [10, 20]])
+
+Readings may be any sequence of numbers; an array.array('d') or a contiguous
+float64 numpy array is passed to the library without copying. One Fuser may
+be shared by threads (ctypes releases the GIL during each call); the
+workspace it holds is per thread.
+
+Usage: python3 telemetry_fuser.py [path/to/libtelemetry_fuser.so]
+"""
+
+import array
+import ctypes
+import os
+import sys
+import threading
+
+TF_OK = 0
+_STATUS = {1: ValueError, 2: BufferError, 3: MemoryError, 4: RuntimeError}
+
+ALGORITHMS = ['median', 'trimmed_mean', 'winsorized_mean', 'huber', 'weighted', 'sketch', 'auto']
+
+
+class _Options(ctypes.Structure):
+    _fields_ = [
+        ('struct_size', ctypes.c_uint32),
+        ('algorithm', ctypes.c_int32),
+        ('tolerance', ctypes.c_double),
+        ('interval', ctypes.c_int32),
+        ('interval_level', ctypes.c_double),
+        ('deadline_ms', ctypes.c_double),
+        ('max_resamples', ctypes.c_uint32),
+        ('parallel', ctypes.c_int32),
+    ]
+
+
+class _Result(ctypes.Structure):
+    _fields_ = [
+        ('value', ctypes.c_double),
+        ('confidence', ctypes.c_double),
+        ('algorithm', ctypes.c_int32),
+        ('has_interval', ctypes.c_int32),
+        ('interval_low', ctypes.c_double),
+        ('interval_high', ctypes.c_double),
+        ('resamples', ctypes.c_uint32),
+    ]
+
+
+_double_p = ctypes.POINTER(ctypes.c_double)
+
+
+def find_library():
+    """$TELEMETRY_FUSER_LIB, then the repository's build directories."""
+    if os.environ.get('TELEMETRY_FUSER_LIB'):
+        return os.environ['TELEMETRY_FUSER_LIB']
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..')
+    for build in ('build', '_gate_build', 'cmake-build-release'):
+        candidate = os.path.join(root, build, 'libtelemetry_fuser.so')
+        if os.path.exists(candidate):
+            return candidate
+    return 'libtelemetry_fuser.so.1'
+
+
+def _load(path):
+    lib = ctypes.CDLL(path)
+    lib.tf_abi_version.restype = ctypes.c_uint32
+    lib.tf_last_error.restype = ctypes.c_char_p
+    lib.tf_algorithm_name.restype = ctypes.c_char_p
+    lib.tf_algorithm_name.argtypes = [ctypes.c_int32]
+    lib.tf_options_init.argtypes = [ctypes.POINTER(_Options)]
+    lib.tf_service_create.restype = ctypes.c_void_p
+    lib.tf_service_destroy.argtypes = [ctypes.c_void_p]
+    lib.tf_service_configure.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.tf_service_config.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t,
+                                      ctypes.POINTER(ctypes.c_size_t)]
+    lib.tf_workspace_create.restype = ctypes.c_void_p
+    lib.tf_workspace_destroy.argtypes = [ctypes.c_void_p]
+    lib.tf_fuse.argtypes = [ctypes.c_void_p, ctypes.c_void_p, _double_p, ctypes.c_size_t, _double_p,
+                            ctypes.POINTER(_Options), ctypes.POINTER(_Result)]
+    lib.tf_fuse_batch.argtypes = [ctypes.c_void_p, ctypes.c_void_p, _double_p,
+                                  ctypes.POINTER(ctypes.c_size_t), ctypes.c_size_t, _double_p,
+                                  ctypes.POINTER(_Options), _double_p, ctypes.c_size_t]
+    if lib.tf_abi_version() != 1:
+        raise OSError('%s: unsupported ABI version %d' % (path, lib.tf_abi_version()))
+    return lib
+
+
+def _doubles(values):
+    """(pointer, length, keepalive) for `values`, without copying when possible."""
+    if values is None:
+        return None, 0, None
+    if isinstance(values, array.array) and values.typecode == 'd':
+        buffer = values
+    elif hasattr(values, 'ctypes') and getattr(values, 'dtype', None) is not None \
+            and values.dtype.str == '<f8' and values.flags['C_CONTIGUOUS']:
+        return values.ctypes.data_as(_double_p), len(values), values
+    else:
+        buffer = array.array('d', values)
+    address, length = buffer.buffer_info()
+    return ctypes.cast(address, _double_p), length, buffer
+
+
+class Fuser:
+    def __init__(self, library=None, config=None):
+        self._lib = _load(library or find_library())
+        self._service = self._lib.tf_service_create()
+        if not self._service:
+            raise MemoryError('tf_service_create failed')
+        self._local = threading.local()
+        self._workspaces = []
+        self._workspaces_lock = threading.Lock()
+        if config is not None:
+            self.configure(config)
+
+    def close(self):
+        if self._service:
+            for workspace in self._workspaces:
+                self._lib.tf_workspace_destroy(workspace)
+            self._workspaces = []
+            self._lib.tf_service_destroy(self._service)
+            self._service = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def _check(self, status):
+        if status != TF_OK:
+            raise _STATUS.get(status, RuntimeError)(self._lib.tf_last_error().decode())
+
+    def _workspace(self):
+        workspace = getattr(self._local, 'workspace', None)
+        if workspace is None:
+            workspace = self._lib.tf_workspace_create()
+            if not workspace:
+                raise MemoryError('tf_workspace_create failed')
+            with self._workspaces_lock:
+                self._workspaces.append(workspace)
+            self._local.workspace = workspace
+        return workspace
+
+    def _options(self, algorithm, interval, tolerance):
+        options = _Options()
+        self._lib.tf_options_init(ctypes.byref(options))
+        if algorithm is not None:
+            options.algorithm = ALGORITHMS.index('auto' if algorithm == 'automatic' else algorithm)
+        options.interval = 1 if interval else 0
+        if tolerance is not None:
+            options.tolerance = tolerance
+        return options
+
+    def configure(self, config_json):
+        """Applies a POST /config document."""
+        self._check(self._lib.tf_service_configure(self._service, config_json.encode()))
+
+    def config(self):
+        required = ctypes.c_size_t(0)
+        self._lib.tf_service_config(self._service, None, 0, ctypes.byref(required))
+        buffer = ctypes.create_string_buffer(required.value)
+        self._check(self._lib.tf_service_config(self._service, buffer, required.value, None))
+        return buffer.value.decode()
+
+    def fuse(self, readings, weights=None, algorithm=None, interval=False, tolerance=None):
+        """Fuses one series; returns the fields of a POST /fuse response."""
+        readings_p, count, keep_readings = _doubles(readings)
+        weights_p, weight_count, keep_weights = _doubles(weights)
+        if weights is not None and weight_count != count:
+            raise ValueError('weights must have one entry per reading')
+        options = self._options(algorithm, interval, tolerance)
+        result = _Result()
+        self._check(self._lib.tf_fuse(self._service, self._workspace(), readings_p, count, weights_p,
+                                      ctypes.byref(options), ctypes.byref(result)))
+        fused = {
+            'value': result.value,
+            'confidence': result.confidence,
+            'algorithm': self._lib.tf_algorithm_name(result.algorithm).decode(),
+        }
+        if result.has_interval:
+            fused['interval'] = (result.interval_low, result.interval_high)
+            fused['resamples'] = result.resamples
+        return fused
+
+    def fuse_batch(self, batches, algorithm=None):
+        """Fuses each series in `batches`; returns the fused values."""
+        flat = array.array('d')
+        offsets = (ctypes.c_size_t * (len(batches) + 1))()
+        for i, batch in enumerate(batches):
+            flat.extend(batch)
+            offsets[i + 1] = len(flat)
+        readings_p, _, _ = _doubles(flat)
+        values = (ctypes.c_double * len(batches))()
+        options = self._options(algorithm, False, None)
+        self._check(self._lib.tf_fuse_batch(self._service, self._workspace(), readings_p, offsets, len(batches),
+                                            None, ctypes.byref(options), values, len(batches)))
+        return list(values)
+
+
+def main():
+    with Fuser(sys.argv[1] if len(sys.argv) > 1 else None) as fuser:
+        readings = [12.1, 11.9, 12.0, 12.2, 55.0]
+        print('fuse %s -> %s' % (readings, fuser.fuse(readings)))
+        print('huber with interval -> %s' % fuser.fuse(readings, algorithm='huber', interval=True))
+        print('weighted -> %s' % fuser.fuse(readings, weights=[1, 1, 1, 1, 0.01], algorithm='weighted'))
+        print('batch -> %s' % fuser.fuse_batch([[1, 2, 3], [10, 20], [5, 6, 7, 8]]))
+        try:
+            fuser.fuse([1.0, float('nan')])
+        except ValueError as error:
+            print('rejected: %s' % error)
+        fuser.configure('{"invalid_readings": "drop"}')
+        print('with invalid_readings=drop -> %s' % fuser.fuse([1.0, float('nan'), 3.0]))
+
+
+if __name__ == '__main__':
+    main()